@@ -1,4 +1,5 @@
 #pragma once
+#include "common/runtime/Hash.hpp"
 #include "common/runtime/Types.hpp"
 #include "vectorwise/Operators.hpp"
 
@@ -8,6 +9,29 @@ struct ExperimentConfig{
   bool useSimdHash = false;
   bool useSimdSel = false;
   bool useSimdProj = false;
+  /// hyper queries select the tuples of their scans with SIMD predicates
+  /// before processing the matches, see hyper/Selection.hpp
+  bool useSimdScan = false;
+  /// hash function used by the hyper queries
+  runtime::HashFunction hashHyper = runtime::HashFunction::CRC32;
+  /// default hash function of the vectorwise hash primitives
+  runtime::HashFunction hashVectorwise = runtime::HashFunction::MurMur;
+  /// Q3 and Q18 return only the first 10 and 100 rows of their ORDER BY
+  bool topN = false;
+  /// Q3 and Q18 join orders and lineitem with MergeJoin instead of Hashjoin
+  bool mergeJoin = false;
+  /// Q6 selects with bitmaps and aggregates with the representation which
+  /// is cheapest for the density of each vector
+  bool bitmapSelection = false;
+  /// vectorwise hash joins pick their implementation per join instance and
+  /// probe vector, see Hashjoin::joinAdaptive
+  bool adaptiveJoin = false;
+  /// Q3 and Q18 probe their hash tables in prefetched batches of a
+  /// hyper::ProbeStage instead of one tuple at a time
+  bool relaxedFusion = false;
+  /// SSB Q3.1 leaves the nations of customer and supplier in the hash table
+  /// entries and fetches them after the date join has discarded its tuples
+  bool lateMaterialization = false;
   vectorwise::primitives::F2 hash_int32_t_col();
   vectorwise::primitives::F3 hash_sel_int32_t_col();
   vectorwise::primitives::F2 rehash_int32_t_col();
@@ -242,7 +242,11 @@ struct Q31Builder : public vectorwise::QueryBuilder {
       c_nation,
       s_nation,
       sum_revenue,
-      d_year
+      d_year,
+      customer_entries,
+      supplier_entries,
+      c_nation_fetched,
+      s_nation_fetched
    };
    struct Q31 {
       types::Char<12> region = types::Char<12>::castString("ASIA");
@@ -26,7 +26,9 @@ struct Q1Builder : public Query, private vectorwise::QueryBuilder {
       sum_base_price,
       sum_disc_price,
       sum_charge,
-      count_order
+      count_order,
+      packed,
+      grouped_packed
    };
    struct Q1 {
       types::Numeric<12, 2> one = types::Numeric<12, 2>::castString("1.00");
@@ -52,7 +54,8 @@ struct Q1Builder : public Query, private vectorwise::QueryBuilder {
     // duplicate sets for register pressure experiment (20 accumulators total)
     sum_qty_2, sum_base_price_2, sum_disc_price_2, sum_charge_2, count_order_2,
     sum_qty_3, sum_base_price_3, sum_disc_price_3, sum_charge_3, count_order_3,
-    sum_qty_4, sum_base_price_4, sum_disc_price_4, sum_charge_4, count_order_4
+    sum_qty_4, sum_base_price_4, sum_disc_price_4, sum_charge_4, count_order_4,
+    packed, grouped_packed
   };
   struct Q1 {
     types::Numeric<12, 2> one = types::Numeric<12, 2>::castString("1.00");
@@ -89,7 +92,11 @@ struct Q3Builder : private vectorwise::QueryBuilder {
       l_orderkey,
       o_orderdate,
       o_shippriority,
-      result_proj_minus
+      result_proj_minus,
+      top_revenue,
+      top_shippriority,
+      top_orderdate,
+      top_orderkey
    };
    struct Q3 {
       std::string building = "BUILDING";
@@ -214,10 +221,12 @@ struct Q9Builder : public Query, private vectorwise::QueryBuilder {
       result_proj_minus,
       amount,
       o_year,
-      sum_profit
+      sum_profit,
+      ps_key,
+      l_key
    };
    struct Q9 {
-      types::Varchar<55> contains = types::Varchar<55>::castString("green");
+      types::LikePattern green{"%green%"};
       types::Numeric<12, 2> one = types::Numeric<12, 2>::castString("1.00");
       std::unique_ptr<vectorwise::Operator> rootOp;
    };
@@ -256,7 +265,13 @@ struct Q18Builder : public Query, private vectorwise::QueryBuilder {
       group_sum,
       lineitem_matches_grouped,
       compact_quantity,
-      compact_l_orderkey
+      compact_l_orderkey,
+      top_c_name,
+      top_o_custkey,
+      top_l_orderkey,
+      top_o_orderdate,
+      top_o_totalprice,
+      top_sum
    };
    struct Q18 {
       uint64_t zero = 0;
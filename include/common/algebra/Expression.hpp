@@ -0,0 +1,57 @@
+#pragma once
+#include "common/algebra/Types.hpp"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+namespace algebra {
+
+class Expression
+/// Scalar expression over the attributes of an operator's input
+{
+ public:
+   virtual ~Expression() = default;
+   /// add the attributes the expression reads to attributes
+   virtual void used(std::unordered_set<std::string>& attributes) const = 0;
+   virtual void print(std::ostream& s) const = 0;
+};
+
+class AttributeRef : public Expression {
+ public:
+   /// qualified name, e.g. "lineitem.l_discount"
+   std::string name;
+   AttributeRef(std::string name);
+   void used(std::unordered_set<std::string>& attributes) const override;
+   void print(std::ostream& s) const override;
+};
+
+class Constant : public Expression {
+ public:
+   /// literal as read by castString of the type, e.g. "1995-03-15"
+   std::string value;
+   std::unique_ptr<Type> type;
+   Constant(std::string value, std::unique_ptr<Type> type);
+   void used(std::unordered_set<std::string>&) const override {}
+   void print(std::ostream& s) const override;
+};
+
+class BinaryExpression : public Expression {
+ public:
+   /// one of + - * / == != < <= > >= && ||
+   std::string op;
+   std::unique_ptr<Expression> left;
+   std::unique_ptr<Expression> right;
+   BinaryExpression(std::string op, std::unique_ptr<Expression> l,
+                    std::unique_ptr<Expression> r);
+   void used(std::unordered_set<std::string>& attributes) const override;
+   void print(std::ostream& s) const override;
+};
+
+std::unique_ptr<Expression> attr(std::string name);
+std::unique_ptr<Expression> constant(std::string value,
+                                     std::unique_ptr<Type> type);
+std::unique_ptr<Expression> binary(std::string op,
+                                   std::unique_ptr<Expression> l,
+                                   std::unique_ptr<Expression> r);
+} // namespace algebra
@@ -1,6 +1,9 @@
 #pragma once
 #include <string>
 #include <memory>
+#include <unordered_set>
+#include <vector>
+#include "common/algebra/Expression.hpp"
 #include "common/runtime/Database.hpp"
 
 
@@ -11,7 +14,9 @@ namespace algebra {
       const std::string name;
       Operator(std::string name);
       virtual void print(std::ostream& s) const;
-      Operator* parent;
+      Operator* parent = nullptr;
+      /// add the attributes this operator reads from its input
+      virtual void used(std::unordered_set<std::string>&) const {}
       virtual ~Operator() = default;
    };
 
@@ -33,21 +38,60 @@ namespace algebra {
    class Scan : public Operator{
    public:
       runtime::Relation& rel;
+      /// attributes are named "<alias>.<attribute>"
+      std::string alias;
       Scan(runtime::Relation& r);
+      Scan(runtime::Relation& r, std::string alias);
+      void print(std::ostream& s)const override;
+   };
+   class Select : public UnaryOperator{
+   public:
+      std::unique_ptr<Expression> predicate;
+      Select(std::unique_ptr<Operator> c, std::unique_ptr<Expression> p);
+      void used(std::unordered_set<std::string>& attributes) const override;
    };
    class Map : public UnaryOperator{
    public:
-      Map(std::unique_ptr<Operator> c);
+      /// name of the computed attribute
+      std::string attribute;
+      std::unique_ptr<Expression> expression;
+      Map(std::unique_ptr<Operator> c, std::string attribute,
+          std::unique_ptr<Expression> e);
+      void used(std::unordered_set<std::string>& attributes) const override;
    };
    struct Print : public UnaryOperator{
      // fully qualified attributes, e.g. "relname.attr"
      std::vector<std::string> attributes;
      Print(std::unique_ptr<Operator> c, std::vector<std::string>&& attributes);
+     void used(std::unordered_set<std::string>& attributes) const override;
    };
    class HashJoin : public BinaryOperator{
    public:
+      /// equal keys of build and probe side, pairwise
+      std::vector<std::string> buildKeys;
+      std::vector<std::string> probeKeys;
       HashJoin(std::unique_ptr<Operator>&& build, std::unique_ptr<Operator>&& probe);
+      HashJoin(std::unique_ptr<Operator>&& build,
+               std::unique_ptr<Operator>&& probe,
+               std::vector<std::string> buildKeys,
+               std::vector<std::string> probeKeys);
       void print(std::ostream& s)const override;
+      void used(std::unordered_set<std::string>& attributes) const override;
+   };
+   class GroupBy : public UnaryOperator{
+   public:
+      struct Aggregate {
+         enum Kind { Sum, Count } kind;
+         /// name of the result attribute
+         std::string name;
+         /// summed expression, nullptr for Count
+         std::unique_ptr<Expression> input;
+      };
+      std::vector<std::string> keys;
+      std::vector<Aggregate> aggregates;
+      GroupBy(std::unique_ptr<Operator> c, std::vector<std::string> keys,
+              std::vector<Aggregate> aggregates);
+      void used(std::unordered_set<std::string>& attributes) const override;
    };
 
 }
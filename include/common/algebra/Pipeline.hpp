@@ -8,10 +8,17 @@ namespace algebra{
    public:
       std::unique_ptr<Operator> root;
    public:
-      Pipeline& map();
+      Pipeline& map(std::string attribute, std::unique_ptr<Expression> e);
       Pipeline& scan(runtime::Relation& r);
+      Pipeline& scan(runtime::Relation& r, std::string alias);
+      Pipeline& select(std::unique_ptr<Expression> predicate);
       Pipeline& print(std::vector<std::string> attrs);
       Pipeline& hashjoin(Pipeline& materialized);
+      Pipeline& hashjoin(Pipeline& materialized,
+                         std::vector<std::string> buildKeys,
+                         std::vector<std::string> probeKeys);
+      Pipeline& groupby(std::vector<std::string> keys,
+                        std::vector<GroupBy::Aggregate> aggregates);
       void print(std::ostream& s) const;
    };
 }
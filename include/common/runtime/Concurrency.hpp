@@ -3,6 +3,7 @@
 #include "common/Compat.hpp"
 #include "common/runtime/Barrier.hpp"
 #include "common/runtime/MemoryPool.hpp"
+#include "common/runtime/Topology.hpp"
 #include "tbb/task_group.h"
 #include <deque>
 #include <fstream>
@@ -10,83 +11,64 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <pthread.h>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace runtime {
 
 class Worker;
 class WorkerGroup;
 
-// -------------------------------------------------------------------------
-// NUMA topology constants (compile-time; must match the hardware this binary
-// is built for).  These drive both the scheduling policies below and the
-// regionOf() helper used for per-NUMA work distribution.
-// -------------------------------------------------------------------------
-static constexpr size_t SOCKETS_COUNT    = 4;
-static constexpr size_t CORES_PER_SOCKET = 22;
-static constexpr size_t SMT_PER_CORE     = 2;
-static constexpr size_t NUM_NUMA_REGIONS = SOCKETS_COUNT; // one region per socket
-
-// regionOf(thread_id) — single source of truth for thread → NUMA region mapping.
-//
-// Under NUMA_BANDWIDTH (fan-out schedule): threads are interleaved across
-// sockets, so thread t lands on socket t % SOCKETS_COUNT.
-//
-// Under NUMA_POOLS (consolidated schedule): threads are packed per socket,
-// so the first CORES_PER_SOCKET*SMT_PER_CORE threads are on socket 0, etc.
-//
-// Memory-order note: this is a pure arithmetic mapping; no atomics involved.
-#if defined(NUMA_BANDWIDTH)
-inline size_t regionOf(size_t thread_id) {
-    return thread_id % SOCKETS_COUNT;
-}
-#elif defined(NUMA_POOLS)
-inline size_t regionOf(size_t thread_id) {
-    return thread_id / (CORES_PER_SOCKET * SMT_PER_CORE);
-}
-#else
+#if !defined(NUMA_BANDWIDTH) && !defined(NUMA_POOLS)
 #error "Neither NUMA_BANDWIDTH nor NUMA_POOLS is defined. \
  Exactly one must be set at compile time."
 #endif
 
-extern thread_local Worker* this_worker;
-#ifdef NUMA_POOLS
-constexpr size_t MAX_NUMA_NODES = 4;
-extern GlobalPool numaPools[MAX_NUMA_NODES];
-extern size_t activeNumaNodes;
-
-// NUMA utility functions - declared before Worker class
-inline size_t detectNumaNodes() {
-#ifdef __linux__
-    // Read from /sys/devices/system/node to detect NUMA nodes
-    size_t nodeCount = 0;
-    for (size_t i = 0; i < MAX_NUMA_NODES; ++i) {
-        std::string path = "/sys/devices/system/node/node" + std::to_string(i);
-        std::ifstream nodeCheck(path);
-        if (nodeCheck.good()) {
-            nodeCount = i + 1;
-        }
-    }
-    return nodeCount > 0 ? nodeCount : 1;
+/// Indexes into Topology::machine().cpus of the workers of a group, in the
+/// order of their worker_id. With NEW_POLICY the schedule fans out over the
+/// NUMA regions (NUMA_BANDWIDTH) or consolidates per region (NUMA_LATENCY),
+/// otherwise workers take the allowed CPUs by id.
+inline const std::vector<size_t>& workerSchedule() {
+#if defined(NEW_POLICY) && defined(NUMA_LATENCY)
+   static const auto schedule = Topology::machine().consolidatedSchedule();
+#elif defined(NEW_POLICY)
+   static const auto schedule = Topology::machine().fanOutSchedule();
 #else
-    return 1; // Non-Linux systems default to single node
+   static const auto schedule = [] {
+      std::vector<size_t> s(Topology::machine().cpus.size());
+      for (size_t i = 0; i < s.size(); ++i) s[i] = i;
+      return s;
+   }();
 #endif
+   return schedule;
 }
 
-inline size_t cpuToNumaNode(size_t cpu, size_t socketsCount, size_t coresPerSocket) {
-    // For typical Intel/AMD systems: NUMA node corresponds to socket
-    // Physical layout: cpu = socket * coresPerSocket * smtPerCore + ...
-    return cpu / (coresPerSocket * 2); // Assuming 2-way SMT
+/// CPU of worker w of a group, groups larger than the machine wrap around
+inline const Topology::Cpu& cpuOf(size_t w) {
+   auto& schedule = workerSchedule();
+   return Topology::machine().cpus[schedule[w % schedule.size()]];
 }
 
-inline GlobalPool* getNumaPool(size_t numaNode) {
-    if (numaNode >= activeNumaNodes) {
-        numaNode = 0; // Fallback to node 0 if invalid
+/// NUMA region of worker w, the single source of truth for per region work
+/// distribution
+inline size_t regionOf(size_t w) { return cpuOf(w).region; }
+
+extern thread_local Worker* this_worker;
+#ifdef NUMA_POOLS
+/// one memory pool per NUMA region, bound to its node with NUMA_MBIND
+extern std::deque<GlobalPool> numaPools;
+
+inline GlobalPool* getNumaPool(size_t region) {
+    if (region >= numaPools.size()) {
+        region = 0; // Fallback to region 0 if invalid
     }
-    return &numaPools[numaNode];
+    return &numaPools[region];
 }
 #else
 extern GlobalPool defaultPool;
@@ -109,7 +91,7 @@ class Worker
    HierarchicBarrier* barrier;
    size_t worker_id = 0; // logical index assigned by WorkerGroup::run (0-based)
 #ifdef NUMA_POOLS
-   size_t numaNode = 0;
+   size_t numaNode = 0; // NUMA region of the worker, see regionOf
 #endif
 
    void start() {
@@ -163,149 +145,24 @@ class WorkerGroup
    inline void run(std::function<void()> f);
 };
 
-// #############################################################################
-// static scheduling policies
-// #############################################################################
-inline std::vector<size_t> buildNumaPhysicalCoreMap(size_t socketsCount, 
-                                                     size_t coresPerSocket,
-                                                     size_t smtPerCore) {
-    // Physical PU IDs are laid out as:
-    // First all physical cores: core * socketsCount + socket
-    // Then HT siblings offset by (socketsCount * coresPerSocket * smtIndex)
-    size_t totalPhysical = socketsCount * coresPerSocket;
-    std::vector<size_t> physicalCores;
-    physicalCores.reserve(totalPhysical * smtPerCore);
-
-    for (size_t smt = 0; smt < smtPerCore; ++smt)
-        for (size_t socket = 0; socket < socketsCount; ++socket)
-            for (size_t core = 0; core < coresPerSocket; ++core)
-                physicalCores.push_back(smt * totalPhysical + core * socketsCount + socket);
-
-    return physicalCores;
-}
-
-// Bandwidth-optimized: fan out across NUMA nodes as early as possible
-// Physical cores exhausted first, then hyperthreads in the same order
-inline std::vector<size_t> numaFanOutSchedule(size_t numThreads,
-                                               size_t socketsCount,
-                                               size_t coresPerSocket,
-                                               size_t smtPerCore = 1) {
-    auto physicalMap = buildNumaPhysicalCoreMap(socketsCount, coresPerSocket, smtPerCore);
-    size_t totalPUs = socketsCount * coresPerSocket * smtPerCore;
-
-    if (numThreads > totalPUs)
-        throw std::runtime_error("numThreads " + std::to_string(numThreads) +
-                                 " exceeds available PUs " + std::to_string(totalPUs));
-
-    std::vector<size_t> schedule;
-    schedule.reserve(numThreads);
-
-    // Walk: smt -> core -> socket, so physical cores across all sockets
-    // are exhausted before any hyperthread is used
-    for (size_t smt = 0; smt < smtPerCore && schedule.size() < numThreads; ++smt)
-        for (size_t core = 0; core < coresPerSocket && schedule.size() < numThreads; ++core)
-            for (size_t socket = 0; socket < socketsCount && schedule.size() < numThreads; ++socket)
-                schedule.push_back(physicalMap[smt * socketsCount * coresPerSocket +
-                                               socket * coresPerSocket + core]);
-
-    return schedule;
-}
-
-// Latency-optimized: consolidate within NUMA node before spilling over
-// Physical cores exhausted per socket first, then hyperthreads per socket
-inline std::vector<size_t> numaConsolidatedSchedule(size_t numThreads,
-                                                     size_t socketsCount,
-                                                     size_t coresPerSocket,
-                                                     size_t smtPerCore = 1) {
-    auto physicalMap = buildNumaPhysicalCoreMap(socketsCount, coresPerSocket, smtPerCore);
-    size_t totalPUs = socketsCount * coresPerSocket * smtPerCore;
-
-    if (numThreads > totalPUs)
-        throw std::runtime_error("numThreads " + std::to_string(numThreads) +
-                                 " exceeds available PUs " + std::to_string(totalPUs));
-
-    std::vector<size_t> schedule;
-    schedule.reserve(numThreads);
-
-    // Walk: socket -> smt -> core, so all SMT siblings on a socket
-    // are used before moving to the next socket
-    for (size_t socket = 0; socket < socketsCount && schedule.size() < numThreads; ++socket)
-        for (size_t smt = 0; smt < smtPerCore && schedule.size() < numThreads; ++smt)
-            for (size_t core = 0; core < coresPerSocket && schedule.size() < numThreads; ++core)
-                schedule.push_back(physicalMap[smt * socketsCount * coresPerSocket +
-                                               socket * coresPerSocket + core]);
-
-    return schedule;
-}
-
 inline void WorkerGroup::run(std::function<void()> f) {
    tbb::task_group g;
    auto barriers = HierarchicBarrier::create(size);
    int64_t group = -1;
 
-
-   
-   size_t nprocs = 88;
-   size_t smt = 2;
-#ifdef NUMA_BANDWIDTH
-   // fan-out: good for Q1, Q6 (bandwidth bound)
-   auto schedule = numaFanOutSchedule(size - 1, 4, 22, smt);
-
-#elif NUMA_LATENCY
-   // consolidated: good for Q3, Q9 (join/hash table heavy)
-   auto schedule = numaConsolidatedSchedule(size - 1, 4, 22,smt);
-#else
-   std::vector<size_t> schedule;
-#endif
-
-   for (size_t i = 0; i < schedule.size(); ++i) {
-       if (schedule[i] >= nprocs*smt) {
-           throw std::runtime_error("Schedule entry " + std::to_string(i) + 
-                   " maps to invalid CPU " + std::to_string(schedule[i]));
-       }
-   }
-
-
-
-
    for (size_t i = 0; i < size - 1; ++i) {
       // lets carefully use the mapping to barriers that the system was already
       // using then ask for the cpu that we want based on our schedule
       if (i % HierarchicBarrier::threadsPerBarrier == 0) ++group;
-#ifdef NUMA_POOLS
-      // Determine CPU assignment first, then compute NUMA node
-      size_t selection;
-#ifdef NEW_POLICY
-      selection = schedule[i];
-#else
-      selection = i;
-#endif
-      size_t node = cpuToNumaNode(selection, 4, 22); // 4 sockets, 22 cores per socket
-      threads.emplace_back(this, f, barriers[group]);
-      threads.back().worker_id = i;
-      threads.back().numaNode = node;
-      threads.back().allocator.setSource(getNumaPool(node));
-
-      // Debug output (will be compiled out in release if desired)
-      static std::once_flag debug_flag;
-      // std::call_once(debug_flag, []() {
-      //    std::cerr << "[NUMA] Worker assignment (first few): thread -> CPU -> NUMA node" << std::endl;
-      // });
-      // if (i < 4) {
-      //    std::cerr << "[NUMA] Worker " << i << " -> CPU " << selection << " -> Node " << node << std::endl;
-      // }
-#else
       threads.emplace_back(this, f, barriers[group]);
       threads.back().worker_id = i;
-#endif
       auto worker = &threads.back();
-#ifndef NUMA_POOLS
-#ifdef NEW_POLICY
-      size_t selection = schedule[i];
-#else
-      size_t selection = i;
-#endif
+      auto& cpu = cpuOf(i);
+#ifdef NUMA_POOLS
+      worker->numaNode = cpu.region;
+      worker->allocator.setSource(getNumaPool(cpu.region));
 #endif
+      size_t selection = cpu.id;
 
       g.run([worker, i,selection]() {
 
@@ -386,6 +243,77 @@ T& thread_specific<T>::create(Args&&... args) {
        .first->second;
 }
 
+template <typename T> class worker_specific
+/// Per worker state indexed by this_worker->worker_id, in place of the
+/// thread id lookup of tbb::enumerable_thread_specific. A worker constructs
+/// its element on first use in cache line padded memory of its own
+/// allocator, so that it is placed near the worker and shares no cache line
+/// with the elements of other workers.
+{
+   std::vector<T*> slots;
+   static constexpr size_t paddedSize = (sizeof(T) + 63) & ~size_t(63);
+
+ public:
+   using value_type = T;
+
+   class iterator
+   /// Iterates the elements of the workers which created one
+   {
+      T* const* pos;
+      T* const* end;
+      void skip() {
+         while (pos != end && !*pos) ++pos;
+      }
+
+    public:
+      iterator(T* const* p, T* const* e) : pos(p), end(e) { skip(); }
+      T& operator*() const { return **pos; }
+      T* operator->() const { return *pos; }
+      iterator& operator++() {
+         ++pos;
+         skip();
+         return *this;
+      }
+      bool operator!=(const iterator& o) const { return pos != o.pos; }
+      bool operator==(const iterator& o) const { return pos == o.pos; }
+   };
+
+   explicit worker_specific(size_t nrWorkers) : slots(nrWorkers, nullptr) {}
+   worker_specific(const worker_specific&) = delete;
+   worker_specific(worker_specific&&) = default;
+   ~worker_specific() {
+      for (auto slot : slots)
+         if (slot) slot->~T();
+   }
+
+   /// element of the calling worker, constructed on first use
+   T& local() {
+      bool exists;
+      return local(exists);
+   }
+   T& local(bool& exists) {
+      auto id = this_worker->worker_id;
+      if (id >= slots.size())
+         throw std::runtime_error("worker " + std::to_string(id) +
+                                  " outside of " +
+                                  std::to_string(slots.size()) + " workers");
+      auto& slot = slots[id];
+      exists = slot;
+      if (!exists) slot = new (this_worker->allocator.allocate(paddedSize)) T();
+      return *slot;
+   }
+   size_t size() const { return slots.size(); }
+   /// element of worker w, nullptr if w did not use one
+   T* slot(size_t w) const { return slots[w]; }
+   iterator begin() const {
+      return iterator(slots.data(), slots.data() + slots.size());
+   }
+   iterator end() const {
+      return iterator(slots.data() + slots.size(),
+                      slots.data() + slots.size());
+   }
+};
+
 inline bool __attribute__((noinline)) barrier()
 /// Shorthand for using the current thread groups barrier
 {
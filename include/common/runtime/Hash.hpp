@@ -4,6 +4,9 @@
 #include "common/defs.hpp"
 #include "common/runtime/SIMD.hpp"
 #include "common/runtime/Types.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
 
 // --- Architecture Detection & SIMD Mapping ---
 #if defined(__x86_64__) && defined(__AVX512F__)
@@ -490,4 +493,174 @@ class CRC32Hash : public Hash<CRC32Hash> {
    }
 };
 EXTRAOPS(CRC32Hash);
+
+/// Fold helper for byte strings, shared by the integer-only hash functions
+/// below: hashes the input in 8 byte words and mixes in the remaining tail.
+template <typename H>
+inline uint64_t hashBytesWordwise(const H& h, const void* key, int len,
+                                  uint64_t seed) {
+   auto data = reinterpret_cast<const uint8_t*>(key);
+   uint64_t s = seed ^ len;
+   while (len >= 8) {
+      uint64_t w;
+      std::memcpy(&w, data, 8);
+      s = h.hashKey(w, s);
+      data += 8;
+      len -= 8;
+   }
+   if (len) {
+      uint64_t w = 0;
+      std::memcpy(&w, data, len);
+      s = h.hashKey(w, s);
+   }
+   return s;
+}
+
+/// 64 bit integer path of XXH3 (len 4-8 variant with rrmxmx finalizer)
+class XXH3Hash : public Hash<XXH3Hash> {
+   static constexpr uint64_t secret = 0x1cad21f72c81017cull ^ 0xdb979083e96dd4deull;
+   static constexpr uint64_t prime = 0x9fb21c651e98df25ull;
+
+ public:
+   inline hash_t hashKey(uint64_t k) const { return hashKey(k, 0); }
+   inline hash_t hashKey(uint64_t k, hash_t seed) const {
+      uint64_t h = k ^ (secret - seed);
+      h ^= rotl64(h, 49) ^ rotl64(h, 24);
+      h *= prime;
+      h ^= (h >> 35) + 8;
+      h *= prime;
+      return h ^ (h >> 28);
+   }
+   inline hash_t hashKey(const void* key, int len, hash_t seed) const {
+      return hashBytesWordwise(*this, key, len, seed);
+   }
+
+#if defined(__AVX512DQ__) || defined(SIMDE_X86_AVX512DQ_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
+   inline Vec8u hashKey(Vec8u k, Vec8u seed) const {
+      Vec8u h = k ^ (Vec8u(secret) - seed);
+      h = h ^ Vec8u(_mm512_rol_epi64(h, 49)) ^ Vec8u(_mm512_rol_epi64(h, 24));
+      h = h * Vec8u(prime);
+      h = h ^ ((h >> 35) + Vec8u(8));
+      h = h * Vec8u(prime);
+      return h ^ (h >> 28);
+   }
+#endif
+};
+EXTRAOPS(XXH3Hash);
+
+/// Multiplicative (Fibonacci) hashing. The upper half of the product is
+/// folded into the lower bits, because hash tables index with the low bits.
+class MultiplyShiftHash : public Hash<MultiplyShiftHash> {
+   static constexpr uint64_t factor = 0x9e3779b97f4a7c15ull;
+
+ public:
+   inline hash_t hashKey(uint64_t k) const { return hashKey(k, 0); }
+   inline hash_t hashKey(uint64_t k, hash_t seed) const {
+      uint64_t h = (k ^ seed) * factor;
+      return h ^ (h >> 32);
+   }
+   inline hash_t hashKey(const void* key, int len, hash_t seed) const {
+      return hashBytesWordwise(*this, key, len, seed);
+   }
+
+#if defined(__AVX512DQ__) || defined(SIMDE_X86_AVX512DQ_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
+   inline Vec8u hashKey(Vec8u k, Vec8u seed) const {
+      Vec8u h = (k ^ seed) * Vec8u(factor);
+      return h ^ (h >> 32);
+   }
+#endif
+};
+EXTRAOPS(MultiplyShiftHash);
+
+#if defined(__PCLMUL__)
+/// Carry-less multiplication of the key with a constant, whose 128 bit
+/// product is folded to 64 bit by xor and finished by a multiplicative
+/// finalizer. Unlike CRC32Hash there is no reduction modulo a polynomial.
+/// The Vec8u variant hashes 8 keys at once with VPCLMULQDQ. It is compiled
+/// for that ISA extension only, callers must check hasVectorCLMul().
+class CLMulFoldHash : public Hash<CLMulFoldHash> {
+   static constexpr uint64_t poly = 0x82f63b78edb88320ull;
+   static constexpr uint64_t factor = 0x2545f4914f6cdd1dull;
+
+ public:
+   inline hash_t hashKey(uint64_t k) const { return hashKey(k, 0); }
+   inline hash_t hashKey(uint64_t k, hash_t seed) const {
+      auto p = _mm_clmulepi64_si128(_mm_cvtsi64_si128(k),
+                                    _mm_cvtsi64_si128(poly), 0x00);
+      uint64_t folded = _mm_cvtsi128_si64(p) ^ _mm_extract_epi64(p, 1);
+      uint64_t h = (folded ^ seed) * factor;
+      return h ^ (h >> 32);
+   }
+   inline hash_t hashKey(const void* key, int len, hash_t seed) const {
+      return hashBytesWordwise(*this, key, len, seed);
+   }
+
+#if defined(__AVX512DQ__)
+   static bool hasVectorCLMul() {
+      return __builtin_cpu_supports("vpclmulqdq");
+   }
+   __attribute__((target("vpclmulqdq"))) inline Vec8u
+   hashKey(Vec8u k, Vec8u seed) const {
+      const __m512i p = _mm512_set1_epi64(poly);
+      // products of the even and the odd keys, 128 bit each
+      auto even = _mm512_clmulepi64_epi128(k.reg, p, 0x00);
+      auto odd = _mm512_clmulepi64_epi128(k.reg, p, 0x01);
+      // fold upper into lower 64 bit of each product
+      even = _mm512_xor_si512(even, _mm512_shuffle_epi32(even, _MM_PERM_BADC));
+      odd = _mm512_xor_si512(odd, _mm512_shuffle_epi32(odd, _MM_PERM_BADC));
+      Vec8u folded = _mm512_mask_blend_epi64(0xAA, even, odd);
+      Vec8u h = (folded ^ seed) * Vec8u(factor);
+      return h ^ (h >> 32);
+   }
+#endif
+};
+EXTRAOPS(CLMulFoldHash);
+#endif
+
+/// Hash functions that can be selected at runtime, e.g. per engine in the
+/// benchmark drivers or per operator when building a query
+enum class HashFunction { CRC32, MurMur, XXH3, MultiplyShift, CLMulFold };
+
+inline HashFunction hashFunctionFromString(const std::string& name) {
+   if (name == "crc32") return HashFunction::CRC32;
+   if (name == "murmur") return HashFunction::MurMur;
+   if (name == "xxh3") return HashFunction::XXH3;
+   if (name == "mulshift") return HashFunction::MultiplyShift;
+   if (name == "clmulfold") return HashFunction::CLMulFold;
+   throw std::runtime_error("Unknown hash function " + name);
+}
+
+inline const char* hashFunctionName(HashFunction f) {
+   switch (f) {
+   case HashFunction::CRC32: return "crc32";
+   case HashFunction::MurMur: return "murmur";
+   case HashFunction::XXH3: return "xxh3";
+   case HashFunction::MultiplyShift: return "mulshift";
+   case HashFunction::CLMulFold: return "clmulfold";
+   }
+   return "unknown";
+}
+
+/// Calls fn with an instance of the hash class selected by f, so that
+/// templated code can be dispatched once at runtime
+template <typename F> auto withHash(HashFunction f, F&& fn) {
+   switch (f) {
+   case HashFunction::MurMur:
+#if HASH_SIZE == 32
+      return fn(MurMurHash3());
+#else
+      return fn(MurMurHash());
+#endif
+   case HashFunction::XXH3: return fn(XXH3Hash());
+   case HashFunction::MultiplyShift: return fn(MultiplyShiftHash());
+   case HashFunction::CLMulFold:
+#if defined(__PCLMUL__)
+      return fn(CLMulFoldHash());
+#else
+      throw std::runtime_error("clmulfold hash not supported on this platform");
+#endif
+   case HashFunction::CRC32: break;
+   }
+   return fn(CRC32Hash());
+}
 } // namespace runtime
@@ -399,6 +399,7 @@ class Hashset : public Hashmap {
    static const uint64_t seed = 902850234;
 
  public:
+   using key_type = K;
    struct Entry {
       EntryHeader h;
       K k;
@@ -408,6 +409,7 @@ class Hashset : public Hashmap {
    void insertAll(std::deque<Entry>& entries);
    void insertAll(runtime::Stack<Entry>& entries);
    bool contains(const K& key);
+   bool contains(const K& key, hash_t hash);
    hash_t hash(const K& k);
    hash_t hash(const K& k, hash_t seed);
    inline static Entry* end() { return nullptr; }
@@ -444,7 +446,11 @@ void Hashset<K, H, useTags>::insertAll(runtime::Stack<Entry>& entries) {
 
 template <typename K, typename H, bool useTags>
 inline bool Hashset<K, H, useTags>::contains(const K& key) {
-   auto h = hash(key, seed);
+   return contains(key, hash(key, seed));
+}
+
+template <typename K, typename H, bool useTags>
+inline bool Hashset<K, H, useTags>::contains(const K& key, hash_t h) {
    Entry* entry;
    if (useTags)
       entry = reinterpret_cast<Entry*>(find_chain_tagged(h));
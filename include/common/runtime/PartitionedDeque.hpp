@@ -1,10 +1,13 @@
 #include "common/defs.hpp"
 #include "common/runtime/Concurrency.hpp"
 #include "common/runtime/MemoryPool.hpp"
+#include "common/runtime/Spill.hpp"
 #include "common/runtime/Util.hpp"
+#include <algorithm>
 #include <assert.h>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <vector>
 
 namespace runtime {
@@ -28,6 +31,13 @@ class PartitionedDeque
       Chunk(Chunk&&) = delete;
    };
 
+   struct Extent
+   /// Consecutive entries of one partition in the spill file
+   {
+      size_t offset;
+      size_t n;
+   };
+
    struct Partition
    /// Chunks and metadata for one partition
    {
@@ -35,13 +45,16 @@ class PartitionedDeque
       Chunk* last = nullptr;
       void* current = nullptr;
       void* end = nullptr;
-      void push_back(void* element, size_t size);
+      /// Entries written to the spill file, preceding those in chunks
+      std::vector<Extent> spilled;
+      void push_back(void* element, PartitionedDeque& deque);
       size_t size(Chunk* chunk, size_t entrySize) const;
 
       Partition() = default;
       Partition(const Partition&) = delete;
       Partition(Partition&& o)
-          : first(o.first), last(o.last), current(o.current), end(o.end) {
+          : first(o.first), last(o.last), current(o.current), end(o.end),
+            spilled(std::move(o.spilled)) {
          o.first = nullptr;
          o.last = nullptr;
          o.current = nullptr;
@@ -49,12 +62,12 @@ class PartitionedDeque
       };
 
     private:
-      Chunk* newChunk(size_t entrySize);
+      Chunk* newChunk(PartitionedDeque& deque);
    };
 
    PartitionedDeque(size_t nrPartitions_ = 0, size_t entrySize_ = 0);
-   // required so that we are able to cope with the tbb interface for
-   // enumerable_thread_specific
+   // required so that we are able to cope with the default construction of
+   // worker_specific
    void postConstruct(size_t nrPartitions_ = 0, size_t entrySize_ = 0);
    PartitionedDeque(const PartitionedDeque&) = delete;
    ~PartitionedDeque();
@@ -63,6 +76,14 @@ class PartitionedDeque
 
    const std::vector<Partition>& getPartitions();
 
+   /// Wait until spilled entries are on disk, required before reading them
+   void finishWrites();
+   /// Bytes written to the spill file
+   size_t spilledBytes() const;
+   /// Calls f(void* entries, size_t n) for all entries of partition nr.
+   /// Spilled entries are read back one chunk at a time.
+   template <typename F> void forEachChunk(size_t nr, F f);
+
    /// Size of one entry in bytes
    size_t entrySize;
 
@@ -70,6 +91,14 @@ class PartitionedDeque
    /// Mask to go from hash to partition number
    std::vector<Partition> partitions;
    uint8_t shift;
+   /// Chunks released by spilling, reused before allocating new ones
+   Chunk* spare = nullptr;
+   /// Bytes allocated for chunks, accounted in spillableBytes
+   size_t allocated = 0;
+   std::unique_ptr<SpillFile> file;
+
+   /// Write the full chunks of a partition to the spill file
+   void spill(Partition& partition);
 };
 
 template <size_t chunkSize>
@@ -108,6 +137,7 @@ void PartitionedDeque<chunkSize>::postConstruct(size_t nrPartitions_,
 }
 
 template <size_t chunkSize> PartitionedDeque<chunkSize>::~PartitionedDeque() {
+   spillableBytes -= allocated;
    // for (auto& partition : partitions)
    //    for (auto chunk = partition.first; chunk;) {
    //       auto nextChunk = chunk->next;
@@ -119,21 +149,79 @@ template <size_t chunkSize> PartitionedDeque<chunkSize>::~PartitionedDeque() {
 template <size_t chunkSize>
 void PartitionedDeque<chunkSize>::push_back(void* element, hash_t hash) {
    // use upper bits of hash
-   partitions[hash >> shift].push_back(element, entrySize);
+   auto& partition = partitions[hash >> shift];
+   if (partition.current == partition.end && partition.first &&
+       overSpillBudget())
+      spill(partition);
+   partition.push_back(element, *this);
+}
+
+template <size_t chunkSize>
+void PartitionedDeque<chunkSize>::spill(Partition& partition) {
+   if (!file) file = std::make_unique<SpillFile>();
+   auto bytes = chunkSize * entrySize;
+   for (auto chunk = partition.first; chunk;) {
+      auto offset = file->append(chunk->template data<void>(), bytes);
+      auto& extents = partition.spilled;
+      if (!extents.empty() &&
+          extents.back().offset + extents.back().n * entrySize == offset)
+         extents.back().n += chunkSize;
+      else
+         extents.push_back(Extent{offset, chunkSize});
+      auto next = chunk->next;
+      chunk->next = spare;
+      spare = chunk;
+      chunk = next;
+   }
+   partition.first = nullptr;
+   partition.last = nullptr;
+   partition.current = nullptr;
+   partition.end = nullptr;
+}
+
+template <size_t chunkSize> void PartitionedDeque<chunkSize>::finishWrites() {
+   if (file) file->flush();
+}
+
+template <size_t chunkSize>
+size_t PartitionedDeque<chunkSize>::spilledBytes() const {
+   size_t n = 0;
+   for (auto& partition : partitions)
+      for (auto& extent : partition.spilled) n += extent.n;
+   return n * entrySize;
+}
+
+template <size_t chunkSize>
+template <typename F>
+void PartitionedDeque<chunkSize>::forEachChunk(size_t nr, F f) {
+   auto& partition = partitions[nr];
+   if (!partition.spilled.empty()) {
+      std::unique_ptr<uint8_t[]> buffer(new uint8_t[chunkSize * entrySize]);
+      for (auto& extent : partition.spilled)
+         for (size_t pos = 0; pos < extent.n; pos += chunkSize) {
+            auto n = std::min(chunkSize, extent.n - pos);
+            file->read(extent.offset + pos * entrySize, buffer.get(),
+                       n * entrySize);
+            f(reinterpret_cast<void*>(buffer.get()), n);
+         }
+   }
+   for (auto chunk = partition.first; chunk; chunk = chunk->next)
+      f(chunk->template data<void>(), partition.size(chunk, entrySize));
 }
 
 template <size_t chunkSize>
-void PartitionedDeque<chunkSize>::Partition::push_back(void* element,
-                                                       size_t entrySize) {
+void PartitionedDeque<chunkSize>::Partition::push_back(
+    void* element, PartitionedDeque& deque) {
+   auto entrySize = deque.entrySize;
    if (!first) {
-      auto created = newChunk(entrySize);
+      auto created = newChunk(deque);
       first = created;
       last = created;
       current = created->template data<void>();
       end = addBytes(current, entrySize * chunkSize);
    }
    if (current == end) {
-      auto created = newChunk(entrySize);
+      auto created = newChunk(deque);
       last->next = created;
       last = created;
       current = created->template data<void>();
@@ -156,10 +244,17 @@ size_t PartitionedDeque<chunkSize>::Partition::size(Chunk* chunk,
 
 template <size_t chunkSize>
 typename PartitionedDeque<chunkSize>::Chunk*
-PartitionedDeque<chunkSize>::Partition::newChunk(size_t entrySize) {
-
-   auto alloc =
-       this_worker->allocator.allocate(sizeof(Chunk) + chunkSize * entrySize);
+PartitionedDeque<chunkSize>::Partition::newChunk(PartitionedDeque& deque) {
+   if (deque.spare) {
+      auto c = deque.spare;
+      deque.spare = c->next;
+      c->next = nullptr;
+      return c;
+   }
+   auto bytes = sizeof(Chunk) + chunkSize * deque.entrySize;
+   auto alloc = this_worker->allocator.allocate(bytes);
+   deque.allocated += bytes;
+   spillableBytes += bytes;
    auto c = reinterpret_cast<Chunk*>(alloc);
    new (c) Chunk();
    return c;
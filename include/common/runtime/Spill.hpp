@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace runtime {
+
+/// Memory budget in bytes for operator state which can be spilled to disk,
+/// 0 disables spilling
+extern size_t spillBudget;
+/// Directory for temporary spill files
+extern std::string spillDirectory;
+/// Bytes currently held in memory by spillable operator state
+extern std::atomic<size_t> spillableBytes;
+
+/// true if spillable state exceeds the memory budget
+inline bool overSpillBudget() {
+   return spillBudget &&
+          spillableBytes.load(std::memory_order_relaxed) > spillBudget;
+}
+
+struct ScopedSpillBudget
+/// Sets spillBudget for its lifetime and restores the previous budget
+{
+   size_t previous;
+   explicit ScopedSpillBudget(size_t budget) : previous(spillBudget) {
+      spillBudget = budget;
+   }
+   ScopedSpillBudget(const ScopedSpillBudget&) = delete;
+   ~ScopedSpillBudget() { spillBudget = previous; }
+};
+
+class SpillFile
+/// Append only temporary file. Appends are collected in a large buffer which
+/// is written asynchronously while the next one fills up, so the disk only
+/// sees large sequential writes.
+{
+   int fd;
+   /// Bytes appended so far, file offset of the next append
+   size_t size = 0;
+   std::vector<uint8_t> buffer;
+   std::vector<uint8_t> inFlight;
+   std::future<void> pending;
+
+   void writeBuffer();
+
+ public:
+   static const size_t bufferSize = 4 * 1024 * 1024;
+   SpillFile();
+   SpillFile(const SpillFile&) = delete;
+   ~SpillFile();
+   /// Append n bytes, returns their offset in the file
+   size_t append(const void* data, size_t n);
+   /// Wait until all appended bytes are on disk
+   void flush();
+   /// Read n bytes at offset, requires a flush after the last append
+   void read(size_t offset, void* dest, size_t n) const;
+};
+
+class FileBackedArena
+/// Bump allocator on shared mappings of a temporary file. Pages are written
+/// back by the kernel under memory pressure instead of exhausting the swap.
+{
+   int fd;
+   size_t fileSize = 0;
+   std::vector<std::pair<void*, size_t>> segments;
+   uint8_t* current = nullptr;
+   size_t remaining = 0;
+
+ public:
+   static const size_t segmentSize = 64 * 1024 * 1024;
+   FileBackedArena();
+   FileBackedArena(const FileBackedArena&) = delete;
+   ~FileBackedArena();
+   void* allocate(size_t bytes);
+   /// Bytes mapped from the file
+   size_t size() const { return fileSize; }
+};
+} // namespace runtime
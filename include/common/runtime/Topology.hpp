@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace runtime {
+
+class Topology
+/// The CPUs this process may run on and where they are in the machine, read
+/// from sysfs. Regions are the NUMA nodes with allowed CPUs, numbered densely
+/// from 0, so that they can index per region state such as memory pools.
+{
+ public:
+   struct Cpu {
+      /// id of the OS, which threads are pinned to
+      size_t id;
+      /// physical package
+      size_t socket;
+      /// id of the NUMA node, e.g. for mbind
+      size_t node;
+      /// index of the node in nodes
+      size_t region;
+      /// id of the core, unique within its socket
+      size_t core;
+      /// index among the SMT siblings of its core, 0 for the first one
+      size_t smt;
+   };
+   /// allowed CPUs, ordered by id
+   std::vector<Cpu> cpus;
+   /// NUMA node id of each region
+   std::vector<size_t> nodes;
+   size_t sockets = 0;
+   /// most SMT siblings of a core
+   size_t smtPerCore = 0;
+
+   /// Read the topology below sysfs, e.g. /sys/devices/system, limited to the
+   /// CPUs in allowed unless it is empty. Missing files fall back to one
+   /// socket and one node, with a core per CPU.
+   static Topology discover(const std::string& sysfs,
+                            const std::vector<size_t>& allowed);
+   /// Topology of this machine, limited to the affinity mask of the process,
+   /// which reflects its cpuset. Discovered on first use.
+   static const Topology& machine();
+   /// CPU ids of a sysfs cpu list like "0-3,8,10-11"
+   static std::vector<size_t> parseList(const std::string& list);
+
+   /// Indexes into cpus for the workers of a group, fanned out over the
+   /// regions as early as possible: the physical cores of all regions come
+   /// round robin first, then their SMT siblings. Good for bandwidth bound
+   /// queries.
+   std::vector<size_t> fanOutSchedule() const;
+   /// Indexes into cpus for the workers of a group, consolidated per region:
+   /// the physical cores of a region and then their SMT siblings before the
+   /// next region. Good for latency bound, hash table heavy queries.
+   std::vector<size_t> consolidatedSchedule() const;
+};
+} // namespace runtime
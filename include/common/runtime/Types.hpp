@@ -6,6 +6,8 @@
 #include <cstdint>
 #include <cstring>
 #include <ostream>
+#include <string>
+#include <vector>
 //---------------------------------------------------------------------------
 // HyPer
 // (c) Thomas Neumann 2010
@@ -155,6 +157,75 @@ bool contains(const Varchar<maxLen>& str, const char* txt, unsigned len) {
 const char* memmemSSE(const char* haystack, size_t len, const char* needleStr,
                       size_t needleLength);
 //---------------------------------------------------------------------------
+/// Find needle by comparing its first and last character with 16 positions of
+/// haystack at once, only candidates matching both are compared completely
+const char* memmemFirstLast(const char* haystack, size_t len,
+                            const char* needle, size_t needleLength);
+//---------------------------------------------------------------------------
+/// A SQL LIKE pattern with % and _ wildcards, split into the segments
+/// between the % wildcards. The shape of the pattern selects the cheapest
+/// match, patterns with _ are always matched segment by segment.
+class LikePattern {
+ public:
+   enum Kind { Equal, Prefix, Suffix, Contains, Segments };
+   /// The shape
+   Kind kind;
+   /// The segments, without empty ones
+   std::vector<std::string> segments;
+   /// Does the pattern start resp. end with a segment
+   bool anchoredBegin, anchoredEnd;
+   /// Do the segments contain _, which matches any single character
+   bool singleWildcards;
+
+   /// Parse
+   explicit LikePattern(const std::string& pattern);
+
+   /// Match
+   bool match(const char* str, unsigned len) const {
+      switch (kind) {
+      case Equal: return matchEqual(str, len);
+      case Prefix: return matchPrefix(str, len);
+      case Suffix: return matchSuffix(str, len);
+      case Contains: return matchContains(str, len);
+      default: return matchSegments(str, len);
+      }
+   }
+   /// Match pattern without wildcard
+   bool matchEqual(const char* str, unsigned len) const {
+      auto& s = segments[0];
+      return len == s.size() && memcmp(str, s.data(), len) == 0;
+   }
+   /// Match pattern 'literal%'
+   bool matchPrefix(const char* str, unsigned len) const {
+      auto& s = segments[0];
+      return len >= s.size() && memcmp(str, s.data(), s.size()) == 0;
+   }
+   /// Match pattern '%literal'
+   bool matchSuffix(const char* str, unsigned len) const {
+      auto& s = segments[0];
+      return len >= s.size() &&
+             memcmp(str + len - s.size(), s.data(), s.size()) == 0;
+   }
+   /// Match pattern '%literal%'
+   bool matchContains(const char* str, unsigned len) const {
+      auto& s = segments[0];
+      return memmemFirstLast(str, len, s.data(), s.size()) != nullptr;
+   }
+   /// Match any pattern, segments are searched from left to right
+   bool matchSegments(const char* str, unsigned len) const;
+
+ private:
+   /// Does segment s match at str, which has at least s.size() characters
+   bool segmentAt(const char* str, const std::string& s) const;
+   /// Find the first match of segment s in str
+   const char* findSegment(const char* str, size_t len,
+                           const std::string& s) const;
+};
+//---------------------------------------------------------------------------
+template <typename STR> bool like(const STR& str, const LikePattern& pattern) {
+   return pattern.match(str.begin(), str.length());
+}
+//---------------------------------------------------------------------------
 template <unsigned maxLen>
 bool contains2(Varchar<maxLen>& str, const char* txt1, unsigned len1,
                const char* txt2, unsigned len2) {
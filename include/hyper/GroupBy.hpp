@@ -1,11 +1,12 @@
 #include "common/runtime/Hashmap.hpp"
+#include <algorithm>
 #include "common/runtime/Stack.hpp"
 #include "tbb/tbb.h"
 
 template <typename K, typename V, typename HASH, typename UPDATE>
 class GroupBy {
    /// Hashmap for grouping
-   tbb::enumerable_thread_specific<runtime::Hashmapx<K, V, HASH, false>> groups;
+   runtime::worker_specific<runtime::Hashmapx<K, V, HASH, false>> groups;
 
  public:
    /// type of entry struct in hashmap
@@ -13,10 +14,33 @@ class GroupBy {
 
  private:
    /// Memory for materialized entries in hashmap
-   tbb::enumerable_thread_specific<runtime::Stack<group_t>> entries;
+   runtime::worker_specific<runtime::Stack<group_t>> entries;
    /// Memory for spilling hastable entries
-   tbb::enumerable_thread_specific<runtime::PartitionedDeque<1024>>
-       partitionedDeques;
+   runtime::worker_specific<runtime::PartitionedDeque<1024>> partitionedDeques;
+
+   /// tuples per sample of the reduction of pre-aggregation
+   static constexpr size_t sampleSize = 16 * 1024;
+   /// minimal tuples per created group for pre-aggregation to pay off
+   static constexpr size_t minReduction = 2;
+   /// tuples bypassing pre-aggregation after a poor sample, doubled for each
+   /// further poor sample
+   static constexpr size_t minBypass = 4 * sampleSize;
+   static constexpr size_t maxBypass = 64 * sampleSize;
+
+   struct Adaptation
+   /// Whether pre-aggregation pays off for a thread, kept across morsels
+   {
+      /// tuples consumed and groups created in the current sample
+      size_t consumed = 0;
+      size_t created = 0;
+      /// tuples left to write directly into the partitions
+      size_t bypass = 0;
+      /// tuples to bypass after the next poor sample
+      size_t backoff = minBypass;
+      /// tuples written directly into the partitions in total
+      size_t bypassed = 0;
+   };
+   runtime::worker_specific<Adaptation> adaptations;
 
    UPDATE update;
    V init;
@@ -25,7 +49,9 @@ class GroupBy {
 
  public:
    GroupBy(UPDATE u, V i, size_t nrThreads_)
-       : update(u), init(i), nrThreads(nrThreads_) {}
+       : groups(nrThreads_), entries(nrThreads_),
+        partitionedDeques(nrThreads_), adaptations(nrThreads_), update(u),
+        init(i), nrThreads(nrThreads_) {}
 
    GroupBy(const GroupBy& g) = delete;
    GroupBy(GroupBy&& g) = default;
@@ -38,6 +64,7 @@ class GroupBy {
       runtime::Hashmapx<K, V, HASH, false>& groups;
       runtime::Stack<group_t>& entries;
       runtime::PartitionedDeque<1024>& spillStorage;
+      Adaptation& adaptation;
       size_t maxFill;
 
       void spill() {
@@ -46,15 +73,19 @@ class GroupBy {
                spillStorage.push_back(&entry, entry.h.hash);
       }
 
-    public:
-      Locals(GroupBy& p, runtime::Hashmapx<K, V, HASH, false>& g,
-             runtime::Stack<group_t>& e, runtime::PartitionedDeque<1024>& s,
-             size_t m)
-          : parent(p), groups(g), entries(e), spillStorage(s), maxFill(m) {}
+      /// bypass pre-aggregation for a while if the last sample did not
+      /// reduce the tuples enough
+      void adapt() {
+         if (adaptation.created * minReduction > adaptation.consumed) {
+            adaptation.bypass = adaptation.backoff;
+            adaptation.backoff = std::min(adaptation.backoff * 2, maxBypass);
+         } else
+            adaptation.backoff = minBypass;
+         adaptation.consumed = 0;
+         adaptation.created = 0;
+      }
 
-      /// consume key and value
-      template <typename KEY, typename VALUE>
-      inline void consume(KEY&& key, VALUE&& value) {
+      template <typename KEY> inline V& findOrCreate(KEY&& key) {
          auto group = groups.findOrCreate(key, groups.hash(key), parent.init,
                                           entries, [&]() {
                                              if (groups.size() >= maxFill) {
@@ -62,33 +93,52 @@ class GroupBy {
                                                 groups.clear();
                                                 entries.clear();
                                              }
+                                             adaptation.created++;
                                           });
-         parent.update(*group, std::forward<VALUE>(value));
+         if (++adaptation.consumed == sampleSize) adapt();
+         return *group;
+      }
+
+      /// group of key written directly into the partitions after cb updated
+      /// it, if pre-aggregation is bypassed
+      template <typename KEY, typename VALUECB>
+      inline bool bypass(KEY&& key, VALUECB cb) {
+         if (!adaptation.bypass) return false;
+         adaptation.bypass--;
+         adaptation.bypassed++;
+         group_t entry(groups.hash(key), key, parent.init);
+         cb(entry.v);
+         spillStorage.push_back(&entry, entry.h.hash);
+         return true;
+      }
+
+    public:
+      Locals(GroupBy& p, runtime::Hashmapx<K, V, HASH, false>& g,
+             runtime::Stack<group_t>& e, runtime::PartitionedDeque<1024>& s,
+             Adaptation& a, size_t m)
+          : parent(p), groups(g), entries(e), spillStorage(s), adaptation(a),
+            maxFill(m) {}
+
+      /// consume key and value
+      template <typename KEY, typename VALUE>
+      inline void consume(KEY&& key, VALUE&& value) {
+         if (bypass(key, [&](V& group) {
+                parent.update(group, std::forward<VALUE>(value));
+             }))
+            return;
+         parent.update(findOrCreate(key), std::forward<VALUE>(value));
       }
 
       template <typename KEY, typename VALUECB>
       inline void consume_callback(KEY&& key, VALUECB cb) {
-         auto group = groups.findOrCreate(key, groups.hash(key), parent.init,
-                                          entries, [&]() {
-                                             if (groups.size() >= maxFill) {
-                                                spill();
-                                                groups.clear();
-                                                entries.clear();
-                                             }
-                                          });
-         cb(*group);
+         if (bypass(key, cb)) return;
+         cb(findOrCreate(key));
       }
 
-     template<typename KEY>
-      inline V& getGroup(KEY&& key) {
-       return *groups.findOrCreate(std::forward<KEY>(key), groups.hash(std::forward<KEY>(key)), parent.init,
-                                     entries, [&]() {
-                                        if (groups.size() >= maxFill) {
-                                           spill();
-                                           groups.clear();
-                                           entries.clear();
-                                        }
-                                     });
+      /// group of key in the thread local hash table, always pre-aggregates
+      /// as the caller updates the group later
+      template <typename KEY> inline V& getGroup(KEY&& key) {
+         return findOrCreate(std::forward<KEY>(key));
       }
    };
 
@@ -107,18 +157,25 @@ class GroupBy {
       auto& spillStorage = partitionedDeques.local(exists);
       if (!exists) spillStorage.postConstruct(nrThreads * 4, sizeof(group_t));
 
-      return Locals(*this, g, e, spillStorage, maxFill);
+      return Locals(*this, g, e, spillStorage, adaptations.local(), maxFill);
+   }
+   /// Tuples all threads wrote directly into the partitions, bypassing
+   /// pre-aggregation
+   size_t bypassed() {
+      size_t n = 0;
+      for (auto& a : adaptations) n += a.bypassed;
+      return n;
    }
    /// Spill all
    void spillAll() {
-      tbb::parallel_for(entries.range(), [&](const auto& e) {
-
+      tbb::parallel_for(size_t(0), entries.size(), size_t(1), [&](size_t w) {
+         auto e = entries.slot(w);
+         if (!e) return;
          bool exists;
          auto& deque = partitionedDeques.local(exists);
          if (!exists) deque.postConstruct(nrThreads * 4, sizeof(group_t));
-         for (auto& entries : e)
-            for (auto block : entries)
-               for (auto& entry : block) deque.push_back(&entry, entry.h.hash);
+         for (auto block : *e)
+            for (auto& entry : block) deque.push_back(&entry, entry.h.hash);
       });
    }
 
@@ -134,6 +191,7 @@ class GroupBy {
    template <typename C> inline void forallGroups(C consume) {
 
       spillAll();
+      for (auto& deque : partitionedDeques) deque.finishWrites();
 
       // aggregate from spill partitions
       auto nrPartitions = partitionedDeques.begin()->getPartitions().size();
@@ -151,10 +209,9 @@ class GroupBy {
          localEntries.clear();
          // aggregate values from all deques for partitionNr
          for (auto& deque : partitionedDeques) {
-            auto& partition = deque.getPartitions()[partitionNr];
-            for (auto chunk = partition.first; chunk; chunk = chunk->next) {
-               for (auto value = chunk->template data<group_t>(),
-                         end = value + partition.size(chunk, sizeof(group_t));
+            deque.forEachChunk(partitionNr, [&](void* chunk, size_t n) {
+               for (auto value = reinterpret_cast<group_t*>(chunk),
+                         end = value + n;
                     value < end; value++) {
                   auto group = ht.findOrCreate(
                       value->k, value->h.hash, init, localEntries, [&]() {
@@ -164,7 +221,7 @@ class GroupBy {
                       });
                   update(*group, value->v);
                }
-            }
+            });
          }
 
          // push aggregated groups into following pipeline
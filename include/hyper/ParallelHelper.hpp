@@ -18,6 +18,8 @@ inline ProcessingResources initQuery(size_t nrThreads) {
 
    tbb::parallel_for(size_t(0), nrThreads, size_t(1), [&](auto i) {
       auto& worker = r.workers[i];
+      // index of the worker's runtime::worker_specific elements
+      worker.worker_id = i;
       // save thread local worker pointer
       worker.previousWorker = runtime::this_worker;
       // use this worker resource
@@ -67,7 +69,7 @@ void parallel_scan(size_t n, E& entriesGlobal, L& cb) {
        [](const size_t& a, const size_t& b) { return a + b; })
 
 template <typename E, typename HT> void parallel_insert(E& entries, HT& ht) {
-   tbb::parallel_for(entries.range(), [&ht](const auto& r) {
-      for (auto& entries : r) ht.insertAll(entries);
+   tbb::parallel_for(size_t(0), entries.size(), size_t(1), [&](size_t w) {
+      if (auto e = entries.slot(w)) ht.insertAll(*e);
    });
 }
@@ -0,0 +1,79 @@
+#pragma once
+#include "common/runtime/Hashmap.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace hyper {
+
+/// Probes buffered by a ProbeStage before they are finished as a batch
+static const size_t probeBatch = 16;
+
+/// Result of a probe: the value of a Hashmapx entry or nullptr
+template <typename K, typename V, typename H, bool useTags>
+inline V* probe(runtime::Hashmapx<K, V, H, useTags>& ht, const K& key,
+                runtime::Hashmap::hash_t hash) {
+   return ht.findOne(key, hash);
+}
+/// Result of a probe: whether a Hashset contains the key
+template <typename K, typename H, bool useTags>
+inline bool probe(runtime::Hashset<K, H, useTags>& ht, const K& key,
+                  runtime::Hashmap::hash_t hash) {
+   return ht.contains(key, hash);
+}
+
+template <typename HT, typename T, typename F, size_t N = probeBatch>
+class ProbeStage
+/// Stage of a fused pipeline in front of a hash table probe, see relaxed
+/// operator fusion. It buffers the probes of up to N tuples and prefetches
+/// their buckets, then finishes the probes as a batch, so that their cache
+/// misses overlap instead of stalling the pipeline one by one. The rest of
+/// the pipeline is the continuation f(tuple, result), with the result of
+/// Hashmapx::findOne or Hashset::contains.
+{
+   using key_t = typename HT::key_type;
+   using hash_t = runtime::Hashmap::hash_t;
+   struct Probe {
+      hash_t hash;
+      key_t key;
+      /// what the continuation needs of the tuple, e.g. its position
+      T tuple;
+   };
+
+   HT& ht;
+   F f;
+   Probe probes[N];
+   size_t n = 0;
+
+ public:
+   ProbeStage(HT& h, F continuation) : ht(h), f(continuation) {}
+   ProbeStage(const ProbeStage&) = delete;
+   ProbeStage(ProbeStage&&) = delete;
+   ~ProbeStage() { flush(); }
+
+   /// probe key for tuple, finished at the latest by the next flush
+   inline void push(const key_t& key, const T& tuple) {
+      auto hash = ht.hash(key);
+      __builtin_prefetch(&ht.entries[hash & ht.mask]);
+      probes[n++] = Probe{hash, key, tuple};
+      if (n == N) flush();
+   }
+
+   /// finish all buffered probes, e.g. at the end of a morsel
+   inline void flush() {
+      // the bucket heads are cached now, prefetch the first entries
+      for (size_t i = 0; i < n; ++i)
+         __builtin_prefetch(reinterpret_cast<void*>(
+             reinterpret_cast<uintptr_t>(ht.find_chain(probes[i].hash)) &
+             ht.maskPointer));
+      for (size_t i = 0; i < n; ++i)
+         f(probes[i].tuple, probe(ht, probes[i].key, probes[i].hash));
+      n = 0;
+   }
+};
+
+/// Stage probing ht for tuples of type T before continuing with f
+template <typename T, size_t N = probeBatch, typename HT, typename F>
+ProbeStage<HT, T, F, N> probeStage(HT& ht, F f) {
+   return ProbeStage<HT, T, F, N>(ht, f);
+}
+} // namespace hyper
@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace hyper {
+
+/// Tuples a SIMD scan selects at once, their match list stays in the L1 cache
+static const size_t selectionBatch = 1024;
+
+template <typename T> struct Between
+/// Predicate min <= column[i] <= max on the values of a column of
+/// types::Integer, Date or Numeric
+{
+   using value_t = decltype(T::value);
+   static_assert(sizeof(value_t) == 4 || sizeof(value_t) == 8,
+                 "only 32 and 64 bit values are supported");
+   const value_t* column;
+   value_t min;
+   value_t max;
+   Between(const T* c, T mi, T ma)
+       : column(reinterpret_cast<const value_t*>(c)), min(mi.value),
+         max(ma.value) {}
+   bool operator()(size_t i) const {
+      return (min <= column[i]) & (column[i] <= max);
+   }
+};
+
+template <typename T> Between<T> between(const T* column, T min, T max) {
+   return Between<T>(column, min, max);
+}
+/// Predicate column[i] < bound
+template <typename T> Between<T> less(const T* column, T bound) {
+   using value_t = typename Between<T>::value_t;
+   return Between<T>(column, T(std::numeric_limits<value_t>::min()),
+                     T(bound.value - 1));
+}
+
+namespace selection {
+#if defined(__AVX512F__)
+/// bit j set if tuple i + j satisfies p
+template <typename T>
+inline __mmask16 mask(const Between<T>& p, size_t i) {
+   if constexpr (sizeof(typename Between<T>::value_t) == 4) {
+      auto v = _mm512_loadu_si512(p.column + i);
+      return _mm512_cmpge_epi32_mask(v, _mm512_set1_epi32(p.min)) &
+             _mm512_cmple_epi32_mask(v, _mm512_set1_epi32(p.max));
+   } else {
+      auto min = _mm512_set1_epi64(p.min);
+      auto max = _mm512_set1_epi64(p.max);
+      auto lo = _mm512_loadu_si512(p.column + i);
+      auto hi = _mm512_loadu_si512(p.column + i + 8);
+      __mmask16 l = _mm512_cmpge_epi64_mask(lo, min) &
+                    _mm512_cmple_epi64_mask(lo, max);
+      __mmask16 h = _mm512_cmpge_epi64_mask(hi, min) &
+                    _mm512_cmple_epi64_mask(hi, max);
+      return l | (h << 8);
+   }
+}
+#elif defined(__AVX2__)
+/// bit j set if tuple i + j satisfies p
+template <typename T> inline unsigned mask(const Between<T>& p, size_t i) {
+   auto in = reinterpret_cast<const __m256i*>(p.column + i);
+   if constexpr (sizeof(typename Between<T>::value_t) == 4) {
+      auto v = _mm256_loadu_si256(in);
+      auto out =
+          _mm256_or_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(p.min), v),
+                          _mm256_cmpgt_epi32(v, _mm256_set1_epi32(p.max)));
+      return ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 0xff;
+   } else {
+      auto min = _mm256_set1_epi64x(p.min);
+      auto max = _mm256_set1_epi64x(p.max);
+      auto lo = _mm256_loadu_si256(in);
+      auto hi = _mm256_loadu_si256(in + 1);
+      auto l = _mm256_or_si256(_mm256_cmpgt_epi64(min, lo),
+                               _mm256_cmpgt_epi64(lo, max));
+      auto h = _mm256_or_si256(_mm256_cmpgt_epi64(min, hi),
+                               _mm256_cmpgt_epi64(hi, max));
+      return ~(_mm256_movemask_pd(_mm256_castsi256_pd(l)) |
+               (_mm256_movemask_pd(_mm256_castsi256_pd(h)) << 4)) &
+             0xff;
+   }
+}
+
+struct Permutations
+/// Lanes of the set bits of each 8 bit mask, moved to the front
+{
+   alignas(32) uint32_t lanes[256][8];
+};
+constexpr Permutations makePermutations() {
+   Permutations p{};
+   for (unsigned m = 0; m < 256; ++m) {
+      unsigned k = 0;
+      for (unsigned lane = 0; lane < 8; ++lane)
+         if (m & (1u << lane)) p.lanes[m][k++] = lane;
+   }
+   return p;
+}
+inline constexpr Permutations permutations = makePermutations();
+#endif
+} // namespace selection
+
+/// Offsets from begin of the tuples in [begin, end) which satisfy all
+/// predicates, written to matches, which has room for end - begin entries.
+/// Returns the number of matches.
+template <typename... P>
+inline size_t select(size_t begin, size_t end, uint32_t* matches,
+                     const P&... predicates) {
+   size_t found = 0;
+   size_t i = begin;
+#if defined(__AVX512F__)
+   // AVX-512 compresses the offsets of the matching lanes
+   auto ids =
+       _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+   for (; i + 16 <= end; i += 16) {
+      __mmask16 m = (selection::mask(predicates, i) & ...);
+      _mm512_mask_compressstoreu_epi32(matches + found, m, ids);
+      found += __builtin_popcount(m);
+      ids = _mm512_add_epi32(ids, _mm512_set1_epi32(16));
+   }
+#elif defined(__AVX2__)
+   // AVX2 moves the matching lanes to the front with a permutation table
+   auto ids = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+   for (; i + 8 <= end; i += 8) {
+      unsigned m = (selection::mask(predicates, i) & ...);
+      auto lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(
+          selection::permutations.lanes[m]));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(matches + found),
+                          _mm256_permutevar8x32_epi32(ids, lanes));
+      found += __builtin_popcount(m);
+      ids = _mm256_add_epi32(ids, _mm256_set1_epi32(8));
+   }
+#endif
+   for (; i < end; ++i) {
+      matches[found] = i - begin;
+      found += (predicates(i) & ...);
+   }
+   return found;
+}
+
+/// Calls f(i) for the tuples i of [begin, end) which satisfy all predicates.
+/// The predicates of a batch are evaluated with SIMD first, so that only the
+/// matching tuples are processed one at a time.
+template <typename F, typename... P>
+inline void forEachMatch(size_t begin, size_t end, F&& f,
+                         const P&... predicates) {
+   uint32_t matches[selectionBatch];
+   for (size_t b = begin; b < end; b += selectionBatch) {
+      auto n = select(b, std::min(b + selectionBatch, end), matches,
+                      predicates...);
+      for (size_t m = 0; m < n; ++m) f(b + matches[m]);
+   }
+}
+} // namespace hyper
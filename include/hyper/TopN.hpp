@@ -0,0 +1,85 @@
+#pragma once
+#include "tbb/tbb.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <vector>
+
+/// Keeps the first limit tuples in the order given by LESS. RANK maps a tuple
+/// to an int64 which is monotone in the first order key, smaller ranks come
+/// first. The worst rank of any full thread local heap bounds the result and
+/// is shared, so that producers can discard tuples before building them.
+template <typename T, typename LESS, typename RANK> class TopN {
+   /// Thread local bounded heaps, the worst tuple is on top
+   tbb::enumerable_thread_specific<std::vector<T>> heaps;
+   /// Smallest rank of the worst tuple of all full heaps
+   std::atomic<int64_t> threshold;
+
+   size_t limit;
+   LESS less;
+   RANK rank;
+
+   void publish(int64_t local) {
+      auto current = threshold.load(std::memory_order_relaxed);
+      while (local < current &&
+             !threshold.compare_exchange_weak(current, local,
+                                              std::memory_order_relaxed))
+         ;
+   }
+
+ public:
+   TopN(size_t limit_, LESS l, RANK r)
+       : threshold(std::numeric_limits<int64_t>::max()), limit(limit_),
+         less(l), rank(r) {}
+
+   TopN(const TopN& t) = delete;
+
+   /// Class which manages the thread local heap
+   class Locals {
+      TopN& parent;
+      std::vector<T>& heap;
+
+    public:
+      Locals(TopN& p, std::vector<T>& h) : parent(p), heap(h) {}
+
+      /// true if no tuple with this rank can be part of the result
+      inline bool discards(int64_t rank) const {
+         return rank > parent.threshold.load(std::memory_order_relaxed);
+      }
+
+      /// consume tuple
+      template <typename TUPLE> inline void consume(TUPLE&& tuple) {
+         if (heap.size() < parent.limit) {
+            heap.emplace_back(std::forward<TUPLE>(tuple));
+            std::push_heap(heap.begin(), heap.end(), parent.less);
+            if (heap.size() < parent.limit) return;
+         } else if (parent.less(tuple, heap.front())) {
+            // replace the worst tuple
+            std::pop_heap(heap.begin(), heap.end(), parent.less);
+            heap.back() = std::forward<TUPLE>(tuple);
+            std::push_heap(heap.begin(), heap.end(), parent.less);
+         } else
+            return;
+         parent.publish(parent.rank(heap.front()));
+      }
+   };
+
+   /// Create thread local state
+   Locals locals() { return Locals(*this, heaps.local()); }
+
+   /// Merge the thread local heaps and pass the result in order to consume
+   template <typename C> void forallTuples(C consume) {
+      std::vector<T> result;
+      for (auto& heap : heaps)
+         result.insert(result.end(), heap.begin(), heap.end());
+      auto n = std::min(limit, result.size());
+      std::partial_sort(result.begin(), result.begin() + n, result.end(), less);
+      result.resize(n);
+      consume(result);
+   }
+};
+
+template <typename T, typename LESS, typename RANK>
+TopN<T, LESS, RANK> make_TopN(size_t limit, LESS l, RANK r) {
+   return TopN<T, LESS, RANK>(limit, l, r);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common/algebra/Operators.hpp"
+#include "common/runtime/Concurrency.hpp"
+#include "common/runtime/Database.hpp"
+#include "common/runtime/Query.hpp"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hyper {
+
+/// C++ source of a query running plan, whose root must be a print. Defines
+/// the function `query` with the signature of CompiledQuery::Function, which
+/// reads the relations of the scans from its first argument in the order
+/// given in relations.
+std::string generate(algebra::Operator& plan,
+                     std::vector<runtime::Relation*>& relations);
+
+/// Arguments of the compiler call compiling source into the shared object
+/// object, with the compiler, flags and include paths of this build
+std::vector<std::string> compilerArguments(const std::string& source,
+                                           const std::string& object);
+
+class QueryCache
+/// Shared objects of compiled queries on local disk, reused across
+/// processes. Keyed by the generated source, the compiler and its flags, the
+/// cpu and the runtime headers, so changing any of them compiles anew.
+{
+ public:
+   const std::string directory;
+   std::atomic<size_t> hits{0};
+   std::atomic<size_t> misses{0};
+
+   /// cache in directory, which is created if missing. Throws runtime_error
+   /// unless it is a directory, not a symlink, of this user with mode 0700,
+   /// as the cached shared objects are loaded into the process.
+   explicit QueryCache(std::string directory);
+   /// cache in the directory of env HyperCache, by default hyper in
+   /// XDG_CACHE_HOME or ~/.cache
+   static QueryCache& global();
+   /// path of the shared object of source, compiled if not cached; throws
+   /// runtime_error with the compiler output if compiling fails
+   std::string get(const std::string& source);
+
+ private:
+   std::atomic<size_t> nextFile{0};
+};
+
+class CompiledQuery
+/// Plan compiled into a shared object with the system compiler and loaded
+/// into the process. The scanned relations must outlive it.
+{
+ public:
+   using Function = runtime::Query* (*)(runtime::Relation* const* relations,
+                                        size_t nrThreads);
+   /// runs the query without the compiled code, e.g. a vectorwise plan
+   using Fallback =
+       std::function<std::unique_ptr<runtime::Query>(size_t nrThreads)>;
+
+   /// generate, compile and load plan
+   explicit CompiledQuery(algebra::Operator& plan,
+                          QueryCache& cache = QueryCache::global());
+   /// compile plan in the background, run uses fallback until it is loaded
+   CompiledQuery(algebra::Operator& plan, Fallback fallback,
+                 QueryCache& cache = QueryCache::global());
+   CompiledQuery(const CompiledQuery&) = delete;
+   ~CompiledQuery();
+
+   /// whether run uses the compiled query
+   bool ready();
+   /// run the compiled query or the fallback, rethrows compile errors
+   std::unique_ptr<runtime::Query> run(size_t nrThreads);
+   const std::string& source() const { return code; }
+
+ private:
+   std::string code;
+   std::vector<runtime::Relation*> relations;
+   Fallback fallback;
+   /// path of the shared object compiled in the background
+   std::future<std::string> compilation;
+   void* handle = nullptr;
+   Function function = nullptr;
+
+   void load(const std::string& path);
+};
+} // namespace hyper
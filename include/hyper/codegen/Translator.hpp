@@ -2,12 +2,89 @@
 
 #include "common/algebra/Operators.hpp"
 #include "hyper/codegen/TranslatorRegistry.hpp"
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace hyper{
 
+   struct Variable {
+      /// C++ variable holding the value in the tuple loop
+      std::string name;
+      /// C++ type, usually an alias declared before the pipeline
+      std::string type;
+   };
+
+   class Context
+   /// State of the code generation for one query. Operators write the
+   /// function body pipeline by pipeline, a pipeline is opened by its source
+   /// (a scan or the output of a group by) and runs parallel over morsels.
+   {
+   public:
+      struct Pipeline {
+         /// before the pipeline: types, constants and operator state
+         std::ostringstream declarations;
+         /// at the start of each morsel, e.g. thread local state
+         std::ostringstream morsel;
+         /// per tuple
+         std::ostringstream tuple;
+         /// after the pipeline, e.g. building a hash table
+         std::ostringstream finish;
+      };
+      /// pipeline being generated
+      std::unique_ptr<Pipeline> pipeline;
+      /// attributes of the pipeline by their qualified name
+      std::unordered_map<std::string, Variable> attributes;
+      /// attributes an operator materialized in its state, with their type
+      /// in the order of its tuples, e.g. the payload of a hash join
+      std::unordered_map<const algebra::Operator*,
+                         std::vector<std::pair<std::string, std::string>>>
+          materialized;
+      /// relations of the scans, passed to the query in this order
+      std::vector<runtime::Relation*> relations;
+      /// the function body
+      std::ostringstream body;
+
+      /// new unique C++ identifier
+      std::string fresh(const std::string& prefix);
+      /// suffix of the names of an operator's state, the same in all of its
+      /// pipelines
+      std::string id(const algebra::Operator& op);
+      /// variable of a qualified attribute, throws for unknown attributes
+      const Variable& attribute(const std::string& name) const;
+      /// C++ code of e in the tuple loop, if typeOnly with std::declval in
+      /// place of the attributes, for decltype
+      std::string expression(const algebra::Expression& e,
+                             bool typeOnly = false);
+      /// C++ type of the values of an algebra type
+      static std::string cppType(const algebra::Type& t);
+      /// attributes read by the ancestors of op
+      static std::unordered_set<std::string>
+      usedAbove(const algebra::Operator& op);
+
+      /// start a new pipeline without attributes
+      void beginPipeline();
+      /// add the pipeline to the body, morselBegin opens the loop over the
+      /// morsels, tupleBegin the loop over the tuples of a morsel
+      void endPipeline(const std::string& morselBegin,
+                       const std::string& tupleBegin,
+                       const std::string& tupleEnd,
+                       const std::string& morselEnd);
+
+   private:
+      size_t nextId = 0;
+      std::unordered_map<const algebra::Operator*, std::string> ids;
+      /// variables of the constants, declared before their first use
+      std::unordered_map<const algebra::Expression*, std::string> constants;
+   };
+
    class Translator{
    public:
-      static void produce(algebra::Operator& op, std::ostream& s);
-      static void consume(algebra::Operator& op, algebra::Operator& source , std::ostream& s);
+      static void produce(algebra::Operator& op, Context& ctx);
+      static void consume(algebra::Operator& op, algebra::Operator& source,
+                          Context& ctx);
    };
 }
@@ -1,13 +1,16 @@
 #pragma once
 
-#include "hyper/codegen/Translator.hpp"
+#include "common/algebra/Operators.hpp"
+#include <string>
 #include <unordered_map>
 
 namespace hyper {
 
-typedef void (*ProduceFunc)(algebra::Operator& op, std::ostream& s);
+class Context;
+
+typedef void (*ProduceFunc)(algebra::Operator& op, Context& ctx);
 typedef void (*ConsumeFunc)(algebra::Operator& op, algebra::Operator& sender,
-                            std::ostream& s);
+                            Context& ctx);
 
 class TranslatorRegistry {
  public:
@@ -1,9 +1,17 @@
 #pragma once
 #include "Primitives.hpp"
-#include <experimental/tuple>
+#include <chrono>
 #include <functional>
+#include <iosfwd>
+#include <map>
 #include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace vectorwise {
 
@@ -11,7 +19,49 @@ namespace vectorwise {
 // Gather
 
 struct Op;
+
+/// evaluate expressions with their compiled programs instead of calling
+/// each op through its virtual run
+extern bool threadedCode;
+
+/// One step of a compiled program. Plain primitive calls are executed
+/// directly, reading their arguments through the addresses of the op fields
+/// because operators rebind these fields for every vector. Everything else
+/// runs through a thunk.
+struct Instruction {
+   enum Kind : uint8_t { F1, F2, F3, F4, Thunk, End };
+   using Primitive = void (*)();
+   Kind kind = End;
+   Primitive primitive = nullptr;
+   void* const* args[4] = {};
+   pos_t (*thunk)(Op*, pos_t) = nullptr;
+   Op* op = nullptr;
+};
+
+/// Flat instruction array for the ops of an expression, dispatched with
+/// computed gotos
+class Program {
+   std::vector<Instruction> code;
+   /// the ops code was compiled from, in order
+   std::vector<const Op*> source;
+
+ public:
+   /// true if the program was compiled from exactly these ops
+   bool compiledFor(const std::vector<std::unique_ptr<Op>>& ops) const {
+      if (code.empty() || source.size() != ops.size()) return false;
+      for (size_t i = 0; i < ops.size(); ++i)
+         if (source[i] != ops[i].get()) return false;
+      return true;
+   }
+   void compile(const std::vector<std::unique_ptr<Op>>& ops);
+   /// run all instructions, chain passes the result of each instruction as
+   /// n to the next one, otherwise all get n and the last result is returned
+   template <bool chain> pos_t run(pos_t n);
+};
+
 class Expression {
+   Program program;
+
  public:
    std::vector<std::unique_ptr<Op>> ops;
    /// Evaluate all operations of this expression
@@ -21,6 +71,8 @@ class Expression {
 };
 
 class Aggregates {
+   Program program;
+
  public:
    std::vector<std::unique_ptr<Op>> ops;
    /// Evaluate all operations of this aggregate
@@ -43,16 +95,75 @@ class Scatter {
    pos_t evaluate(pos_t n, void* start);
 };
 
+/// number of the next op a thread creates, reset for every plan a
+/// QueryBuilder builds
+extern thread_local size_t nextOpSite;
+
 struct Op {
+   /// call site of this op in its plan. Every worker and repetition builds
+   /// the same plan in the same order, so their copies of an op share it.
+   size_t site = nextOpSite++;
    virtual pos_t run(pos_t n) = 0;
+   /// emit the instruction executing this op, calls run by default
+   virtual void compile(Instruction& i);
+   /// primitive this op calls, identifies it in the PrimitiveProfile.
+   /// nullptr for ops which evaluate nested expressions.
+   virtual const void* primitive() const { return nullptr; }
    virtual ~Op() = default;
 };
 
+/// Run the ops of expressions one by one and record their cost in
+/// primitiveProfile
+extern bool primitiveProfiling;
+
+class PrimitiveProfile
+/// Calls, tuples and cycles per call site of a primitive, summed over all
+/// threads
+{
+ public:
+   struct Site {
+      /// Op::site
+      size_t op;
+      const void* primitive;
+      bool operator<(const Site& other) const {
+         return std::tie(op, primitive) < std::tie(other.op, other.primitive);
+      }
+   };
+   struct Counters {
+      uint64_t calls = 0;
+      uint64_t tuples = 0;
+      uint64_t cycles = 0;
+      /// retired instructions, if counted
+      uint64_t instructions = 0;
+   };
+   /// count retired instructions with a hardware counter of each thread, if
+   /// the kernel permits it
+   bool countInstructions = false;
+
+   /// run op and add its cost to its call site
+   pos_t run(Op& op, pos_t n);
+   /// counters of all call sites so far
+   std::map<Site, Counters> collect();
+   /// table of all call sites, most expensive first
+   void print(std::ostream& out);
+   void reset();
+};
+extern PrimitiveProfile primitiveProfile;
+
 template <typename> class OpArgs;
 
 template <typename... Args>
 class OpArgs<pos_t (*)(pos_t, Args...)> : public Op {
-   std::function<pos_t(pos_t, Args...)> function;
+   pos_t (*function)(pos_t, Args...);
+
+   template <size_t... I>
+   inline pos_t call(pos_t n, std::index_sequence<I...>) {
+      return function(n, std::get<I>(args)...);
+   }
+   static pos_t invoke(Op* op, pos_t n) {
+      return static_cast<OpArgs*>(op)->call(n,
+                                            std::index_sequence_for<Args...>());
+   }
 
  public:
    std::tuple<Args...> args;
@@ -63,12 +174,82 @@ class OpArgs<pos_t (*)(pos_t, Args...)> : public Op {
       return std::get<n>(args);
    }
 
-   virtual pos_t run(pos_t n) override {
-      return std::experimental::apply(function,
-                                      std::tuple_cat(std::make_tuple(n), args));
+   virtual pos_t run(pos_t n) override { return invoke(this, n); }
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(function);
+   }
+   virtual void compile(Instruction& i) override {
+      i.kind = Instruction::Thunk;
+      i.thunk = &invoke;
+      i.op = this;
+   }
+};
+
+/// Settings of micro-adaptive flavor selection. If enabled, every primitive
+/// call site with several flavors (see primitives::flavorsOf) alternates
+/// between an explore phase, which runs each flavor for exploreCalls calls
+/// and measures its cycles per tuple, and an exploit phase of exploitCalls
+/// calls with the cheapest flavor. Read when an operation is constructed.
+struct MicroAdaptivity {
+   bool enabled = false;
+   uint32_t exploreCalls = 2;
+   uint32_t exploitCalls = 256;
+};
+extern MicroAdaptivity microAdaptivity;
+
+inline uint64_t cycleCounter() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+   return __rdtsc();
+#else
+   return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/// Decides which flavor the next call of a primitive call site uses
+class FlavorChooser {
+   std::vector<uint64_t> cycles;
+   std::vector<uint64_t> tuples;
+   uint32_t exploreCalls;
+   uint32_t exploitCalls;
+   uint64_t calls = 0;
+   size_t best = 0;
+
+ public:
+   FlavorChooser(size_t nrFlavors, const MicroAdaptivity& settings);
+   /// flavor for the next call, measure is set if its cost must be recorded
+   size_t next(bool& measure);
+   /// record the cost of a measured call
+   void record(size_t flavor, uint64_t cycles, pos_t n);
+   /// flavor used in the current or last exploit phase
+   size_t exploited() const { return best; }
+};
+
+template <typename F> struct AdaptivePrimitive {
+   std::vector<F> flavors;
+   FlavorChooser chooser;
+   AdaptivePrimitive(std::vector<F> f)
+       : flavors(std::move(f)), chooser(flavors.size(), microAdaptivity) {}
+   template <typename... Args> pos_t run(pos_t n, Args... args) {
+      bool measure;
+      auto flavor = chooser.next(measure);
+      if (!measure) return flavors[flavor](n, args...);
+      auto start = cycleCounter();
+      auto found = flavors[flavor](n, args...);
+      chooser.record(flavor, cycleCounter() - start, n);
+      return found;
    }
 };
 
+/// Wraps op for micro-adaptive execution if that is enabled and op has
+/// several flavors, returns nullptr otherwise
+template <typename F>
+std::unique_ptr<AdaptivePrimitive<F>> makeAdaptive(F op) {
+   if (!microAdaptivity.enabled) return nullptr;
+   auto flavors = primitives::flavorsOf(op);
+   if (flavors.size() < 2) return nullptr;
+   return std::make_unique<AdaptivePrimitive<F>>(std::move(flavors));
+}
+
 using FScatterOp = OpArgs<primitives::FScatter>;
 using FScatterSelOp = OpArgs<primitives::FScatterSel>;
 using FScatterSelRowOp = OpArgs<primitives::FScatterSelRow>;
@@ -80,6 +261,9 @@ using FPartitionByKeyOp = OpArgs<primitives::FPartitionByKey>;
 using FPartitionByKeySelOp = OpArgs<primitives::FPartitionByKeySel>;
 using FPartitionByKeyRowOp = OpArgs<primitives::FPartitionByKeyRow>;
 using NEQCheckRowOp = OpArgs<primitives::NEQCheckRow>;
+using FPackOp = OpArgs<primitives::FPack>;
+using FPackSelOp = OpArgs<primitives::FPackSel>;
+using F5_Op = OpArgs<primitives::F5>;
 using F6_Op = OpArgs<primitives::F6>;
 using F7_Op = OpArgs<primitives::F7>;
 
@@ -90,6 +274,23 @@ struct GatherOpCol : public Op {
    void* target;
    GatherOpCol(primitives::FGather op, void** source, size_t off, void* target);
    virtual pos_t run(pos_t n) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(op);
+   }
+};
+
+struct GatherSelOpCol : public Op {
+   primitives::FGatherSel op;
+   pos_t* selection;
+   void** source;
+   size_t offset;
+   void* target;
+   GatherSelOpCol(primitives::FGatherSel op, pos_t* selection, void** source,
+                  size_t off, void* target);
+   virtual pos_t run(pos_t n) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(op);
+   }
 };
 
 struct GatherOpVal : public Op {
@@ -101,6 +302,9 @@ struct GatherOpVal : public Op {
    GatherOpVal(primitives::FGatherVal op, void** source, size_t off,
                size_t* struct_size, void* target);
    virtual pos_t run(pos_t n) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(op);
+   }
 };
 
 struct EqualityCheck : public Op {
@@ -113,6 +317,9 @@ struct EqualityCheck : public Op {
                  pos_t* probeIdxs, void* probeData);
    /// run check operations
    virtual pos_t run(pos_t n) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(prim);
+   }
 };
 
 struct NEqualityCheck : public Op {
@@ -125,6 +332,9 @@ struct NEqualityCheck : public Op {
    NEqualityCheck(primitives::NEQCheck eq, pos_t* entryIdx, void** entry,
                   void* probeKey, size_t offset, SizeBuffer<pos_t>* notEq);
    virtual pos_t run(pos_t n) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(eq);
+   }
 };
 
 struct NEqualityCheckSel : public Op {
@@ -139,6 +349,42 @@ struct NEqualityCheckSel : public Op {
                      pos_t* probes, void* probeKey, size_t offset,
                      SizeBuffer<pos_t>* notEq);
    virtual pos_t run(pos_t n) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(eq);
+   }
+};
+
+struct FusedOp : public Op
+/// fused primitive replacing a producer and a consumer op. Runs the original
+/// ops instead if the intermediate result turns out to be needed elsewhere.
+{
+   std::unique_ptr<Op> fused;
+   std::unique_ptr<Op> producer;
+   std::unique_ptr<Op> consumer;
+   bool materialize = false;
+   FusedOp(std::unique_ptr<Op> f, std::unique_ptr<Op> p,
+           std::unique_ptr<Op> c)
+       : fused(std::move(f)), producer(std::move(p)), consumer(std::move(c)) {}
+   virtual pos_t run(pos_t n) override;
+   const void* primitive() const override { return fused->primitive(); }
+};
+
+/// Representation in which a selection passes the qualifying tuples on: all
+/// tuples of the vector, a bitmap (see primitives::bitmap_t) over the vector
+/// or a selection vector
+enum class SelectionKind : uint8_t { All, Bitmap, List };
+/// smallest fraction of qualifying tuples which is passed on as bitmap
+extern double bitmapDensity;
+
+struct SelectionSwitch : public Op
+/// runs the alternative for the representation of the current selection
+{
+   const SelectionKind* kind;
+   std::unique_ptr<Expression> alternatives[3];
+   SelectionSwitch(const SelectionKind* k, std::unique_ptr<Expression> all,
+                   std::unique_ptr<Expression> bitmap,
+                   std::unique_ptr<Expression> list);
+   virtual pos_t run(pos_t n) override;
 };
 
 struct F1_Op : public Op {
@@ -146,15 +392,24 @@ struct F1_Op : public Op {
    primitives::F1 operation;
    F1_Op(void* i, primitives::F1 op) : input(i), operation(op) {}
    virtual pos_t run(pos_t n) override;
+   virtual void compile(Instruction& i) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(operation);
+   }
 };
 
 struct F2_Op : public Op {
    void* input;
    void* param1;
    primitives::F2 operation;
+   std::unique_ptr<AdaptivePrimitive<primitives::F2>> adaptive;
    F2_Op(void* i, void* p1, primitives::F2 op)
-       : input(i), param1(p1), operation(op) {}
+       : input(i), param1(p1), operation(op), adaptive(makeAdaptive(op)) {}
    virtual pos_t run(pos_t n) override;
+   virtual void compile(Instruction& i) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(operation);
+   }
 };
 
 struct F3_Op : public Op
@@ -164,9 +419,15 @@ struct F3_Op : public Op
    void* param1;
    void* param2;
    primitives::F3 operation;
+   std::unique_ptr<AdaptivePrimitive<primitives::F3>> adaptive;
    F3_Op(void* out, void* p1, void* p2, primitives::F3 o)
-       : outputSelectionV(out), param1(p1), param2(p2), operation(o) {}
+       : outputSelectionV(out), param1(p1), param2(p2), operation(o),
+         adaptive(makeAdaptive(o)) {}
    virtual pos_t run(pos_t n) override;
+   virtual void compile(Instruction& i) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(operation);
+   }
 };
 
 struct F4_Op : public Op
@@ -177,9 +438,14 @@ struct F4_Op : public Op
    void* param1;
    void* param2;
    primitives::F4 operation;
+   std::unique_ptr<AdaptivePrimitive<primitives::F4>> adaptive;
    F4_Op(void* in, void* out, void* p1, void* p2, primitives::F4 o)
        : inputSelectionV(in), outputSelectionV(out), param1(p1), param2(p2),
-         operation(o) {}
+         operation(o), adaptive(makeAdaptive(o)) {}
    virtual pos_t run(pos_t n) override;
+   virtual void compile(Instruction& i) override;
+   const void* primitive() const override {
+      return reinterpret_cast<const void*>(operation);
+   }
 };
 }
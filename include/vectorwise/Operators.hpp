@@ -6,11 +6,18 @@
 #include "common/runtime/Hashmap.hpp"
 #include "common/runtime/PartitionedDeque.hpp"
 #include "common/runtime/Query.hpp"
+#include "common/runtime/Spill.hpp"
+#include "tbb/concurrent_queue.h"
 #include "vectorwise/Primitives.hpp"
 #include <atomic>
 #include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -19,6 +26,54 @@ namespace vectorwise {
 
 const size_t EndOfStream = 0;
 
+/// wrap all operators a QueryBuilder creates in Profiled, except the
+/// ResultWriter at the root, which drivers read their results from
+extern bool analyze;
+
+struct OperatorStats
+/// Runtime statistics of one operator of a plan, summed over all workers
+{
+   std::string name;
+   /// positions of the child operators in PlanStats
+   std::vector<size_t> children;
+   std::atomic<uint64_t> calls{0};
+   std::atomic<uint64_t> tuples{0};
+   /// cycles spent in next(), including the children
+   std::atomic<uint64_t> cycles{0};
+   std::atomic<uint64_t> htEntries{0};
+   std::atomic<uint64_t> spilledBytes{0};
+   /// operator specific counters, e.g. the decisions of adaptive operators
+   std::map<std::string, uint64_t> notes;
+   std::mutex notesMutex;
+   void note(const std::string& what, uint64_t count);
+};
+
+class PlanStats
+/// Statistics of all operators of a plan, by the order in which the
+/// QueryBuilder created them, so the root comes last
+{
+   std::mutex m;
+   std::deque<OperatorStats> operators;
+
+   std::vector<size_t> roots() const;
+   uint64_t selfCycles(size_t nr) const;
+   void print(std::ostream& out, size_t nr, size_t depth, uint64_t total);
+   void printJson(std::ostream& out, size_t nr);
+
+ public:
+   OperatorStats& get(size_t nr);
+   /// set name and children of operator nr, if no worker did so before
+   void describe(size_t nr, std::string name, std::vector<size_t> children);
+   bool empty() const { return operators.empty(); }
+   /// plan tree annotated with the statistics of every operator
+   void print(std::ostream& out);
+   void printJson(std::ostream& out);
+};
+
+/// Statistics of the plan analyzed last, nullptr if there is none. Plans
+/// hand them over when their shared state is destroyed.
+std::unique_ptr<PlanStats> takeAnalyzedPlan();
+
 class Operator {
  public:
    Operator() = default;
@@ -26,6 +81,8 @@ class Operator {
    Operator(const Operator&) = delete;
    virtual size_t next() = 0;
    virtual ~Operator() = default;
+   /// add hashtable sizes and spill volumes of this worker
+   virtual void addStats(OperatorStats&) const {}
 };
 
 class UnaryOperator : public Operator {
@@ -39,12 +96,44 @@ class BinaryOperator : public Operator {
    std::unique_ptr<Operator> right;
 };
 
+class Profiled : public Operator
+/// Forwards to op and records its statistics, which are added to the plan
+/// statistics when the worker destroys its plan
+{
+   PlanStats& plan;
+   size_t nr;
+   uint64_t calls = 0;
+   uint64_t tuples = 0;
+   uint64_t cycles = 0;
+
+ public:
+   std::unique_ptr<Operator> op;
+   Profiled(std::unique_ptr<Operator> op, PlanStats& plan, size_t nr);
+   ~Profiled();
+   size_t next() override;
+};
+
 class Select : public UnaryOperator {
  public:
    std::unique_ptr<Expression> condition;
    virtual size_t next() override;
 };
 
+class AdaptiveSelect : public Select
+/// Selection which passes the qualifying tuples of each vector on as all
+/// selected, bitmap or selection vector, depending on their density. The
+/// condition produces either representation, the other one is derived.
+{
+ public:
+   /// the condition produces a bitmap, otherwise a selection vector
+   bool bitmapCondition = true;
+   primitives::bitmap_t* bitmap = nullptr;
+   pos_t* selection = nullptr;
+   /// representation of the last vector passed on
+   SelectionKind kind = SelectionKind::List;
+   virtual size_t next() override;
+};
+
 class Project : public UnaryOperator {
  public:
    std::vector<std::unique_ptr<Expression>> expressions;
@@ -73,7 +162,12 @@ class SharedStateManager {
    std::mutex onceMutex;
 
  public:
-   SharedStateManager() : oncesExecuted(0) {}
+   /// statistics of the operators if the plan is analyzed
+   std::unique_ptr<PlanStats> stats;
+
+   SharedStateManager()
+       : oncesExecuted(0), stats(std::make_unique<PlanStats>()) {}
+   ~SharedStateManager();
    template <typename T> T& get(size_t i) {
       std::lock_guard<std::mutex> lock(m);
       auto s = state.find(i);
@@ -136,18 +230,24 @@ template <typename PAYLOAD> class DebugOperator : public UnaryOperator {
    std::function<void(PAYLOAD&)> finish_;
 };
 
-class Scan : public Operator {
+class Scan : public Operator
+/// Produces vectors of the morsels a worker claims. Every worker owns an
+/// equal range of morsels and claims them in order. Workers which exhausted
+/// their range steal from the one with the most morsels left, in their own
+/// NUMA region first, so a slow worker does not hold up the others.
+{
  public:
    struct Shared : public SharedState {
-      // One atomic counter per NUMA region, padded to a cache line each to
-      // prevent false sharing between regions.  fetch_add uses relaxed order:
-      // the counter only gates which chunk a thread claims, and the actual
-      // data access imposes the necessary ordering through the column pointer
-      // arithmetic that follows.
+      // One counter of claimed morsels per worker, padded to a cache line
+      // each to prevent false sharing. fetch_add uses relaxed order: the
+      // counter only gates which morsel a thread claims, the data itself is
+      // read-only.
       struct alignas(64) PaddedAtomic {
          std::atomic<size_t> val{0};
       };
-      std::array<PaddedAtomic, runtime::NUM_NUMA_REGIONS> pos;
+      std::unique_ptr<PaddedAtomic[]> claimed;
+      size_t workers = 0;
+      std::once_flag init;
       Shared() = default;
    };
 
@@ -156,11 +256,26 @@ class Scan : public Operator {
    Shared& shared;
    bool needsInit;
    size_t vecInChunk;
-   size_t currentChunk;
-   size_t lastOffset;
+   /// first tuple of the current morsel
+   size_t morselBegin = 0;
    size_t nrTuples;
    size_t vecSize;
-   std::vector<std::pair<void**, size_t>> consumers;
+   size_t worker;
+   /// morsels stolen from other workers
+   size_t stolen = 0;
+   struct Consumer {
+      void** colPtr;
+      size_t typeSize;
+      uint8_t* column;
+   };
+   std::vector<Consumer> consumers;
+
+   size_t nrMorsels() const;
+   /// morsels owned by worker w
+   std::pair<size_t, size_t> range(size_t w) const;
+   size_t remaining(size_t w) const;
+   bool claimFrom(size_t w);
+   bool claimMorsel();
 
  public:
    Scan(Shared& sm, size_t nrTuples, size_t vecSize);
@@ -168,6 +283,7 @@ class Scan : public Operator {
    /// type pointed to by colPtr
    void addConsumer(void** colPtr, size_t typeSize);
    virtual size_t next() override;
+   void addStats(OperatorStats& stats) const override;
 };
 
 class ResultWriter : public UnaryOperator {
@@ -224,6 +340,29 @@ class Hashjoin : public BinaryOperator {
    } contCon;
    bool consumed = false;
    std::vector<std::pair<void*, size_t>> allocations;
+   /// Memory for ht entries allocated beyond the spill budget
+   std::unique_ptr<runtime::FileBackedArena> overflow;
+   /// Bytes of ht entries accounted in runtime::spillableBytes
+   size_t accounted = 0;
+   struct AdaptiveJoin
+   /// State of joinAdaptive
+   {
+      std::vector<pos_t (Hashjoin::*)()> candidates;
+      std::unique_ptr<FlavorChooser> chooser;
+      /// candidate for the current probe vector, and the one exploited
+      size_t current = 0;
+      size_t exploited = 0;
+      bool measure = false;
+      bool inVector = false;
+      /// cycles spent on the current probe vector so far
+      uint64_t cycles = 0;
+      /// probe vectors per candidate
+      std::vector<uint64_t> vectors;
+      uint64_t switches = 0;
+      uint64_t probes = 0;
+      uint64_t matches = 0;
+   } adaptive;
+   void chooseJoinCandidates();
 
  public:
    size_t followupBufferSize = 1025;
@@ -232,6 +371,7 @@ class Hashjoin : public BinaryOperator {
 
  public:
    Hashjoin(Shared& sm);
+   void addStats(OperatorStats& stats) const override;
    pos_t batchSize;
    size_t ht_entry_size;
    Expression buildHash;
@@ -268,15 +408,121 @@ class Hashjoin : public BinaryOperator {
    /// selection vector probeSel for probe side
    /// Implementation: For SkylakeX using AVX512
    pos_t joinSelSIMD();
+   /// runs one of the implementations above per probe vector. They are
+   /// ordered by a cost model of build size, cache size, probe density and
+   /// ISA, which picks the first. Then the FlavorChooser measures them and
+   /// switches whenever another one is cheaper per probe tuple.
+   pos_t joinAdaptive();
 
    virtual size_t next() override;
    ~Hashjoin();
 };
 
+class Fetch : public UnaryOperator
+/// Gathers build values which a late materializing Hashjoin left in its ht
+/// entries, placed above the operators that discard join results so that
+/// only surviving entries are loaded
+{
+ public:
+   Aggregates gather;
+   size_t next() override;
+};
+
+class MergeJoin : public BinaryOperator
+/// Equi-join on one key of at most 8 bytes for inputs which arrive sorted on
+/// it, e.g. relations clustered on the join key. Every worker materializes its
+/// part of the build side (left) into a run of rows, which are the key as
+/// normalized prefix followed by the payload. The runs are merged into one
+/// sorted array in key ranges, one range per worker. Probe vectors (right)
+/// stay pipelined: each worker gallops forward through the build keys from
+/// where its previous probe key matched. The result is produced in
+/// buildMatches and probeMatches, like in Hashjoin.
+{
+ public:
+   struct Run {
+      uint8_t* rows;
+      size_t n;
+   };
+   struct Shared : public SharedState {
+      std::mutex runsMutex;
+      std::vector<Run> runs;
+      /// keys which separate the merge partitions
+      std::vector<int64_t> splitters;
+      std::atomic<size_t> partition;
+      /// merged rows and a dense copy of their keys for galloping
+      uint8_t* rows = nullptr;
+      int64_t* keys = nullptr;
+      size_t n = 0;
+      Shared() : partition(0) {}
+   } & shared;
+
+   struct IteratorContinuation
+   /// State to continue iteration in next call
+   {
+      pos_t nextProbe = 0;
+      pos_t numProbes = 0;
+      /// first build row with key not less than the last probe key
+      size_t cursor = 0;
+      /// build rows of the current probe which are not yet produced
+      size_t match = 0;
+      size_t matchEnd = 0;
+   } cont;
+
+   /// bytes of a row, key followed by the payload
+   size_t rowSize = sizeof(int64_t);
+   pos_t batchSize;
+
+   /// ------ build
+   /// Expression which computes normalized build keys into buildKeys
+   Expression buildKey;
+   /// Scatter build keys and payload into rows at scatterStart
+   Aggregates buildScatter;
+   uint8_t* scatterStart;
+   /// Gather primitives reading the build rows in buildMatches
+   Aggregates buildGather;
+   uint8_t** buildMatches;
+
+   /// ------ probe
+   /// Expression which computes normalized probe keys into probeKeys, at the
+   /// position of the probe tuple
+   Expression probeKey;
+   int64_t* probeKeys;
+   pos_t* probeSel = nullptr;
+   pos_t* probeMatches;
+
+   MergeJoin(Shared& shared);
+   virtual size_t next() override;
+
+ private:
+   bool consumed = false;
+   std::vector<uint8_t> localRows;
+
+   /// materialize build side of this worker into a sorted run
+   Run buildRun();
+   /// executed by one worker: choose splitters and allocate the result
+   void prepareMerge();
+   /// merge the rows of partition p from all runs
+   void mergePartition(size_t p);
+   /// position of the first row in run with key not less than key
+   size_t lowerBound(const Run& run, int64_t key);
+   /// position of the first build key not less than key, searched from the
+   /// cursor in exponentially growing steps
+   size_t gallop(int64_t key, size_t from);
+   /// computes join result into buildMatches and probeMatches
+   pos_t join();
+   static int64_t keyOf(const uint8_t* row) {
+      return *reinterpret_cast<const int64_t*>(row);
+   }
+};
+
 class HashGroup : public UnaryOperator {
    runtime::Hashmap ht;
    size_t maxFill;
    const size_t initialMapSize = 1024;
+   /// groups this worker created in its preaggregation and in the global
+   /// aggregation of its partitions
+   size_t localGroups = 0;
+   size_t globalGroups = 0;
 
  public:
    using hash_t = decltype(ht)::hash_t;
@@ -415,11 +661,170 @@ class HashGroup : public UnaryOperator {
    } cont;
 
    virtual size_t next() override;
+   void addStats(OperatorStats& stats) const override;
 
  private:
    void clearHashtable();
 };
 
+class Sort : public UnaryOperator
+/// Parallel sort. Every worker materializes its input into rows of normalized
+/// key bytes followed by the payload and radix sorts them into a run. The key
+/// range is then split into partitions which all workers merge from the runs
+/// into one sorted array. The first worker returns that array in vectors, so
+/// that the global order is kept.
+{
+ public:
+   struct Run {
+      uint8_t* rows;
+      size_t n;
+   };
+   struct Shared : public SharedState {
+      std::mutex runsMutex;
+      std::vector<Run> runs;
+      /// normalized keys which separate the merge partitions
+      std::vector<uint8_t*> splitters;
+      std::atomic<size_t> partition;
+      uint8_t* sorted = nullptr;
+      size_t n = 0;
+      Shared() : partition(0) {}
+   } & shared;
+
+   /// bytes of the normalized key at the start of each row
+   size_t keySize = 0;
+   /// bytes of a row, normalized key followed by the payload
+   size_t rowSize = 0;
+   size_t vecSize;
+
+   /// ------ phase 1: run generation
+   /// Normalize keys and scatter payload into rows at scatterStart
+   Aggregates materialize;
+   uint8_t* scatterStart;
+   std::vector<std::pair<void*, size_t>> allocations;
+
+   /// ------ produce result
+   /// Gather primitives reading rows from outputStart
+   Aggregates gatherRows;
+   uint8_t* outputStart;
+
+   /// number of rows produced, all by default
+   size_t limit = std::numeric_limits<size_t>::max();
+
+   Sort(Shared& shared);
+   virtual size_t next() override;
+
+ protected:
+   bool consumed = false;
+   size_t emitted = 0;
+   /// merge the run of this worker with those of all other workers
+   void mergeRuns(Run run);
+   /// produce the next vector of the merged rows
+   size_t emit();
+
+ private:
+   /// radix sort materialized rows into a contiguous run
+   Run sortRun(size_t n);
+   /// executed by one worker: choose splitters and allocate the result
+   void prepareMerge();
+   /// merge the rows of partition p from all runs
+   void mergePartition(size_t p);
+   /// position of the first row in run with key not less than key
+   size_t lowerBound(const Run& run, const uint8_t* key);
+};
+
+class TopN : public Sort
+/// First limit rows in sort order. Every worker keeps its best rows in a
+/// bounded heap. Once the heap is full, the key prefix of its worst row is
+/// published as a shared threshold and incoming vectors are filtered against
+/// it before their rows are materialized. The heaps are merged like the runs
+/// of Sort.
+{
+ public:
+   struct Shared : public Sort::Shared {
+      /// smallest normalized key prefix of a full heap of any worker
+      std::atomic<int64_t> threshold;
+      Shared() : threshold(std::numeric_limits<int64_t>::max()) {}
+   };
+   std::atomic<int64_t>& sharedThreshold;
+   /// normalized key prefix an input tuple must not exceed, read by the
+   /// threshold selection
+   int64_t threshold = std::numeric_limits<int64_t>::max();
+   /// Selects the input tuples below the threshold into survivors
+   Expression thresholdSelection;
+   int64_t* prefixes;
+   pos_t* survivors;
+
+   TopN(Shared& shared, size_t limit);
+   virtual size_t next() override;
+
+ private:
+   /// rows of the heap, heap holds their slot numbers with the worst on top
+   uint8_t* slots = nullptr;
+   std::vector<uint32_t> heap;
+   uint8_t* row(uint32_t slot) { return slots + slot * rowSize; }
+   void insert(const uint8_t* candidate);
+   void publishThreshold();
+};
+
+class Exchange : public UnaryOperator
+/// Moves tuples between the workers running a plan without barriers. Every
+/// worker pulls vectors from its child and pushes copies into the lock-free
+/// queues of their target workers, and returns vectors from its own queue.
+/// Repartition sends each tuple to the worker chosen by its hash, Broadcast
+/// sends all tuples to every worker and Gather sends them to worker 0.
+{
+ public:
+   enum class Mode { Repartition, Broadcast, Gather };
+   /// up to vecSize tuples, stored column by column
+   struct Batch {
+      size_t n = 0;
+      std::unique_ptr<uint8_t[]> data;
+   };
+   struct Shared : public SharedState {
+      std::once_flag initialized;
+      /// one queue per worker
+      std::deque<tbb::concurrent_queue<Batch*>> queues;
+      /// number of workers which may still push into the queues
+      std::atomic<size_t> producers;
+      Shared() : producers(0) {}
+      ~Shared();
+   } & shared;
+   struct Column {
+      void* input;
+      void* output;
+      size_t size;
+      /// start of the column within a batch
+      size_t offset;
+   };
+   Mode mode;
+   /// deque, as Scan rebinds the input fields by address
+   std::deque<Column> columns;
+   /// selection vector of the input, nullptr if all tuples are moved
+   pos_t* inputSelection = nullptr;
+   /// hashes of the moved tuples, required for Repartition
+   defs::hash_t* hashes = nullptr;
+   size_t vecSize;
+   /// bytes of a batch
+   size_t batchSize = 0;
+
+   Exchange(Shared& shared, Mode mode, size_t vecSize);
+   ~Exchange();
+   /// worker of a tuple with hash among workers under Repartition
+   static size_t target(defs::hash_t hash, size_t workers);
+   virtual size_t next() override;
+
+ private:
+   bool producing = true;
+   /// partially filled batch per target worker for Repartition
+   std::vector<Batch*> staged;
+   Batch* newBatch();
+   /// copy n input tuples into b, all tuples if sel is nullptr
+   void append(Batch& b, pos_t n, pos_t* sel);
+   /// distribute the next vector of the child, false once it is exhausted
+   bool produce();
+   size_t consume(Batch* b);
+};
+
 template <typename T>
 void HashGroup::GroupLookup<T>::htProbe(pos_t n, runtime::Hashmap& ht) {
    // Pass 1: scatter — load chain heads for all n tuples into htMatches.
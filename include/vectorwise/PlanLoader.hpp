@@ -0,0 +1,110 @@
+#pragma once
+#include "common/runtime/Concurrency.hpp"
+#include "common/runtime/Database.hpp"
+#include "common/runtime/Query.hpp"
+#include "vectorwise/QueryBuilder.hpp"
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vectorwise {
+
+struct PlanDescription
+/// Textual description of a vectorwise plan, which is built by the
+/// QueryBuilder without recompiling. One statement per line, pushing and
+/// popping operators like the QueryBuilder calls do. The lines of its body
+/// follow a statement and are indented, # starts a comment:
+///
+///   scan <alias> <relation>
+///   select | project                one expression of all body lines
+///      <primitive> <arg>...
+///   hashjoin <probe matches> [<join>]
+///      probesel <sel> [<join>]
+///      buildkey <col> [<sel>] <hash> <scatter>
+///      probekey <col> [<sel>] <hash> [<sel eq>] <eq>
+///      buildvalue <col> [<sel>] <scatter> <target> <gather>
+///   hashgroup
+///      keysel <sel> <out>
+///      key <col> <hash> <eq> <partition> <scatter> <eq row>
+///          <partition row> <scatter row> <gather> <out>
+///      key <col> <sel> <hash> <eq> <partition> <sel scatter> <scatter>
+///          <eq row> <partition row> <scatter row> <gather> <out>
+///      value <col> [<sel>] <init> <aggr> <aggr row> <gather> <out>
+///   result                          last statement, writes the output
+///      <name> <arg>
+///
+/// Each body line maps to the QueryBuilder method of the same name and
+/// arguments, lines indented deeper continue it. Primitives are named like
+/// the variables in vectorwise::primitives and need the signature of their
+/// place, e.g. F3 for an expression with 3 arguments. If their names mention
+/// types, as in hash_int32_t_col, the columns, constants and typed buffers
+/// of the line must be of these types. <join> is one of all, sel, boncz,
+/// allsimd, selsimd and adaptive. Arguments are
+///   col:<alias>.<attribute>      column of a scan
+///   buf:<name>[:<entry size>]    buffer, the size is given on first use in
+///                                bytes or as a type, e.g. int64_t or pos_t
+///   <type>:<literal>             constant, e.g. Date:1995-03-15, int32_t:5,
+///                                Numeric_12_2:0.05 or Char_25:"MIDDLE EAST"
+{
+   struct Arg {
+      enum Kind { Column, Buffer, Constant, Word } kind;
+      /// scan alias, buffer name or the word itself
+      std::string name;
+      /// attribute of a column
+      std::string attribute;
+      /// number and entry size of a buffer, size 0 if declared before
+      size_t buffer = 0;
+      size_t size = 0;
+      /// value of a constant, or the primitive a word names
+      void* data = nullptr;
+   };
+   struct Line {
+      size_t nr;
+      /// the keyword or primitive first, then its arguments
+      std::vector<Arg> args;
+   };
+   struct Statement {
+      Line head;
+      std::vector<Line> body;
+   };
+
+   std::vector<Statement> statements;
+   /// storage of the constants, read by all workers
+   std::vector<std::unique_ptr<uint64_t[]>> constants;
+
+   /// Parse plan and resolve its primitives and columns in db, throws
+   /// runtime_error with the line number for invalid plans
+   static PlanDescription parse(std::istream& plan, runtime::Database& db);
+   static PlanDescription parse(const std::string& plan,
+                                runtime::Database& db);
+};
+
+class PlanBuilder : public QueryBuilder
+/// Builds the operators of a plan description for one worker
+{
+   const PlanDescription& plan;
+   std::unordered_map<std::string, ScanBuilder> scans;
+
+   DS data(const PlanDescription::Arg& arg);
+   std::unique_ptr<vectorwise::Expression>
+   expression(const std::vector<PlanDescription::Line>& ops);
+   void hashJoin(const PlanDescription::Statement& s);
+   void hashGroup(const PlanDescription::Statement& s);
+
+ public:
+   /// shared state of the result writer, valid after build
+   ResultWriter::Shared* output = nullptr;
+   PlanBuilder(runtime::Database& db, SharedStateManager& shared,
+               const PlanDescription& plan, size_t vectorSize = 1024);
+   /// builds all operators, returns the root
+   std::unique_ptr<Operator> build();
+};
+
+/// run plan on nrThreads workers
+std::unique_ptr<runtime::Query> runPlan(runtime::Database& db,
+                                        const PlanDescription& plan,
+                                        size_t nrThreads,
+                                        size_t vectorSize = 1024);
+} // namespace vectorwise
@@ -0,0 +1,123 @@
+// All primitives of vectorwise::primitives by their function pointer type,
+// expanded through PRIMITIVE(sig, name) and the MK_*_DECL macros of
+// Primitives.hpp. No include guard, since it is expanded once per definition
+// of PRIMITIVE.
+
+EACH_COMP(EACH_TYPE, MK_SEL_COLCOL_DECL)
+EACH_COMP(EACH_TYPE, MK_SEL_COLVALORVAL_DECL)
+EACH_COMP(EACH_TYPE, MK_SEL_COLVAL_DECL)
+EACH_COMP(EACH_TYPE, MK_SELSEL_COLCOL_DECL)
+EACH_COMP(EACH_TYPE, MK_SELSEL_COLVAL_DECL)
+
+EACH_COMP(EACH_TYPE, MK_SEL_COLCOL_BF_DECL)
+EACH_COMP(EACH_TYPE, MK_SEL_COLVAL_BF_DECL)
+EACH_COMP(EACH_TYPE, MK_SELSEL_COLCOL_BF_DECL)
+EACH_COMP(EACH_TYPE, MK_SELSEL_COLVAL_BF_DECL)
+EACH_COMP(EACH_TYPE, MK_BITMAP_SEL_COLVAL_DECL)
+EACH_COMP(EACH_TYPE, MK_BITMAP_SELSEL_COLVAL_DECL)
+
+PRIMITIVE(F3, sel_contains_Varchar_55_col_Varchar_55_val)
+
+EACH_STRING(NIL, MK_LIKE_DECL)
+
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_COLCOL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_COLVAL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_BOTH_COLCOL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_COLCOL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_COL_SEL_COL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_COL_SEL_COL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_COLVAL_DECL)
+EACH_ARITH_NON_COMM(EACH_TYPE_FULL, MK_PROJ_VALCOL_DECL)
+EACH_ARITH_NON_COMM(EACH_TYPE_FULL, MK_PROJ_SEL_VALCOL_DECL)
+
+PRIMITIVE(F2, apply_extract_year_col)
+PRIMITIVE(F3, apply_extract_year_sel_col)
+
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_STATIC_COL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_STATIC_SEL_COL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_STATIC_BITMAP_COL_DECL)
+EACH_TYPE_FULL(EACH_FUSED_ARITH, MK_PROJ_FUSED_DECL)
+EACH_TYPE_FULL(EACH_FUSED_ARITH, MK_AGGR_STATIC_FUSED_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_COL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_SEL_COL_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_ROW_DECL)
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_INIT_DECL)
+PRIMITIVE(F1, aggr_static_count_star)
+PRIMITIVE(FAggr, aggr_count_star)
+
+EACH_TYPE(NIL, MK_HASH_DECL)
+EACH_TYPE(NIL, MK_HASH_SEL_DECL)
+EACH_TYPE(NIL, MK_REHASH_DECL)
+EACH_TYPE(NIL, MK_REHASH_SEL_DECL)
+EACH_PACKED(NIL, MK_HASH_DECL)
+EACH_PACKED(NIL, MK_HASH_SEL_DECL)
+EACH_HASH_FN(EACH_TYPE, MK_HASH_FN_DECL)
+EACH_HASH_FN(EACH_PACKED, MK_HASH_FN_DECL)
+
+EACH_TYPE(NIL, MK_SCATTER_DECL)
+EACH_TYPE(NIL, MK_SCATTER_SEL_DECL)
+EACH_TYPE(NIL, MK_SCATTER_SEL_ROW_DECL)
+EACH_PACKED(NIL, MK_SCATTER_DECL)
+EACH_PACKED(NIL, MK_SCATTER_SEL_DECL)
+EACH_PACKED(NIL, MK_SCATTER_SEL_ROW_DECL)
+
+EACH_TYPE(NIL, MK_GATHER_COL_DECL)
+EACH_TYPE(NIL, MK_GATHER_SEL_COL_DECL)
+EACH_TYPE(NIL, MK_GATHER_VAL_DECL)
+EACH_PACKED(NIL, MK_GATHER_COL_DECL)
+EACH_PACKED(NIL, MK_GATHER_VAL_DECL)
+
+EACH_TYPE(NIL, MK_KEYS_EQUAL_DECL)
+EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_DECL)
+EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_SEL_DECL)
+EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_ROW_DECL)
+EACH_PACKED(NIL, MK_KEYS_EQUAL_DECL)
+EACH_PACKED(NIL, MK_KEYS_NOT_EQUAL_DECL)
+EACH_PACKED(NIL, MK_KEYS_NOT_EQUAL_SEL_DECL)
+EACH_PACKED(NIL, MK_KEYS_NOT_EQUAL_ROW_DECL)
+PRIMITIVE(F3, lookup_sel)
+
+EACH_TYPE(NIL, MK_PARTITION_DECL)
+EACH_TYPE(NIL, MK_PARTITION_SEL_DECL)
+EACH_TYPE(NIL, MK_PARTITION_ROW_DECL)
+EACH_PACKED(NIL, MK_PARTITION_DECL)
+EACH_PACKED(NIL, MK_PARTITION_SEL_DECL)
+EACH_PACKED(NIL, MK_PARTITION_ROW_DECL)
+
+EACH_PACKED_KEY(EACH_TYPE_PACKABLE, MK_PACK_DECL)
+EACH_PACKED_KEY(EACH_TYPE_PACKABLE, MK_PACK_SEL_DECL)
+EACH_PACKED_KEY(EACH_TYPE_PACKABLE, MK_UNPACK_DECL)
+
+// Specializations
+
+#if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
+PRIMITIVE(F2, hash8_int64_t_col)
+PRIMITIVE(F3, hash8_sel_int64_t_col)
+PRIMITIVE(F2, rehash8_int64_t_col)
+PRIMITIVE(F3, rehash8_sel_int64_t_col)
+PRIMITIVE(F2, hash8_packed64_col)
+PRIMITIVE(F3, hash8_sel_packed64_col)
+PRIMITIVE(F2, hash8_xxh3_int64_t_col)
+PRIMITIVE(F2, hash8_mulshift_int64_t_col)
+#if defined(__PCLMUL__) && defined(__AVX512DQ__)
+PRIMITIVE(F2, hash8_clmulfold_int64_t_col)
+#endif
+PRIMITIVE(EQCheck, keys_equal8_int64_t_col)
+PRIMITIVE(EQCheck, keys_equal8_packed64_col)
+
+PRIMITIVE(F2, hash4_int32_t_col)
+PRIMITIVE(F3, hash4_sel_int32_t_col)
+PRIMITIVE(F2, rehash4_int32_t_col)
+PRIMITIVE(F3, rehash4_sel_int32_t_col)
+
+PRIMITIVE(F4, proj_sel8_minus_int64_t_val_int64_t_col)
+PRIMITIVE(F4, proj_sel8_plus_int64_t_col_int64_t_val)
+PRIMITIVE(F3, proj8_multiplies_int64_t_col_int64_t_col)
+PRIMITIVE(F4, proj8_multiplies_sel_int64_t_col_int64_t_col)
+
+PRIMITIVE(F3, sel_less_int32_t_col_int32_t_val_avx512)
+PRIMITIVE(F4, selsel_greater_equal_int32_t_col_int32_t_val_avx512)
+PRIMITIVE(F4, selsel_greater_equal_int64_t_col_int64_t_val_avx512)
+PRIMITIVE(F4, selsel_less_int64_t_col_int64_t_val_avx512)
+PRIMITIVE(F4, selsel_less_equal_int64_t_col_int64_t_val_avx512)
+#endif
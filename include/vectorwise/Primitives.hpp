@@ -1,12 +1,18 @@
 #pragma once
 #include "common/defs.hpp"
+#include "common/runtime/Hash.hpp"
 #include "common/runtime/HashmapSmall.hpp"
 #include "common/runtime/SIMD.hpp"
 #include "common/runtime/Types.hpp"
 #include "common/runtime/Util.hpp"
 #include "vectorwise/VectorAllocator.hpp"
 #include "vectorwise/defs.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 // #include "/home/kersten/tools/iaca-lin64/iacaMarks.h"
 
 namespace vectorwise {
@@ -86,6 +92,82 @@ pos_t selsel_col_col(pos_t n, pos_t* RES inSel, pos_t* RES result,
    return found;
 }
 
+// --- LIKE selection templates
+template <typename T, bool negate, typename MATCH>
+pos_t sel_matching(pos_t n, pos_t* RES result, T* RES input, MATCH match)
+/// select strings for which match returns !negate, branch free
+{
+   auto rStart = result;
+   for (uint64_t i = 0; i < n; ++i) {
+      *result = i;
+      result += match(input[i].begin(), input[i].length()) != negate;
+   }
+   return result - rStart;
+}
+
+template <typename T, bool negate, typename MATCH>
+pos_t selsel_matching(pos_t n, pos_t* RES inSel, pos_t* RES result,
+                      T* RES input, MATCH match)
+/// select strings for which match returns !negate with input selection vector
+{
+   auto rStart = result;
+   for (uint64_t i = 0; i < n; ++i) {
+      const auto idx = inSel[i];
+      *result = idx;
+      result += match(input[idx].begin(), input[idx].length()) != negate;
+   }
+   return result - rStart;
+}
+
+/// call f with the match function for the shape of pattern, so that the
+/// shape is dispatched once per vector instead of once per string
+template <typename F>
+pos_t dispatchLike(const types::LikePattern& pattern, F f) {
+   using P = types::LikePattern;
+   switch (pattern.kind) {
+   case P::Equal:
+      return f([&](const char* s, unsigned l) {
+         return pattern.matchEqual(s, l);
+      });
+   case P::Prefix:
+      return f([&](const char* s, unsigned l) {
+         return pattern.matchPrefix(s, l);
+      });
+   case P::Suffix:
+      return f([&](const char* s, unsigned l) {
+         return pattern.matchSuffix(s, l);
+      });
+   case P::Contains:
+      return f([&](const char* s, unsigned l) {
+         return pattern.matchContains(s, l);
+      });
+   default:
+      return f([&](const char* s, unsigned l) {
+         return pattern.matchSegments(s, l);
+      });
+   }
+}
+
+template <typename T, bool negate>
+pos_t sel_like_col_val(pos_t n, pos_t* RES result, T* RES param1,
+                       types::LikePattern* RES param2)
+/// select strings matching a LIKE pattern
+{
+   return dispatchLike(*param2, [&](auto match) {
+      return sel_matching<T, negate>(n, result, param1, match);
+   });
+}
+
+template <typename T, bool negate>
+pos_t selsel_like_col_val(pos_t n, pos_t* RES inSel, pos_t* RES result,
+                          T* RES param1, types::LikePattern* RES param2)
+/// select strings matching a LIKE pattern with input selection vector
+{
+   return dispatchLike(*param2, [&](auto match) {
+      return selsel_matching<T, negate>(n, inSel, result, param1, match);
+   });
+}
+
 // --- branchfree selection templates
 template <typename T, template <typename> class Op>
 pos_t sel_col_val_bf(pos_t n, pos_t* RES result, T* RES param1, T* RES param2)
@@ -248,6 +330,53 @@ pos_t proj_sel_col_sel_col(pos_t n, pos_t* RES inSel1, pos_t* RES inSel2,
    return n;
 }
 
+//------------------------------------------------------------------------------
+//--- fused compound primitives, the inner result is never materialized
+template <typename T, template <typename> class Outer,
+          template <typename> class Inner>
+pos_t proj_sel_col_val_sel_col(pos_t n, pos_t* RES inSel, T* RES result,
+                               T* RES param1, T* RES param2, T* RES param3)
+/// project param1 Outer (param2 Inner param3), columns through inSel
+{
+   const auto constant = *param2;
+   for (uint64_t i = 0; i < n; ++i) {
+      const auto idx = inSel[i];
+      result[i] = Outer<T>()(param1[idx], Inner<T>()(constant, param3[idx]));
+   }
+   return n;
+}
+
+template <typename T, template <typename> class Outer,
+          template <typename> class Inner>
+pos_t proj_col_sel_col_val(pos_t n, pos_t* RES inSel, T* RES result,
+                           T* RES param1, T* RES param2, T* RES param3)
+/// project param1 Outer (param2 Inner param3), only param2 through inSel
+{
+   const auto constant = *param3;
+   for (uint64_t i = 0; i < n; ++i) {
+      const auto idx = inSel[i];
+      result[i] = Outer<T>()(param1[i], Inner<T>()(param2[idx], constant));
+   }
+   return n;
+}
+
+template <typename T, template <typename> class Outer,
+          template <typename> class Inner>
+pos_t aggr_static_sel_col_col(pos_t n, pos_t* RES inSel, T* RES result,
+                              T* RES param1, T* RES param2)
+/// aggregate (param1 Inner param2) with input selection vector into single
+/// value
+{
+   auto aggregator = *result;
+   for (uint64_t i = 0; i < n; ++i) {
+      const auto idx = inSel[i];
+      aggregator =
+          Outer<T>()(Inner<T>()(param1[idx], param2[idx]), aggregator);
+   }
+   *result = aggregator;
+   return n > 0;
+}
+
 template <typename T, typename R, template <typename> class Op>
 pos_t apply_col(pos_t n, R* RES result, T* RES param1)
 /// project with input selection vector and constant and column
@@ -293,6 +422,137 @@ pos_t aggr_static_sel_col(pos_t n, pos_t* RES inSel, T* RES result,
    return n;
 }
 
+/// Selection bitmap, bit i % 64 of word i / 64 is set if tuple i qualifies.
+/// Bits beyond the vector size are zero.
+using bitmap_t = uint64_t;
+inline size_t bitmapWords(size_t n) { return (n + 63) / 64; }
+
+template <typename T, template <typename> class Op>
+inline bitmap_t bitmap_word(const T* RES in, const T& value, size_t count)
+/// compare up to 64 values with a constant, bit j is set if in[j] Op value
+{
+   bitmap_t word = 0;
+   for (size_t j = 0; j < count; ++j)
+      word |= bitmap_t(Op<T>()(in[j], value)) << j;
+   return word;
+}
+
+#if defined(__AVX512F__)
+template <template <typename> class Op> struct CmpInt;
+template <> struct CmpInt<std::equal_to> {
+   static constexpr int value = _MM_CMPINT_EQ;
+};
+template <> struct CmpInt<std::less> {
+   static constexpr int value = _MM_CMPINT_LT;
+};
+template <> struct CmpInt<std::less_equal> {
+   static constexpr int value = _MM_CMPINT_LE;
+};
+template <> struct CmpInt<std::greater> {
+   static constexpr int value = _MM_CMPINT_NLE;
+};
+template <> struct CmpInt<std::greater_equal> {
+   static constexpr int value = _MM_CMPINT_NLT;
+};
+#endif
+
+template <typename T, template <typename> class Op> struct BitmapWord {
+   static inline bitmap_t get(const T* RES in, const T& value, size_t count) {
+      return bitmap_word<T, Op>(in, value, count);
+   }
+};
+
+#if defined(__AVX512F__)
+/// full words of 32 and 64 bit integers compare into mask registers
+template <template <typename> class Op> struct BitmapWord<int32_t, Op> {
+   static inline bitmap_t get(const int32_t* RES in, const int32_t& value,
+                              size_t count) {
+      if (count < 64) return bitmap_word<int32_t, Op>(in, value, count);
+      auto v = _mm512_set1_epi32(value);
+      bitmap_t word = 0;
+      for (size_t j = 0; j < 64; j += 16)
+         word |= bitmap_t(_mm512_cmp_epi32_mask(_mm512_loadu_si512(in + j), v,
+                                                CmpInt<Op>::value))
+                 << j;
+      return word;
+   }
+};
+template <template <typename> class Op> struct BitmapWord<int64_t, Op> {
+   static inline bitmap_t get(const int64_t* RES in, const int64_t& value,
+                              size_t count) {
+      if (count < 64) return bitmap_word<int64_t, Op>(in, value, count);
+      auto v = _mm512_set1_epi64(value);
+      bitmap_t word = 0;
+      for (size_t j = 0; j < 64; j += 8)
+         word |= bitmap_t(_mm512_cmp_epi64_mask(_mm512_loadu_si512(in + j), v,
+                                                CmpInt<Op>::value))
+                 << j;
+      return word;
+   }
+};
+#endif
+
+template <typename T, template <typename> class Op>
+pos_t bitmap_sel_col_val(pos_t n, bitmap_t* RES result, T* RES param1,
+                         T* RES param2)
+/// bitmap of the tuples with param1 Op *param2, returns the number of
+/// qualifying tuples
+{
+   pos_t found = 0;
+   const auto value = *param2;
+   for (size_t w = 0, i = 0; i < n; ++w, i += 64) {
+      auto word = BitmapWord<T, Op>::get(param1 + i, value,
+                                         std::min<size_t>(64, n - i));
+      result[w] = word;
+      found += __builtin_popcountll(word);
+   }
+   return found;
+}
+
+template <typename T, template <typename> class Op>
+pos_t bitmap_selsel_col_val(pos_t n, bitmap_t* RES inBitmap,
+                            bitmap_t* RES result, T* RES param1, T* RES param2)
+/// bitmap of the tuples in inBitmap with param1 Op *param2, returns the
+/// number of qualifying tuples. All tuples are compared, words without
+/// qualifying tuples are skipped.
+{
+   pos_t found = 0;
+   const auto value = *param2;
+   for (size_t w = 0, i = 0; i < n; ++w, i += 64) {
+      auto word = inBitmap[w];
+      if (word)
+         word &= BitmapWord<T, Op>::get(param1 + i, value,
+                                        std::min<size_t>(64, n - i));
+      result[w] = word;
+      found += __builtin_popcountll(word);
+   }
+   return found;
+}
+
+template <typename T, template <typename> class Op>
+pos_t aggr_static_bitmap_col(pos_t n, bitmap_t* RES bitmap, T* RES result,
+                             T* RES param1)
+/// aggregate the tuples of param1 set in bitmap into single value
+{
+   auto aggregator = *result;
+   for (size_t w = 0, i = 0; i < n; ++w, i += 64) {
+      auto word = bitmap[w];
+      if (word == ~bitmap_t(0)) {
+         for (size_t j = i; j < i + 64; ++j)
+            aggregator = Op<T>()(param1[j], aggregator);
+      } else
+         for (; word; word &= word - 1)
+            aggregator = Op<T>()(param1[i + __builtin_ctzll(word)], aggregator);
+   }
+   *result = aggregator;
+   return n > 0;
+}
+
+/// selection vector of the tuples set in bitmap, returns their number
+pos_t bitmap_to_sel(pos_t n, pos_t* RES result, bitmap_t* RES bitmap);
+/// bitmap of the n tuples in selection vector sel for a vector of size tuples
+void sel_to_bitmap(pos_t n, pos_t* RES sel, pos_t size, bitmap_t* RES result);
+
 template <typename T, template <typename> class Op>
 pos_t aggr_col(pos_t n, T* RES entries[], T* RES param1, size_t offset)
 /// aggregate into multiple aggregators given by result
@@ -707,6 +967,274 @@ pos_t rehash4_16_sel(pos_t n, pos_t* RES inSel, hash_t* RES result,
    }
    return n;
 }
+
+template <typename T, typename Op>
+pos_t rehash8(pos_t n, hash_t* RES result, T* RES input)
+/// compute hash for input column, taking the value in result as seed
+{
+   static_assert(sizeof(T) == 8, "Can only be used for inputs types of size 8");
+   size_t rest = n % 8;
+   for (uint64_t i = 0; i < n - rest; i += 8) {
+      Vec8u seeds(result + i);
+      Vec8u in(input + i);
+      auto hashes = Op().hashKey(in, seeds);
+      _mm512_storeu_si512(result + i, hashes);
+   }
+   if (rest) {
+      mask8_t remaining = (1 << rest) - 1;
+      Vec8u seeds = _mm512_maskz_loadu_epi64(remaining, result + n - rest);
+      Vec8u in = _mm512_maskz_loadu_epi64(remaining, input + n - rest);
+      auto hashes = Op().hashKey(in, seeds);
+      _mm512_mask_storeu_epi64(result + n - rest, remaining, hashes);
+   }
+   return n;
+}
+
+template <typename T, typename Op>
+pos_t hash8_sel(pos_t n, pos_t* RES inSel, hash_t* RES result, T* RES input)
+/// compute hash for input column with selection vector
+{
+   static_assert(sizeof(T) == 8, "Can only be used for inputs types of size 8");
+   size_t rest = n % 8;
+   Vec8u seeds(seed);
+   for (uint64_t i = 0; i < n - rest; i += 8) {
+      auto inSels = _mm256_loadu_si256((const __m256i*)(inSel + i));
+      Vec8u in = _mm512_i32gather_epi64(inSels, input, 8);
+      auto hashes = Op().hashKey(in, seeds);
+      _mm512_storeu_si512(result + i, hashes);
+   }
+   if (rest) {
+      mask8_t remaining = (1 << rest) - 1;
+      auto inSels = _mm256_maskz_loadu_epi32(remaining, inSel + n - rest);
+      Vec8u in = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), remaining,
+                                             inSels, input, 8);
+      auto hashes = Op().hashKey(in, seeds);
+      _mm512_mask_storeu_epi64(result + n - rest, remaining, hashes);
+   }
+   return n;
+}
+
+template <typename T, typename Op>
+pos_t rehash8_sel(pos_t n, pos_t* RES inSel, hash_t* RES result, T* RES input)
+/// compute hash for input column with selection vector, taking the value in
+/// result as seed
+{
+   static_assert(sizeof(T) == 8, "Can only be used for inputs types of size 8");
+   size_t rest = n % 8;
+   for (uint64_t i = 0; i < n - rest; i += 8) {
+      Vec8u seeds(result + i);
+      auto inSels = _mm256_loadu_si256((const __m256i*)(inSel + i));
+      Vec8u in = _mm512_i32gather_epi64(inSels, input, 8);
+      auto hashes = Op().hashKey(in, seeds);
+      _mm512_storeu_si512(result + i, hashes);
+   }
+   if (rest) {
+      mask8_t remaining = (1 << rest) - 1;
+      Vec8u seeds = _mm512_maskz_loadu_epi64(remaining, result + n - rest);
+      auto inSels = _mm256_maskz_loadu_epi32(remaining, inSel + n - rest);
+      Vec8u in = _mm512_mask_i32gather_epi64(_mm512_setzero_si512(), remaining,
+                                             inSels, input, 8);
+      auto hashes = Op().hashKey(in, seeds);
+      _mm512_mask_storeu_epi64(result + n - rest, remaining, hashes);
+   }
+   return n;
+}
+
+//------------------------------------------------------------------------------
+//--- packing of composite keys
+/// Composite keys whose columns fit into 64 or 128 bits are packed into a
+/// single key, so that hashing and key comparison need one pass instead of
+/// one pass per column.
+using packed64 = uint64_t;
+using packed128 = std::tuple<uint64_t, uint64_t>;
+
+template <typename T> inline uint64_t packBits(const T& value) {
+   static_assert(sizeof(T) <= sizeof(uint64_t), "Type too wide for packing");
+   uint64_t bits = 0;
+   std::memcpy(&bits, &value, sizeof(T));
+   return bits;
+}
+
+template <typename T> inline T unpackBits(uint64_t bits) {
+   T value;
+   std::memcpy(&value, &bits, sizeof(T));
+   return value;
+}
+
+template <> inline types::Date unpackBits(uint64_t bits) {
+   return types::Date(unpackBits<int32_t>(bits));
+}
+
+/// Keys are packed in ascending shift order, a shift of 0 (or 64 for the
+/// upper half of a 128 bit key) initializes the word.
+inline void packInto(packed64& key, uint64_t bits, size_t shift) {
+   if (shift == 0)
+      key = bits;
+   else
+      key |= bits << shift;
+}
+
+inline void packInto(packed128& key, uint64_t bits, size_t shift) {
+   if (shift == 0)
+      key = packed128(bits, 0);
+   else if (shift < 64)
+      std::get<0>(key) |= bits << shift;
+   else if (shift == 64)
+      std::get<1>(key) = bits;
+   else
+      std::get<1>(key) |= bits << (shift - 64);
+}
+
+inline uint64_t unpackFrom(const packed64& key, size_t shift) {
+   return key >> shift;
+}
+
+inline uint64_t unpackFrom(const packed128& key, size_t shift) {
+   return shift < 64 ? std::get<0>(key) >> shift
+                     : std::get<1>(key) >> (shift - 64);
+}
+
+template <typename T, typename K>
+pos_t pack(pos_t n, K* RES result, T* RES input, size_t shift)
+/// pack input column into composite key at bit offset shift
+{
+   for (uint64_t i = 0; i < n; ++i)
+      packInto(result[i], packBits(input[i]), shift);
+   return n;
+}
+
+template <typename T, typename K>
+pos_t pack_sel(pos_t n, pos_t* RES inSel, K* RES result, T* RES input,
+               size_t shift)
+/// pack input column with selection vector into composite key at bit offset
+/// shift
+{
+   for (uint64_t i = 0; i < n; ++i)
+      packInto(result[i], packBits(input[inSel[i]]), shift);
+   return n;
+}
+
+template <typename T, typename K>
+pos_t unpack(pos_t n, T* RES result, K* RES input, size_t shift)
+/// extract column at bit offset shift from composite key
+{
+   for (uint64_t i = 0; i < n; ++i)
+      result[i] = unpackBits<T>(unpackFrom(input[i], shift));
+   return n;
+}
+
+//------------------------------------------------------------------------------
+//--- key normalization for sorting
+/// Sort keys are normalized into byte strings whose memcmp order is the sort
+/// order: integers are written big endian with the sign bit flipped, Char and
+/// Varchar strings are zero padded to their maximum length. Descending keys
+/// are inverted.
+template <typename T> struct NormalizedKey {
+   static constexpr size_t width = sizeof(T);
+   static void write(const T& value, uint8_t* out) {
+      using U = typename std::make_unsigned<T>::type;
+      auto bits = U(value);
+      if (std::is_signed<T>::value) bits ^= U(U(1) << (sizeof(T) * 8 - 1));
+      for (size_t i = 0; i < sizeof(T); ++i)
+         out[i] = uint8_t(bits >> (8 * (sizeof(T) - 1 - i)));
+   }
+};
+
+template <> struct NormalizedKey<types::Date> {
+   static constexpr size_t width = sizeof(int32_t);
+   static void write(const types::Date& value, uint8_t* out) {
+      NormalizedKey<int32_t>::write(value.value, out);
+   }
+};
+
+template <> struct NormalizedKey<types::Char<1>> {
+   static constexpr size_t width = 1;
+   static void write(const types::Char<1>& value, uint8_t* out) {
+      out[0] = uint8_t(value.value);
+   }
+};
+
+template <typename S, unsigned maxLen> struct NormalizedStringKey {
+   static constexpr size_t width = maxLen;
+   static void write(const S& value, uint8_t* out) {
+      auto len = value.length();
+      std::memcpy(out, value.begin(), len);
+      std::memset(out + len, 0, maxLen - len);
+   }
+};
+
+template <unsigned maxLen>
+struct NormalizedKey<types::Char<maxLen>>
+    : NormalizedStringKey<types::Char<maxLen>, maxLen> {};
+
+template <unsigned maxLen>
+struct NormalizedKey<types::Varchar<maxLen>>
+    : NormalizedStringKey<types::Varchar<maxLen>, maxLen> {};
+
+template <typename T, bool descending>
+inline void normalizeInto(const T& value, uint8_t* out) {
+   NormalizedKey<T>::write(value, out);
+   if (descending)
+      for (size_t b = 0; b < NormalizedKey<T>::width; ++b) out[b] = ~out[b];
+}
+
+/// first eight bytes of the normalized key as an integer with the same order,
+/// shorter keys are zero padded
+template <typename T, bool descending>
+inline int64_t normalizedPrefix(const T& value) {
+   uint8_t bytes[NormalizedKey<T>::width < 8 ? 8 : NormalizedKey<T>::width] =
+       {};
+   normalizeInto<T, descending>(value, bytes);
+   uint64_t prefix = 0;
+   for (size_t b = 0; b < 8; ++b) prefix = (prefix << 8) | bytes[b];
+   return int64_t(prefix ^ (uint64_t(1) << 63));
+}
+
+template <typename T, bool descending>
+pos_t normalized_prefix(pos_t n, int64_t* RES result, T* RES input)
+/// compute prefixes of normalized keys of input column
+{
+   for (uint64_t i = 0; i < n; ++i)
+      result[i] = normalizedPrefix<T, descending>(input[i]);
+   return n;
+}
+
+template <typename T, bool descending>
+pos_t normalized_prefix_sel(pos_t n, pos_t* RES inSel, int64_t* RES result,
+                            T* RES input)
+/// compute prefixes of normalized keys of input column with selection vector,
+/// result is written at the selected positions
+{
+   for (uint64_t i = 0; i < n; ++i)
+      result[inSel[i]] = normalizedPrefix<T, descending>(input[inSel[i]]);
+   return n;
+}
+
+template <typename T, bool descending>
+pos_t normalize(pos_t n, T* RES input, uint8_t** RES start, size_t* step,
+                size_t offset)
+/// write normalized keys of input column into rows at offset
+{
+   const auto s = *step;
+   auto current = *start + offset;
+   for (uint64_t i = 0; i < n; ++i, current += s)
+      normalizeInto<T, descending>(input[i], current);
+   return n;
+}
+
+template <typename T, bool descending>
+pos_t normalize_sel(pos_t n, pos_t* RES inSel, T* RES input,
+                    uint8_t** RES start, size_t* step, size_t offset)
+/// write normalized keys of input column with selection vector into rows at
+/// offset
+{
+   const auto s = *step;
+   auto current = *start + offset;
+   for (uint64_t i = 0; i < n; ++i, current += s)
+      normalizeInto<T, descending>(input[inSel[i]], current);
+   return n;
+}
+
 //------------------------------------------------------------------------------
 //--- key equality check for hashjoin
 template <typename T, template <typename> class Op>
@@ -726,6 +1254,36 @@ pos_t keys_equal(pos_t n, T* RES buildEntry[], size_t offset, pos_t* probeIdx,
    return found;
 }
 
+template <typename T>
+pos_t keys_equal8(pos_t n, T* RES buildEntry[], size_t offset, pos_t* probeIdx,
+                  T* RES probeKey)
+/// SIMD variant of keys_equal for keys of size 8, e.g. packed composite keys
+{
+   static_assert(sizeof(T) == 8, "Can only be used for inputs types of size 8");
+   uint64_t found = 0;
+   size_t rest = n % 8;
+   Vec8u offsets(offset);
+   for (uint64_t i = 0; i < n - rest; i += 8) {
+      Vec8u entries(buildEntry + i);
+      Vec8u buildKeys = _mm512_i64gather_epi64(entries + offsets, nullptr, 1);
+      auto idxs = _mm256_loadu_si256((const __m256i*)(probeIdx + i));
+      Vec8u probeKeys = _mm512_i32gather_epi64(idxs, probeKey, 8);
+      mask8_t eq = buildKeys == probeKeys;
+      // compress in place: writes never overtake the current read position
+      _mm512_mask_compressstoreu_epi64(buildEntry + found, eq, entries);
+      _mm256_mask_compressstoreu_epi32(probeIdx + found, eq, idxs);
+      found += __builtin_popcount(eq);
+   }
+   for (uint64_t i = n - rest; i < n; ++i) {
+      auto buildKey = addBytes(buildEntry[i], offset);
+      if (*buildKey == probeKey[probeIdx[i]]) {
+         buildEntry[found] = buildEntry[i];
+         probeIdx[found++] = probeIdx[i];
+      }
+   }
+   return found;
+}
+
 //------------------------------------------------------------------------------
 //--- key equality check for groupby
 template <typename T>
@@ -1102,6 +1660,26 @@ using FPartitionByKeyRow = pos_t (*)(pos_t n, pos_t* sel,
                                      pos_t* partitionBounds, pos_t* selOut,
                                      pos_t* partitionBoundsOut,
                                      runtime::HashmapSmall<pos_t, pos_t>* ht);
+/// function types for packing composite keys
+using FPack = pos_t (*)(pos_t n, void* RES result, void* RES input,
+                        size_t shift);
+using FPackSel = pos_t (*)(pos_t n, pos_t* RES inSel, void* RES result,
+                           void* RES input, size_t shift);
+using FUnpack = pos_t (*)(pos_t n, void* RES result, void* RES input,
+                          size_t shift);
+/// primitives that write normalized sort keys into rows, together with the
+/// width of the normalized key in bytes
+struct FNormalize {
+   FScatter op;
+   size_t width;
+};
+struct FNormalizeSel {
+   FScatterSel op;
+   size_t width;
+   /// prefix of the normalized key as int64_t, for pruning by a threshold
+   F2 prefix;
+   F3 prefixSel;
+};
 
 //---------------------------------------------------------------------------
 //--- pointers to instantiated primitives
@@ -1136,172 +1714,205 @@ using Varchar_55 = types::Varchar<55>;
 #define EACH_TYPE_FULL(m, c)                                                   \
    m(int32_t, c) m(int64_t, c) m(int8_t, c) m(int16_t, c)
 #define EACH_TYPE(m, c) EACH_TYPE_BASIC(m, c) EACH_TYPE_FULL(m, c)
+/// apply all string types with a length as first argument to m, pass c as
+/// second arg
+#define EACH_STRING(m, c)                                                      \
+   m(Char_6, c) m(Char_7, c) m(Char_9, c) m(Char_10, c) m(Char_12, c)          \
+       m(Char_15, c) m(Char_25, c) m(Char_55, c) m(Varchar_55, c)
 
 #define NIL(t, m) m(t)
 
+/// apply all types with normalized sort keys as first argument to m, pass c
+/// as second arg
+#define EACH_SORT_KEY(m, c) EACH_TYPE(m, c) m(Char_55, c) m(Varchar_55, c)
+
+/// apply all packed key types as first argument to m, pass c as second arg
+#define EACH_PACKED(m, c) m(packed64, c) m(packed128, c)
+/// apply all packed key types as second argument to m, pass c as first arg
+#define EACH_PACKED_KEY(m, c) m(c, packed64) m(c, packed128)
+/// apply all hash functions which can be selected at runtime as second
+/// argument to m, pass c as first arg
+#if defined(__PCLMUL__)
+#define EACH_HASH_FN(m, c)                                                     \
+   m(c, murmur) m(c, crc32) m(c, xxh3) m(c, mulshift) m(c, clmulfold)
+#else
+#define EACH_HASH_FN(m, c) m(c, murmur) m(c, crc32) m(c, xxh3) m(c, mulshift)
+#endif
+/// apply all (outer, inner) operator pairs with fused primitives
+#define EACH_FUSED_ARITH(type, m)                                              \
+   m(type, multiplies, minus) m(type, multiplies, plus)                        \
+       m(type, plus, multiplies) m(type, minus, multiplies)                    \
+           m(type, plus, plus) m(type, multiplies, multiplies)
+/// apply all types which can be packed into a composite key
+#define EACH_TYPE_PACKABLE(m, c)                                               \
+   m(Date, c) m(Char_1, c) m(int8_t, c) m(int16_t, c) m(int32_t, c)            \
+       m(int64_t, c)
+
+/// declares the primitive name of function pointer type sig. The list of all
+/// primitives in PrimitiveList.hpp is expanded with other definitions of
+/// PRIMITIVE to enumerate them, e.g. to look them up by name.
+#define PRIMITIVE(sig, name) extern sig name;
+
 #define MK_SEL_COLCOL_DECL(type, op)                                           \
-   extern F3 sel_##op##_##type##_col_##type##_col;
+   PRIMITIVE(F3, sel_##op##_##type##_col_##type##_col)
 #define MK_SEL_COLVAL_DECL(type, op)                                           \
-   extern F3 sel_##op##_##type##_col_##type##_val;
+   PRIMITIVE(F3, sel_##op##_##type##_col_##type##_val)
 #define MK_SEL_COLVALORVAL_DECL(type, op)                                      \
-   extern F4 sel_##op##_##type##_col_##type##_val_or_##type##_val;
+   PRIMITIVE(F4, sel_##op##_##type##_col_##type##_val_or_##type##_val)
 #define MK_SELSEL_COLCOL_DECL(type, op)                                        \
-   extern F4 selsel_##op##_##type##_col_##type##_col;
+   PRIMITIVE(F4, selsel_##op##_##type##_col_##type##_col)
 #define MK_SELSEL_COLVAL_DECL(type, op)                                        \
-   extern F4 selsel_##op##_##type##_col_##type##_val;
+   PRIMITIVE(F4, selsel_##op##_##type##_col_##type##_val)
 
 #define MK_SEL_COLCOL_BF_DECL(type, op)                                        \
-   extern F3 sel_##op##_##type##_col_##type##_col_bf;
+   PRIMITIVE(F3, sel_##op##_##type##_col_##type##_col_bf)
 #define MK_SEL_COLVAL_BF_DECL(type, op)                                        \
-   extern F3 sel_##op##_##type##_col_##type##_val_bf;
+   PRIMITIVE(F3, sel_##op##_##type##_col_##type##_val_bf)
 #define MK_SELSEL_COLCOL_BF_DECL(type, op)                                     \
-   extern F4 selsel_##op##_##type##_col_##type##_col_bf;
+   PRIMITIVE(F4, selsel_##op##_##type##_col_##type##_col_bf)
 #define MK_SELSEL_COLVAL_BF_DECL(type, op)                                     \
-   extern F4 selsel_##op##_##type##_col_##type##_val_bf;
+   PRIMITIVE(F4, selsel_##op##_##type##_col_##type##_val_bf)
+#define MK_BITMAP_SEL_COLVAL_DECL(type, op)                                    \
+   PRIMITIVE(F3, bitmap_sel_##op##_##type##_col_##type##_val)
+#define MK_BITMAP_SELSEL_COLVAL_DECL(type, op)                                 \
+   PRIMITIVE(F4, bitmap_selsel_##op##_##type##_col_##type##_val)
 
 #define MK_PROJ_COLCOL_DECL(type, op)                                          \
-   extern F3 proj_##op##_##type##_col_##type##_col;
+   PRIMITIVE(F3, proj_##op##_##type##_col_##type##_col)
 #define MK_PROJ_COLVAL_DECL(type, op)                                          \
-   extern F3 proj_##op##_##type##_col_##type##_val;
+   PRIMITIVE(F3, proj_##op##_##type##_col_##type##_val)
 #define MK_PROJ_VALCOL_DECL(type, op)                                          \
-   extern F3 proj_##op##_##type##_val_##type##_col;
+   PRIMITIVE(F3, proj_##op##_##type##_val_##type##_col)
 #define MK_PROJ_SEL_BOTH_COLCOL_DECL(type, op)                                 \
-   extern F4 proj_sel_both_##op##_##type##_col_##type##_col;
+   PRIMITIVE(F4, proj_sel_both_##op##_##type##_col_##type##_col)
 #define MK_PROJ_SEL_COLCOL_DECL(type, op)                                      \
-   extern F4 proj_##op##_sel_##type##_col_##type##_col;
+   PRIMITIVE(F4, proj_##op##_sel_##type##_col_##type##_col)
 #define MK_PROJ_COL_SEL_COL_DECL(type, op)                                     \
-   extern F4 proj_##op##_##type##_col_sel_##type##_col;
+   PRIMITIVE(F4, proj_##op##_##type##_col_sel_##type##_col)
 #define MK_PROJ_SEL_COL_SEL_COL_DECL(type, op)                                 \
-   extern F5 proj_##op##_sel_##type##_col_sel_##type##_col;
+   PRIMITIVE(F5, proj_##op##_sel_##type##_col_sel_##type##_col)
 #define MK_PROJ_SEL_COLVAL_DECL(type, op)                                      \
-   extern F4 proj_sel_##op##_##type##_col_##type##_val;
+   PRIMITIVE(F4, proj_sel_##op##_##type##_col_##type##_val)
 #define MK_PROJ_SEL_VALCOL_DECL(type, op)                                      \
-   extern F4 proj_sel_##op##_##type##_val_##type##_col;
+   PRIMITIVE(F4, proj_sel_##op##_##type##_val_##type##_col)
+
+#define MK_PROJ_FUSED_DECL(type, outer, inner)                                 \
+   PRIMITIVE(F5,                                                               \
+       proj_sel_##outer##_##inner##_##type##_col_##type##_val_##type##_col)    \
+   PRIMITIVE(F5,                                                               \
+       proj_##outer##_##inner##_##type##_col_sel_##type##_col_##type##_val)
+#define MK_AGGR_STATIC_FUSED_DECL(type, outer, inner)                          \
+   PRIMITIVE(F4,                                                               \
+       aggr_static_sel_##outer##_##inner##_##type##_col_##type##_col)
 
 #define MK_AGGR_STATIC_COL_DECL(type, op)                                      \
-   extern F2 aggr_static_##op##_##type##_col;
+   PRIMITIVE(F2, aggr_static_##op##_##type##_col)
 #define MK_AGGR_STATIC_SEL_COL_DECL(type, op)                                  \
-   extern F3 aggr_static_sel_##op##_##type##_col;
-#define MK_AGGR_COL_DECL(type, op) extern FAggr aggr_##op##_##type##_col;
+   PRIMITIVE(F3, aggr_static_sel_##op##_##type##_col)
+#define MK_AGGR_STATIC_BITMAP_COL_DECL(type, op)                               \
+   PRIMITIVE(F3, aggr_static_bitmap_##op##_##type##_col)
+#define MK_AGGR_COL_DECL(type, op) PRIMITIVE(FAggr, aggr_##op##_##type##_col)
 #define MK_AGGR_SEL_COL_DECL(type, op)                                         \
-   extern FAggrSel aggr_sel_##op##_##type##_col;
-#define MK_AGGR_ROW_DECL(type, op) extern FAggrRow aggr_row_##op##_##type##_col;
+   PRIMITIVE(FAggrSel, aggr_sel_##op##_##type##_col)
+#define MK_AGGR_ROW_DECL(type, op)                                             \
+   PRIMITIVE(FAggrRow, aggr_row_##op##_##type##_col)
 #define MK_AGGR_INIT_DECL(type, op)                                            \
-   extern FAggrInit aggr_init_##op##_##type##_col;
-
-#define MK_HASH_DECL(type) extern F2 hash_##type##_col;
-#define MK_HASH_SEL_DECL(type) extern F3 hash_sel_##type##_col;
-#define MK_REHASH_DECL(type) extern F2 rehash_##type##_col;
-#define MK_REHASH_SEL_DECL(type) extern F3 rehash_sel_##type##_col;
-
-#define MK_SCATTER_DECL(type) extern FScatter scatter_##type##_col;
-#define MK_SCATTER_SEL_DECL(type) extern FScatterSel scatter_sel_##type##_col;
+   PRIMITIVE(FAggrInit, aggr_init_##op##_##type##_col)
+
+#define MK_HASH_DECL(type) PRIMITIVE(F2, hash_##type##_col)
+#define MK_HASH_SEL_DECL(type) PRIMITIVE(F3, hash_sel_##type##_col)
+#define MK_REHASH_DECL(type) PRIMITIVE(F2, rehash_##type##_col)
+#define MK_REHASH_SEL_DECL(type) PRIMITIVE(F3, rehash_sel_##type##_col)
+#define MK_HASH_FN_DECL(type, fn)                                              \
+   PRIMITIVE(F2, hash_##fn##_##type##_col)                                     \
+   PRIMITIVE(F3, hash_sel_##fn##_##type##_col)                                 \
+   PRIMITIVE(F2, rehash_##fn##_##type##_col)                                   \
+   PRIMITIVE(F3, rehash_sel_##fn##_##type##_col)
+
+#define MK_SCATTER_DECL(type) PRIMITIVE(FScatter, scatter_##type##_col)
+#define MK_SCATTER_SEL_DECL(type)                                              \
+   PRIMITIVE(FScatterSel, scatter_sel_##type##_col)
 #define MK_SCATTER_SEL_ROW_DECL(type)                                          \
-   extern FScatterSelRow scatter_sel_row_##type##_col;
+   PRIMITIVE(FScatterSelRow, scatter_sel_row_##type##_col)
 
-#define MK_GATHER_COL_DECL(type) extern FGather gather_col_##type##_col;
+#define MK_GATHER_COL_DECL(type) PRIMITIVE(FGather, gather_col_##type##_col)
 #define MK_GATHER_SEL_COL_DECL(type)                                           \
-   extern FGatherSel gather_sel_col_##type##_col;
-#define MK_GATHER_VAL_DECL(type) extern FGatherVal gather_val_##type##_col;
+   PRIMITIVE(FGatherSel, gather_sel_col_##type##_col)
+#define MK_GATHER_VAL_DECL(type) PRIMITIVE(FGatherVal, gather_val_##type##_col)
 
-#define MK_KEYS_EQUAL_DECL(type) extern EQCheck keys_equal_##type##_col;
+#define MK_KEYS_EQUAL_DECL(type) PRIMITIVE(EQCheck, keys_equal_##type##_col)
 #define MK_KEYS_NOT_EQUAL_DECL(type)                                           \
-   extern NEQCheck keys_not_equal_##type##_col;
+   PRIMITIVE(NEQCheck, keys_not_equal_##type##_col)
 #define MK_KEYS_NOT_EQUAL_SEL_DECL(type)                                       \
-   extern NEQCheckSel keys_not_equal_sel_##type##_col;
+   PRIMITIVE(NEQCheckSel, keys_not_equal_sel_##type##_col)
 #define MK_KEYS_NOT_EQUAL_ROW_DECL(type)                                       \
-   extern NEQCheckRow keys_not_equal_row_##type##_col;
+   PRIMITIVE(NEQCheckRow, keys_not_equal_row_##type##_col)
+
+#define MK_PACK_DECL(type, key) PRIMITIVE(FPack, pack_##type##_col_##key)
+#define MK_PACK_SEL_DECL(type, key)                                            \
+   PRIMITIVE(FPackSel, pack_sel_##type##_col_##key)
+#define MK_UNPACK_DECL(type, key) PRIMITIVE(FUnpack, unpack_##type##_col_##key)
+
+#define MK_LIKE_DECL(type)                                                     \
+   PRIMITIVE(F3, sel_like_##type##_col_pattern_val)                            \
+   PRIMITIVE(F3, sel_not_like_##type##_col_pattern_val)                        \
+   PRIMITIVE(F4, selsel_like_##type##_col_pattern_val)                         \
+   PRIMITIVE(F4, selsel_not_like_##type##_col_pattern_val)
+
+#define MK_NORMALIZE_DECL(type)                                                \
+   extern FNormalize normalize_##type##_col;                                   \
+   extern FNormalize normalize_desc_##type##_col;
+#define MK_NORMALIZE_SEL_DECL(type)                                            \
+   extern FNormalizeSel normalize_sel_##type##_col;                            \
+   extern FNormalizeSel normalize_sel_desc_##type##_col;
 
 #define MK_PARTITION_DECL(type)                                                \
-   extern FPartitionByKey partition_by_key_##type##_col;
+   PRIMITIVE(FPartitionByKey, partition_by_key_##type##_col)
 #define MK_PARTITION_SEL_DECL(type)                                            \
-   extern FPartitionByKeySel partition_by_key_sel_##type##_col;
+   PRIMITIVE(FPartitionByKeySel, partition_by_key_sel_##type##_col)
 #define MK_PARTITION_ROW_DECL(type)                                            \
-   extern FPartitionByKeyRow partition_by_key_row_##type##_col;
+   PRIMITIVE(FPartitionByKeyRow, partition_by_key_row_##type##_col)
 
 // create declarations
-EACH_COMP(EACH_TYPE, MK_SEL_COLCOL_DECL)
-EACH_COMP(EACH_TYPE, MK_SEL_COLVALORVAL_DECL)
-EACH_COMP(EACH_TYPE, MK_SEL_COLVAL_DECL)
-EACH_COMP(EACH_TYPE, MK_SELSEL_COLCOL_DECL)
-EACH_COMP(EACH_TYPE, MK_SELSEL_COLVAL_DECL)
-
-EACH_COMP(EACH_TYPE, MK_SEL_COLCOL_BF_DECL)
-EACH_COMP(EACH_TYPE, MK_SEL_COLVAL_BF_DECL)
-EACH_COMP(EACH_TYPE, MK_SELSEL_COLCOL_BF_DECL)
-EACH_COMP(EACH_TYPE, MK_SELSEL_COLVAL_BF_DECL)
-
-extern F3 sel_contains_Varchar_55_col_Varchar_55_val;
-
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_COLCOL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_COLVAL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_BOTH_COLCOL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_COLCOL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_COL_SEL_COL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_COL_SEL_COL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_PROJ_SEL_COLVAL_DECL)
-EACH_ARITH_NON_COMM(EACH_TYPE_FULL, MK_PROJ_VALCOL_DECL)
-EACH_ARITH_NON_COMM(EACH_TYPE_FULL, MK_PROJ_SEL_VALCOL_DECL)
-
-extern F2 apply_extract_year_col;
-extern F3 apply_extract_year_sel_col;
-
-EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_STATIC_COL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_STATIC_SEL_COL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_COL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_SEL_COL_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_ROW_DECL)
-EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_INIT_DECL)
-extern F1 aggr_static_count_star;
-extern FAggr aggr_count_star;
-
-EACH_TYPE(NIL, MK_HASH_DECL)
-EACH_TYPE(NIL, MK_HASH_SEL_DECL)
-EACH_TYPE(NIL, MK_REHASH_DECL)
-EACH_TYPE(NIL, MK_REHASH_SEL_DECL)
-
-EACH_TYPE(NIL, MK_SCATTER_DECL)
-EACH_TYPE(NIL, MK_SCATTER_SEL_DECL)
-EACH_TYPE(NIL, MK_SCATTER_SEL_ROW_DECL)
-
-EACH_TYPE(NIL, MK_GATHER_COL_DECL)
-EACH_TYPE(NIL, MK_GATHER_SEL_COL_DECL)
-EACH_TYPE(NIL, MK_GATHER_VAL_DECL)
-
-EACH_TYPE(NIL, MK_KEYS_EQUAL_DECL)
-EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_DECL)
-EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_SEL_DECL)
-EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_ROW_DECL)
-extern F3 lookup_sel;
-
-EACH_TYPE(NIL, MK_PARTITION_DECL);
-EACH_TYPE(NIL, MK_PARTITION_SEL_DECL);
-EACH_TYPE(NIL, MK_PARTITION_ROW_DECL);
-
-// Specializations
-
-#if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
-extern F2 hash8_int64_t_col;
-// extern F3 hash8_sel_int64_t_col;
-// extern F2 rehash8_int64_t_col;
-// extern F3 rehash8_sel_int64_t_col;
-
-extern F2 hash4_int32_t_col;
-extern F3 hash4_sel_int32_t_col;
-extern F2 rehash4_int32_t_col;
-extern F3 rehash4_sel_int32_t_col;
-
-extern F4 proj_sel8_minus_int64_t_val_int64_t_col;
-extern F4 proj_sel8_plus_int64_t_col_int64_t_val;
-extern F3 proj8_multiplies_int64_t_col_int64_t_col;
-extern F4 proj8_multiplies_sel_int64_t_col_int64_t_col;
-
-extern F3 sel_less_int32_t_col_int32_t_val_avx512;
-extern F4 selsel_greater_equal_int32_t_col_int32_t_val_avx512;
-extern F4 selsel_greater_equal_int64_t_col_int64_t_val_avx512;
-extern F4 selsel_less_int64_t_col_int64_t_val_avx512;
-extern F4 selsel_less_equal_int64_t_col_int64_t_val_avx512;
-#endif
+#include "vectorwise/PrimitiveList.hpp"
+EACH_SORT_KEY(NIL, MK_NORMALIZE_DECL)
+EACH_SORT_KEY(NIL, MK_NORMALIZE_SEL_DECL)
+
+/// Redirects the default hash_* and rehash_* primitives to the given hash
+/// function. Must be called before queries are built, since operators keep
+/// the primitive pointers they were built with. The SIMD hash flavors always
+/// use MurMur.
+void setHashFunction(runtime::HashFunction f);
+extern runtime::HashFunction currentHashFunction;
+
+/// Equivalent implementations (flavors) of a primitive, e.g. branching,
+/// branch-free and SIMD selections or scalar and SIMD hashes. Returns all
+/// flavors of op including op itself, or only op if there are no others.
+std::vector<F2> flavorsOf(F2 op);
+std::vector<F3> flavorsOf(F3 op);
+std::vector<F4> flavorsOf(F4 op);
+
+/// Chains of two primitives for which a fused primitive exists. The names
+/// list the producer first, its result is an input of the consumer.
+enum class FusedShape {
+   None,
+   /// proj_sel_<inner>_val_col, proj_<outer>_sel_col_col -> F5 (sel, result,
+   /// consumer col, producer val, producer col)
+   ProjSelValCol_ProjSelColCol,
+   /// proj_sel_<inner>_col_val, proj_<outer>_col_col -> F5 (sel, result,
+   /// consumer col, producer col, producer val)
+   ProjSelColVal_ProjColCol,
+   /// proj_sel_both_<inner>_col_col, aggr_static_<outer>_col -> F4 (sel,
+   /// aggregator, producer col, producer col)
+   ProjSelBothColCol_AggrStatic
+};
+struct Fused {
+   FusedShape shape = FusedShape::None;
+   void* primitive = nullptr;
+};
+/// Fused primitive replacing producer followed by consumer, shape None if
+/// there is none. All flavors of the producer are recognized.
+Fused fusedOf(void* producer, void* consumer);
 } // namespace primitives
 } // namespace vectorwise
 
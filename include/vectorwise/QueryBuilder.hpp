@@ -8,6 +8,9 @@
 
 namespace vectorwise {
 
+/// substitute fused primitives for producer/consumer chains in expressions
+extern bool fusePrimitives;
+
 class QueryBuilder {
  public:
    runtime::GlobalPool* previous;
@@ -18,6 +21,11 @@ class QueryBuilder {
    SharedStateManager& operatorState;
    VectorAllocator vecs;
    std::unordered_map<size_t, std::pair<size_t, void*>> buffers;
+   /// buffers that fused primitives do not write, by buffer address
+   std::unordered_map<void*, FusedOp*> fusedIntermediates;
+   /// build values a late materializing hash join left in its ht entries, by
+   /// target buffer address: entries of the join result and entry offset
+   std::unordered_map<void*, std::pair<void**, size_t>> lateValues;
 
    struct DataStorage
    /// handle for data sources, e.g. base table columns or cache buffers
@@ -60,6 +68,8 @@ class QueryBuilder {
       std::deque<size_t> keyOffsets;
       void* buildHashBuffer = nullptr;
       void* probeHashBuffer = nullptr;
+      /// entries of the join result if build values are materialized late
+      void** lateEntries = nullptr;
       Hashjoin* join;
       HashJoinBuilder(QueryBuilder& b);
       ~HashJoinBuilder();
@@ -81,6 +91,52 @@ class QueryBuilder {
       setProbeSelVector(DS vec,
                         pos_t (Hashjoin::*join)() = &Hashjoin::joinSelParallel);
       B& pushProbeSelVector(DS sel, DS target);
+      /// The join emits the matching ht entries to entries and leaves build
+      /// values added afterwards in them, a Fetch gathers them later.
+      /// Must precede the probe keys.
+      B& setLateMaterialization(DS entries);
+   };
+
+   struct FetchBuilder {
+      QueryBuilder& base;
+      vectorwise::Fetch* fetch;
+      /// selection vector of the input, if it has one
+      DS inputSel;
+      using B = FetchBuilder;
+      /// gather late build value into out, for input without selection
+      B& addValue(DS late, primitives::FGather gather, DS out);
+      /// gather late build value of the selected tuples densely into out
+      B& addValue(DS late, primitives::FGatherSel gather, DS out);
+
+    private:
+      std::pair<void**, size_t> find(DS late);
+   };
+
+   struct MergeJoinBuilder
+   /// same interface as HashJoinBuilder, but keys are normalized to their
+   /// 8 byte prefix instead of hashed, so they must not be wider than that and
+   /// both sides need keys of the same type
+   {
+      QueryBuilder& base;
+      vectorwise::MergeJoin* join;
+      bool probeHasSelection = false;
+      size_t keyWidth = 0;
+      void* buildKeyBuffer = nullptr;
+      using B = MergeJoinBuilder;
+
+      B& addBuildKey(DS col, primitives::FNormalizeSel normalize);
+      B& addBuildKey(DS col, DS sel, primitives::FNormalizeSel normalize);
+      B& addProbeKey(DS col, primitives::FNormalizeSel normalize);
+      B& addProbeKey(DS col, DS sel, primitives::FNormalizeSel normalize);
+      B& addBuildValue(DS source, primitives::FScatter scatter, DS target,
+                       primitives::FGather gather);
+      B& addBuildValue(DS source, DS sel, primitives::FScatterSel scatter,
+                       DS target, primitives::FGather gather);
+      B& setProbeSelVector(DS vec);
+
+    private:
+      /// a join has one key of at most 8 bytes on each side
+      void checkKey(const vectorwise::Expression& keys, size_t width);
    };
 
    struct HashGroupBuilder {
@@ -132,23 +188,114 @@ class QueryBuilder {
       ~HashGroupBuilder();
    };
 
+   struct SortBuilder
+   /// sort keys come first, in order of significance, then the payload
+   {
+      QueryBuilder& base;
+      vectorwise::Sort* sort;
+      using B = SortBuilder;
+      B& addKey(DS col, primitives::FNormalize normalize);
+      B& addKey(DS col, DS sel, primitives::FNormalizeSel normalize);
+      B& addValue(DS col, primitives::FScatter scatter,
+                  primitives::FGatherVal gather, DS out);
+      B& addValue(DS col, DS sel, primitives::FScatterSel scatter,
+                  primitives::FGatherVal gather, DS out);
+      ~SortBuilder();
+
+    private:
+      size_t addKeyBytes(size_t width);
+      void addOutput(size_t offset, size_t size,
+                     primitives::FGatherVal gather, DS out);
+   };
+
+   struct ExchangeBuilder {
+      QueryBuilder& base;
+      vectorwise::Exchange* exchange;
+      using B = ExchangeBuilder;
+      /// move col to out, a buffer of the same entry size
+      B& addValue(DS col, DS out);
+      /// move only the tuples in sel, hashes are still dense
+      B& setInputSelection(DS sel);
+      /// hashes which select the target worker for Repartition
+      B& setHashes(DS hashes);
+   };
+
+   struct TopNBuilder
+   /// like SortBuilder, but all columns are read through the selection of
+   /// tuples below the threshold, which the first key computes
+   {
+      QueryBuilder& base;
+      vectorwise::TopN* topN;
+      /// selection vector of the input, if it has one
+      DS inputSel;
+      SortBuilder rows;
+      using B = TopNBuilder;
+      B& addKey(DS col, primitives::FNormalizeSel normalize);
+      B& addValue(DS col, primitives::FScatterSel scatter,
+                  primitives::FGatherVal gather, DS out);
+   };
+
+   struct KeyPackBuilder
+   /// packs several key columns into one 64 or 128 bit key, so that hashing
+   /// and key comparison in joins and aggregations take a single pass
+   {
+      QueryBuilder& base;
+      class Project& project;
+      DS packed;
+      size_t usedBits = 0;
+      std::vector<size_t> shifts;
+      using B = KeyPackBuilder;
+      B& addKey(DS col, primitives::FPack pack);
+      B& addKey(DS col, DS sel, primitives::FPackSel pack);
+      /// bit offset of the i-th key within the packed key
+      size_t shift(size_t i) const;
+
+    private:
+      size_t nextShift(size_t keySize);
+   };
+
    struct ExpressionBuilder {
       std::unique_ptr<vectorwise::Expression> expression;
+      QueryBuilder* base = nullptr;
       using DS = DataStorage;
       ExpressionBuilder& addOp(primitives::F1 op, DS a);
       ExpressionBuilder& addOp(primitives::F2 op, DS a, DS b);
       ExpressionBuilder& addOp(primitives::F3 op, DS a, DS b, DS c);
       ExpressionBuilder& addOp(primitives::F4 op, DS a, DS b, DS c, DS d);
+      ExpressionBuilder& addOp(primitives::FPack op, DS result, DS input,
+                               size_t shift);
+      ExpressionBuilder& addOp(primitives::FPackSel op, DS sel, DS result,
+                               DS input, size_t shift);
+      /// runs one of the alternatives depending on the representation an
+      /// AdaptiveSelect passed the current vector on in
+      ExpressionBuilder&
+      addSelectionSwitch(const SelectionKind* kind,
+                         std::unique_ptr<vectorwise::Expression> all,
+                         std::unique_ptr<vectorwise::Expression> bitmap,
+                         std::unique_ptr<vectorwise::Expression> list);
       operator std::unique_ptr<vectorwise::Expression>();
       operator std::unique_ptr<vectorwise::Aggregates>();
+
+    private:
+      /// last op added, candidate producer for fusion
+      struct Added {
+         void* primitive = nullptr;
+         std::vector<DS> args;
+      } previous;
+      /// replaces the last two ops by a fused primitive if one exists
+      void fuse(void* consumer, std::vector<DS> args);
    };
 
    QueryBuilder(runtime::Database& db_, SharedStateManager& s,
                 size_t vSize = 1024)
-       : db(db_), operatorState(s), vecs(vSize) {}
+       : db(db_), operatorState(s), vecs(vSize) {
+      nextOpSite = 0;
+   }
 
    size_t opNr = 0;
    size_t onceNr = 0;
+   /// number of the next operator wrapped in Profiled
+   size_t profiledNr = 0;
    size_t nextOpNr();
    size_t nextOnceNr();
 
@@ -159,12 +306,28 @@ class QueryBuilder {
               std::function<void(PAYLOAD&)> finish);
    void DebugCounter(std::string message);
    void Select(std::unique_ptr<Expression>&& exp);
+   /// Selection passing tuples on in the representation cheapest for their
+   /// density. exp produces bitmap, or sel if bitmapCondition is false,
+   /// bitmap needs a buffer with entries of sizeof(primitives::bitmap_t).
+   /// Returns the representation of the current vector for
+   /// addSelectionSwitch.
+   const SelectionKind* AdaptiveSelect(std::unique_ptr<Expression>&& exp,
+                                       DS bitmap, DS sel,
+                                       bool bitmapCondition = true);
    ProjectionBuilder Project();
    void FixedAggregation(std::unique_ptr<Aggregates>&& aggrs);
    HashJoinBuilder
    HashJoin(DS probeMatches,
             pos_t (Hashjoin::*join)() = &Hashjoin::joinAllParallel);
+   MergeJoinBuilder MergeJoin(DS probeMatches);
+   FetchBuilder Fetch();
+   FetchBuilder Fetch(DS sel);
    HashGroupBuilder HashGroup();
+   SortBuilder Sort();
+   ExchangeBuilder Exchange(vectorwise::Exchange::Mode mode);
+   TopNBuilder TopN(size_t limit);
+   TopNBuilder TopN(size_t limit, DS sel);
+   KeyPackBuilder PackKeys(DS packed);
 
    ~QueryBuilder();
 
@@ -1,5 +1,6 @@
 #include "common/algebra/Operators.hpp"
-#include "hyper/codegen/Translator.hpp"
+#include "common/runtime/Types.hpp"
+#include "hyper/codegen/Compiler.hpp"
 #include <iostream>
 
 using namespace std;
@@ -10,11 +11,39 @@ int main() {
 
   Relation test;
   test.name = "relname";
-  test.insert("country", make_unique<Integer>());
+  vector<types::Integer> country, population;
+  for (int32_t i = 0; i < 1000; ++i) {
+    country.push_back(i % 10);
+    population.push_back(i);
+  }
+  test.insert("country", make_unique<Integer>()) = move(country);
+  test.insert("population", make_unique<Integer>()) = move(population);
+  test.nrTuples = 1000;
 
+  // select country, sum(population) from relname where population < 500
+  // group by country
   auto scan = make_unique<Scan>(test);
-  Print print(move(scan), {"country"});
+  auto select = make_unique<Select>(
+      move(scan), binary("<", attr("relname.population"),
+                         constant("500", make_unique<Integer>())));
+  vector<GroupBy::Aggregate> aggregates;
+  aggregates.push_back({GroupBy::Aggregate::Sum, "population",
+                        attr("relname.population")});
+  auto group = make_unique<GroupBy>(move(select),
+                                    vector<string>{"relname.country"},
+                                    move(aggregates));
+  Print print(move(group), {"relname.country", "population"});
 
-  hyper::Translator::produce(print, cout);
+  hyper::CompiledQuery query(print);
+  cout << query.source();
+  auto result = query.run(1);
+  auto countryAttr = result->result->getAttribute("country");
+  auto sumAttr = result->result->getAttribute("population");
+  for (auto& block : *result->result) {
+    auto countries = reinterpret_cast<types::Integer*>(block.data(countryAttr));
+    auto sums = reinterpret_cast<types::Integer*>(block.data(sumAttr));
+    for (size_t i = 0; i < block.size(); ++i)
+      cout << countries[i] << " " << sums[i] << "\n";
+  }
   return 0;
 }
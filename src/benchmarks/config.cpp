@@ -8,7 +8,8 @@ vectorwise::primitives::F2 ExperimentConfig::hash_int32_t_col() {
 
 
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
-   if (useSimdHash) return vectorwise::primitives::hash4_int32_t_col;
+   if (useSimdHash && hashVectorwise == runtime::HashFunction::MurMur)
+      return vectorwise::primitives::hash4_int32_t_col;
 #endif
    return vectorwise::primitives::hash_int32_t_col;
 }
@@ -16,7 +17,8 @@ vectorwise::primitives::F3 ExperimentConfig::hash_sel_int32_t_col() {
 
 
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
-   if (useSimdHash) return vectorwise::primitives::hash4_sel_int32_t_col;
+   if (useSimdHash && hashVectorwise == runtime::HashFunction::MurMur)
+      return vectorwise::primitives::hash4_sel_int32_t_col;
 #endif
    return vectorwise::primitives::hash_sel_int32_t_col;
 }
@@ -24,7 +26,8 @@ vectorwise::primitives::F2 ExperimentConfig::rehash_int32_t_col() {
 
 
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
-   if (useSimdHash) return vectorwise::primitives::rehash4_int32_t_col;
+   if (useSimdHash && hashVectorwise == runtime::HashFunction::MurMur)
+      return vectorwise::primitives::rehash4_int32_t_col;
 #endif
    return vectorwise::primitives::rehash_int32_t_col;
 }
@@ -32,7 +35,8 @@ vectorwise::primitives::F3 ExperimentConfig::rehash_sel_int32_t_col() {
 
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
 
-   if (useSimdHash) return vectorwise::primitives::rehash4_sel_int32_t_col;
+   if (useSimdHash && hashVectorwise == runtime::HashFunction::MurMur)
+      return vectorwise::primitives::rehash4_sel_int32_t_col;
 #endif
    return vectorwise::primitives::rehash_sel_int32_t_col;
 }
@@ -98,6 +102,7 @@ vectorwise::primitives::F4 ExperimentConfig::selsel_less_equal_int64_t_col_int64
 }
 
 ExperimentConfig::joinFun ExperimentConfig::joinAll() {
+  if (adaptiveJoin) return &vectorwise::Hashjoin::joinAdaptive;
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
   if (useSimdJoin) return &vectorwise::Hashjoin::joinAllSIMD;
 #endif
@@ -108,6 +113,7 @@ ExperimentConfig::joinFun ExperimentConfig::joinAll() {
 }
 
 ExperimentConfig::joinFun ExperimentConfig::joinSel() {
+  if (adaptiveJoin) return &vectorwise::Hashjoin::joinAdaptive;
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
   if (useSimdJoin) return &vectorwise::Hashjoin::joinSelSIMD;
 #endif
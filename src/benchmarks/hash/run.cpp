@@ -0,0 +1,205 @@
+#include "common/runtime/Hash.hpp"
+#include "common/runtime/Hashmap.hpp"
+#include "common/runtime/Import.hpp"
+#include "common/runtime/Types.hpp"
+#include "vectorwise/Primitives.hpp"
+#include "vectorwise/defs.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/// Hash function quality and speed benchmark.
+///
+/// For every key column and every hash function this reports
+///  - throughput of the vectorwise hash primitive in million keys per second
+///  - the bucket distribution of a runtime::Hashmap sized for the distinct
+///    keys (average probe length, longest chain, fraction of empty buckets)
+///  - full-width hash collisions and collisions after folding to 32 bits
+///
+/// Usage: run_hash [-p tpch_dir] [-n synthetic_keys] [-r repetitions]
+/// Without -p, dense and strided synthetic integer keys are used.
+
+using namespace std;
+using namespace vectorwise::primitives;
+using vectorwise::pos_t;
+using runtime::Hashmap;
+using hash_t = defs::hash_t;
+
+struct KeyColumn {
+   string name;
+   /// int32_t keys for single columns
+   vector<int32_t> keys;
+   /// packed64 keys for composite keys
+   vector<packed64> packed;
+   bool composite() const { return !packed.empty(); }
+   size_t size() const { return composite() ? packed.size() : keys.size(); }
+};
+
+struct HashFn {
+   string name;
+   F2 hashInt;
+   F2 hashPacked;
+};
+
+#define MK_HASH_FN_ENTRY(_, fn)                                                \
+   {#fn, hash_##fn##_int32_t_col, hash_##fn##_packed64_col},
+static vector<HashFn> hashFunctions = {EACH_HASH_FN(MK_HASH_FN_ENTRY, )};
+
+static const size_t vecSize = 1024;
+
+/// Hashes all keys of the column in chunks of vecSize
+static void hashColumn(const HashFn& fn, KeyColumn& col, hash_t* out) {
+   auto n = col.size();
+   for (size_t i = 0; i < n; i += vecSize) {
+      auto chunk = pos_t(min(vecSize, n - i));
+      if (col.composite())
+         fn.hashPacked(chunk, out + i, col.packed.data() + i);
+      else
+         fn.hashInt(chunk, out + i, col.keys.data() + i);
+   }
+}
+
+/// Number of distinct keys whose hash equals that of another distinct key
+template <typename T> static size_t collisions(vector<T> hashes) {
+   sort(hashes.begin(), hashes.end());
+   size_t c = 0;
+   for (size_t i = 1; i < hashes.size(); ++i)
+      if (hashes[i] == hashes[i - 1]) c++;
+   return c;
+}
+
+static void report(const HashFn& fn, KeyColumn& col, size_t repetitions) {
+   auto n = col.size();
+   vector<hash_t> hashes(n);
+
+   double best = numeric_limits<double>::max();
+   for (size_t r = 0; r < repetitions; ++r) {
+      auto start = chrono::steady_clock::now();
+      hashColumn(fn, col, hashes.data());
+      auto end = chrono::steady_clock::now();
+      best = min(best, chrono::duration<double>(end - start).count());
+   }
+
+   // quality is measured on distinct keys only
+   if (col.composite()) {
+      sort(col.packed.begin(), col.packed.end());
+      col.packed.erase(unique(col.packed.begin(), col.packed.end()),
+                       col.packed.end());
+   } else {
+      sort(col.keys.begin(), col.keys.end());
+      col.keys.erase(unique(col.keys.begin(), col.keys.end()), col.keys.end());
+   }
+   auto distinct = col.size();
+   vector<hash_t> distinctHashes(distinct);
+   hashColumn(fn, col, distinctHashes.data());
+
+   Hashmap ht;
+   ht.setSize(distinct);
+   vector<uint32_t> chains(ht.capacity, 0);
+   for (auto h : distinctHashes) chains[h & ht.mask]++;
+   size_t empty = 0, longest = 0, probes = 0;
+   for (auto c : chains) {
+      if (!c) empty++;
+      longest = max<size_t>(longest, c);
+      // finding the i-th element of a chain takes i probes
+      probes += size_t(c) * (c + 1) / 2;
+   }
+
+   vector<uint32_t> folded(distinct);
+   for (size_t i = 0; i < distinct; ++i)
+      folded[i] = uint32_t(distinctHashes[i] ^ (uint64_t(distinctHashes[i]) >> 32));
+
+   cout << left << setw(20) << col.name << setw(10) << fn.name << right
+        << setw(12) << fixed << setprecision(1) << n / best / 1e6
+        << setw(12) << distinct << setw(10) << setprecision(3)
+        << double(probes) / distinct << setw(8) << longest << setw(10)
+        << double(empty) / ht.capacity << setw(10) << collisions(distinctHashes)
+        << setw(10) << collisions(folded) << endl;
+}
+
+static KeyColumn intColumn(runtime::Database& db, string table, string attr) {
+   auto& rel = db[table];
+   auto data = rel[attr].data<types::Integer>();
+   KeyColumn col{attr, {}, {}};
+   col.keys.resize(rel.nrTuples);
+   for (size_t i = 0; i < rel.nrTuples; ++i) col.keys[i] = data[i].value;
+   return col;
+}
+
+static KeyColumn packedColumn(string name, vector<int32_t>& a,
+                              vector<int32_t>& b) {
+   KeyColumn col{name, {}, {}};
+   col.packed.resize(a.size());
+   for (size_t i = 0; i < a.size(); i += vecSize) {
+      auto chunk = pos_t(min(vecSize, a.size() - i));
+      pack_int32_t_col_packed64(chunk, col.packed.data() + i, a.data() + i, 0);
+      pack_int32_t_col_packed64(chunk, col.packed.data() + i, b.data() + i,
+                                32);
+   }
+   return col;
+}
+
+int main(int argc, char* argv[]) {
+   string path;
+   size_t n = 1 << 22;
+   size_t repetitions = 3;
+   int opt;
+   while ((opt = getopt(argc, argv, "p:n:r:")) != -1) {
+      switch (opt) {
+      case 'p': path = optarg; break;
+      case 'n': n = atoll(optarg); break;
+      case 'r': repetitions = atoll(optarg); break;
+      default:
+         cerr << "Usage: " << argv[0]
+              << " [-p tpch_dir] [-n synthetic_keys] [-r repetitions]" << endl;
+         return 1;
+      }
+   }
+
+   vector<KeyColumn> columns;
+   if (!path.empty()) {
+      runtime::Database db;
+      importTPCH(path, db);
+      columns.push_back(intColumn(db, "lineitem", "l_orderkey"));
+      columns.push_back(intColumn(db, "lineitem", "l_partkey"));
+      columns.push_back(intColumn(db, "lineitem", "l_suppkey"));
+      columns.push_back(intColumn(db, "orders", "o_orderkey"));
+      columns.push_back(intColumn(db, "orders", "o_custkey"));
+      columns.push_back(intColumn(db, "customer", "c_custkey"));
+      columns.push_back(intColumn(db, "part", "p_partkey"));
+      auto partkey = intColumn(db, "partsupp", "ps_partkey");
+      auto suppkey = intColumn(db, "partsupp", "ps_suppkey");
+      columns.push_back(
+          packedColumn("ps_partkey,ps_suppkey", partkey.keys, suppkey.keys));
+   } else {
+      KeyColumn dense{"dense", vector<int32_t>(n), {}};
+      iota(dense.keys.begin(), dense.keys.end(), 1);
+      KeyColumn strided{"strided_4096", vector<int32_t>(n), {}};
+      for (size_t i = 0; i < n; ++i) strided.keys[i] = int32_t(i * 4096);
+      vector<int32_t> high(n), low(n);
+      for (size_t i = 0; i < n; ++i) {
+         high[i] = int32_t(i / 4);
+         low[i] = int32_t(i % 4);
+      }
+      columns.push_back(move(dense));
+      columns.push_back(move(strided));
+      columns.push_back(packedColumn("composite", high, low));
+   }
+
+   cout << left << setw(20) << "column" << setw(10) << "hash" << right
+        << setw(12) << "Mkeys/s" << setw(12) << "distinct" << setw(10)
+        << "probes" << setw(8) << "chain" << setw(10) << "empty" << setw(10)
+        << "coll" << setw(10) << "coll32" << endl;
+   for (auto& col : columns)
+      for (auto& fn : hashFunctions) {
+         auto copy = col;
+         report(fn, copy, repetitions);
+      }
+   return 0;
+}
@@ -1,4 +1,5 @@
 #include "profile.hpp"
+#include "vectorwise/Operations.hpp"
 #include "vectorwise/Primitives.hpp"
 #include "vectorwise/defs.hpp"
 #include <algorithm>
@@ -78,6 +79,43 @@ void putRandom(vector<pos_t>& sel, vector<T>& v, size_t min = 0,
                        repetitions);                                           \
    }
 
+/// evaluate a chain of selections and a projection over n tuples in vectors
+/// of vecSize, once through the virtual ops and once as compiled program
+void benchExpressionOverhead(PerfEvents& e, size_t n, size_t vecSize,
+                             size_t repetitions) {
+   using namespace vectorwise;
+   vector<int32_t> a(vecSize), b(vecSize), result(vecSize);
+   putRandom(a);
+   putRandom(b);
+   vector<pos_t> sel1(vecSize), sel2(vecSize), sel3(vecSize);
+   int32_t low = 10, high = 90, mid = 50;
+   Expression expression;
+   expression.ops.push_back(make_unique<F3_Op>(
+       sel1.data(), a.data(), &high, (F3)sel_less_int32_t_col_int32_t_val));
+   expression.ops.push_back(
+       make_unique<F4_Op>(sel1.data(), sel2.data(), a.data(), &low,
+                          (F4)selsel_greater_int32_t_col_int32_t_val));
+   expression.ops.push_back(
+       make_unique<F4_Op>(sel2.data(), sel3.data(), b.data(), &mid,
+                          (F4)selsel_less_equal_int32_t_col_int32_t_val));
+   expression.ops.push_back(
+       make_unique<F4_Op>(sel3.data(), result.data(), a.data(), b.data(),
+                          (F4)proj_sel_both_plus_int32_t_col_int32_t_col));
+
+   for (auto threaded : {false, true}) {
+      threadedCode = threaded;
+      e.timeAndProfile(string("expr\t") + to_string(vecSize) + "\t" +
+                           (threaded ? "threaded" : "virtual") + "\t",
+                       n,
+                       [&]() {
+                          for (size_t i = 0; i < n; i += vecSize)
+                             expression.evaluate(min(vecSize, n - i));
+                       },
+                       repetitions);
+   }
+   threadedCode = true;
+}
+
 int main() {
    size_t vecSize = 1024 * 8;
    size_t n = 1024 * 8;
@@ -87,5 +125,8 @@ int main() {
    EACH_BF(EACH_T, EACH_SEL, BENCH_LESS);
    n = 1024 * 4;
    EACH_BF(EACH_T, EACH_SEL, BENCH_LESS_SEL);
+   // interpretation overhead of expressions at small vector sizes
+   for (size_t v : {16, 64, 128, 256, 512, 1024})
+      benchExpressionOverhead(e, 1024 * 1024, v, 100);
    return 0;
 }
@@ -6,6 +6,7 @@
 #include "common/runtime/Types.hpp"
 #include "hyper/GroupBy.hpp"
 #include "hyper/ParallelHelper.hpp"
+#include "hyper/Selection.hpp"
 #include "tbb/tbb.h"
 #include "vectorwise/Operations.hpp"
 #include "vectorwise/Operators.hpp"
@@ -36,8 +37,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q12_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashset<types::Integer, hash> ht;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_yearmonthnum = d["d_yearmonthnum"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -65,6 +66,18 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q12_hyper(Database& db,
        [&](const tbb::blocked_range<size_t>& r,
            const types::Numeric<18, 4>& s) {
           auto revenue = s;
+          if (conf.useSimdScan) {
+             // select with SIMD, then probe only the matches
+             hyper::forEachMatch(
+                 r.begin(), r.end(),
+                 [&](size_t i) {
+                    if (ht.contains(lo_orderdate[i]))
+                       revenue += lo_extendedprice[i] * lo_discount[i];
+                 },
+                 hyper::between(lo_quantity, quantity_min, quantity_max),
+                 hyper::between(lo_discount, discount_min, discount_max));
+             return revenue;
+          }
           for (size_t i = r.begin(), end = r.end(); i != end; ++i) {
              auto& quantity = lo_quantity[i];
              auto& discount = lo_discount[i];
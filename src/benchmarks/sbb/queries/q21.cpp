@@ -57,8 +57,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q21_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashmapx<types::Integer, types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_year = d["d_year"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -72,8 +72,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q21_hyper(Database& db,
 
    // --- ht for join supplier-lineorder
    Hashset<types::Integer, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto& su = db["supplier"];
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_region = su["s_region"].data<types::Char<12>>();
@@ -91,8 +91,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q21_hyper(Database& db,
 
    // --- ht for join part-lineorder
    Hashmapx<types::Integer, types::Char<9>, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<decltype(ht3)::Entry>>
+       entries3(nrThreads);
    auto& p = db["part"];
    auto p_partkey = p["p_partkey"].data<types::Integer>();
    auto p_category = p["p_category"].data<types::Char<7>>();
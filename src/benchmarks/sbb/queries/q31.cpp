@@ -57,8 +57,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q31_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashmapx<types::Integer, types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_year = d["d_year"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -75,8 +75,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q31_hyper(Database& db,
 
    // --- ht for join supplier-lineorder
    Hashmapx<types::Integer, types::Char<15>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto& su = db["supplier"];
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_region = su["s_region"].data<types::Char<12>>();
@@ -96,8 +96,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q31_hyper(Database& db,
 
    // --- ht for join part-lineorder
    Hashmapx<types::Integer, types::Char<15>, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<decltype(ht3)::Entry>>
+       entries3(nrThreads);
    auto& c = db["customer"];
    auto c_custkey = c["c_custkey"].data<types::Integer>();
    auto c_nation = c["c_nation"].data<types::Char<15>>();
@@ -214,7 +214,15 @@ std::unique_ptr<Q31Builder::Q31> Q31Builder::getQuery() {
                              Column(customer, "c_region"), Value(&r->region)));
 
    auto lineorder = Scan("lineorder");
-   HashJoin(Buffer(lineorder_customer, sizeof(pos_t)), conf.joinAll())
+   // with late materialization the nations stay in the ht entries until the
+   // joins with supplier and date have discarded their lineorders
+   auto late = conf.lateMaterialization;
+   auto customerJoin =
+       HashJoin(Buffer(lineorder_customer, sizeof(pos_t)), conf.joinAll());
+   if (late)
+      customerJoin.setLateMaterialization(Buffer(
+          customer_entries, sizeof(runtime::Hashmap::EntryHeader*)));
+   customerJoin
        .addBuildKey(Column(customer, "c_custkey"), Buffer(sel_customer),
                     conf.hash_sel_int32_t_col(),
                     primitives::scatter_sel_int32_t_col)
@@ -226,7 +234,12 @@ std::unique_ptr<Q31Builder::Q31> Q31Builder::getQuery() {
                     primitives::keys_equal_int32_t_col);
 
    // filter for c_nation is lineorder_supplier
-   HashJoin(Buffer(lineorder_supplier, sizeof(pos_t)), conf.joinAll())
+   auto supplierJoin =
+       HashJoin(Buffer(lineorder_supplier, sizeof(pos_t)), conf.joinAll());
+   if (late)
+      supplierJoin.setLateMaterialization(Buffer(
+          supplier_entries, sizeof(runtime::Hashmap::EntryHeader*)));
+   supplierJoin
        .addBuildKey(Column(supplier, "s_suppkey"), Buffer(sel_supplier),
                     conf.hash_sel_int32_t_col(),
                     primitives::scatter_sel_int32_t_col)
@@ -262,50 +275,80 @@ std::unique_ptr<Q31Builder::Q31> Q31Builder::getQuery() {
                     Buffer(lineorder_supplier_date, sizeof(pos_t)),
                     primitives::keys_equal_int32_t_col);
 
-   HashGroup()
-       .addKey(Buffer(d_year),          //
-               conf.hash_int32_t_col(), //
-               primitives::keys_not_equal_int32_t_col,
-               primitives::partition_by_key_int32_t_col,
-               primitives::scatter_sel_int32_t_col,
-               primitives::keys_not_equal_row_int32_t_col,
-               primitives::partition_by_key_row_int32_t_col,
-               primitives::scatter_sel_row_int32_t_col,
-               primitives::gather_val_int32_t_col, Buffer(d_year))
-       .pushKeySelVec(Buffer(lineorder_date_customer),
-                      Buffer(lineorder_date_part_grouped, sizeof(pos_t)))
-       .addKey(Buffer(c_nation, sizeof(types::Char<15>)),
-               Buffer(lineorder_date_customer),
-               primitives::rehash_sel_Char_15_col,
-               primitives::keys_not_equal_sel_Char_15_col,
-               primitives::partition_by_key_sel_Char_15_col,
-               Buffer(lineorder_date_part_grouped, sizeof(pos_t)),
-               primitives::scatter_sel_Char_15_col,
-               primitives::keys_not_equal_row_Char_15_col,
-               primitives::partition_by_key_row_Char_15_col,
-               primitives::scatter_sel_row_Char_15_col,
-               primitives::gather_val_Char_15_col,
-               Buffer(c_nation, sizeof(types::Char<15>)))
-       .pushKeySelVec(Buffer(lineorder_date),
-                      Buffer(lineorder_date_supplier_grouped, sizeof(pos_t)))
-       .addKey(Buffer(s_nation, sizeof(types::Char<15>)),
-               Buffer(lineorder_date), primitives::rehash_sel_Char_15_col,
-               primitives::keys_not_equal_sel_Char_15_col,
-               primitives::partition_by_key_sel_Char_15_col,
-               Buffer(lineorder_date_supplier_grouped, sizeof(pos_t)),
-               primitives::scatter_sel_Char_15_col,
-               primitives::keys_not_equal_row_Char_15_col,
-               primitives::partition_by_key_row_Char_15_col,
-               primitives::scatter_sel_row_Char_15_col,
-               primitives::gather_val_Char_15_col,
-               Buffer(s_nation, sizeof(types::Char<15>)))
-       .addValue(Column(lineorder, "lo_revenue"),
-                 Buffer(lineorder_supplier_date),
-                 primitives::aggr_init_plus_int64_t_col,
-                 primitives::aggr_sel_plus_int64_t_col,
-                 primitives::aggr_row_plus_int64_t_col,
-                 primitives::gather_val_int64_t_col,
-                 Buffer(sum_revenue, sizeof(types::Numeric<18, 2>)));
+   if (late) {
+      Fetch(Buffer(lineorder_date_customer))
+          .addValue(Buffer(c_nation), primitives::gather_sel_col_Char_15_col,
+                    Buffer(c_nation_fetched, sizeof(types::Char<15>)));
+      Fetch(Buffer(lineorder_date))
+          .addValue(Buffer(s_nation), primitives::gather_sel_col_Char_15_col,
+                    Buffer(s_nation_fetched, sizeof(types::Char<15>)));
+   }
+
+   auto group = HashGroup();
+   group.addKey(Buffer(d_year),          //
+                conf.hash_int32_t_col(), //
+                primitives::keys_not_equal_int32_t_col,
+                primitives::partition_by_key_int32_t_col,
+                primitives::scatter_sel_int32_t_col,
+                primitives::keys_not_equal_row_int32_t_col,
+                primitives::partition_by_key_row_int32_t_col,
+                primitives::scatter_sel_row_int32_t_col,
+                primitives::gather_val_int32_t_col, Buffer(d_year));
+   if (late)
+      // the fetched nations are dense in the result of the date join
+      group
+          .addKey(Buffer(c_nation_fetched), primitives::rehash_Char_15_col,
+                  primitives::keys_not_equal_Char_15_col,
+                  primitives::partition_by_key_Char_15_col,
+                  primitives::scatter_sel_Char_15_col,
+                  primitives::keys_not_equal_row_Char_15_col,
+                  primitives::partition_by_key_row_Char_15_col,
+                  primitives::scatter_sel_row_Char_15_col,
+                  primitives::gather_val_Char_15_col, Buffer(c_nation))
+          .addKey(Buffer(s_nation_fetched), primitives::rehash_Char_15_col,
+                  primitives::keys_not_equal_Char_15_col,
+                  primitives::partition_by_key_Char_15_col,
+                  primitives::scatter_sel_Char_15_col,
+                  primitives::keys_not_equal_row_Char_15_col,
+                  primitives::partition_by_key_row_Char_15_col,
+                  primitives::scatter_sel_row_Char_15_col,
+                  primitives::gather_val_Char_15_col, Buffer(s_nation));
+   else
+      group
+          .pushKeySelVec(Buffer(lineorder_date_customer),
+                         Buffer(lineorder_date_part_grouped, sizeof(pos_t)))
+          .addKey(Buffer(c_nation, sizeof(types::Char<15>)),
+                  Buffer(lineorder_date_customer),
+                  primitives::rehash_sel_Char_15_col,
+                  primitives::keys_not_equal_sel_Char_15_col,
+                  primitives::partition_by_key_sel_Char_15_col,
+                  Buffer(lineorder_date_part_grouped, sizeof(pos_t)),
+                  primitives::scatter_sel_Char_15_col,
+                  primitives::keys_not_equal_row_Char_15_col,
+                  primitives::partition_by_key_row_Char_15_col,
+                  primitives::scatter_sel_row_Char_15_col,
+                  primitives::gather_val_Char_15_col,
+                  Buffer(c_nation, sizeof(types::Char<15>)))
+          .pushKeySelVec(Buffer(lineorder_date),
+                         Buffer(lineorder_date_supplier_grouped, sizeof(pos_t)))
+          .addKey(Buffer(s_nation, sizeof(types::Char<15>)),
+                  Buffer(lineorder_date), primitives::rehash_sel_Char_15_col,
+                  primitives::keys_not_equal_sel_Char_15_col,
+                  primitives::partition_by_key_sel_Char_15_col,
+                  Buffer(lineorder_date_supplier_grouped, sizeof(pos_t)),
+                  primitives::scatter_sel_Char_15_col,
+                  primitives::keys_not_equal_row_Char_15_col,
+                  primitives::partition_by_key_row_Char_15_col,
+                  primitives::scatter_sel_row_Char_15_col,
+                  primitives::gather_val_Char_15_col,
+                  Buffer(s_nation, sizeof(types::Char<15>)));
+   group.addValue(Column(lineorder, "lo_revenue"),
+                  Buffer(lineorder_supplier_date),
+                  primitives::aggr_init_plus_int64_t_col,
+                  primitives::aggr_sel_plus_int64_t_col,
+                  primitives::aggr_row_plus_int64_t_col,
+                  primitives::gather_val_int64_t_col,
+                  Buffer(sum_revenue, sizeof(types::Numeric<18, 2>)));
 
    result.addValue("revenue", Buffer(sum_revenue))
        .addValue("d_year", Buffer(d_year))
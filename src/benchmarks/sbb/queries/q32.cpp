@@ -57,8 +57,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q32_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashmapx<types::Integer, types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_year = d["d_year"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -75,8 +75,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q32_hyper(Database& db,
 
    // --- ht for join supplier-lineorder
    Hashmapx<types::Integer, types::Char<10>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto& su = db["supplier"];
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_nation = su["s_nation"].data<types::Char<15>>();
@@ -96,8 +96,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q32_hyper(Database& db,
 
    // --- ht for join part-lineorder
    Hashmapx<types::Integer, types::Char<10>, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<decltype(ht3)::Entry>>
+       entries3(nrThreads);
    auto& c = db["customer"];
    auto c_custkey = c["c_custkey"].data<types::Integer>();
    auto c_nation = c["c_nation"].data<types::Char<15>>();
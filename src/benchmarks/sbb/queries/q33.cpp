@@ -58,8 +58,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q33_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashmapx<types::Integer, types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_year = d["d_year"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -76,8 +76,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q33_hyper(Database& db,
 
    // --- ht for join supplier-lineorder
    Hashmapx<types::Integer, types::Char<10>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto& su = db["supplier"];
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_city = su["s_city"].data<types::Char<10>>();
@@ -95,8 +95,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q33_hyper(Database& db,
 
    // --- ht for join part-lineorder
    Hashmapx<types::Integer, types::Char<10>, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<decltype(ht3)::Entry>>
+       entries3(nrThreads);
    auto& c = db["customer"];
    auto c_custkey = c["c_custkey"].data<types::Integer>();
    auto c_city = c["c_city"].data<types::Char<10>>();
@@ -61,8 +61,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q41_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashmapx<types::Integer, types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_year = d["d_year"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -77,8 +77,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q41_hyper(Database& db,
 
    // --- ht for join part-lineorder
    Hashset<types::Integer, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto& p = db["part"];
    auto p_partkey = p["p_partkey"].data<types::Integer>();
    auto p_mfgr = p["p_mfgr"].data<types::Char<6>>();
@@ -95,8 +95,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q41_hyper(Database& db,
 
    // --- ht for join customer-lineorder
    Hashmapx<types::Integer, types::Char<15>, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<decltype(ht3)::Entry>>
+       entries3(nrThreads);
    auto& c = db["customer"];
    auto c_custkey = c["c_custkey"].data<types::Integer>();
    auto c_nation = c["c_nation"].data<types::Char<15>>();
@@ -115,8 +115,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q41_hyper(Database& db,
 
    // --- ht for join supplier-lineorder
    Hashset<types::Integer, hash> ht4;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht4)::Entry>>
-       entries4;
+   runtime::worker_specific<runtime::Stack<decltype(ht4)::Entry>>
+       entries4(nrThreads);
    auto& su = db["supplier"];
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_region = su["s_region"].data<types::Char<12>>();
@@ -64,8 +64,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q43_hyper(Database& db,
 
    // --- ht for join date-lineorder
    Hashmapx<types::Integer, types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto& d = db["date"];
    auto d_year = d["d_year"].data<types::Integer>();
    auto d_datekey = d["d_datekey"].data<types::Integer>();
@@ -82,8 +82,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q43_hyper(Database& db,
 
    // --- ht for join part-lineorder
    Hashmapx<types::Integer, types::Char<9>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto& p = db["part"];
    auto p_partkey = p["p_partkey"].data<types::Integer>();
    auto p_brand1 = p["p_brand1"].data<types::Char<9>>();
@@ -102,8 +102,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q43_hyper(Database& db,
 
    // --- ht for join customer-lineorder
    Hashset<types::Integer, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<decltype(ht3)::Entry>>
+       entries3(nrThreads);
    auto& c = db["customer"];
    auto c_custkey = c["c_custkey"].data<types::Integer>();
    auto c_region = c["c_region"].data<types::Char<12>>();
@@ -120,8 +120,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q43_hyper(Database& db,
 
    // --- ht for join supplier-lineorder
    Hashmapx<types::Integer, types::Char<10>, hash> ht4;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht4)::Entry>>
-       entries4;
+   runtime::worker_specific<runtime::Stack<decltype(ht4)::Entry>>
+       entries4(nrThreads);
    auto& su = db["supplier"];
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_nation = su["s_nation"].data<types::Char<15>>();
@@ -16,6 +16,25 @@ using namespace ssb;
 
 static void escape(void* p) { asm volatile("" : : "g"(p) : "memory"); }
 
+/// 0 disables analyzing vectorwise plans, 1 prints the annotated plan tree, 2
+/// the same as JSON
+static int analyzeFormat = 0;
+
+/// Print the statistics of the vectorwise plan run last, if it was analyzed,
+/// and the cost of the primitives it called in all repetitions
+static void printAnalyzed() {
+   if (auto plan = vectorwise::takeAnalyzedPlan()) {
+      if (analyzeFormat == 2)
+         plan->printJson(std::cout);
+      else
+         plan->print(std::cout);
+   }
+   if (vectorwise::primitiveProfiling) {
+      vectorwise::primitiveProfile.print(std::cout);
+      vectorwise::primitiveProfile.reset();
+   }
+}
+
 size_t nrTuples(Database& db, std::vector<std::string> tables) {
    size_t sum = 0;
    for (auto& table : tables) sum += db[table].nrTuples;
@@ -63,9 +82,32 @@ int main(int argc, char* argv[]) {
    if (auto v = std::getenv("vectorSize")) vectorSize = atoi(v);
    if (auto v = std::getenv("SIMDhash")) conf.useSimdHash = atoi(v);
    if (auto v = std::getenv("SIMDjoin")) conf.useSimdJoin = atoi(v);
+   if (auto v = std::getenv("AdaptiveJoin")) conf.adaptiveJoin = atoi(v);
+   if (auto v = std::getenv("LateMaterialization"))
+      conf.lateMaterialization = atoi(v);
    if (auto v = std::getenv("SIMDsel")) conf.useSimdSel = atoi(v);
    if (auto v = std::getenv("SIMDproj")) conf.useSimdProj = atoi(v);
+   if (auto v = std::getenv("SIMDscan")) conf.useSimdScan = atoi(v);
+   if (auto v = std::getenv("HashHyper"))
+      conf.hashHyper = hashFunctionFromString(v);
+   if (auto v = std::getenv("HashVectorwise"))
+      conf.hashVectorwise = hashFunctionFromString(v);
+   vectorwise::primitives::setHashFunction(conf.hashVectorwise);
+   if (auto v = std::getenv("MicroAdaptive"))
+      vectorwise::microAdaptivity.enabled = atoi(v);
+   if (auto v = std::getenv("FusePrimitives"))
+      vectorwise::fusePrimitives = atoi(v);
+   if (auto v = std::getenv("ThreadedCode"))
+      vectorwise::threadedCode = atoi(v);
    if (auto v = std::getenv("clearCaches")) clearCaches = atoi(v);
+   if (auto v = std::getenv("PrimitiveProfile")) {
+      vectorwise::primitiveProfiling = atoi(v);
+      vectorwise::primitiveProfile.countInstructions = atoi(v) > 1;
+   }
+   if (auto v = std::getenv("Analyze")) {
+      analyzeFormat = std::string(v) == "json" ? 2 : atoi(v);
+      vectorwise::analyze = analyzeFormat;
+   }
    if (auto v = std::getenv("q")) {
      using namespace std;
      istringstream iss((string(v)));
@@ -77,33 +119,46 @@ int main(int argc, char* argv[]) {
    tbb::global_control scheduler(tbb::global_control::max_allowed_parallelism, nrThreads);
    if (q.count("1.1h")) e.timeAndProfile("q1.1 hyper     ", nrTuples(ssb, {"date", "lineorder"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q11_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("1.1v")) e.timeAndProfile("q1.1 vectorwise", nrTuples(ssb, {"date", "lineorder"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q11_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("1.2h")) e.timeAndProfile("q1.2 hyper     ", nrTuples(ssb, {"date", "lineorder"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q12_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("1.2v")) e.timeAndProfile("q1.2 vectorwise", nrTuples(ssb, {"date", "lineorder"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q12_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("1.3h")) e.timeAndProfile("q1.3 hyper     ", nrTuples(ssb, {"date", "lineorder"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q13_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("1.3v")) e.timeAndProfile("q1.3 vectorwise", nrTuples(ssb, {"date", "lineorder"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q13_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
 
    if (q.count("2.1h")) e.timeAndProfile("q2.1 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q21_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("2.1v")) e.timeAndProfile("q2.1 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q21_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("2.2h")) e.timeAndProfile("q2.2 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q22_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("2.2v")) e.timeAndProfile("q2.2 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q22_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("2.3h")) e.timeAndProfile("q2.3 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q23_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("2.3v")) e.timeAndProfile("q2.3 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q23_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
 
    if (q.count("3.1h")) e.timeAndProfile("q3.1 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q31_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("3.1v")) e.timeAndProfile("q3.1 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q31_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("3.2h")) e.timeAndProfile("q3.2 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q32_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("3.2v")) e.timeAndProfile("q3.2 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q32_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("3.3h")) e.timeAndProfile("q3.3 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q33_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("3.3v")) e.timeAndProfile("q3.3 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q33_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("3.3h")) e.timeAndProfile("q3.4 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q34_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("3.3v")) e.timeAndProfile("q3.4 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q34_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
 
    if (q.count("4.1h")) e.timeAndProfile("q4.1 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q41_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("4.1v")) e.timeAndProfile("q4.1 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q41_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("4.2h")) e.timeAndProfile("q4.2 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q42_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("4.2v")) e.timeAndProfile("q4.2 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q42_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
    if (q.count("4.3h")) e.timeAndProfile("q4.3 hyper     ", nrTuples(ssb, {"date", "lineorder", "supplier", "customer", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q43_hyper(ssb, nrThreads); escape(&result);}, repetitions);
    if (q.count("4.3v")) e.timeAndProfile("q4.3 vectorwise", nrTuples(ssb, {"date", "lineorder", "supplier", "customer", "part"}), [&]() { if(clearCaches) clearOsCaches(); auto result = q43_vectorwise(ssb, nrThreads, vectorSize); escape(&result);}, repetitions);
+   printAnalyzed();
 
    return 0;
 }
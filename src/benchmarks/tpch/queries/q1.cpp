@@ -56,8 +56,9 @@ static volatile int64_t cse_barrier_1 = 1;
 static volatile int64_t cse_barrier_2 = 1;
 static volatile int64_t cse_barrier_3 = 1;
 
-NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
-                                                     size_t nrThreads) {
+template <typename hash>
+NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper_(Database& db,
+                                                      size_t nrThreads) {
    using namespace types;
    using namespace std;
    types::Date c1 = types::Date::castString("1998-09-02");
@@ -73,8 +74,6 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
 
    auto resources = initQuery(nrThreads);
 
-   using hash = runtime::CRC32Hash;
-
    // Read the volatile barriers once before the parallel region so the
    // value is in scope for the lambda but still opaque to the optimizer.
    // These will always be 1 at runtime; the compiler cannot know that.
@@ -220,7 +219,7 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
    auto chargeAttr = result->addAttribute("sum_charge", sizeof(Numeric<12, 6>));
    auto count_orderAttr = result->addAttribute("count_order", sizeof(int64_t));
 
-   groupOp.forallGroups([&](runtime::Stack<decltype(groupOp)::group_t>& entries) {
+   groupOp.forallGroups([&](runtime::Stack<typename decltype(groupOp)::group_t>& entries) {
       auto n = entries.size();
       auto block = result->createBlock(n);
       auto ret = reinterpret_cast<Char<1>*>(block.data(retAttr));
@@ -254,6 +253,12 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
    return move(resources.query);
 }
 
+std::unique_ptr<runtime::Query> q1_hyper(Database& db, size_t nrThreads) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q1_hyper_<decltype(h)>(db, nrThreads);
+   });
+}
+
 std::unique_ptr<Q1Builder::Q1> Q1Builder::getQuery() {
    using namespace vectorwise;
    auto result = Result();
@@ -285,30 +290,22 @@ std::unique_ptr<Q1Builder::Q1> Q1Builder::getQuery() {
                       Buffer(charge, sizeof(int64_t)),
                       Buffer(disc_price, sizeof(int64_t)),
                       Buffer(result_proj_plus, sizeof(int64_t))));
-   HashGroup()
-       .pushKeySelVec(Buffer(sel_date), Buffer(sel_date_grouped, sizeof(pos_t)))
-       .addKey(Column(lineitem, "l_returnflag"), Buffer(sel_date),
-               primitives::hash_sel_Char_1_col,
-               primitives::keys_not_equal_sel_Char_1_col,
-               primitives::partition_by_key_sel_Char_1_col,
-               Buffer(sel_date_grouped, sizeof(pos_t)),
-               primitives::scatter_sel_Char_1_col,
-               primitives::keys_not_equal_row_Char_1_col,
-               primitives::partition_by_key_row_Char_1_col,
-               primitives::scatter_sel_row_Char_1_col,
-               primitives::gather_val_Char_1_col,
-               Buffer(returnflag, sizeof(Char_1)))
+   // both group keys in one word, hashed and compared in a single pass
+   auto keys = PackKeys(Buffer(packed, sizeof(primitives::packed64)));
+   keys.addKey(Column(lineitem, "l_returnflag"), Buffer(sel_date),
+               primitives::pack_sel_Char_1_col_packed64)
        .addKey(Column(lineitem, "l_linestatus"), Buffer(sel_date),
-               primitives::rehash_sel_Char_1_col,
-               primitives::keys_not_equal_sel_Char_1_col,
-               primitives::partition_by_key_sel_Char_1_col,
-               Buffer(sel_date_grouped, sizeof(pos_t)),
-               primitives::scatter_sel_Char_1_col,
-               primitives::keys_not_equal_row_Char_1_col,
-               primitives::partition_by_key_row_Char_1_col,
-               primitives::scatter_sel_row_Char_1_col,
-               primitives::gather_val_Char_1_col,
-               Buffer(linestatus, sizeof(Char_1)))
+               primitives::pack_sel_Char_1_col_packed64);
+   HashGroup()
+       .addKey(Buffer(packed), primitives::hash_packed64_col,
+               primitives::keys_not_equal_packed64_col,
+               primitives::partition_by_key_packed64_col,
+               primitives::scatter_sel_packed64_col,
+               primitives::keys_not_equal_row_packed64_col,
+               primitives::partition_by_key_row_packed64_col,
+               primitives::scatter_sel_row_packed64_col,
+               primitives::gather_val_packed64_col,
+               Buffer(grouped_packed, sizeof(primitives::packed64)))
        .padToAlign(sizeof(types::Numeric<12, 4>))
        // original aggregates
        .addValue(Buffer(disc_price), primitives::aggr_init_plus_int64_t_col,
@@ -427,6 +424,16 @@ std::unique_ptr<Q1Builder::Q1> Q1Builder::getQuery() {
                  primitives::gather_val_int64_t_col,
                  Buffer(count_order_4, sizeof(uint64_t)));
 
+   Project()
+       .addExpression(Expression().addOp(
+           primitives::unpack_Char_1_col_packed64,
+           Buffer(returnflag, sizeof(Char_1)), Buffer(grouped_packed),
+           keys.shift(0)))
+       .addExpression(Expression().addOp(
+           primitives::unpack_Char_1_col_packed64,
+           Buffer(linestatus, sizeof(Char_1)), Buffer(grouped_packed),
+           keys.shift(1)));
+
    result.addValue("l_returnflag", Buffer(returnflag))
        .addValue("l_linestatus", Buffer(linestatus))
        .addValue("sum_qty", Buffer(sum_qty))
@@ -480,8 +487,9 @@ std::unique_ptr<runtime::Query> q1_vectorwise(Database& db, size_t nrThreads,
 #ifndef STRESS_TEST
 
 
-NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
-                                                     size_t nrThreads) {
+template <typename hash>
+NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper_(Database& db,
+                                                      size_t nrThreads) {
    using namespace types;
    using namespace std;
    types::Date c1 = types::Date::castString("1998-09-02");
@@ -497,8 +505,6 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
 
    auto resources = initQuery(nrThreads);
 
-   using hash = runtime::CRC32Hash;
-
    auto groupOp = make_GroupBy<tuple<Char<1>, Char<1>>,
                                tuple<Numeric<12, 2>, Numeric<12, 2>,
                                      Numeric<12, 4>, Numeric<12, 6>, int64_t>,
@@ -545,7 +551,7 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
    auto chargeAttr = result->addAttribute("sum_charge", sizeof(Numeric<12, 2>));
    auto count_orderAttr = result->addAttribute("count_order", sizeof(int64_t));
 
-   groupOp.forallGroups([&](runtime::Stack<decltype(groupOp)::group_t>& /*auto&*/ entries) {
+   groupOp.forallGroups([&](runtime::Stack<typename decltype(groupOp)::group_t>& /*auto&*/ entries) {
       auto n = entries.size();
       auto block = result->createBlock(n);
       auto ret = reinterpret_cast<Char<1>*>(block.data(retAttr));
@@ -575,6 +581,12 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q1_hyper(Database& db,
    return move(resources.query);
 }
 
+std::unique_ptr<runtime::Query> q1_hyper(Database& db, size_t nrThreads) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q1_hyper_<decltype(h)>(db, nrThreads);
+   });
+}
+
 std::unique_ptr<Q1Builder::Q1> Q1Builder::getQuery() {
    using namespace vectorwise;
    auto result = Result();
@@ -606,30 +618,22 @@ std::unique_ptr<Q1Builder::Q1> Q1Builder::getQuery() {
                       Buffer(charge, sizeof(int64_t)),
                       Buffer(disc_price, sizeof(int64_t)),
                       Buffer(result_proj_plus, sizeof(int64_t))));
-   HashGroup()
-       .pushKeySelVec(Buffer(sel_date), Buffer(sel_date_grouped, sizeof(pos_t)))
-       .addKey(Column(lineitem, "l_returnflag"), Buffer(sel_date),
-               primitives::hash_sel_Char_1_col,
-               primitives::keys_not_equal_sel_Char_1_col,
-               primitives::partition_by_key_sel_Char_1_col,
-               Buffer(sel_date_grouped, sizeof(pos_t)),
-               primitives::scatter_sel_Char_1_col,
-               primitives::keys_not_equal_row_Char_1_col,
-               primitives::partition_by_key_row_Char_1_col,
-               primitives::scatter_sel_row_Char_1_col,
-               primitives::gather_val_Char_1_col,
-               Buffer(returnflag, sizeof(Char_1)))
+   // both group keys in one word, hashed and compared in a single pass
+   auto keys = PackKeys(Buffer(packed, sizeof(primitives::packed64)));
+   keys.addKey(Column(lineitem, "l_returnflag"), Buffer(sel_date),
+               primitives::pack_sel_Char_1_col_packed64)
        .addKey(Column(lineitem, "l_linestatus"), Buffer(sel_date),
-               primitives::rehash_sel_Char_1_col,
-               primitives::keys_not_equal_sel_Char_1_col,
-               primitives::partition_by_key_sel_Char_1_col,
-               Buffer(sel_date_grouped, sizeof(pos_t)),
-               primitives::scatter_sel_Char_1_col,
-               primitives::keys_not_equal_row_Char_1_col,
-               primitives::partition_by_key_row_Char_1_col,
-               primitives::scatter_sel_row_Char_1_col,
-               primitives::gather_val_Char_1_col,
-               Buffer(linestatus, sizeof(Char_1)))
+               primitives::pack_sel_Char_1_col_packed64);
+   HashGroup()
+       .addKey(Buffer(packed), primitives::hash_packed64_col,
+               primitives::keys_not_equal_packed64_col,
+               primitives::partition_by_key_packed64_col,
+               primitives::scatter_sel_packed64_col,
+               primitives::keys_not_equal_row_packed64_col,
+               primitives::partition_by_key_row_packed64_col,
+               primitives::scatter_sel_row_packed64_col,
+               primitives::gather_val_packed64_col,
+               Buffer(grouped_packed, sizeof(primitives::packed64)))
        .padToAlign(sizeof(types::Numeric<12, 4>))
        .addValue(Buffer(disc_price), primitives::aggr_init_plus_int64_t_col,
                  primitives::aggr_plus_int64_t_col,
@@ -660,6 +664,16 @@ std::unique_ptr<Q1Builder::Q1> Q1Builder::getQuery() {
                  primitives::gather_val_int64_t_col,
                  Buffer(count_order, sizeof(uint64_t)));
 
+   Project()
+       .addExpression(Expression().addOp(
+           primitives::unpack_Char_1_col_packed64,
+           Buffer(returnflag, sizeof(Char_1)), Buffer(grouped_packed),
+           keys.shift(0)))
+       .addExpression(Expression().addOp(
+           primitives::unpack_Char_1_col_packed64,
+           Buffer(linestatus, sizeof(Char_1)), Buffer(grouped_packed),
+           keys.shift(1)));
+
    result.addValue("l_returnflag", Buffer(returnflag))
        .addValue("l_linestatus", Buffer(linestatus))
        .addValue("sum_qty", Buffer(sum_qty))
@@ -6,6 +6,8 @@
 #include "common/runtime/Types.hpp"
 #include "hyper/GroupBy.hpp"
 #include "hyper/ParallelHelper.hpp"
+#include "hyper/ProbeStage.hpp"
+#include "hyper/TopN.hpp"
 #include "tbb/tbb.h"
 #include "vectorwise/Operations.hpp"
 #include "vectorwise/Operators.hpp"
@@ -48,14 +50,17 @@ using namespace std;
 //   o_orderkey,
 //   o_orderdate,
 //   o_totalprice
-
-NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
-                                                      size_t nrThreads) {
+// order by  (only with conf.topN)
+//   o_totalprice desc,
+//   o_orderdate
+// limit 100
+
+template <typename hash>
+NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper_(Database& db,
+                                                       size_t nrThreads) {
    using namespace types;
    using namespace std;
 
-   using hash = runtime::CRC32Hash;
-
    auto resources = initQuery(nrThreads);
 
    auto& li = db["lineitem"];
@@ -63,9 +68,9 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
    auto l_orderkey = li["l_orderkey"].data<types::Integer>();
    auto l_quantity = li["l_quantity"].data<types::Numeric<12, 2>>();
 
-   tbb::enumerable_thread_specific<
+   runtime::worker_specific<
        Hashmapx<types::Integer, types::Numeric<12, 2>, hash, false>>
-       groups;
+       groups(nrThreads);
 
    const auto zero = types::Numeric<12, 2>::castString("0.00");
 
@@ -79,15 +84,13 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
 
                         for (size_t i = r.begin(), end = r.end(); i != end;
                              ++i) {
-                           auto& group = locals.getGroup(l_orderkey[i]);
-                           group += l_quantity[i];
-                           // locals.consume(l_orderkey[i], l_quantity[i]);
+                           locals.consume(l_orderkey[i], l_quantity[i]);
                         }
                      });
 
    Hashset<types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht1)::Entry>>
+       entries1(nrThreads);
    const auto threeHundret = types::Numeric<12, 2>::castString("300");
    std::atomic<size_t> nrGroups;
    nrGroups = 0;
@@ -112,8 +115,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
    auto c_custkey = cu["c_custkey"].data<types::Integer>();
    auto c_name = cu["c_name"].data<types::Char<25>>();
    Hashmapx<types::Integer, types::Char<25>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht2)::Entry>>
+       entries2(nrThreads);
 
    PARALLEL_SCAN(cu.nrTuples, entries2, {
       entries.emplace_back(ht2.hash(c_custkey[i]), c_custkey[i], c_name[i]);
@@ -126,25 +129,55 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
                                        types::Numeric<12, 2>, types::Char<25>>,
             hash>
        ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht3)::Entry>>
+       entries3(nrThreads);
 
    auto& ord = db["orders"];
    auto o_orderkey = ord["o_orderkey"].data<types::Integer>();
    auto o_custkey = ord["o_custkey"].data<types::Integer>();
    auto o_orderdate = ord["o_orderdate"].data<types::Date>();
    auto o_totalprice = ord["o_totalprice"].data<types::Numeric<12, 2>>();
-   // scan orders
-   auto found = PARALLEL_SELECT(ord.nrTuples, entries3, {
-      types::Char<25>* name;
-      // check if it matches the order criteria and look up the customer name
-      if (ht1.contains(o_orderkey[i]) && (name = ht2.findOne(o_custkey[i]))) {
-         entries.emplace_back(
-             ht3.hash(o_orderkey[i]), o_orderkey[i],
-             make_tuple(o_custkey[i], o_orderdate[i], o_totalprice[i], *name));
-         found++;
-      }
-   });
+   // scan orders, with relaxedFusion the order criteria stage continues
+   // into the customer name stage
+   auto fused = [&](const tbb::blocked_range<size_t>& r, const size_t& f) {
+      auto& entries = entries3.local();
+      auto found = f;
+      auto customers =
+          hyper::probeStage<size_t>(ht2, [&](size_t i, types::Char<25>* name) {
+             if (!name) return;
+             entries.emplace_back(
+                 ht3.hash(o_orderkey[i]), o_orderkey[i],
+                 make_tuple(o_custkey[i], o_orderdate[i], o_totalprice[i],
+                            *name));
+             found++;
+          });
+      auto orders = hyper::probeStage<size_t>(ht1, [&](size_t i, bool matches) {
+         if (matches) customers.push(o_custkey[i], i);
+      });
+      for (size_t i = r.begin(), end = r.end(); i != end; ++i)
+         orders.push(o_orderkey[i], i);
+      orders.flush();
+      customers.flush();
+      return found;
+   };
+   size_t found;
+   if (conf.relaxedFusion)
+      found = tbb::parallel_reduce(
+          tbb::blocked_range<size_t>(0, ord.nrTuples, morselSize), 0, fused,
+          [](const size_t& a, const size_t& b) { return a + b; });
+   else
+      found = PARALLEL_SELECT(ord.nrTuples, entries3, {
+         types::Char<25>* name;
+         // check if it matches the order criteria and look up the customer
+         // name
+         if (ht1.contains(o_orderkey[i]) &&
+             (name = ht2.findOne(o_custkey[i]))) {
+            entries.emplace_back(ht3.hash(o_orderkey[i]), o_orderkey[i],
+                                 make_tuple(o_custkey[i], o_orderdate[i],
+                                            o_totalprice[i], *name));
+            found++;
+         }
+      });
    ht3.setSize(found);
    parallel_insert(entries3, ht3);
 
@@ -160,6 +193,18 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
        [&](const tbb::blocked_range<size_t>& r) {
           auto locals = finalGroupOp.preAggLocals();
 
+          if (conf.relaxedFusion) {
+             auto orders =
+                 hyper::probeStage<size_t>(ht3, [&](size_t i, auto* v) {
+                    if (!v) return;
+                    auto& group = locals.getGroup(
+                        tuple_cat(*v, make_tuple(l_orderkey[i])));
+                    group += l_quantity[i];
+                 });
+             for (size_t i = r.begin(), end = r.end(); i != end; ++i)
+                orders.push(l_orderkey[i], i);
+             return;
+          }
           for (size_t i = r.begin(), end = r.end(); i != end; ++i) {
              std::tuple<types::Integer, types::Date, types::Numeric<12, 2>,
                         types::Char<25>>* v;
@@ -180,6 +225,48 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
        result->addAttribute("o_totalprice", sizeof(types::Numeric<12, 2>));
    auto sumAttr = result->addAttribute("sum", sizeof(types::Numeric<12, 2>));
 
+   if (conf.topN) {
+      using row_t = std::tuple<Char<25>, Integer, Integer, Date,
+                               Numeric<12, 2>, Numeric<12, 2>>;
+      auto topN = make_TopN<row_t>(
+          100,
+          [](const row_t& a, const row_t& b) {
+             if (get<4>(a) != get<4>(b)) return get<4>(b) < get<4>(a);
+             return get<3>(a) < get<3>(b);
+          },
+          [](const row_t& row) { return -get<4>(row).value; });
+      finalGroupOp.forallGroups([&](auto& groups) {
+         auto locals = topN.locals();
+         for (auto block : groups)
+            for (auto& group : block) {
+               auto& k = group.k;
+               if (locals.discards(-get<2>(k).value)) continue;
+               locals.consume(make_tuple(get<3>(k), get<0>(k), get<4>(k),
+                                         get<1>(k), get<2>(k), group.v));
+            }
+      });
+      topN.forallTuples([&](auto& rows) {
+         auto block = result->createBlock(rows.size());
+         auto name = reinterpret_cast<Char<25>*>(block.data(namAttr));
+         auto cky = reinterpret_cast<Integer*>(block.data(ckyAttr));
+         auto oky = reinterpret_cast<Integer*>(block.data(okyAttr));
+         auto dat = reinterpret_cast<Date*>(block.data(datAttr));
+         auto tot = reinterpret_cast<Numeric<12, 2>*>(block.data(totAttr));
+         auto sum = reinterpret_cast<Numeric<12, 2>*>(block.data(sumAttr));
+         for (auto& row : rows) {
+            *name++ = get<0>(row);
+            *cky++ = get<1>(row);
+            *oky++ = get<2>(row);
+            *dat++ = get<3>(row);
+            *tot++ = get<4>(row);
+            *sum++ = get<5>(row);
+         }
+         block.addedElements(rows.size());
+      });
+      leaveQuery(nrThreads);
+      return move(resources.query);
+   }
+
    finalGroupOp.forallGroups([&](auto& groups) {
       // write aggregates to result
       auto n = groups.size();
@@ -207,6 +294,12 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q18_hyper(Database& db,
    return move(resources.query);
 }
 
+std::unique_ptr<runtime::Query> q18_hyper(Database& db, size_t nrThreads) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q18_hyper_<decltype(h)>(db, nrThreads);
+   });
+}
+
 std::unique_ptr<Q18Builder::Q18> Q18Builder::getQuery() {
    using namespace vectorwise;
 
@@ -258,28 +351,55 @@ std::unique_ptr<Q18Builder::Q18> Q18Builder::getQuery() {
                       Buffer(c_name, sizeof(types::Char<25>)),
                       primitives::gather_col_Char_25_col);
    auto lineitem2 = Scan("lineitem");
-   HashJoin(Buffer(lineitem_matches, sizeof(pos_t)))
-       .addBuildKey(Column(orders, "o_orderkey"), Buffer(customer_matches),
-                    primitives::hash_sel_int32_t_col,
-                    primitives::scatter_sel_int32_t_col)
-       .addProbeKey(Column(lineitem2, "l_orderkey"),
-                    primitives::hash_int32_t_col,
-                    primitives::keys_equal_int32_t_col)
-       .addBuildValue(Column(orders, "o_custkey"), Buffer(customer_matches),
-                      primitives::scatter_sel_int32_t_col,
-                      Buffer(o_custkey, sizeof(int32_t)),
-                      primitives::gather_col_int32_t_col)
-       .addBuildValue(Column(orders, "o_orderdate"), Buffer(customer_matches),
-                      primitives::scatter_sel_Date_col,
-                      Buffer(o_orderdate, sizeof(types::Date)),
-                      primitives::gather_col_Date_col)
-       .addBuildValue(Column(orders, "o_totalprice"), Buffer(customer_matches),
-                      primitives::scatter_sel_int64_t_col,
-                      Buffer(o_totalprice, sizeof(types::Numeric<12, 2>)),
-                      primitives::gather_col_int64_t_col)
-       .addBuildValue(Buffer(c_name), primitives::scatter_Char_25_col,
-                      Buffer(c_name2, sizeof(types::Char<25>)),
-                      primitives::gather_col_Char_25_col);
+   if (conf.mergeJoin)
+      // orders and lineitem are clustered on orderkey
+      MergeJoin(Buffer(lineitem_matches, sizeof(pos_t)))
+          .addBuildKey(Column(orders, "o_orderkey"), Buffer(customer_matches),
+                       primitives::normalize_sel_int32_t_col)
+          .addProbeKey(Column(lineitem2, "l_orderkey"),
+                       primitives::normalize_sel_int32_t_col)
+          .addBuildValue(Column(orders, "o_custkey"), Buffer(customer_matches),
+                         primitives::scatter_sel_int32_t_col,
+                         Buffer(o_custkey, sizeof(int32_t)),
+                         primitives::gather_col_int32_t_col)
+          .addBuildValue(Column(orders, "o_orderdate"),
+                         Buffer(customer_matches),
+                         primitives::scatter_sel_Date_col,
+                         Buffer(o_orderdate, sizeof(types::Date)),
+                         primitives::gather_col_Date_col)
+          .addBuildValue(Column(orders, "o_totalprice"),
+                         Buffer(customer_matches),
+                         primitives::scatter_sel_int64_t_col,
+                         Buffer(o_totalprice, sizeof(types::Numeric<12, 2>)),
+                         primitives::gather_col_int64_t_col)
+          .addBuildValue(Buffer(c_name), primitives::scatter_Char_25_col,
+                         Buffer(c_name2, sizeof(types::Char<25>)),
+                         primitives::gather_col_Char_25_col);
+   else
+      HashJoin(Buffer(lineitem_matches, sizeof(pos_t)))
+          .addBuildKey(Column(orders, "o_orderkey"), Buffer(customer_matches),
+                       primitives::hash_sel_int32_t_col,
+                       primitives::scatter_sel_int32_t_col)
+          .addProbeKey(Column(lineitem2, "l_orderkey"),
+                       primitives::hash_int32_t_col,
+                       primitives::keys_equal_int32_t_col)
+          .addBuildValue(Column(orders, "o_custkey"), Buffer(customer_matches),
+                         primitives::scatter_sel_int32_t_col,
+                         Buffer(o_custkey, sizeof(int32_t)),
+                         primitives::gather_col_int32_t_col)
+          .addBuildValue(Column(orders, "o_orderdate"),
+                         Buffer(customer_matches),
+                         primitives::scatter_sel_Date_col,
+                         Buffer(o_orderdate, sizeof(types::Date)),
+                         primitives::gather_col_Date_col)
+          .addBuildValue(Column(orders, "o_totalprice"),
+                         Buffer(customer_matches),
+                         primitives::scatter_sel_int64_t_col,
+                         Buffer(o_totalprice, sizeof(types::Numeric<12, 2>)),
+                         primitives::gather_col_int64_t_col)
+          .addBuildValue(Buffer(c_name), primitives::scatter_Char_25_col,
+                         Buffer(c_name2, sizeof(types::Char<25>)),
+                         primitives::gather_col_Char_25_col);
    HashGroup() //
        .pushKeySelVec(Buffer(lineitem_matches),
                       Buffer(lineitem_matches_grouped, sizeof(pos_t)))
@@ -337,13 +457,48 @@ std::unique_ptr<Q18Builder::Q18> Q18Builder::getQuery() {
                  primitives::gather_val_int64_t_col,
                  Buffer(group_sum, sizeof(types::Numeric<12, 2>)));
 
-   result.addValue("c_name", Buffer(group_c_name))
-       .addValue("c_custkey", Buffer(group_o_custkey))
-       .addValue("o_orderkey", Buffer(group_l_orderkey))
-       .addValue("o_orderdate", Buffer(group_o_orderdate))
-       .addValue("o_totalprice", Buffer(group_o_totalprice))
-       .addValue("sum", Buffer(group_sum))
-       .finalize();
+   if (conf.topN) {
+      // order by o_totalprice desc, o_orderdate limit 100
+      TopN(100)
+          .addKey(Buffer(group_o_totalprice),
+                  primitives::normalize_sel_desc_int64_t_col)
+          .addKey(Buffer(group_o_orderdate), primitives::normalize_sel_Date_col)
+          .addValue(Buffer(group_c_name), primitives::scatter_sel_Char_25_col,
+                    primitives::gather_val_Char_25_col,
+                    Buffer(top_c_name, sizeof(types::Char<25>)))
+          .addValue(Buffer(group_o_custkey),
+                    primitives::scatter_sel_int32_t_col,
+                    primitives::gather_val_int32_t_col,
+                    Buffer(top_o_custkey, sizeof(int32_t)))
+          .addValue(Buffer(group_l_orderkey),
+                    primitives::scatter_sel_int32_t_col,
+                    primitives::gather_val_int32_t_col,
+                    Buffer(top_l_orderkey, sizeof(int32_t)))
+          .addValue(Buffer(group_o_orderdate), primitives::scatter_sel_Date_col,
+                    primitives::gather_val_Date_col,
+                    Buffer(top_o_orderdate, sizeof(types::Date)))
+          .addValue(Buffer(group_o_totalprice),
+                    primitives::scatter_sel_int64_t_col,
+                    primitives::gather_val_int64_t_col,
+                    Buffer(top_o_totalprice, sizeof(int64_t)))
+          .addValue(Buffer(group_sum), primitives::scatter_sel_int64_t_col,
+                    primitives::gather_val_int64_t_col,
+                    Buffer(top_sum, sizeof(types::Numeric<12, 2>)));
+      result.addValue("c_name", Buffer(top_c_name))
+          .addValue("c_custkey", Buffer(top_o_custkey))
+          .addValue("o_orderkey", Buffer(top_l_orderkey))
+          .addValue("o_orderdate", Buffer(top_o_orderdate))
+          .addValue("o_totalprice", Buffer(top_o_totalprice))
+          .addValue("sum", Buffer(top_sum))
+          .finalize();
+   } else
+      result.addValue("c_name", Buffer(group_c_name))
+          .addValue("c_custkey", Buffer(group_o_custkey))
+          .addValue("o_orderkey", Buffer(group_l_orderkey))
+          .addValue("o_orderdate", Buffer(group_o_orderdate))
+          .addValue("o_totalprice", Buffer(group_o_totalprice))
+          .addValue("sum", Buffer(group_sum))
+          .finalize();
 
    r->rootOp = popOperator();
    return r;
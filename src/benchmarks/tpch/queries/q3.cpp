@@ -3,6 +3,8 @@
 #include "common/runtime/Types.hpp"
 #include "hyper/GroupBy.hpp"
 #include "hyper/ParallelHelper.hpp"
+#include "hyper/ProbeStage.hpp"
+#include "hyper/TopN.hpp"
 #include "tbb/tbb.h"
 #include "vectorwise/Operations.hpp"
 #include "vectorwise/Operators.hpp"
@@ -35,9 +37,14 @@ using vectorwise::primitives::hash_t;
 //   l_orderkey,
 //   o_orderdate,
 //   o_shippriority
+// order by  (only with conf.topN)
+//   revenue desc,
+//   o_orderdate
+// limit 10
 
-NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
-                                                     size_t nrThreads) {
+template <typename hash>
+NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper_(Database& db,
+                                                      size_t nrThreads) {
 
    // --- aggregates
 
@@ -65,7 +72,6 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
        li["l_extendedprice"].data<types::Numeric<12, 2>>();
    auto l_discount = li["l_discount"].data<types::Numeric<12, 2>>();
 
-   using hash = runtime::CRC32Hash;
    using range = tbb::blocked_range<size_t>;
 
    const auto add = [](const size_t& a, const size_t& b) { return a + b; };
@@ -73,8 +79,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
 
    // build ht for first join
    Hashset<types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto found1 = tbb::parallel_reduce(
        range(0, cu.nrTuples, morselSize), 0,
        [&](const tbb::blocked_range<size_t>& r, const size_t& f) {
@@ -94,13 +100,27 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
 
    // join and build second ht
    Hashmapx<types::Integer, std::tuple<types::Date, types::Integer>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto found2 = tbb::parallel_reduce(
        range(0, ord.nrTuples, morselSize), 0,
        [&](const tbb::blocked_range<size_t>& r, const size_t& f) {
           auto& entries = entries2.local();
           auto found = f;
+          if (conf.relaxedFusion) {
+             auto customers = hyper::probeStage<size_t>(
+                 ht1, [&](size_t i, bool matches) {
+                    if (!matches) return;
+                    entries.emplace_back(
+                        ht2.hash(o_orderkey[i]), o_orderkey[i],
+                        make_tuple(o_orderdate[i], o_shippriority[i]));
+                    found++;
+                 });
+             for (size_t i = r.begin(), end = r.end(); i != end; ++i)
+                if (o_orderdate[i] < c1) customers.push(o_custkey[i], i);
+             customers.flush();
+             return found;
+          }
           for (size_t i = r.begin(), end = r.end(); i != end; ++i)
              if (o_orderdate[i] < c1 && ht1.contains(o_custkey[i])) {
                 entries.emplace_back(
@@ -117,10 +137,10 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
    const auto one = types::Numeric<12, 2>::castString("1.00");
    const auto zero = types::Numeric<12, 4>::castString("0.00");
 
-   tbb::enumerable_thread_specific<
+   runtime::worker_specific<
        Hashmapx<std::tuple<types::Integer, types::Date, types::Integer>,
                 types::Numeric<12, 4>, hash, false>>
-       groups;
+       groups(nrThreads);
 
    auto groupOp =
        make_GroupBy<std::tuple<types::Integer, types::Date, types::Integer>,
@@ -133,8 +153,20 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
        [&](const tbb::blocked_range<size_t>& r) {
           auto locals = groupOp.preAggLocals();
 
+          if (conf.relaxedFusion) {
+             auto orders =
+                 hyper::probeStage<size_t>(ht2, [&](size_t i, auto* v) {
+                    if (!v) return;
+                    locals.consume(
+                        make_tuple(l_orderkey[i], get<0>(*v), get<1>(*v)),
+                        l_extendedprice[i] * (one - l_discount[i]));
+                 });
+             for (size_t i = r.begin(), end = r.end(); i != end; ++i)
+                if (l_shipdate[i] > c2) orders.push(l_orderkey[i], i);
+             return;
+          }
           for (size_t i = r.begin(), end = r.end(); i != end; ++i) {
-             decltype(ht2)::value_type* v;
+             typename decltype(ht2)::value_type* v;
              if (l_shipdate[i] > c2 && (v = ht2.findOne(l_orderkey[i]))) {
                 locals.consume(
                     make_tuple(l_orderkey[i], get<0>(*v), get<1>(*v)),
@@ -152,6 +184,43 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
    auto prioAttr =
        result->addAttribute("o_shippriority", sizeof(types::Integer));
 
+   if (conf.topN) {
+      using row_t = std::tuple<types::Numeric<12, 4>, types::Integer,
+                               types::Date, types::Integer>;
+      auto topN = make_TopN<row_t>(
+          10,
+          [](const row_t& a, const row_t& b) {
+             if (get<0>(a) != get<0>(b)) return get<0>(b) < get<0>(a);
+             return get<2>(a) < get<2>(b);
+          },
+          [](const row_t& row) { return -get<0>(row).value; });
+      groupOp.forallGroups([&](auto& entries) {
+         auto locals = topN.locals();
+         for (auto block : entries)
+            for (auto& entry : block)
+               if (!locals.discards(-entry.v.value))
+                  locals.consume(make_tuple(entry.v, get<0>(entry.k),
+                                            get<1>(entry.k), get<2>(entry.k)));
+      });
+      topN.forallTuples([&](auto& rows) {
+         auto block = result->createBlock(rows.size());
+         auto rev =
+             reinterpret_cast<types::Numeric<12, 4>*>(block.data(revAttr));
+         auto order = reinterpret_cast<types::Integer*>(block.data(orderAttr));
+         auto date = reinterpret_cast<types::Date*>(block.data(dateAttr));
+         auto prio = reinterpret_cast<types::Integer*>(block.data(prioAttr));
+         for (auto& row : rows) {
+            *rev++ = get<0>(row);
+            *order++ = get<1>(row);
+            *date++ = get<2>(row);
+            *prio++ = get<3>(row);
+         }
+         block.addedElements(rows.size());
+      });
+      leaveQuery(nrThreads);
+      return move(resources.query);
+   }
+
    groupOp.forallGroups([&](auto& entries) {
       // write aggregates to result
       auto n = entries.size();
@@ -174,6 +243,12 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q3_hyper(Database& db,
    return move(resources.query);
 }
 
+std::unique_ptr<runtime::Query> q3_hyper(Database& db, size_t nrThreads) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q3_hyper_<decltype(h)>(db, nrThreads);
+   });
+}
+
 std::unique_ptr<Q3Builder::Q3> Q3Builder::getQuery() {
    using namespace vectorwise;
    auto result = Result();
@@ -205,24 +280,41 @@ std::unique_ptr<Q3Builder::Q3> Q3Builder::getQuery() {
                              Buffer(sel_lineitem, sizeof(pos_t)),           //
                              Column(lineitem, "l_shipdate"),                //
                              Value(&r->c3)));
-   HashJoin(Buffer(j1_lineitem, sizeof(pos_t)), conf.joinAll()) //
-       .setProbeSelVector(Buffer(sel_lineitem), conf.joinSel())
-       .addBuildKey(Column(order, "o_orderkey"), //
-                    Buffer(cust_ord),            //
-                    conf.hash_sel_int32_t_col(), //
-                    primitives::scatter_sel_int32_t_col)
-       .addBuildValue(Column(order, "o_orderdate"), Buffer(cust_ord),
-                      primitives::scatter_sel_Date_col,
-                      Buffer(o_orderdate, sizeof(types::Date)),
-                      primitives::gather_col_Date_col)
-       .addBuildValue(Column(order, "o_shippriority"), Buffer(cust_ord),
-                      primitives::scatter_sel_int32_t_col,
-                      Buffer(o_shippriority, sizeof(types::Integer)),
-                      primitives::gather_col_int32_t_col)
-       .addProbeKey(Column(lineitem, "l_orderkey"), //
-                    Buffer(sel_lineitem),           //
-                    conf.hash_sel_int32_t_col(),    //
-                    primitives::keys_equal_int32_t_col);
+   if (conf.mergeJoin)
+      // orders and lineitem are clustered on orderkey
+      MergeJoin(Buffer(j1_lineitem, sizeof(pos_t)))
+          .setProbeSelVector(Buffer(sel_lineitem))
+          .addBuildKey(Column(order, "o_orderkey"), Buffer(cust_ord),
+                       primitives::normalize_sel_int32_t_col)
+          .addBuildValue(Column(order, "o_orderdate"), Buffer(cust_ord),
+                         primitives::scatter_sel_Date_col,
+                         Buffer(o_orderdate, sizeof(types::Date)),
+                         primitives::gather_col_Date_col)
+          .addBuildValue(Column(order, "o_shippriority"), Buffer(cust_ord),
+                         primitives::scatter_sel_int32_t_col,
+                         Buffer(o_shippriority, sizeof(types::Integer)),
+                         primitives::gather_col_int32_t_col)
+          .addProbeKey(Column(lineitem, "l_orderkey"), Buffer(sel_lineitem),
+                       primitives::normalize_sel_int32_t_col);
+   else
+      HashJoin(Buffer(j1_lineitem, sizeof(pos_t)), conf.joinAll()) //
+          .setProbeSelVector(Buffer(sel_lineitem), conf.joinSel())
+          .addBuildKey(Column(order, "o_orderkey"), //
+                       Buffer(cust_ord),            //
+                       conf.hash_sel_int32_t_col(), //
+                       primitives::scatter_sel_int32_t_col)
+          .addBuildValue(Column(order, "o_orderdate"), Buffer(cust_ord),
+                         primitives::scatter_sel_Date_col,
+                         Buffer(o_orderdate, sizeof(types::Date)),
+                         primitives::gather_col_Date_col)
+          .addBuildValue(Column(order, "o_shippriority"), Buffer(cust_ord),
+                         primitives::scatter_sel_int32_t_col,
+                         Buffer(o_shippriority, sizeof(types::Integer)),
+                         primitives::gather_col_int32_t_col)
+          .addProbeKey(Column(lineitem, "l_orderkey"), //
+                       Buffer(sel_lineitem),           //
+                       conf.hash_sel_int32_t_col(),    //
+                       primitives::keys_equal_int32_t_col);
    // build value o_orderdate, o_shippriority
    Project().addExpression(
        Expression() //
@@ -273,11 +365,35 @@ std::unique_ptr<Q3Builder::Q3> Q3Builder::getQuery() {
                  primitives::aggr_row_plus_int64_t_col,
                  primitives::gather_val_int64_t_col, Buffer(result_project));
 
-   result.addValue("revenue", Buffer(result_project))
-       .addValue("o_shippriority", Buffer(o_shippriority))
-       .addValue("o_orderdate", Buffer(o_orderdate))
-       .addValue("l_orderkey", Buffer(l_orderkey))
-       .finalize();
+   if (conf.topN) {
+      // order by revenue desc, o_orderdate limit 10
+      TopN(10)
+          .addKey(Buffer(result_project),
+                  primitives::normalize_sel_desc_int64_t_col)
+          .addKey(Buffer(o_orderdate), primitives::normalize_sel_Date_col)
+          .addValue(Buffer(result_project), primitives::scatter_sel_int64_t_col,
+                    primitives::gather_val_int64_t_col,
+                    Buffer(top_revenue, sizeof(int64_t)))
+          .addValue(Buffer(o_shippriority), primitives::scatter_sel_int32_t_col,
+                    primitives::gather_val_int32_t_col,
+                    Buffer(top_shippriority, sizeof(types::Integer)))
+          .addValue(Buffer(o_orderdate), primitives::scatter_sel_Date_col,
+                    primitives::gather_val_Date_col,
+                    Buffer(top_orderdate, sizeof(types::Date)))
+          .addValue(Buffer(l_orderkey), primitives::scatter_sel_int32_t_col,
+                    primitives::gather_val_int32_t_col,
+                    Buffer(top_orderkey, sizeof(types::Integer)));
+      result.addValue("revenue", Buffer(top_revenue))
+          .addValue("o_shippriority", Buffer(top_shippriority))
+          .addValue("o_orderdate", Buffer(top_orderdate))
+          .addValue("l_orderkey", Buffer(top_orderkey))
+          .finalize();
+   } else
+      result.addValue("revenue", Buffer(result_project))
+          .addValue("o_shippriority", Buffer(o_shippriority))
+          .addValue("o_orderdate", Buffer(o_orderdate))
+          .addValue("l_orderkey", Buffer(l_orderkey))
+          .finalize();
 
    r->rootOp = popOperator();
    return r;
@@ -43,8 +43,9 @@ using vectorwise::primitives::hash_t;
 
 using namespace runtime;
 using namespace std;
-NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
-                                                     size_t nrThreads) {
+template <typename hash>
+NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper_(Database& db,
+                                                      size_t nrThreads) {
 
    const size_t morselSize = 10000;
 
@@ -63,14 +64,12 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
    auto& ord = db["orders"];
    auto& li = db["lineitem"];
 
-   using hash = runtime::CRC32Hash;
-
    auto r_name = re["r_name"].data<types::Char<25>>();
    auto r_regionkey = re["r_regionkey"].data<types::Integer>();
    // --- select region and build ht
    Hashset<types::Integer, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht1)::Entry>>
+       entries1(nrThreads);
    auto found1 = PARALLEL_SELECT(re.nrTuples, entries1, {
       if (r_name[i] == c3) {
          entries.emplace_back(ht1.hash(r_regionkey[i]), r_regionkey[i]);
@@ -85,8 +84,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
    auto n_nationkey = na["n_nationkey"].data<types::Integer>();
    auto n_name = na["n_name"].data<types::Char<25>>();
    Hashmapx<types::Integer, types::Char<25>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-       entries2;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht2)::Entry>>
+       entries2(nrThreads);
    auto found2 = PARALLEL_SELECT(na.nrTuples, entries2, {
       if (ht1.contains(n_regionkey[i])) {
          entries.emplace_back(ht2.hash(n_nationkey[i]), n_nationkey[i],
@@ -102,11 +101,11 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
    auto c_custkey = cu["c_custkey"].data<types::Integer>();
    Hashmapx<types::Integer, std::tuple<types::Integer, types::Char<25>>, hash>
        ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-       entries3;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht3)::Entry>>
+       entries3(nrThreads);
 
    auto found3 = PARALLEL_SELECT(cu.nrTuples, entries3, {
-      decltype(ht2)::value_type* v;
+      typename decltype(ht2)::value_type* v;
       if ((v = ht2.findOne(c_nationkey[i]))) {
          entries.emplace_back(ht3.hash(c_custkey[i]), c_custkey[i],
                               make_tuple(c_nationkey[i], *v));
@@ -122,11 +121,11 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
    auto o_custkey = ord["o_custkey"].data<types::Integer>();
    Hashmapx<types::Integer, std::tuple<types::Integer, types::Char<25>>, hash>
        ht4;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht4)::Entry>>
-       entries4;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht4)::Entry>>
+       entries4(nrThreads);
 
    auto found4 = PARALLEL_SELECT(ord.nrTuples, entries4, {
-      decltype(ht3)::value_type* v;
+      typename decltype(ht3)::value_type* v;
       if ((o_orderdate[i] < c2) & (o_orderdate[i] >= c1) &&
           (v = ht3.findOne(o_custkey[i]))) {
          entries.emplace_back(ht4.hash(o_orderkey[i]), o_orderkey[i], *v);
@@ -140,8 +139,8 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
    auto s_suppkey = su["s_suppkey"].data<types::Integer>();
    auto s_nationkey = su["s_nationkey"].data<types::Integer>();
    Hashset<std::tuple<types::Integer, types::Integer>, hash> ht5;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht5)::Entry>>
-       entries5;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht5)::Entry>>
+       entries5(nrThreads);
 
    PARALLEL_SCAN(su.nrTuples, entries5, {
       auto key = make_tuple(s_suppkey[i], s_nationkey[i]);
@@ -204,6 +203,12 @@ NOVECTORIZE std::unique_ptr<runtime::Query> q5_hyper(Database& db,
    return move(resources.query);
 }
 
+std::unique_ptr<runtime::Query> q5_hyper(Database& db, size_t nrThreads) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q5_hyper_<decltype(h)>(db, nrThreads);
+   });
+}
+
 unique_ptr<Q5Builder::Q5> Q5Builder::getQuery() {
    using namespace vectorwise;
    auto result = Result();
@@ -35,7 +35,8 @@ using vectorwise::primitives::hash_t;
 
 using namespace runtime;
 using namespace std;
-NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
+template <typename hash>
+NOVECTORIZE Relation q5_no_sel_hyper_(Database& db) {
 
    // --- aggregates
    types::Numeric<12, 4> revenue = 0;
@@ -48,12 +49,10 @@ NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
    auto& ord = db["orders"];
    auto& li = db["lineitem"];
 
-   using hash = runtime::CRC32Hash;
-
    auto& r_regionkey = re["r_regionkey"].typedAccess<types::Integer>();
    // --- select region and build ht
    Hashset<types::Integer, hash> ht1;
-   deque<decltype(ht1)::Entry> entries1;
+   deque<typename decltype(ht1)::Entry> entries1;
    for (size_t i = 0; i < re.nrTuples; ++i)
       entries1.emplace_back(ht1.hash(r_regionkey[i]), r_regionkey[i]);
    ht1.setSize(entries1.size());
@@ -63,7 +62,7 @@ NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
    auto& n_regionkey = na["n_regionkey"].typedAccess<types::Integer>();
    auto& n_nationkey = na["n_nationkey"].typedAccess<types::Integer>();
    Hashset<types::Integer, hash> ht2;
-   deque<decltype(ht2)::Entry> entries2;
+   deque<typename decltype(ht2)::Entry> entries2;
    for (size_t i = 0; i < na.nrTuples; ++i)
       if (ht1.contains(n_regionkey[i]))
          entries2.emplace_back(ht2.hash(n_nationkey[i]), n_nationkey[i]);
@@ -74,7 +73,7 @@ NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
    auto& c_nationkey = cu["c_nationkey"].typedAccess<types::Integer>();
    auto& c_custkey = cu["c_custkey"].typedAccess<types::Integer>();
    Hashmapx<types::Integer, types::Integer, hash> ht3;
-   deque<decltype(ht3)::Entry> entries3;
+   deque<typename decltype(ht3)::Entry> entries3;
    for (size_t i = 0; i < cu.nrTuples; ++i)
       if (ht2.contains(c_nationkey[i]))
          entries3.emplace_back(ht3.hash(c_custkey[i]), c_custkey[i],
@@ -86,7 +85,7 @@ NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
    auto& o_orderkey = ord["o_orderkey"].typedAccess<types::Integer>();
    auto& o_custkey = ord["o_custkey"].typedAccess<types::Integer>();
    Hashmapx<types::Integer, types::Integer, hash> ht4;
-   deque<decltype(ht4)::Entry> entries4;
+   deque<typename decltype(ht4)::Entry> entries4;
    for (size_t i = 0; i < ord.nrTuples; ++i) {
       types::Integer* v;
       if ((v = ht3.findOne(o_custkey[i])))
@@ -99,7 +98,7 @@ NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
    auto& s_suppkey = su["s_suppkey"].typedAccess<types::Integer>();
    auto& s_nationkey = su["s_nationkey"].typedAccess<types::Integer>();
    Hashset<std::tuple<types::Integer, types::Integer>, hash> ht5;
-   deque<decltype(ht5)::Entry> entries5;
+   deque<typename decltype(ht5)::Entry> entries5;
    for (size_t i = 0; i < su.nrTuples; ++i) {
       auto key = make_tuple(s_suppkey[i], s_nationkey[i]);
       entries5.emplace_back(ht5.hash(key), key);
@@ -138,6 +137,12 @@ NOVECTORIZE Relation q5_no_sel_hyper(Database& db) {
    return result;
 }
 
+Relation q5_no_sel_hyper(Database& db) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q5_no_sel_hyper_<decltype(h)>(db);
+   });
+}
+
 unique_ptr<Q5Builder::Q5> Q5Builder::getNoSelQuery() {
    using namespace vectorwise;
    auto result = Result();
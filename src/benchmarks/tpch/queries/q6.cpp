@@ -1,5 +1,6 @@
 #include "benchmarks/tpch/Queries.hpp"
 #include "common/runtime/Types.hpp"
+#include "hyper/Selection.hpp"
 #include "tbb/tbb.h"
 #include "vectorwise/Operations.hpp"
 #include "vectorwise/Operators.hpp"
@@ -56,6 +57,18 @@ Relation q6_hyper(Database& db, size_t /*nrThreads*/) {
        [&](const tbb::blocked_range<size_t>& r,
            const types::Numeric<12, 4>& s) {
           auto revenue = s;
+          if (conf.useSimdScan) {
+             // select with SIMD, then aggregate only the matches
+             hyper::forEachMatch(
+                 r.begin(), r.end(),
+                 [&](size_t i) {
+                    revenue += l_extendedprice_col[i] * l_discount_col[i];
+                 },
+                 hyper::between(l_shipdate_col, c1, types::Date(c2.value - 1)),
+                 hyper::less(l_quantity_col, types::Numeric<12, 2>(c5)),
+                 hyper::between(l_discount_col, c3, c4));
+             return revenue;
+          }
           for (size_t i = r.begin(), end = r.end(); i != end; ++i) {
              auto& l_shipdate = l_shipdate_col[i];
              auto& l_quantity = l_quantity_col[i];
@@ -92,7 +105,7 @@ unique_ptr<Q6Builder::Q6> Q6Builder::getQuery() {
    // --- constants
    auto res = make_unique<Q6>();
    auto& consts = *res;
-   enum { sel_a, sel_b, result_project };
+   enum { sel_a, sel_b, result_project, bitmap_a, bitmap_b };
 
    assert(db["lineitem"]["l_shipdate"].type->rt_size() == sizeof(consts.c2));
    assert(db["lineitem"]["l_quantity"].type->rt_size() == sizeof(consts.c5));
@@ -100,6 +113,64 @@ unique_ptr<Q6Builder::Q6> Q6Builder::getQuery() {
    assert(db["lineitem"]["l_extendedprice"].type->rt_size() == sizeof(int64_t));
 
    auto lineitem = Scan("lineitem");
+   if (conf.bitmapSelection) {
+      using primitives::bitmap_t;
+      auto kind = AdaptiveSelect(
+          Expression()
+              .addOp(primitives::bitmap_sel_less_int32_t_col_int32_t_val,
+                     Buffer(bitmap_a, sizeof(bitmap_t)),
+                     Column(lineitem, "l_shipdate"), Value(&consts.c2))
+              .addOp(
+                  primitives::
+                      bitmap_selsel_greater_equal_int32_t_col_int32_t_val,
+                  Buffer(bitmap_a), Buffer(bitmap_b, sizeof(bitmap_t)),
+                  Column(lineitem, "l_shipdate"), Value(&consts.c1))
+              .addOp(primitives::bitmap_selsel_less_int64_t_col_int64_t_val,
+                     Buffer(bitmap_b), Buffer(bitmap_a),
+                     Column(lineitem, "l_quantity"), Value(&consts.c5))
+              .addOp(
+                  primitives::
+                      bitmap_selsel_greater_equal_int64_t_col_int64_t_val,
+                  Buffer(bitmap_a), Buffer(bitmap_b),
+                  Column(lineitem, "l_discount"), Value(&consts.c3))
+              .addOp(
+                  primitives::bitmap_selsel_less_equal_int64_t_col_int64_t_val,
+                  Buffer(bitmap_b), Buffer(bitmap_a),
+                  Column(lineitem, "l_discount"), Value(&consts.c4)),
+          Buffer(bitmap_a), Buffer(sel_a, sizeof(pos_t)));
+      // dense vectors project all tuples, the list alternative is built last
+      // so that it can be fused
+      std::unique_ptr<vectorwise::Expression> all =
+          Expression()
+              .addOp(primitives::proj_multiplies_int64_t_col_int64_t_col,
+                     Buffer(result_project, sizeof(int64_t)),
+                     Column(lineitem, "l_discount"),
+                     Column(lineitem, "l_extendedprice"))
+              .addOp(primitives::aggr_static_plus_int64_t_col,
+                     Value(&consts.aggregator), Buffer(result_project));
+      std::unique_ptr<vectorwise::Expression> bitmap =
+          Expression()
+              .addOp(primitives::proj_multiplies_int64_t_col_int64_t_col,
+                     Buffer(result_project), Column(lineitem, "l_discount"),
+                     Column(lineitem, "l_extendedprice"))
+              .addOp(primitives::aggr_static_bitmap_plus_int64_t_col,
+                     Buffer(bitmap_a), Value(&consts.aggregator),
+                     Buffer(result_project));
+      std::unique_ptr<vectorwise::Expression> list =
+          Expression()
+              .addOp(
+                  primitives::proj_sel_both_multiplies_int64_t_col_int64_t_col,
+                  Buffer(sel_a), Buffer(result_project),
+                  Column(lineitem, "l_discount"),
+                  Column(lineitem, "l_extendedprice"))
+              .addOp(primitives::aggr_static_plus_int64_t_col,
+                     Value(&consts.aggregator), Buffer(result_project));
+      FixedAggregation(Expression().addSelectionSwitch(
+          kind, move(all), move(bitmap), move(list)));
+      res->rootOp = popOperator();
+      assert(operatorStack.size() == 0);
+      return res;
+   }
    Select((Expression()                                       //
               .addOp(conf.sel_less_int32_t_col_int32_t_val(), //
                      Buffer(sel_a, sizeof(pos_t)),            //
@@ -127,17 +198,18 @@ unique_ptr<Q6Builder::Q6> Q6Builder::getQuery() {
                      Buffer(sel_a, sizeof(pos_t)),                     //
                      Column(lineitem, "l_discount"),                   //
                      Value(&consts.c4)));
-   Project().addExpression(
+   // the projection feeds the aggregate directly, so that the builder fuses
+   // both into one primitive and revenue is never materialized
+   FixedAggregation(
        Expression() //
            .addOp(primitives::proj_sel_both_multiplies_int64_t_col_int64_t_col,
                   Buffer(sel_a),                           //
                   Buffer(result_project, sizeof(int64_t)), //
                   Column(lineitem, "l_discount"),
-                  Column(lineitem, "l_extendedprice")));
-   FixedAggregation(Expression() //
-                        .addOp(primitives::aggr_static_plus_int64_t_col,
-                               Value(&consts.aggregator), //
-                               Buffer(result_project)));
+                  Column(lineitem, "l_extendedprice"))
+           .addOp(primitives::aggr_static_plus_int64_t_col,
+                  Value(&consts.aggregator), //
+                  Buffer(result_project)));
    res->rootOp = popOperator();
    assert(operatorStack.size() == 0);
    return res;
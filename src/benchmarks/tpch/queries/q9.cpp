@@ -51,15 +51,15 @@ nation,
 
 */
 
-std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
-                                         size_t nrThreads) {
+template <typename hash>
+std::unique_ptr<runtime::Query> q9_hyper_(runtime::Database& db,
+                                          size_t nrThreads) {
 
    // --- aggregates
    auto resources = initQuery(nrThreads);
-   using hash = runtime::CRC32Hash;
 
    // --- constants
-   auto contains = types::Varchar<55>::castString("green");
+   types::LikePattern green("%green%");
 
    auto& na = db["nation"];
    auto& supp = db["supplier"];
@@ -68,8 +68,8 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
    auto n_nationkey = na["n_nationkey"].data<types::Integer>();
    auto n_name = na["n_name"].data<types::Char<25>>();
    Hashmapx<types::Integer, types::Char<25>, hash> ht1;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht1)::Entry>>
-       entries1;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht1)::Entry>>
+       entries1(nrThreads);
    PARALLEL_SCAN(na.nrTuples, entries1, {
       auto& key = n_nationkey[i];
       entries.emplace_back(ht1.hash(key), key, n_name[i]);
@@ -80,8 +80,8 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
 
    // --- ht for bushy join
    Hashmapx<types::Integer, types::Char<25>, hash> ht2;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht2)::Entry>>
-     entries2;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht2)::Entry>>
+     entries2(nrThreads);
    auto s_suppkey = supp["s_suppkey"].data<types::Integer>();
    auto s_nationkey = supp["s_nationkey"].data<types::Integer>();
    // do join nation-supplier and put result into bushy ht
@@ -99,8 +99,8 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
 
    // --- ht for join part-partsupp
    Hashset<types::Integer, hash> ht3;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht3)::Entry>>
-     entries3;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht3)::Entry>>
+     entries3(nrThreads);
    auto& part = db["part"];
    auto p_partkey = part["p_partkey"].data<types::Integer>();
    auto p_name = part["p_name"].data<types::Varchar<55>>();
@@ -108,7 +108,7 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
    auto found3 = PARALLEL_SELECT(part.nrTuples, entries3, {
        auto& pk = p_partkey[i];
        auto& pn = p_name[i];
-       if (memmem(pn.value, pn.len, contains.value, contains.len) != nullptr){
+       if (like(pn, green)) {
           entries.emplace_back(ht3.hash(pk), pk);
           found++;
        }
@@ -119,8 +119,8 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
    Hashmapx<tuple<types::Integer, types::Integer>,
             tuple<types::Char<25>, types::Numeric<12, 2>>, hash>
        ht4;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht4)::Entry>>
-       entries4;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht4)::Entry>>
+       entries4(nrThreads);
    auto& partsupp = db["partsupp"];
    auto ps_partkey = partsupp["ps_partkey"].data<types::Integer>();
    auto ps_suppkey = partsupp["ps_suppkey"].data<types::Integer>();
@@ -145,8 +145,8 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
              types::Numeric<12, 2>, types::Numeric<12, 2>, types::Char<25>>,
        hash>
        ht5;
-   tbb::enumerable_thread_specific<runtime::Stack<decltype(ht5)::Entry>>
-       entries5;
+   runtime::worker_specific<runtime::Stack<typename decltype(ht5)::Entry>>
+       entries5(nrThreads);
    auto& li = db["lineitem"];
    auto l_orderkey = li["l_orderkey"].data<types::Integer>();
    auto l_partkey = li["l_partkey"].data<types::Integer>();
@@ -227,6 +227,13 @@ std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
    return move(resources.query);
 }
 
+std::unique_ptr<runtime::Query> q9_hyper(runtime::Database& db,
+                                         size_t nrThreads) {
+   return runtime::withHash(conf.hashHyper, [&](auto h) {
+      return q9_hyper_<decltype(h)>(db, nrThreads);
+   });
+}
+
 std::unique_ptr<Q9Builder::Q9> Q9Builder::getQuery(){
 
    using namespace vectorwise;
@@ -250,10 +257,10 @@ std::unique_ptr<Q9Builder::Q9> Q9Builder::getQuery(){
                     primitives::keys_equal_int32_t_col);
 
    auto part = Scan("part");
-   Select(Expression().addOp(primitives::sel_contains_Varchar_55_col_Varchar_55_val,
+   Select(Expression().addOp(primitives::sel_like_Varchar_55_col_pattern_val,
                              Buffer(sel_part, sizeof(pos_t)),
                              Column(part, "p_name"), //
-                             Value(&r->contains)));
+                             Value(&r->green)));
    auto partsupp = Scan("partsupp");
    HashJoin(Buffer(part_partsupp, sizeof(pos_t)), conf.joinAll())
        .addBuildKey(Column(part, "p_partkey"), //
@@ -278,16 +285,21 @@ std::unique_ptr<Q9Builder::Q9> Q9Builder::getQuery(){
                     conf.hash_sel_int32_t_col(),
                     primitives::keys_equal_int32_t_col);
 
+   // both join keys in one word, hashed and compared in a single pass
+   PackKeys(Buffer(ps_key, sizeof(primitives::packed64)))
+       .addKey(Column(partsupp, "ps_partkey"), Buffer(pspp),
+               primitives::pack_sel_int32_t_col_packed64)
+       .addKey(Column(partsupp, "ps_suppkey"), Buffer(pspp),
+               primitives::pack_sel_int32_t_col_packed64);
    auto lineitem = Scan("lineitem");
+   PackKeys(Buffer(l_key, sizeof(primitives::packed64)))
+       .addKey(Column(lineitem, "l_partkey"),
+               primitives::pack_int32_t_col_packed64)
+       .addKey(Column(lineitem, "l_suppkey"),
+               primitives::pack_int32_t_col_packed64);
    HashJoin(Buffer(xlineitem, sizeof(pos_t)), conf.joinAll())
-       .addBuildKey(Column(partsupp, "ps_partkey"),   //
-                    Buffer(pspp),                     //
-                    conf.hash_sel_int32_t_col(),
-                    primitives::scatter_sel_int32_t_col)
-       .addBuildKey(Column(partsupp, "ps_suppkey"),     //
-                    Buffer(pspp),                       //
-                    conf.rehash_sel_int32_t_col(),
-                    primitives::scatter_sel_int32_t_col)
+       .addBuildKey(Buffer(ps_key), primitives::hash_packed64_col,
+                    primitives::scatter_packed64_col)
        .addBuildValue(Buffer(n_name),                  //
                       primitives::scatter_Char_25_col, //
                       Buffer(n_name),                  //
@@ -297,12 +309,8 @@ std::unique_ptr<Q9Builder::Q9> Q9Builder::getQuery(){
                       primitives::scatter_sel_int64_t_col,
                       Buffer(ps_supplycost, sizeof(int64_t)), //
                       primitives::gather_col_int64_t_col)
-       .addProbeKey(Column(lineitem, "l_partkey"), //
-                    conf.hash_int32_t_col(),
-                    primitives::keys_equal_int32_t_col)
-       .addProbeKey(Column(lineitem, "l_suppkey"), //
-                    conf.rehash_int32_t_col(),
-                    primitives::keys_equal_int32_t_col);
+       .addProbeKey(Buffer(l_key), primitives::hash_packed64_col,
+                    primitives::keys_equal_packed64_col);
 
    auto orders = Scan("orders");
    HashJoin(Buffer(ordersx, sizeof(pos_t)), conf.joinAll())
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <cstdlib>
 #include <exception>
+#include <fstream>
 #include <iostream>
 #include <iterator>
 #include <sstream>
@@ -11,7 +12,9 @@
 
 #include "benchmarks/tpch/Queries.hpp"
 #include "common/runtime/Import.hpp"
+#include "common/runtime/Spill.hpp"
 #include "profile.hpp"
+#include "vectorwise/PlanLoader.hpp"
 #include "tbb/tbb.h"
 #include <tbb/global_control.h>
 
@@ -28,6 +31,25 @@ using namespace runtime;
 
 static void escape(void* p) { asm volatile("" : : "g"(p) : "memory"); }
 
+/// 0 disables analyzing vectorwise plans, 1 prints the annotated plan tree, 2
+/// the same as JSON
+static int analyzeFormat = 0;
+
+/// Print the statistics of the vectorwise plan run last, if it was analyzed,
+/// and the cost of the primitives it called in all repetitions
+static void printAnalyzed() {
+   if (auto plan = vectorwise::takeAnalyzedPlan()) {
+      if (analyzeFormat == 2)
+         plan->printJson(std::cout);
+      else
+         plan->print(std::cout);
+   }
+   if (vectorwise::primitiveProfiling) {
+      vectorwise::primitiveProfile.print(std::cout);
+      vectorwise::primitiveProfile.reset();
+   }
+}
+
 size_t nrTuples(Database& db, std::vector<std::string> tables) {
    size_t sum = 0;
    for (auto& table : tables) sum += db[table].nrTuples;
@@ -58,10 +80,12 @@ int main(int argc, char* argv[]) {
     size_t vectorSize = 1024;
     std::string selectedQuery = "";  // e.g., "1"
     std::string selectedEngine = ""; // e.g., "h" or "v"
+    std::vector<std::string> planFiles;
 
     int opt;
-    // q: query, e: engine, r: reps, p: path, t: threads, v: vectorSize
-    while ((opt = getopt(argc, argv, "q:e:r:p:t:v:")) != -1) {
+    // q: query, e: engine, r: reps, p: path, t: threads, v: vectorSize,
+    // f: vectorwise plan file, may be repeated
+    while ((opt = getopt(argc, argv, "q:e:r:p:t:v:f:")) != -1) {
         switch (opt) {
             case 'q': selectedQuery = optarg; break;
             case 'e': selectedEngine = optarg; break;
@@ -69,8 +93,9 @@ int main(int argc, char* argv[]) {
             case 'p': tpchPath = optarg; break;
             case 't': nrThreads = atoi(optarg); break;
             case 'v': vectorSize = atoi(optarg); break;
+            case 'f': planFiles.push_back(optarg); break;
             default:
-                std::cerr << "Usage: " << argv[0] << " -p <path> [-q query] [-e engine] [-r reps] [-t threads] [-v vSize]\n";
+                std::cerr << "Usage: " << argv[0] << " -p <path> [-q query] [-e engine] [-r reps] [-t threads] [-v vSize] [-f plan]\n";
                 exit(1);
         }
     }
@@ -93,8 +118,8 @@ int main(int argc, char* argv[]) {
         // Run all engines for one query, e.g., "1h" and "1v"
         if (allQueries.count(selectedQuery + "h")) q.insert(selectedQuery + "h");
         if (allQueries.count(selectedQuery + "v")) q.insert(selectedQuery + "v");
-    } else {
-        // Default: Run everything
+    } else if (planFiles.empty()) {
+        // Default: Run everything, unless only plan files are given
         q = allQueries;
     }
 
@@ -106,7 +131,38 @@ int main(int argc, char* argv[]) {
     if (auto v = std::getenv("SIMDjoin")) conf.useSimdJoin = atoi(v);
     if (auto v = std::getenv("SIMDsel")) conf.useSimdSel = atoi(v);
     if (auto v = std::getenv("SIMDproj")) conf.useSimdProj = atoi(v);
+    if (auto v = std::getenv("SIMDscan")) conf.useSimdScan = atoi(v);
+    if (auto v = std::getenv("HashHyper"))
+       conf.hashHyper = hashFunctionFromString(v);
+    if (auto v = std::getenv("HashVectorwise"))
+       conf.hashVectorwise = hashFunctionFromString(v);
+    vectorwise::primitives::setHashFunction(conf.hashVectorwise);
+    if (auto v = std::getenv("MicroAdaptive"))
+       vectorwise::microAdaptivity.enabled = atoi(v);
+    if (auto v = std::getenv("FusePrimitives"))
+       vectorwise::fusePrimitives = atoi(v);
+    if (auto v = std::getenv("ThreadedCode"))
+       vectorwise::threadedCode = atoi(v);
+    if (auto v = std::getenv("TopN")) conf.topN = atoi(v);
+    if (auto v = std::getenv("MergeJoin")) conf.mergeJoin = atoi(v);
+    if (auto v = std::getenv("AdaptiveJoin")) conf.adaptiveJoin = atoi(v);
+    if (auto v = std::getenv("RelaxedFusion")) conf.relaxedFusion = atoi(v);
+    if (auto v = std::getenv("BitmapSelection"))
+       conf.bitmapSelection = atoi(v);
+    if (auto v = std::getenv("BitmapDensity"))
+       vectorwise::bitmapDensity = atof(v);
+    if (auto v = std::getenv("SpillBudget"))
+       runtime::spillBudget = size_t(atoll(v)) << 20; // MiB
+    if (auto v = std::getenv("SpillDir")) runtime::spillDirectory = v;
     if (auto v = std::getenv("clearCaches")) clearCaches = atoi(v);
+    if (auto v = std::getenv("PrimitiveProfile")) {
+       vectorwise::primitiveProfiling = atoi(v);
+       vectorwise::primitiveProfile.countInstructions = atoi(v) > 1;
+    }
+    if (auto v = std::getenv("Analyze")) {
+       analyzeFormat = std::string(v) == "json" ? 2 : atoi(v);
+       vectorwise::analyze = analyzeFormat;
+    }
 
     tbb::global_control scheduler(tbb::global_control::max_allowed_parallelism, nrThreads);
 
@@ -127,6 +183,7 @@ int main(int argc, char* argv[]) {
                           escape(&result);
                        },
                        repetitions);
+   printAnalyzed();
    if (q.count("3h"))
       e.timeAndProfile("q3 hyper     ",
                        nrTuples(tpch, {"customer", "orders", "lineitem"}),
@@ -145,6 +202,7 @@ int main(int argc, char* argv[]) {
              escape(&result);
           },
           repetitions);
+   printAnalyzed();
    if (q.count("5h"))
       e.timeAndProfile("q5 hyper     ",
                        nrTuples(tpch, {"supplier", "region", "nation",
@@ -166,6 +224,7 @@ int main(int argc, char* argv[]) {
                           escape(&result);
                        },
                        repetitions);
+   printAnalyzed();
    if (q.count("6h"))
       e.timeAndProfile("q6 hyper     ", tpch["lineitem"].nrTuples,
                        [&]() {
@@ -183,6 +242,7 @@ int main(int argc, char* argv[]) {
                           escape(&result);
                        },
                        repetitions);
+   printAnalyzed();
    if (q.count("9h"))
       e.timeAndProfile("q9 hyper     ",
                        nrTuples(tpch, {"nation", "supplier", "part", "partsupp",
@@ -204,6 +264,7 @@ int main(int argc, char* argv[]) {
                           escape(&result);
                        },
                        repetitions);
+   printAnalyzed();
    if (q.count("18h"))
       e.timeAndProfile(
           "q18 hyper     ",
@@ -224,5 +285,29 @@ int main(int argc, char* argv[]) {
              escape(&result);
           },
           repetitions);
+   printAnalyzed();
+   for (auto& file : planFiles) {
+      std::ifstream in(file);
+      if (!in) throw std::runtime_error("Could not open plan file " + file);
+      auto plan = vectorwise::PlanDescription::parse(in, tpch);
+      std::vector<std::string> scanned;
+      for (auto& s : plan.statements)
+         if (s.head.args[0].name == "scan")
+            scanned.push_back(s.head.args[2].name);
+      size_t found = 0;
+      e.timeAndProfile(file, nrTuples(tpch, scanned),
+                       [&]() {
+                          if (clearCaches) clearOsCaches();
+                          auto result = vectorwise::runPlan(tpch, plan,
+                                                            nrThreads,
+                                                            vectorSize);
+                          found = 0;
+                          for (auto& block : *result->result)
+                             found += block.size();
+                       },
+                       repetitions);
+      std::cout << file << ": " << found << " tuples" << std::endl;
+      printAnalyzed();
+   }
    return 0;
 }
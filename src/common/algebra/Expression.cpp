@@ -0,0 +1,49 @@
+#include "common/algebra/Expression.hpp"
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace std;
+
+namespace algebra {
+AttributeRef::AttributeRef(string n) : name(move(n)) {}
+void AttributeRef::used(unordered_set<string>& attributes) const {
+   attributes.insert(name);
+}
+void AttributeRef::print(ostream& s) const { s << name; }
+
+Constant::Constant(string v, unique_ptr<Type> t)
+    : value(move(v)), type(move(t)) {}
+void Constant::print(ostream& s) const {
+   s << static_cast<string>(*type) << " '" << value << "'";
+}
+
+BinaryExpression::BinaryExpression(string o, unique_ptr<Expression> l,
+                                   unique_ptr<Expression> r)
+    : op(move(o)), left(move(l)), right(move(r)) {
+   static const unordered_set<string> ops = {
+       "+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">=", "&&", "||"};
+   if (!ops.count(op)) throw runtime_error("unknown operator " + op);
+}
+void BinaryExpression::used(unordered_set<string>& attributes) const {
+   left->used(attributes);
+   right->used(attributes);
+}
+void BinaryExpression::print(ostream& s) const {
+   s << "(";
+   left->print(s);
+   s << " " << op << " ";
+   right->print(s);
+   s << ")";
+}
+
+unique_ptr<Expression> attr(string name) {
+   return make_unique<AttributeRef>(move(name));
+}
+unique_ptr<Expression> constant(string value, unique_ptr<Type> type) {
+   return make_unique<Constant>(move(value), move(type));
+}
+unique_ptr<Expression> binary(string op, unique_ptr<Expression> l,
+                              unique_ptr<Expression> r) {
+   return make_unique<BinaryExpression>(move(op), move(l), move(r));
+}
+} // namespace algebra
@@ -1,5 +1,6 @@
 #include "common/algebra/Operators.hpp"
 #include <ostream>
+#include <stdexcept>
 
 using namespace std;
 
@@ -17,15 +18,55 @@ BinaryOperator::BinaryOperator(string n, unique_ptr<Operator>&& l,
    right->parent = this;
 }
 
-Scan::Scan(runtime::Relation& r) : Operator("scan"), rel(r) {}
-Map::Map(std::unique_ptr<Operator> c) : UnaryOperator("map", move(c)) {}
+Scan::Scan(runtime::Relation& r) : Scan(r, r.name) {}
+Scan::Scan(runtime::Relation& r, string a)
+    : Operator("scan"), rel(r), alias(move(a)) {}
+Select::Select(unique_ptr<Operator> c, unique_ptr<Expression> p)
+    : UnaryOperator("select", move(c)), predicate(move(p)) {}
+Map::Map(unique_ptr<Operator> c, string a, unique_ptr<Expression> e)
+    : UnaryOperator("map", move(c)), attribute(move(a)), expression(move(e)) {}
 Print::Print(std::unique_ptr<Operator> c, std::vector<std::string>&& att)
     : UnaryOperator("print", move(c)), attributes(move(att)) {}
 HashJoin::HashJoin(std::unique_ptr<Operator>&& build,
                    std::unique_ptr<Operator>&& probe)
     : BinaryOperator("hashjoin", move(build), move(probe)) {}
+HashJoin::HashJoin(unique_ptr<Operator>&& build, unique_ptr<Operator>&& probe,
+                   vector<string> b, vector<string> p)
+    : BinaryOperator("hashjoin", move(build), move(probe)),
+      buildKeys(move(b)), probeKeys(move(p)) {
+   if (buildKeys.size() != probeKeys.size())
+      throw runtime_error("hashjoin needs as many build as probe keys");
+}
+GroupBy::GroupBy(unique_ptr<Operator> c, vector<string> k,
+                 vector<Aggregate> a)
+    : UnaryOperator("groupby", move(c)), keys(move(k)), aggregates(move(a)) {
+   for (auto& aggr : aggregates)
+      if ((aggr.kind == Aggregate::Sum) != bool(aggr.input))
+         throw runtime_error("aggregate " + aggr.name +
+                             ": only sum has an input");
+}
+
+void Select::used(unordered_set<string>& attributes) const {
+   predicate->used(attributes);
+}
+void Map::used(unordered_set<string>& attributes) const {
+   expression->used(attributes);
+}
+void Print::used(unordered_set<string>& attrs) const {
+   attrs.insert(attributes.begin(), attributes.end());
+}
+void HashJoin::used(unordered_set<string>& attributes) const {
+   attributes.insert(buildKeys.begin(), buildKeys.end());
+   attributes.insert(probeKeys.begin(), probeKeys.end());
+}
+void GroupBy::used(unordered_set<string>& attributes) const {
+   attributes.insert(keys.begin(), keys.end());
+   for (auto& aggr : aggregates)
+      if (aggr.input) aggr.input->used(attributes);
+}
 
 void Operator::print(ostream& s) const { s << name; }
+void Scan::print(ostream& s) const { s << name << " " << alias; }
 void UnaryOperator::print(ostream& s) const {
    s << name << " <- ";
    child->print(s);
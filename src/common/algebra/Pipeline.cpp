@@ -4,8 +4,8 @@ using namespace std;
 
 namespace algebra{
 
-   Pipeline& Pipeline::map(){
-      root = make_unique<Map>(move(root));
+   Pipeline& Pipeline::map(string attribute, unique_ptr<Expression> e){
+      root = make_unique<Map>(move(root), move(attribute), move(e));
       return *this;
    }
 
@@ -14,6 +14,16 @@ namespace algebra{
       return *this;
    }
 
+   Pipeline& Pipeline::scan(runtime::Relation& r, string alias){
+      root = make_unique<Scan>(r, move(alias));
+      return *this;
+   }
+
+   Pipeline& Pipeline::select(unique_ptr<Expression> predicate){
+      root = make_unique<Select>(move(root), move(predicate));
+      return *this;
+   }
+
   Pipeline& Pipeline::print(std::vector<std::string> attrs){
     root = make_unique<Print>(move(root), move(attrs));
       return *this;
@@ -22,6 +32,18 @@ namespace algebra{
       root = make_unique<HashJoin>(move(m.root), move(root));
       return *this;
    }
+   Pipeline& Pipeline::hashjoin(Pipeline& m, vector<string> buildKeys,
+                                vector<string> probeKeys){
+      root = make_unique<HashJoin>(move(m.root), move(root), move(buildKeys),
+                                   move(probeKeys));
+      return *this;
+   }
+
+   Pipeline& Pipeline::groupby(vector<string> keys,
+                               vector<GroupBy::Aggregate> aggregates){
+      root = make_unique<GroupBy>(move(root), move(keys), move(aggregates));
+      return *this;
+   }
 
 
    void Pipeline::print(std::ostream& s)const{
@@ -9,24 +9,19 @@ WorkerGroup mainGroup(1);
 HierarchicBarrier mainBarrier(1, nullptr);
 
 #ifdef NUMA_POOLS
-// Initialize NUMA pool array
-GlobalPool numaPools[MAX_NUMA_NODES];
-size_t activeNumaNodes = detectNumaNodes();
+std::deque<GlobalPool> numaPools(Topology::machine().nodes.size());
 
-// Initialize NUMA node binding for each pool
 #ifdef NUMA_MBIND
 struct NumaPoolInitializer {
    NumaPoolInitializer() {
-      //std::cerr << "[NUMA] Detected " << activeNumaNodes << " NUMA nodes" << std::endl;
-      for (size_t i = 0; i < MAX_NUMA_NODES; ++i) {
-         numaPools[i].setNumaNode(static_cast<int>(i));
-         //std::cerr << "[NUMA] Pool " << i << " bound to node " << i << std::endl;
-      }
+      auto& nodes = Topology::machine().nodes;
+      for (size_t r = 0; r < nodes.size(); ++r)
+         numaPools[r].setNumaNode(static_cast<int>(nodes[r]));
    }
 } numaPoolInit;
 #endif
 
-Worker mainWorker(&mainGroup, &mainBarrier, 0); // Main worker on NUMA node 0
+Worker mainWorker(&mainGroup, &mainBarrier, 0); // Main worker on region 0
 #else
 GlobalPool defaultPool;
 Worker mainWorker(&mainGroup, &mainBarrier, defaultPool);
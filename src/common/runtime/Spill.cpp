@@ -0,0 +1,111 @@
+#include "common/runtime/Spill.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace runtime {
+
+size_t spillBudget = 0;
+std::string spillDirectory = "/tmp";
+std::atomic<size_t> spillableBytes(0);
+
+static void fail(const char* what) {
+   throw std::runtime_error(std::string(what) + ": " + strerror(errno));
+}
+
+static int createTemporary()
+/// Create a temporary file which is removed as soon as it is closed
+{
+   auto path = spillDirectory + "/spillXXXXXX";
+   std::vector<char> name(path.begin(), path.end());
+   name.push_back(0);
+   auto fd = mkstemp(name.data());
+   if (fd == -1) fail("Could not create spill file");
+   unlink(name.data());
+   return fd;
+}
+
+SpillFile::SpillFile() : fd(createTemporary()) { buffer.reserve(bufferSize); }
+
+SpillFile::~SpillFile() {
+   if (pending.valid()) pending.wait();
+   close(fd);
+}
+
+void SpillFile::writeBuffer() {
+   if (pending.valid()) pending.get();
+   auto offset = size - buffer.size();
+   std::swap(buffer, inFlight);
+   buffer.clear();
+   pending = std::async(std::launch::async, [this, offset]() {
+      auto data = inFlight.data();
+      for (size_t written = 0, n = inFlight.size(); written < n;) {
+         auto w = pwrite(fd, data + written, n - written, offset + written);
+         if (w < 0) {
+            if (errno == EINTR) continue;
+            fail("Could not write spill file");
+         }
+         written += w;
+      }
+   });
+}
+
+size_t SpillFile::append(const void* data, size_t n) {
+   auto offset = size;
+   if (buffer.size() + n > bufferSize && !buffer.empty()) writeBuffer();
+   auto bytes = reinterpret_cast<const uint8_t*>(data);
+   buffer.insert(buffer.end(), bytes, bytes + n);
+   size += n;
+   return offset;
+}
+
+void SpillFile::flush() {
+   if (!buffer.empty()) writeBuffer();
+   if (pending.valid()) pending.get();
+}
+
+void SpillFile::read(size_t offset, void* dest, size_t n) const {
+   auto data = reinterpret_cast<uint8_t*>(dest);
+   for (size_t done = 0; done < n;) {
+      auto r = pread(fd, data + done, n - done, offset + done);
+      if (r < 0) {
+         if (errno == EINTR) continue;
+         fail("Could not read spill file");
+      }
+      if (r == 0) throw std::runtime_error("Spill file is truncated");
+      done += r;
+   }
+}
+
+FileBackedArena::FileBackedArena() : fd(createTemporary()) {}
+
+FileBackedArena::~FileBackedArena() {
+   for (auto& segment : segments) munmap(segment.first, segment.second);
+   close(fd);
+}
+
+void* FileBackedArena::allocate(size_t bytes) {
+   bytes = (bytes + 15) & ~size_t(15);
+   if (bytes > remaining) {
+      auto pageSize = size_t(sysconf(_SC_PAGESIZE));
+      size_t size = (bytes + pageSize - 1) & ~(pageSize - 1);
+      if (size < segmentSize) size = segmentSize;
+      if (ftruncate(fd, fileSize + size) != 0)
+         fail("Could not grow spill file");
+      auto segment = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          fd, fileSize);
+      if (segment == MAP_FAILED) fail("Could not map spill file");
+      fileSize += size;
+      segments.emplace_back(segment, size);
+      current = reinterpret_cast<uint8_t*>(segment);
+      remaining = size;
+   }
+   auto result = current;
+   current += bytes;
+   remaining -= bytes;
+   return result;
+}
+} // namespace runtime
@@ -0,0 +1,169 @@
+#include "common/runtime/Topology.hpp"
+#include <algorithm>
+#include <cctype>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace runtime {
+
+using namespace std;
+
+namespace {
+/// first line of a sysfs file, empty if it does not exist
+string readLine(const string& path) {
+   ifstream in(path);
+   string line;
+   getline(in, line);
+   return line;
+}
+
+/// numeric value of a sysfs file, or otherwise
+size_t readNumber(const string& path, size_t otherwise) {
+   auto line = readLine(path);
+   if (line.empty() || line[0] == '-') return otherwise;
+   return stoul(line);
+}
+
+/// ids of the entries named <prefix><id> in dir
+vector<size_t> numbered(const string& dir, const string& prefix) {
+   vector<size_t> ids;
+   if (auto d = opendir(dir.c_str())) {
+      while (auto entry = readdir(d)) {
+         string name = entry->d_name;
+         if (name.size() > prefix.size() &&
+             name.compare(0, prefix.size(), prefix) == 0 &&
+             all_of(name.begin() + prefix.size(), name.end(), ::isdigit))
+            ids.push_back(stoul(name.substr(prefix.size())));
+      }
+      closedir(d);
+   }
+   sort(ids.begin(), ids.end());
+   return ids;
+}
+
+/// CPUs of the process' affinity mask, empty if it is unknown
+vector<size_t> affinity() {
+   vector<size_t> allowed;
+#ifdef __linux__
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   if (sched_getaffinity(0, sizeof(set), &set) == 0)
+      for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+         if (CPU_ISSET(cpu, &set)) allowed.push_back(cpu);
+#endif
+   return allowed;
+}
+} // namespace
+
+vector<size_t> Topology::parseList(const string& list) {
+   vector<size_t> ids;
+   size_t pos = 0;
+   while (pos < list.size() && isdigit(list[pos])) {
+      size_t end;
+      size_t first = stoul(list.substr(pos), &end);
+      pos += end;
+      size_t last = first;
+      if (pos < list.size() && list[pos] == '-') {
+         last = stoul(list.substr(++pos), &end);
+         pos += end;
+      }
+      for (size_t id = first; id <= last; ++id) ids.push_back(id);
+      if (pos < list.size() && list[pos] == ',') ++pos;
+   }
+   return ids;
+}
+
+Topology Topology::discover(const string& sysfs,
+                            const vector<size_t>& allowed) {
+   auto ids = parseList(readLine(sysfs + "/cpu/online"));
+   if (ids.empty())
+      for (size_t id = 0; id < max(1u, thread::hardware_concurrency()); ++id)
+         ids.push_back(id);
+   if (!allowed.empty()) {
+      vector<size_t> both;
+      set_intersection(ids.begin(), ids.end(), allowed.begin(), allowed.end(),
+                       back_inserter(both));
+      // a stale mask should not leave us without CPUs
+      if (!both.empty()) ids = move(both);
+   }
+
+   map<size_t, size_t> nodeOf;
+   for (auto node : numbered(sysfs + "/node", "node"))
+      for (auto id : parseList(readLine(sysfs + "/node/node" +
+                                        to_string(node) + "/cpulist")))
+         nodeOf[id] = node;
+
+   Topology t;
+   map<pair<size_t, size_t>, size_t> siblings;
+   for (auto id : ids) {
+      auto dir = sysfs + "/cpu/cpu" + to_string(id) + "/topology/";
+      Cpu cpu;
+      cpu.id = id;
+      cpu.socket = readNumber(dir + "physical_package_id", 0);
+      cpu.core = readNumber(dir + "core_id", id);
+      auto node = nodeOf.find(id);
+      cpu.node = node == nodeOf.end() ? 0 : node->second;
+      // cpus are ordered by id, the first sibling of a core has the lowest
+      cpu.smt = siblings[{cpu.socket, cpu.core}]++;
+      t.cpus.push_back(cpu);
+      t.smtPerCore = max(t.smtPerCore, cpu.smt + 1);
+   }
+   vector<size_t> sockets;
+   for (auto& cpu : t.cpus) {
+      t.nodes.push_back(cpu.node);
+      sockets.push_back(cpu.socket);
+   }
+   sort(t.nodes.begin(), t.nodes.end());
+   t.nodes.erase(unique(t.nodes.begin(), t.nodes.end()), t.nodes.end());
+   sort(sockets.begin(), sockets.end());
+   t.sockets = unique(sockets.begin(), sockets.end()) - sockets.begin();
+   for (auto& cpu : t.cpus)
+      cpu.region = lower_bound(t.nodes.begin(), t.nodes.end(), cpu.node) -
+                   t.nodes.begin();
+   return t;
+}
+
+const Topology& Topology::machine() {
+   static const Topology machine = discover("/sys/devices/system", affinity());
+   return machine;
+}
+
+vector<size_t> Topology::fanOutSchedule() const {
+   // cpus of each region and SMT level, ordered by socket and core
+   vector<vector<vector<size_t>>> levels(
+       smtPerCore, vector<vector<size_t>>(nodes.size()));
+   for (size_t i = 0; i < cpus.size(); ++i)
+      levels[cpus[i].smt][cpus[i].region].push_back(i);
+   auto byCore = [&](size_t a, size_t b) {
+      return tie(cpus[a].socket, cpus[a].core) <
+             tie(cpus[b].socket, cpus[b].core);
+   };
+   vector<size_t> schedule;
+   for (auto& regions : levels) {
+      size_t longest = 0;
+      for (auto& region : regions) {
+         sort(region.begin(), region.end(), byCore);
+         longest = max(longest, region.size());
+      }
+      for (size_t k = 0; k < longest; ++k)
+         for (auto& region : regions)
+            if (k < region.size()) schedule.push_back(region[k]);
+   }
+   return schedule;
+}
+
+vector<size_t> Topology::consolidatedSchedule() const {
+   vector<size_t> schedule(cpus.size());
+   for (size_t i = 0; i < cpus.size(); ++i) schedule[i] = i;
+   sort(schedule.begin(), schedule.end(), [&](size_t a, size_t b) {
+      return tie(cpus[a].region, cpus[a].smt, cpus[a].socket, cpus[a].core) <
+             tie(cpus[b].region, cpus[b].smt, cpus[b].socket, cpus[b].core);
+   });
+   return schedule;
+}
+} // namespace runtime
@@ -1,5 +1,7 @@
 #ifdef __SSE4_2__
 #include <nmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
 #endif
 #include "common/runtime/Types.hpp"
 //---------------------------------------------------------------------------
@@ -45,6 +47,113 @@ const char* memmemSSE(const char *haystack, size_t len, const char *needleStr, s
 #endif
 }
 //---------------------------------------------------------------------------
+const char* memmemFirstLast(const char* haystack, size_t len,
+                            const char* needle, size_t needleLength)
+   // Find needle, filtering candidate positions by first and last character
+{
+   if (needleLength == 0) return haystack;
+   if (needleLength > len) return nullptr;
+   size_t candidates = len - needleLength + 1, pos = 0;
+#ifdef __SSE2__
+   auto first = _mm_set1_epi8(needle[0]);
+   auto last = _mm_set1_epi8(needle[needleLength - 1]);
+   // both loads of a block stay within the haystack
+   for (; pos + 16 <= candidates; pos += 16) {
+      auto begins = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(haystack + pos));
+      auto ends = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(haystack + pos + needleLength - 1));
+      unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+          _mm_cmpeq_epi8(begins, first), _mm_cmpeq_epi8(ends, last)));
+      for (; mask; mask &= mask - 1) {
+         auto candidate = haystack + pos + __builtin_ctz(mask);
+         if (memcmp(candidate, needle, needleLength) == 0) return candidate;
+      }
+   }
+#endif
+   for (; pos < candidates; ++pos)
+      if (haystack[pos] == needle[0] &&
+          memcmp(haystack + pos, needle, needleLength) == 0)
+         return haystack + pos;
+   return nullptr;
+}
+//---------------------------------------------------------------------------
+LikePattern::LikePattern(const string& pattern)
+   // Parse pattern into segments
+{
+   anchoredBegin = pattern.empty() || pattern.front() != '%';
+   anchoredEnd = pattern.empty() || pattern.back() != '%';
+   size_t begin = 0;
+   for (size_t end; (end = pattern.find('%', begin)) != string::npos;
+        begin = end + 1)
+      if (end > begin) segments.push_back(pattern.substr(begin, end - begin));
+   if (begin < pattern.size()) segments.push_back(pattern.substr(begin));
+
+   singleWildcards = pattern.find('_') != string::npos;
+   if (singleWildcards)
+      kind = Segments;
+   else if (pattern.find('%') == string::npos) {
+      kind = Equal;
+      segments.assign(1, pattern);
+   } else if (segments.empty()) {
+      // only wildcards, matches everything
+      kind = Contains;
+      segments.emplace_back();
+   } else if (segments.size() == 1 && anchoredBegin != anchoredEnd)
+      kind = anchoredBegin ? Prefix : Suffix;
+   else if (segments.size() == 1 && !anchoredBegin)
+      kind = Contains;
+   else
+      kind = Segments;
+}
+//---------------------------------------------------------------------------
+bool LikePattern::matchSegments(const char* str, unsigned len) const
+   // Match segments from left to right, each as early as possible
+{
+   auto pos = str, end = str + len;
+   auto first = segments.begin(), last = segments.end();
+   if (anchoredBegin) {
+      if (len < first->size() || !segmentAt(str, *first)) return false;
+      pos += first->size();
+      ++first;
+   }
+   if (anchoredEnd) {
+      // a single segment without % is both prefix and suffix
+      if (first == last) return pos == end;
+      --last;
+      if (size_t(end - pos) < last->size() ||
+          !segmentAt(end - last->size(), *last))
+         return false;
+      end -= last->size();
+   }
+   for (; first < last; ++first) {
+      auto found = findSegment(pos, end - pos, *first);
+      if (!found) return false;
+      pos = found + first->size();
+   }
+   return true;
+}
+//---------------------------------------------------------------------------
+bool LikePattern::segmentAt(const char* str, const string& s) const
+   // Compare characterwise only if the segments contain _
+{
+   if (!singleWildcards) return memcmp(str, s.data(), s.size()) == 0;
+   for (size_t i = 0; i < s.size(); ++i)
+      if (s[i] != '_' && s[i] != str[i]) return false;
+   return true;
+}
+//---------------------------------------------------------------------------
+const char* LikePattern::findSegment(const char* str, size_t len,
+                                     const string& s) const
+   // Try every position if the segments contain _
+{
+   if (!singleWildcards)
+      return memmemFirstLast(str, len, s.data(), s.size());
+   for (size_t pos = 0; pos + s.size() <= len; ++pos)
+      if (segmentAt(str + pos, s)) return str + pos;
+   return nullptr;
+}
+//---------------------------------------------------------------------------
 std::ostream& operator<<(std::ostream& out,const Integer& value)
 {
    out << value.value;
@@ -0,0 +1,288 @@
+#include "hyper/codegen/Compiler.hpp"
+#include "common/runtime/Spill.hpp"
+#include "common/runtime/Types.hpp"
+#include "hyper/codegen/Translator.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <fstream>
+#include <pwd.h>
+#include <spawn.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace hyper {
+
+/// Runtime definitions the generated queries use, which the rest of an
+/// executable may not. Referencing them links them into every executable
+/// compiling queries, where the loaded queries resolve them.
+extern const void* const runtimeSymbols[];
+const void* const runtimeSymbols[] = {
+    &runtime::spillableBytes,
+    reinterpret_cast<const void*>(static_cast<types::Date (*)(
+                                      const char*, uint32_t)>(
+        &types::Date::castString)),
+    reinterpret_cast<const void*>(&types::Integer::castString)};
+
+namespace {
+/// indent the generated code by its braces
+string indent(const string& code) {
+   istringstream lines(code);
+   ostringstream out;
+   size_t depth = 0;
+   for (string line; getline(lines, line);) {
+      size_t opened = 0, closed = 0;
+      for (auto c : line) {
+         if (c == '{' || c == '(') opened++;
+         if (c == '}' || c == ')') {
+            if (opened)
+               opened--;
+            else
+               closed++;
+         }
+      }
+      auto lineDepth = depth - min(depth, closed);
+      if (!line.empty()) out << string(3 * lineDepth, ' ') << line;
+      out << "\n";
+      depth = lineDepth + opened;
+   }
+   return out.str();
+}
+
+string readFile(const string& path) {
+   ifstream in(path);
+   ostringstream content;
+   content << in.rdbuf();
+   return content.str();
+}
+
+/// FNV-1a, stable across processes unlike std::hash
+uint64_t fnv(const string& data, uint64_t hash = 14695981039346656037ul) {
+   for (auto c : data) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ul;
+   }
+   return hash;
+}
+
+/// model and feature flags of the cpu, as -march=native depends on them
+string cpuDescription() {
+   ifstream cpuinfo("/proc/cpuinfo");
+   string description;
+   for (string line; getline(cpuinfo, line);) {
+      if (line.compare(0, 10, "model name") == 0 ||
+          line.compare(0, 5, "flags") == 0)
+         description += line + "\n";
+      if (line.empty() && !description.empty()) break;
+   }
+   return description;
+}
+
+/// run the compiler with args, without a shell, and its output in log.
+/// true if it succeeded.
+bool compile(const vector<string>& args, const string& log) {
+   vector<char*> argv;
+   for (auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+   argv.push_back(nullptr);
+   posix_spawn_file_actions_t actions;
+   posix_spawn_file_actions_init(&actions);
+   posix_spawn_file_actions_addopen(&actions, 1, log.c_str(),
+                                    O_WRONLY | O_CREAT | O_TRUNC, 0600);
+   posix_spawn_file_actions_adddup2(&actions, 1, 2);
+   pid_t pid;
+   auto failed = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(),
+                             environ);
+   posix_spawn_file_actions_destroy(&actions);
+   if (failed) {
+      ofstream(log) << "could not run " << args[0] << ": " << strerror(failed);
+      return false;
+   }
+   int status;
+   while (waitpid(pid, &status, 0) == -1)
+      if (errno != EINTR) return false;
+   return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/// hash of the names and contents of the files below dir
+uint64_t hashHeaders(const string& dir, uint64_t hash) {
+   vector<string> entries;
+   if (auto d = opendir(dir.c_str())) {
+      while (auto entry = readdir(d))
+         if (entry->d_name[0] != '.') entries.push_back(entry->d_name);
+      closedir(d);
+   }
+   sort(entries.begin(), entries.end());
+   for (auto& entry : entries) {
+      auto path = dir + "/" + entry;
+      struct stat info;
+      if (stat(path.c_str(), &info)) continue;
+      hash = fnv(entry, hash);
+      if (S_ISDIR(info.st_mode))
+         hash = hashHeaders(path, hash);
+      else
+         hash = fnv(readFile(path), hash);
+   }
+   return hash;
+}
+} // namespace
+
+string generate(algebra::Operator& plan, vector<runtime::Relation*>& relations) {
+   if (plan.name != "print")
+      throw runtime_error("the root of a compiled plan must be a print");
+   Context ctx;
+   Translator::produce(plan, ctx);
+   relations = ctx.relations;
+
+   ostringstream s;
+   s << "#include \"common/runtime/Database.hpp\"\n"
+     << "#include \"common/runtime/Hash.hpp\"\n"
+     << "#include \"common/runtime/Hashmap.hpp\"\n"
+     << "#include \"common/runtime/PartitionedDeque.hpp\"\n"
+     << "#include \"common/runtime/Query.hpp\"\n"
+     << "#include \"common/runtime/Stack.hpp\"\n"
+     << "#include \"common/runtime/Types.hpp\"\n"
+     << "#include \"hyper/GroupBy.hpp\"\n"
+     << "#include \"hyper/ParallelHelper.hpp\"\n"
+     << "#include \"tbb/tbb.h\"\n"
+     << "#include <tuple>\n"
+     << "#include <type_traits>\n"
+     << "#include <utility>\n\n"
+     << "extern \"C\" runtime::Query* query("
+     << "runtime::Relation* const* relations, size_t nrThreads) {\n"
+     << "using hash_fn = runtime::CRC32Hash;\n"
+     << "auto resources = initQuery(nrThreads);\n"
+     << "auto& result = *resources.query->result;\n"
+     << ctx.body.str() << "leaveQuery(nrThreads);\n"
+     << "return resources.query.release();\n"
+     << "}\n";
+   return indent(s.str());
+}
+
+vector<string> compilerArguments(const string& source, const string& object) {
+   vector<string> args;
+   istringstream compiler(HYPER_COMPILER);
+   for (string arg; compiler >> arg;) args.push_back(arg);
+   args.insert(args.end(), {"-shared", "-o", object, source});
+   istringstream libraries(HYPER_LIBRARIES);
+   for (string arg; libraries >> arg;) args.push_back(arg);
+   return args;
+}
+
+QueryCache::QueryCache(string dir) : directory(move(dir)) {
+   if (mkdir(directory.c_str(), 0700) && errno != EEXIST)
+      throw runtime_error("could not create query cache " + directory);
+   struct stat info;
+   if (lstat(directory.c_str(), &info) || !S_ISDIR(info.st_mode) ||
+       info.st_uid != getuid() || (info.st_mode & 0777) != 0700)
+      throw runtime_error("query cache " + directory +
+                          " must be a directory of this user with mode 0700");
+}
+
+QueryCache& QueryCache::global() {
+   static QueryCache cache([]() -> string {
+      if (auto dir = getenv("HyperCache")) return dir;
+      string base;
+      if (auto xdg = getenv("XDG_CACHE_HOME"))
+         base = xdg;
+      else if (auto home = getenv("HOME"))
+         base = string(home) + "/.cache";
+      else if (auto user = getpwuid(getuid()))
+         base = string(user->pw_dir) + "/.cache";
+      else
+         throw runtime_error("no home directory for the query cache");
+      mkdir(base.c_str(), 0700);
+      return base + "/hyper";
+   }());
+   return cache;
+}
+
+string QueryCache::get(const string& source) {
+   // everything the shared object depends on besides the source
+   static const uint64_t environment = [] {
+      uint64_t hash = 14695981039346656037ul;
+      for (auto& arg : compilerArguments("", "")) hash = fnv(arg, hash);
+      hash = fnv(__VERSION__, hash);
+      hash = fnv(cpuDescription(), hash);
+      return hashHeaders(HYPER_INCLUDE, hash);
+   }();
+   char key[17];
+   snprintf(key, sizeof(key), "%016lx", fnv(source, environment));
+   auto path = directory + "/" + key + ".so";
+   if (access(path.c_str(), R_OK) == 0) {
+      hits++;
+      return path;
+   }
+   misses++;
+
+   // compile under a name of this thread, other processes see the shared
+   // object only after the rename
+   auto file = directory + "/" + key + "." + to_string(getpid()) + "." +
+               to_string(nextFile++);
+   ofstream(file + ".cpp") << source;
+   auto removeFiles = [&file] {
+      for (auto ext : {".cpp", ".log", ".so"}) remove((file + ext).c_str());
+   };
+   if (!compile(compilerArguments(file + ".cpp", file + ".so"),
+                file + ".log")) {
+      auto log = readFile(file + ".log");
+      removeFiles();
+      throw runtime_error("compiling query " + string(key) + " failed:\n" +
+                          log);
+   }
+   auto renamed = rename((file + ".so").c_str(), path.c_str());
+   removeFiles();
+   if (renamed) throw runtime_error("could not add " + path + " to the cache");
+   return path;
+}
+
+CompiledQuery::CompiledQuery(algebra::Operator& plan, QueryCache& cache) {
+   code = generate(plan, relations);
+   load(cache.get(code));
+}
+
+CompiledQuery::CompiledQuery(algebra::Operator& plan, Fallback f,
+                             QueryCache& cache)
+    : fallback(move(f)) {
+   code = generate(plan, relations);
+   compilation = async(launch::async,
+                       [&cache, source = code]() { return cache.get(source); });
+}
+
+CompiledQuery::~CompiledQuery() {
+   if (compilation.valid()) compilation.wait();
+   if (handle) dlclose(handle);
+}
+
+void CompiledQuery::load(const string& path) {
+   handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+   if (!handle) throw runtime_error(string("loading query failed: ") + dlerror());
+   function = reinterpret_cast<Function>(dlsym(handle, "query"));
+   if (!function)
+      throw runtime_error(string("resolving query failed: ") + dlerror());
+}
+
+bool CompiledQuery::ready() {
+   return function || (compilation.valid() &&
+                       compilation.wait_for(chrono::seconds(0)) ==
+                           future_status::ready);
+}
+
+unique_ptr<runtime::Query> CompiledQuery::run(size_t nrThreads) {
+   if (!function) {
+      if (fallback && !ready()) return fallback(nrThreads);
+      load(compilation.get());
+   }
+   return unique_ptr<runtime::Query>(function(relations.data(), nrThreads));
+}
+} // namespace hyper
@@ -1,21 +1,115 @@
 #include "hyper/codegen/Translator.hpp"
+#include <cctype>
+#include <cstdio>
+#include <stdexcept>
 
 using namespace std;
 
 namespace hyper{
 
-   void Translator::produce(algebra::Operator& op, std::ostream& s){
+   namespace {
+      /// C++ string literal of s
+      string quote(const string& s){
+         string q = "\"";
+         for (auto c : s) {
+            if (c == '"' || c == '\\') q += '\\';
+            if (isprint(static_cast<unsigned char>(c))) {
+               q += c;
+            } else {
+               char escaped[5];
+               snprintf(escaped, sizeof(escaped), "\\%03o",
+                        static_cast<unsigned char>(c));
+               q += escaped;
+            }
+         }
+         return q + "\"";
+      }
+   }
+
+   void Translator::produce(algebra::Operator& op, Context& ctx){
       // lookup produce function
       auto prod = hyper::TranslatorRegistry::global()->lookupProduce(op.name);
-      // render function into s
-      prod(op, s);
+      // render function into ctx
+      prod(op, ctx);
    }
 
-   void Translator::consume(algebra::Operator& op,algebra::Operator& source, std::ostream& s){
+   void Translator::consume(algebra::Operator& op,algebra::Operator& source, Context& ctx){
       // lookup consume function
       auto cons = hyper::TranslatorRegistry::global()->lookupConsume(op.name);
-      // render function into s
-      cons(op, source, s);
+      // render function into ctx
+      cons(op, source, ctx);
    }
 
+   string Context::fresh(const string& prefix){
+      string name;
+      for (auto c : prefix)
+         name += isalnum(static_cast<unsigned char>(c)) ? c : '_';
+      return name + "_" + to_string(nextId++);
+   }
+
+   string Context::id(const algebra::Operator& op){
+      auto& id = ids[&op];
+      if (id.empty()) id = to_string(nextId++);
+      return id;
+   }
+
+   const Variable& Context::attribute(const string& name) const{
+      auto a = attributes.find(name);
+      if (a == attributes.end())
+         throw runtime_error("unknown attribute " + name);
+      return a->second;
+   }
+
+   string Context::expression(const algebra::Expression& e, bool typeOnly){
+      if (auto a = dynamic_cast<const algebra::AttributeRef*>(&e)) {
+         auto& v = attribute(a->name);
+         if (typeOnly) return "std::declval<" + v.type + "&>()";
+         return v.name;
+      }
+      if (auto c = dynamic_cast<const algebra::Constant*>(&e)) {
+         auto& name = constants[c];
+         if (name.empty()) {
+            name = fresh("constant");
+            auto type = cppType(*c->type);
+            pipeline->declarations << "const " << type << " " << name
+                                   << " = ";
+            if (type == "int64_t")
+               pipeline->declarations << stoll(c->value) << "l;\n";
+            else
+               pipeline->declarations << type << "::castString("
+                                      << quote(c->value) << ", "
+                                      << c->value.size() << ");\n";
+         }
+         return name;
+      }
+      if (auto b = dynamic_cast<const algebra::BinaryExpression*>(&e))
+         return "(" + expression(*b->left, typeOnly) + " " + b->op + " " +
+                expression(*b->right, typeOnly) + ")";
+      throw runtime_error("unknown expression");
+   }
+
+   string Context::cppType(const algebra::Type& t){
+      if (dynamic_cast<const algebra::BigInt*>(&t)) return "int64_t";
+      return "types::" + t.cppname();
+   }
+
+   unordered_set<string> Context::usedAbove(const algebra::Operator& op){
+      unordered_set<string> used;
+      for (auto p = op.parent; p; p = p->parent) p->used(used);
+      return used;
+   }
+
+   void Context::beginPipeline(){
+      pipeline = make_unique<Pipeline>();
+      attributes.clear();
+   }
+
+   void Context::endPipeline(const string& morselBegin,
+                             const string& tupleBegin, const string& tupleEnd,
+                             const string& morselEnd){
+      body << pipeline->declarations.str() << morselBegin
+           << pipeline->morsel.str() << tupleBegin << pipeline->tuple.str()
+           << tupleEnd << morselEnd << pipeline->finish.str();
+      pipeline.reset();
+   }
 }
@@ -1,4 +1,5 @@
 #include "hyper/codegen/TranslatorRegistry.hpp"
+#include <stdexcept>
 
 namespace hyper {
 
@@ -17,7 +18,7 @@ ProduceFunc TranslatorRegistry::lookupProduce(const std::string& op) const {
    if (it != produceRegistry.end()) {
       return it->second;
    } else {
-      throw;
+      throw std::runtime_error("no produce translator for " + op);
    }
 }
 
@@ -31,7 +32,7 @@ ConsumeFunc TranslatorRegistry::lookupConsume(const std::string& op) const {
    if (it != consumeRegistry.end()) {
       return it->second;
    } else {
-      throw;
+      throw std::runtime_error("no consume translator for " + op);
    }
 }
 }
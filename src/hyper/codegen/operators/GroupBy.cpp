@@ -0,0 +1,85 @@
+#include "hyper/codegen/Translator.hpp"
+#include <string>
+
+namespace hyper{
+   namespace translators{
+      /// output pipeline: one tuple per group
+      void groupByProduce(algebra::Operator& op, Context& ctx){
+         auto& group = static_cast<algebra::GroupBy&>(op);
+         Translator::produce(*group.child.get(), ctx);
+
+         auto id = ctx.id(op);
+         ctx.beginPipeline();
+         auto groups = ctx.fresh("groups");
+         auto entry = ctx.fresh("group");
+         auto& attributes = ctx.materialized[&op];
+         for (size_t i = 0; i < attributes.size(); ++i) {
+            bool key = i < group.keys.size();
+            Variable v{ctx.fresh(attributes[i].first), attributes[i].second};
+            ctx.pipeline->tuple
+                << "auto& " << v.name << " = std::get<"
+                << (key ? i : i - group.keys.size()) << ">(" << entry
+                << (key ? ".k" : ".v") << ");\n";
+            ctx.attributes[attributes[i].first] = v;
+         }
+         Translator::consume(*op.parent, op, ctx);
+         // the locals of this thread give an empty input one partition
+         ctx.endPipeline("group_" + id + ".preAggLocals();\n" + "group_" + id +
+                             ".forallGroups([&](auto& " + groups + ") {\n",
+                         "for (auto block : " + groups + ")\nfor (auto& " +
+                             entry + " : block) {\n",
+                         "}\n", "});\n");
+      }
+
+      /// pre-aggregate the input in thread local hash tables
+      void groupByConsume(algebra::Operator& op, algebra::Operator&,
+                          Context& ctx){
+         auto& group = static_cast<algebra::GroupBy&>(op);
+         auto id = ctx.id(op);
+         auto& s = ctx.pipeline->declarations;
+         auto& attributes = ctx.materialized[&op];
+         std::string keyTypes, keys;
+         for (auto& k : group.keys) {
+            auto& v = ctx.attribute(k);
+            keyTypes += (keyTypes.empty() ? "" : ", ") + v.type;
+            keys += (keys.empty() ? "" : ", ") + v.name;
+            attributes.emplace_back(k, v.type);
+         }
+         std::string valueTypes, values, init, update;
+         for (size_t i = 0; i < group.aggregates.size(); ++i) {
+            auto& aggr = group.aggregates[i];
+            std::string type = "int64_t", value = "int64_t(1)";
+            if (aggr.kind == algebra::GroupBy::Aggregate::Sum) {
+               type = ctx.fresh("type");
+               s << "using " << type << " = std::decay_t<decltype("
+                 << ctx.expression(*aggr.input, true) << ")>;\n";
+               value = ctx.expression(*aggr.input);
+            }
+            auto sep = i ? ", " : "";
+            valueTypes += sep + type;
+            values += sep + type + "(" + value + ")";
+            init += sep + type + "(0)";
+            update += "std::get<" + std::to_string(i) + ">(acc) += std::get<" +
+                      std::to_string(i) + ">(v);\n";
+            attributes.emplace_back(aggr.name, type);
+         }
+         s << "using groupKey_" << id << " = std::tuple<" << keyTypes << ">;\n"
+           << "using groupValue_" << id << " = std::tuple<" << valueTypes
+           << ">;\n"
+           << "auto group_" << id << " = make_GroupBy<groupKey_" << id
+           << ", groupValue_" << id << ", hash_fn>(\n"
+           << "[](groupValue_" << id << "& acc, const groupValue_" << id
+           << "& v) {\n"
+           << update << "},\n"
+           << "groupValue_" << id << "(" << init << "), nrThreads);\n";
+         ctx.pipeline->morsel << "auto locals_" << id << " = group_" << id
+                              << ".preAggLocals();\n";
+         ctx.pipeline->tuple << "locals_" << id << ".consume(groupKey_" << id
+                             << "(" << keys << "), groupValue_" << id << "("
+                             << values << "));\n";
+      }
+   }
+}
+
+REGISTER_PRODUCE_FUNC("groupby", hyper::translators::groupByProduce);
+REGISTER_CONSUME_FUNC("groupby", hyper::translators::groupByConsume);
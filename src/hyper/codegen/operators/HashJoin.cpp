@@ -0,0 +1,107 @@
+#include "hyper/codegen/Translator.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace hyper{
+   namespace translators{
+      namespace {
+         /// comma separated variables of the attributes
+         std::string variables(Context& ctx,
+                               const std::vector<std::string>& attributes){
+            std::string list;
+            for (auto& a : attributes)
+               list += (list.empty() ? "" : ", ") + ctx.attribute(a).name;
+            return list;
+         }
+      }
+
+      void hashJoinProduce(algebra::Operator& op, Context& ctx){
+         auto& join = static_cast<algebra::HashJoin&>(op);
+         Translator::produce(*join.left.get(), ctx);
+         Translator::produce(*join.right.get(), ctx);
+      }
+
+      /// build side: materialize keys and the payload the plan reads later,
+      /// the hash table is built after the pipeline
+      void hashJoinBuild(algebra::HashJoin& join, Context& ctx){
+         auto id = ctx.id(join);
+         auto used = Context::usedAbove(join);
+         auto& payload = ctx.materialized[&join];
+         for (auto& a : ctx.attributes)
+            if (used.count(a.first))
+               payload.emplace_back(a.first, a.second.type);
+         std::sort(payload.begin(), payload.end());
+
+         std::string keyTypes, valueTypes, values;
+         for (auto& k : join.buildKeys)
+            keyTypes += (keyTypes.empty() ? "" : ", ") + ctx.attribute(k).type;
+         for (auto& p : payload) {
+            valueTypes += (valueTypes.empty() ? "" : ", ") + p.second;
+            values += (values.empty() ? "" : ", ") + ctx.attribute(p.first).name;
+         }
+         auto& s = ctx.pipeline->declarations;
+         s << "using key_" << id << " = std::tuple<" << keyTypes << ">;\n"
+           << "using value_" << id << " = std::tuple<" << valueTypes << ">;\n"
+           << "using ht_t_" << id << " = runtime::Hashmapx<key_" << id
+           << ", value_" << id << ", hash_fn>;\n"
+           << "ht_t_" << id << " ht_" << id << ";\n"
+           << "runtime::worker_specific<runtime::Stack<ht_t_" << id
+           << "::Entry>> entries_" << id << "(nrThreads);\n";
+         ctx.pipeline->morsel << "auto& localEntries_" << id << " = entries_"
+                              << id << ".local();\n";
+         auto key = ctx.fresh("key");
+         ctx.pipeline->tuple << "key_" << id << " " << key << "("
+                             << variables(ctx, join.buildKeys) << ");\n"
+                             << "localEntries_" << id << ".emplace_back(ht_"
+                             << id << ".hash(" << key << "), " << key
+                             << ", value_" << id << "(" << values << "));\n";
+         ctx.pipeline->finish << "size_t size_" << id << " = 0;\n"
+                              << "for (auto& e : entries_" << id << ") size_"
+                              << id << " += e.size();\n"
+                              << "ht_" << id << ".setSize(size_" << id
+                              << ");\n"
+                              << "parallel_insert(entries_" << id << ", ht_"
+                              << id << ");\n";
+      }
+
+      /// probe side: pass each match with the payload to the parent
+      void hashJoinProbe(algebra::HashJoin& join, Context& ctx){
+         auto id = ctx.id(join);
+         auto key = ctx.fresh("key");
+         auto hash = ctx.fresh("hash");
+         auto entry = ctx.fresh("entry");
+         auto& s = ctx.pipeline->tuple;
+         s << "key_" << id << " " << key << "("
+           << variables(ctx, join.probeKeys) << ");\n"
+           << "auto " << hash << " = ht_" << id << ".hash(" << key << ");\n"
+           << "for (auto " << entry << " = reinterpret_cast<ht_t_" << id
+           << "::Entry*>(ht_" << id << ".find_chain_tagged(" << hash << ")); "
+           << entry << "; " << entry << " = reinterpret_cast<ht_t_" << id
+           << "::Entry*>(" << entry << "->h.next)) {\n"
+           << "if (" << entry << "->h.hash != " << hash << " || !(" << entry
+           << "->k == " << key << ")) continue;\n";
+         auto& payload = ctx.materialized[&join];
+         for (size_t i = 0; i < payload.size(); ++i) {
+            Variable v{ctx.fresh(payload[i].first), payload[i].second};
+            s << "auto& " << v.name << " = std::get<" << i << ">(" << entry
+              << "->v);\n";
+            ctx.attributes[payload[i].first] = v;
+         }
+         Translator::consume(*join.parent, join, ctx);
+         s << "}\n";
+      }
+
+      void hashJoinConsume(algebra::Operator& op, algebra::Operator& source,
+                           Context& ctx){
+         auto& join = static_cast<algebra::HashJoin&>(op);
+         if (&source == join.left.get())
+            hashJoinBuild(join, ctx);
+         else
+            hashJoinProbe(join, ctx);
+      }
+   }
+}
+
+REGISTER_PRODUCE_FUNC("hashjoin", hyper::translators::hashJoinProduce);
+REGISTER_CONSUME_FUNC("hashjoin", hyper::translators::hashJoinConsume);
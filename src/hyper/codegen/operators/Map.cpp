@@ -1,15 +1,22 @@
 #include "hyper/codegen/Translator.hpp"
-#include <iostream>
 
 namespace hyper{
    namespace translators{
-      void mapProduce(algebra::Operator& op, std::ostream& s){
+      void mapProduce(algebra::Operator& op, Context& ctx){
          auto& map = static_cast<algebra::Map&>(op);
-         Translator::produce(*map.child.get(), s);
+         Translator::produce(*map.child.get(), ctx);
       }
-      void mapConsume(algebra::Operator& op, algebra::Operator&, std::ostream& s){
-         s << "x = t.a + z;\n";
-         Translator::consume(*op.parent, op, s);
+      void mapConsume(algebra::Operator& op, algebra::Operator&, Context& ctx){
+         auto& map = static_cast<algebra::Map&>(op);
+         Variable v{ctx.fresh(map.attribute), ctx.fresh("type")};
+         auto type = ctx.expression(*map.expression, true);
+         ctx.pipeline->declarations << "using " << v.type
+                                    << " = std::decay_t<decltype(" << type
+                                    << ")>;\n";
+         ctx.pipeline->tuple << v.type << " " << v.name << " = "
+                             << ctx.expression(*map.expression) << ";\n";
+         ctx.attributes[map.attribute] = v;
+         Translator::consume(*op.parent, op, ctx);
       }
    }
 }
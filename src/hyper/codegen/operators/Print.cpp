@@ -1,14 +1,55 @@
 #include "hyper/codegen/Translator.hpp"
-#include <iostream>
+#include <string>
 
 namespace hyper{
    namespace translators{
-      void printProduce(algebra::Operator& op, std::ostream& s){
+      void printProduce(algebra::Operator& op, Context& ctx){
          auto& print = static_cast<algebra::Print&>(op);
-         Translator::produce(*print.child.get(), s);
+         Translator::produce(*print.child.get(), ctx);
       }
-     void printConsume(algebra::Operator& /*op*/, algebra::Operator&, std::ostream& s){
-         s << "cout << x;\n";
+
+      /// collect the tuples per thread, write them to the query result after
+      /// the pipeline
+      void printConsume(algebra::Operator& op, algebra::Operator&,
+                        Context& ctx){
+         auto& print = static_cast<algebra::Print&>(op);
+         auto id = ctx.id(op);
+         std::string types, values;
+         for (auto& a : print.attributes) {
+            auto& v = ctx.attribute(a);
+            types += (types.empty() ? "" : ", ") + v.type;
+            values += (values.empty() ? "" : ", ") + v.name;
+         }
+         ctx.pipeline->declarations
+             << "using row_" << id << " = std::tuple<" << types << ">;\n"
+             << "runtime::worker_specific<runtime::Stack<row_" << id
+             << ">> rows_" << id << "(nrThreads);\n";
+         ctx.pipeline->morsel << "auto& localRows_" << id << " = rows_" << id
+                              << ".local();\n";
+         ctx.pipeline->tuple << "localRows_" << id << ".emplace_back(" << values
+                             << ");\n";
+
+         // result attributes are named without qualification
+         auto& s = ctx.pipeline->finish;
+         for (size_t i = 0; i < print.attributes.size(); ++i) {
+            auto& a = print.attributes[i];
+            s << "auto attr_" << id << "_" << i << " = result.addAttribute(\""
+              << a.substr(a.rfind('.') + 1) << "\", sizeof("
+              << ctx.attribute(a).type << "));\n";
+         }
+         s << "for (auto& rows : rows_" << id << ")\n"
+           << "for (auto chunk : rows) {\n"
+           << "auto block = result.createBlock(chunk.size());\n";
+         for (size_t i = 0; i < print.attributes.size(); ++i)
+            s << "auto out_" << i << " = reinterpret_cast<"
+              << ctx.attribute(print.attributes[i]).type
+              << "*>(block.data(attr_" << id << "_" << i << "));\n";
+         s << "for (auto& row : chunk) {\n";
+         for (size_t i = 0; i < print.attributes.size(); ++i)
+            s << "*out_" << i << "++ = std::get<" << i << ">(row);\n";
+         s << "}\n"
+           << "block.addedElements(chunk.size());\n"
+           << "}\n";
       }
    }
 }
@@ -1,26 +1,45 @@
 #include "hyper/codegen/Translator.hpp"
-#include <iostream>
+#include <algorithm>
+#include <string>
+#include <vector>
 
 namespace hyper{
    namespace translators{
-      void scanProduce(algebra::Operator& op, std::ostream& s){
+      void scanProduce(algebra::Operator& op, Context& ctx){
          auto& scan = static_cast<algebra::Scan&>(op);
          auto& rel = scan.rel;
+         ctx.beginPipeline();
+         auto& s = ctx.pipeline->declarations;
+         auto relation = ctx.fresh("rel");
+         s << "auto& " << relation << " = *relations[" << ctx.relations.size()
+           << "];\n";
+         ctx.relations.push_back(&rel);
 
-         for(auto& attrIt : rel.attributes){
-           auto& name = attrIt.first;
-           auto& attr = attrIt.second;
-           //TODO: attr type to c++ type
-           s << "auto& " << name << "_vec="<<rel.name<<"attributes.typedAccess<"<< attr.type->cppname() <<">();\n";
+         // only load the attributes which the plan reads
+         auto used = Context::usedAbove(op);
+         std::vector<std::string> names;
+         for (auto& attrIt : rel.attributes)
+            if (used.count(scan.alias + "." + attrIt.first))
+               names.push_back(attrIt.first);
+         std::sort(names.begin(), names.end());
+         for (auto& name : names) {
+            auto& attr = rel[name];
+            auto type = Context::cppType(*attr.type);
+            auto column = ctx.fresh(name + "_col");
+            Variable v{ctx.fresh(name), type};
+            s << "auto " << column << " = " << relation << "[\"" << name
+              << "\"].data<" << type << ">();\n";
+            ctx.pipeline->tuple << "auto& " << v.name << " = " << column
+                                << "[i];\n";
+            ctx.attributes[scan.alias + "." + name] = v;
          }
-        s << "for(int i=0;i<"<< rel.name <<".nrTuples,++i){\n";
-        for(auto& attrIt : rel.attributes){
-          auto& name = attrIt.first;
-          auto& attr = attrIt.second;
-          s << "auto& " << name << "="<<attr.name<<"_vec[i];\n";
-        }
-        Translator::consume(*op.parent, op, s);
-        s << "}\n";
+         Translator::consume(*op.parent, op, ctx);
+         ctx.endPipeline(
+             "tbb::parallel_for(tbb::blocked_range<size_t>(0, " + relation +
+                 ".nrTuples, morselSize),\n"
+                 "[&](const tbb::blocked_range<size_t>& r) {\n",
+             "for (size_t i = r.begin(), end = r.end(); i != end; ++i) {\n",
+             "}\n", "});\n");
       }
    }
 }
@@ -0,0 +1,21 @@
+#include "hyper/codegen/Translator.hpp"
+
+namespace hyper{
+   namespace translators{
+      void selectProduce(algebra::Operator& op, Context& ctx){
+         auto& select = static_cast<algebra::Select&>(op);
+         Translator::produce(*select.child.get(), ctx);
+      }
+      void selectConsume(algebra::Operator& op, algebra::Operator&,
+                         Context& ctx){
+         auto& select = static_cast<algebra::Select&>(op);
+         auto predicate = ctx.expression(*select.predicate);
+         ctx.pipeline->tuple << "if (" << predicate << ") {\n";
+         Translator::consume(*op.parent, op, ctx);
+         ctx.pipeline->tuple << "}\n";
+      }
+   }
+}
+
+REGISTER_PRODUCE_FUNC("select", hyper::translators::selectProduce);
+REGISTER_CONSUME_FUNC("select", hyper::translators::selectConsume);
@@ -1,4 +1,5 @@
 #include "common/runtime/PartitionedDeque.hpp"
+#include "common/runtime/Spill.hpp"
 #include <functional>
 #include <gtest/gtest.h>
 #include <unordered_set>
@@ -30,3 +31,30 @@ TEST(PartitionedDeque, insertAndFind) {
               value < end && value != partition.end; value++)
             ASSERT_EQ(reference.erase(*value), size_t(1));
 }
+
+TEST(PartitionedDeque, spillAndReadBack) {
+   const size_t n = 10000;
+   using deque_t = PartitionedDeque<8>;
+   unordered_set<uint64_t> reference;
+   ScopedSpillBudget budget(1); // spill every full chunk
+   {
+      deque_t deque(5, sizeof(uint64_t));
+      for (uint64_t value = 0; value < n; value++) {
+         deque.push_back(&value, value % 2);
+         reference.insert(value);
+      }
+      deque.finishWrites();
+      size_t spilled = 0;
+      for (size_t nr = 0; nr < deque.getPartitions().size(); nr++) {
+         for (auto& extent : deque.getPartitions()[nr].spilled)
+            spilled += extent.n;
+         deque.forEachChunk(nr, [&](void* chunk, size_t nChunk) {
+            auto values = reinterpret_cast<uint64_t*>(chunk);
+            for (size_t i = 0; i < nChunk; i++)
+               ASSERT_EQ(reference.erase(values[i]), size_t(1));
+         });
+      }
+      ASSERT_GT(spilled, size_t(0));
+   }
+   ASSERT_TRUE(reference.empty());
+}
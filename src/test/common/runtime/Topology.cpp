@@ -0,0 +1,85 @@
+#include "common/runtime/Concurrency.hpp"
+#include "common/runtime/Topology.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+using namespace std;
+using runtime::Topology;
+
+class TopologyT : public ::testing::Test {
+ protected:
+   string sysfs;
+   TopologyT() {
+      string tmp = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+      sysfs = tmp + "/sysfsXXXXXX";
+      if (!mkdtemp(&sysfs[0])) throw runtime_error("no temporary directory");
+      // 2 sockets of 2 cores with 2 SMT siblings, numbered like Linux does:
+      // the sockets interleaved, all physical cores before their siblings.
+      // The sockets are NUMA nodes 0 and 2.
+      write("cpu/online", "0-7");
+      for (size_t id = 0; id < 8; ++id) {
+         auto dir = "cpu/cpu" + to_string(id) + "/topology/";
+         write(dir + "physical_package_id", to_string(id % 2));
+         write(dir + "core_id", to_string(id / 2 % 2));
+      }
+      write("node/node0/cpulist", "0,2,4,6");
+      write("node/node2/cpulist", "1,3,5,7");
+   }
+   ~TopologyT() { system(("rm -rf " + sysfs).c_str()); }
+
+   void write(const string& file, const string& content) {
+      for (size_t pos = 0; (pos = file.find('/', pos)) != string::npos; ++pos)
+         mkdir((sysfs + "/" + file.substr(0, pos)).c_str(), 0700);
+      ofstream(sysfs + "/" + file) << content << "\n";
+   }
+};
+
+TEST_F(TopologyT, parsesLists) {
+   EXPECT_EQ(vector<size_t>({0, 1, 2, 3, 8, 10, 11}),
+             Topology::parseList("0-3,8,10-11"));
+   EXPECT_EQ(vector<size_t>(), Topology::parseList(""));
+}
+
+TEST_F(TopologyT, discoversSysfs) {
+   auto t = Topology::discover(sysfs, {});
+   ASSERT_EQ(8u, t.cpus.size());
+   EXPECT_EQ(2u, t.sockets);
+   EXPECT_EQ(2u, t.smtPerCore);
+   EXPECT_EQ(vector<size_t>({0, 2}), t.nodes);
+   for (auto& cpu : t.cpus) {
+      EXPECT_EQ(cpu.id % 2, cpu.socket);
+      EXPECT_EQ(cpu.id % 2, cpu.region);
+      EXPECT_EQ(2 * cpu.region, cpu.node);
+      EXPECT_EQ(cpu.id / 4, cpu.smt);
+   }
+   EXPECT_EQ(vector<size_t>({0, 1, 2, 3, 4, 5, 6, 7}), t.fanOutSchedule());
+   EXPECT_EQ(vector<size_t>({0, 2, 4, 6, 1, 3, 5, 7}),
+             t.consolidatedSchedule());
+}
+
+TEST_F(TopologyT, limitedToAllowedCpus) {
+   // a cpuset of the second core of each socket, 9 is offline
+   auto t = Topology::discover(sysfs, {2, 3, 6, 7, 9});
+   ASSERT_EQ(4u, t.cpus.size());
+   EXPECT_EQ(6u, t.cpus[2].id);
+   EXPECT_EQ(1u, t.cpus[2].smt);
+   EXPECT_EQ(vector<size_t>({0, 1, 2, 3}), t.fanOutSchedule());
+   EXPECT_EQ(vector<size_t>({0, 2, 1, 3}), t.consolidatedSchedule());
+   // the whole sysfs missing still leaves a CPU
+   auto none = Topology::discover(sysfs + "/missing", {});
+   ASSERT_FALSE(none.cpus.empty());
+   EXPECT_EQ(vector<size_t>({0}), none.nodes);
+}
+
+TEST_F(TopologyT, workersOfThisMachine) {
+   auto& machine = Topology::machine();
+   ASSERT_FALSE(machine.cpus.empty());
+   for (size_t w = 0; w < 2 * machine.cpus.size(); ++w) {
+      EXPECT_LT(runtime::regionOf(w), machine.nodes.size());
+      EXPECT_EQ(runtime::cpuOf(w).region, runtime::regionOf(w));
+   }
+}
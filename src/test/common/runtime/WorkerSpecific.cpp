@@ -0,0 +1,32 @@
+#include "common/runtime/Concurrency.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+TEST(WorkerSpecific, indexedByWorker) {
+   runtime::worker_specific<uint64_t> values(3);
+   auto worker = runtime::this_worker;
+   auto id = worker->worker_id;
+
+   bool exists = true;
+   worker->worker_id = 2;
+   values.local(exists) = 7;
+   EXPECT_FALSE(exists);
+   worker->worker_id = 0;
+   values.local() = 5;
+   worker->worker_id = 2;
+   EXPECT_EQ(7u, values.local(exists));
+   EXPECT_TRUE(exists);
+   worker->worker_id = 3;
+   EXPECT_THROW(values.local(), std::runtime_error);
+   worker->worker_id = id;
+
+   // only the workers' elements, each in its own cache line
+   EXPECT_EQ(nullptr, values.slot(1));
+   EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(values.slot(0)) % 64);
+   EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(values.slot(2)) % 64);
+   std::vector<uint64_t> all;
+   for (auto& v : values) all.push_back(v);
+   EXPECT_EQ(std::vector<uint64_t>({5, 7}), all);
+}
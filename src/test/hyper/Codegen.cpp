@@ -0,0 +1,190 @@
+#include "common/algebra/Operators.hpp"
+#include "common/algebra/Pipeline.hpp"
+#include "common/runtime/Types.hpp"
+#include "hyper/codegen/Compiler.hpp"
+#include "tbb/tbb.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <map>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace algebra;
+using namespace std;
+
+class CodegenT : public ::testing::Test {
+ protected:
+   /// the queries run with one worker, see run(1)
+   tbb::global_control parallelism{
+       tbb::global_control::max_allowed_parallelism, 1};
+   runtime::Relation build, probe;
+   CodegenT() {
+      // build: k = 0..9, v = 10 * k; probe: b = i % 12, x = i for 0..999
+      vector<types::Integer> k, b;
+      vector<int64_t> v, x;
+      for (int32_t i = 0; i < 10; ++i) {
+         k.push_back(i);
+         v.push_back(10 * i);
+      }
+      for (int32_t i = 0; i < 1000; ++i) {
+         b.push_back(i % 12);
+         x.push_back(i);
+      }
+      build.insert("k", make_unique<Integer>()) = move(k);
+      build.insert("v", make_unique<BigInt>()) = move(v);
+      build.nrTuples = 10;
+      probe.insert("b", make_unique<Integer>()) = move(b);
+      probe.insert("x", make_unique<BigInt>()) = move(x);
+      probe.nrTuples = 1000;
+   }
+
+   /// select b, sum(v + x), count(*) from build, probe where k = b and
+   /// x < 500 group by b
+   unique_ptr<Operator> plan() {
+      Pipeline builds, probes;
+      builds.scan(build, "build");
+      probes.scan(probe, "probe").select(
+          binary("<", attr("probe.x"), constant("500", make_unique<BigInt>())));
+      probes.hashjoin(builds, {"build.k"}, {"probe.b"})
+          .map("vx", binary("+", attr("build.v"), attr("probe.x")));
+      vector<GroupBy::Aggregate> aggregates;
+      aggregates.push_back({GroupBy::Aggregate::Sum, "sum", attr("vx")});
+      aggregates.push_back({GroupBy::Aggregate::Count, "count", nullptr});
+      probes.groupby({"probe.b"}, move(aggregates))
+          .print({"probe.b", "sum", "count"});
+      return move(probes.root);
+   }
+
+   using Groups = map<int32_t, pair<int64_t, int64_t>>;
+   /// b -> (sum, count) of the result of plan
+   static Groups groups(runtime::Query& result) {
+      auto bAttr = result.result->getAttribute("b");
+      auto sumAttr = result.result->getAttribute("sum");
+      auto countAttr = result.result->getAttribute("count");
+      Groups groups;
+      for (auto& block : *result.result) {
+         auto bs = reinterpret_cast<types::Integer*>(block.data(bAttr));
+         auto sums = reinterpret_cast<int64_t*>(block.data(sumAttr));
+         auto counts = reinterpret_cast<int64_t*>(block.data(countAttr));
+         for (size_t i = 0; i < block.size(); ++i)
+            groups[bs[i].value] = {sums[i], counts[i]};
+      }
+      return groups;
+   }
+   static Groups expected() {
+      Groups expected;
+      for (int64_t x = 0; x < 500; ++x)
+         if (x % 12 < 10) {
+            auto& g = expected[x % 12];
+            g.first += 10 * (x % 12) + x;
+            g.second++;
+         }
+      return expected;
+   }
+};
+
+/// CodegenT with a query cache in a fresh temporary directory
+class CodegenCacheT : public CodegenT {
+ protected:
+   string dir = string(getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp") +
+                "/hyperCacheXXXXXX";
+   CodegenCacheT() {
+      if (!mkdtemp(&dir[0]))
+         throw runtime_error("could not create a directory for the cache");
+   }
+   ~CodegenCacheT() {
+      if (auto d = opendir(dir.c_str())) {
+         while (auto entry = readdir(d)) {
+            if (entry->d_name[0] == '.') continue;
+            auto path = dir + "/" + entry->d_name;
+            if (unlink(path.c_str())) rmdir(path.c_str());
+         }
+         closedir(d);
+      }
+      rmdir(dir.c_str());
+   }
+
+   /// number of files in the cache directory
+   size_t files() {
+      size_t n = 0;
+      if (auto d = opendir(dir.c_str())) {
+         while (auto entry = readdir(d)) n += entry->d_name[0] != '.';
+         closedir(d);
+      }
+      return n;
+   }
+};
+
+TEST_F(CodegenCacheT, joinAndGroup) {
+   hyper::QueryCache cache(dir);
+   auto root = plan();
+   hyper::CompiledQuery query(*root, cache);
+   ASSERT_EQ(expected(), groups(*query.run(1)));
+}
+
+TEST_F(CodegenCacheT, cachedAndFallback) {
+   hyper::QueryCache cache(dir);
+   {
+      // runs the fallback until the background compile finished
+      size_t fallbacks = 0;
+      auto root = plan();
+      hyper::CompiledQuery query(*root,
+                                 [&](size_t) {
+                                    fallbacks++;
+                                    return make_unique<runtime::Query>();
+                                 },
+                                 cache);
+      query.run(1);
+      EXPECT_EQ(1u, fallbacks);
+      while (!query.ready()) this_thread::sleep_for(chrono::milliseconds(10));
+      EXPECT_EQ(expected(), groups(*query.run(1)));
+      EXPECT_EQ(1u, fallbacks);
+   }
+   // the same plan again loads the cached shared object
+   auto root = plan();
+   hyper::CompiledQuery again(*root, cache);
+   EXPECT_EQ(1u, cache.misses);
+   EXPECT_EQ(1u, cache.hits);
+   EXPECT_EQ(expected(), groups(*again.run(1)));
+   EXPECT_EQ(1u, files());
+}
+
+TEST_F(CodegenCacheT, failedCompile) {
+   // the error carries the compiler output, no files remain
+   hyper::QueryCache cache(dir);
+   try {
+      cache.get("not a query");
+      FAIL();
+   } catch (const runtime_error& e) {
+      EXPECT_NE(string(e.what()).find("error"), string::npos);
+   }
+   EXPECT_EQ(0u, files());
+}
+
+TEST_F(CodegenCacheT, privateDirectory) {
+   // other users could plant shared objects in these
+   auto shared = dir + "/shared";
+   ASSERT_EQ(0, mkdir(shared.c_str(), 0755));
+   EXPECT_THROW(hyper::QueryCache cache(shared), runtime_error);
+   auto link = dir + "/link";
+   ASSERT_EQ(0, symlink(dir.c_str(), link.c_str()));
+   EXPECT_THROW(hyper::QueryCache cache(link), runtime_error);
+   EXPECT_NO_THROW(hyper::QueryCache cache(dir + "/new"));
+}
+
+TEST_F(CodegenT, invalidPlans) {
+   vector<runtime::Relation*> relations;
+   Pipeline p;
+   p.scan(probe, "probe").print({"probe.y"});
+   EXPECT_THROW(hyper::generate(*p.root, relations), runtime_error);
+   Pipeline q;
+   q.scan(probe, "probe").select(
+       binary("<", attr("probe.x"), constant("5", make_unique<BigInt>())));
+   EXPECT_THROW(hyper::generate(*q.root, relations), runtime_error);
+   EXPECT_THROW(binary("<>", attr("probe.x"), attr("probe.x")),
+                runtime_error);
+}
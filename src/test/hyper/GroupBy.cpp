@@ -0,0 +1,63 @@
+#include "common/runtime/Concurrency.hpp"
+#include "common/runtime/Hash.hpp"
+#include "common/runtime/PartitionedDeque.hpp"
+#include "hyper/GroupBy.hpp"
+#include "tbb/tbb.h"
+#include <gtest/gtest.h>
+#include <map>
+#include <mutex>
+
+using namespace std;
+
+class GroupByT : public ::testing::Test {
+ protected:
+   using Groups = map<uint64_t, uint64_t>;
+
+   /// count the keys, all consumed by this thread
+   template <typename KEYS>
+   static Groups count(KEYS keys, size_t n, size_t& bypassed) {
+      // all workers' state is indexed by this thread's worker
+      tbb::global_control parallelism(
+          tbb::global_control::max_allowed_parallelism, 1);
+      auto groupOp = make_GroupBy<uint64_t, uint64_t, runtime::CRC32Hash>(
+          [](auto& acc, auto&& value) { acc += value; }, 0ul, 1);
+      auto locals = groupOp.preAggLocals();
+      for (size_t i = 0; i < n; ++i) locals.consume(keys(i), 1ul);
+      bypassed = groupOp.bypassed();
+      Groups groups;
+      mutex m;
+      groupOp.forallGroups([&](auto& entries) {
+         lock_guard<mutex> lock(m);
+         for (auto block : entries)
+            for (auto& entry : block) groups[entry.k] += entry.v;
+      });
+      return groups;
+   }
+};
+
+TEST_F(GroupByT, bypassesUniqueKeys) {
+   size_t bypassed;
+   auto groups = count([](size_t i) { return i; }, 500000, bypassed);
+   ASSERT_EQ(500000u, groups.size());
+   for (auto& group : groups) ASSERT_EQ(1u, group.second);
+   EXPECT_GT(bypassed, 400000u);
+}
+
+TEST_F(GroupByT, preAggregatesFewKeys) {
+   size_t bypassed;
+   auto groups = count([](size_t i) { return i % 100; }, 500000, bypassed);
+   ASSERT_EQ(100u, groups.size());
+   for (auto& group : groups) ASSERT_EQ(5000u, group.second);
+   EXPECT_EQ(0u, bypassed);
+}
+
+TEST_F(GroupByT, resumesPreAggregation) {
+   // unique keys followed by few keys, the later samples aggregate again
+   size_t bypassed;
+   auto groups = count(
+       [](size_t i) { return i < 100000 ? i + 100 : i % 100; }, 2000000,
+       bypassed);
+   ASSERT_EQ(100100u, groups.size());
+   EXPECT_GT(bypassed, 0u);
+   EXPECT_LT(bypassed, 500000u);
+}
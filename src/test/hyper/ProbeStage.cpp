@@ -0,0 +1,68 @@
+#include "common/runtime/Hash.hpp"
+#include "common/runtime/Hashmap.hpp"
+#include "common/runtime/Types.hpp"
+#include "hyper/ProbeStage.hpp"
+#include <deque>
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace runtime;
+using namespace std;
+
+class ProbeStageT : public ::testing::Test {
+ protected:
+   /// even keys 0..998 with value 3 * key
+   Hashmapx<types::Integer, int64_t, CRC32Hash> map;
+   /// keys divisible by 3 of 0..999
+   Hashset<types::Integer, CRC32Hash> set;
+   deque<decltype(map)::Entry> mapEntries;
+   deque<decltype(set)::Entry> setEntries;
+   ProbeStageT() {
+      for (int32_t k = 0; k < 1000; k += 2)
+         mapEntries.emplace_back(map.hash(k), k, 3 * k);
+      for (int32_t k = 0; k < 1000; k += 3)
+         setEntries.emplace_back(set.hash(k), k);
+      map.setSize(mapEntries.size());
+      map.insertAll(mapEntries);
+      set.setSize(setEntries.size());
+      set.insertAll(setEntries);
+   }
+};
+
+TEST_F(ProbeStageT, findsLikeFindOne) {
+   // 1000 probes are no multiple of the batch, the destructor finishes them
+   vector<int64_t> found(1000, -1);
+   {
+      auto stage = hyper::probeStage<size_t>(map, [&](size_t i, int64_t* v) {
+         ASSERT_EQ(-1, found[i]);
+         found[i] = v ? *v : 0;
+      });
+      for (int32_t i = 0; i < 1000; ++i) stage.push(types::Integer(i), i);
+   }
+   for (int32_t i = 0; i < 1000; ++i) {
+      auto v = map.findOne(types::Integer(i));
+      ASSERT_EQ(v ? *v : 0, found[i]);
+   }
+}
+
+TEST_F(ProbeStageT, chainsStages) {
+   // keys in the set and in the map, a probe of the map for each set match
+   vector<int32_t> matches;
+   auto mapStage =
+       hyper::probeStage<int32_t, 7>(map, [&](int32_t k, int64_t* v) {
+          if (v) {
+             ASSERT_EQ(3 * k, *v);
+             matches.push_back(k);
+          }
+       });
+   auto setStage = hyper::probeStage<int32_t>(set, [&](int32_t k, bool in) {
+      ASSERT_EQ(set.contains(types::Integer(k)), in);
+      if (in) mapStage.push(types::Integer(k), k);
+   });
+   for (int32_t k = 0; k < 1000; ++k) setStage.push(types::Integer(k), k);
+   setStage.flush();
+   mapStage.flush();
+   vector<int32_t> expected;
+   for (int32_t k = 0; k < 1000; k += 6) expected.push_back(k);
+   ASSERT_EQ(expected, matches);
+}
@@ -0,0 +1,43 @@
+#include "common/runtime/Types.hpp"
+#include "hyper/Selection.hpp"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+TEST(Selection, matchesScalarPredicates) {
+   // 32 and 64 bit columns, sizes with all tails of the SIMD loops
+   const size_t n = 3 * hyper::selectionBatch + 37;
+   mt19937 gen(42);
+   uniform_int_distribution<int32_t> dates(0, 99);
+   uniform_int_distribution<int64_t> prices(-50, 50);
+   vector<types::Date> date(n);
+   vector<types::Numeric<12, 2>> price(n);
+   for (size_t i = 0; i < n; ++i) {
+      date[i] = types::Date(dates(gen));
+      price[i] = types::Numeric<12, 2>(prices(gen));
+   }
+   auto inDates =
+       hyper::between(date.data(), types::Date(10), types::Date(40));
+   auto cheap = hyper::less(price.data(), types::Numeric<12, 2>(int64_t(5)));
+
+   for (size_t begin : {size_t(0), size_t(3), size_t(17)}) {
+      vector<size_t> expected, found;
+      for (size_t i = begin; i < n; ++i)
+         if (date[i].value >= 10 && date[i].value <= 40 && price[i].value < 5)
+            expected.push_back(i);
+      hyper::forEachMatch(begin, n, [&](size_t i) { found.push_back(i); },
+                          inDates, cheap);
+      ASSERT_EQ(expected, found);
+   }
+
+   uint32_t matches[16];
+   EXPECT_EQ(0u, hyper::select(0, 0, matches, inDates));
+   vector<uint32_t> all(n);
+   EXPECT_EQ(n, hyper::select(0, n, all.data(),
+                              hyper::between(date.data(), types::Date(0),
+                                             types::Date(99))));
+   for (size_t i = 0; i < n; ++i) ASSERT_EQ(i, all[i]);
+}
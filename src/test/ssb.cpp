@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <gtest/gtest.h>
 #include <map>
+#include <random>
 #include <string>
 #include <unordered_set>
 
@@ -546,3 +547,130 @@ TEST(SSB, q43) {
       checkResult(result->result.get());
    }
 }
+
+class SSBSynthetic : public ::testing::Test {
+ protected:
+   Database db;
+
+   /// Attribute::operator= sizes the column by void*, too small for Char<15>
+   template <typename T>
+   static void fill(Attribute& attribute, const vector<T>& values) {
+      auto& column = attribute.typedAccessForChange<T>();
+      column.reset(values.size());
+      for (auto value : values) column.push_back(value);
+   }
+
+   SSBSynthetic() {
+      using namespace types;
+      mt19937 rnd(42);
+      const size_t days = 3000, suppliers = 50, customers = 300,
+                   lineorders = 20000;
+      const char* regions[] = {"ASIA", "EUROPE", "AMERICA"};
+      // 4 nations per region
+      auto nation = [&](size_t region, size_t i) {
+         return Char<15>::castString(string(regions[region]).substr(0, 2) +
+                                     to_string(i % 4));
+      };
+
+      vector<Integer> d_datekey, d_year;
+      for (size_t i = 0; i < days; ++i) {
+         d_datekey.push_back(Integer(19900000 + i));
+         d_year.push_back(Integer(1990 + i / 300));
+      }
+      auto& date = db["date"];
+      fill(date.insert("d_datekey", make_unique<algebra::Integer>()),
+           d_datekey);
+      fill(date.insert("d_year", make_unique<algebra::Integer>()), d_year);
+      date.nrTuples = days;
+
+      vector<Integer> s_suppkey;
+      vector<Char<12>> s_region;
+      vector<Char<15>> s_nation;
+      for (size_t i = 0; i < suppliers; ++i) {
+         auto region = rnd() % 3;
+         s_suppkey.push_back(Integer(i));
+         s_region.push_back(Char<12>::castString(regions[region]));
+         s_nation.push_back(nation(region, i));
+      }
+      auto& supplier = db["supplier"];
+      fill(supplier.insert("s_suppkey", make_unique<algebra::Integer>()),
+           s_suppkey);
+      fill(supplier.insert("s_region", make_unique<algebra::Char>(12)),
+           s_region);
+      fill(supplier.insert("s_nation", make_unique<algebra::Char>(15)),
+           s_nation);
+      supplier.nrTuples = suppliers;
+
+      vector<Integer> c_custkey;
+      vector<Char<12>> c_region;
+      vector<Char<15>> c_nation;
+      for (size_t i = 0; i < customers; ++i) {
+         auto region = rnd() % 3;
+         c_custkey.push_back(Integer(i));
+         c_region.push_back(Char<12>::castString(regions[region]));
+         c_nation.push_back(nation(region, i));
+      }
+      auto& customer = db["customer"];
+      fill(customer.insert("c_custkey", make_unique<algebra::Integer>()),
+           c_custkey);
+      fill(customer.insert("c_region", make_unique<algebra::Char>(12)),
+           c_region);
+      fill(customer.insert("c_nation", make_unique<algebra::Char>(15)),
+           c_nation);
+      customer.nrTuples = customers;
+
+      vector<Integer> lo_orderdate, lo_custkey, lo_suppkey;
+      vector<Numeric<18, 2>> lo_revenue;
+      for (size_t i = 0; i < lineorders; ++i) {
+         lo_orderdate.push_back(d_datekey[rnd() % days]);
+         lo_custkey.push_back(Integer(rnd() % customers));
+         lo_suppkey.push_back(Integer(rnd() % suppliers));
+         lo_revenue.push_back(Numeric<18, 2>::buildRaw(100 + rnd() % 1000000));
+      }
+      auto& lo = db["lineorder"];
+      fill(lo.insert("lo_orderdate", make_unique<algebra::Integer>()),
+           lo_orderdate);
+      fill(lo.insert("lo_custkey", make_unique<algebra::Integer>()),
+           lo_custkey);
+      fill(lo.insert("lo_suppkey", make_unique<algebra::Integer>()),
+           lo_suppkey);
+      fill(lo.insert("lo_revenue", make_unique<algebra::Numeric>(18, 2)),
+           lo_revenue);
+      lo.nrTuples = lineorders;
+   }
+
+   using Q31Groups = map<tuple<types::Char<15>, types::Char<15>, types::Integer>,
+                         types::Numeric<18, 2>>;
+   /// c_nation, s_nation, d_year -> revenue of a Q3.1 result
+   static Q31Groups q31Groups(BlockRelation* result) {
+      Q31Groups g;
+      auto yearAttr = result->getAttribute("d_year");
+      auto supplierNationAttr = result->getAttribute("s_nation");
+      auto customerNationAttr = result->getAttribute("c_nation");
+      auto sumAttr = result->getAttribute("revenue");
+      for (auto& block : *result) {
+         auto c_nation =
+             reinterpret_cast<types::Char<15>*>(block.data(customerNationAttr));
+         auto s_nation =
+             reinterpret_cast<types::Char<15>*>(block.data(supplierNationAttr));
+         auto year = reinterpret_cast<types::Integer*>(block.data(yearAttr));
+         auto sum =
+             reinterpret_cast<types::Numeric<18, 2>*>(block.data(sumAttr));
+         for (size_t i = 0; i < block.size(); ++i)
+            g[make_tuple(c_nation[i], s_nation[i], year[i])] = sum[i];
+      }
+      return g;
+   }
+};
+
+TEST_F(SSBSynthetic, q31LateMaterialization) {
+   auto hyper = q31Groups(ssb::q31_hyper(db, 1)->result.get());
+   // 4 asian nations each for customer and supplier over 6 years
+   ASSERT_EQ(size_t(4 * 4 * 6), hyper.size());
+   auto eager = q31Groups(ssb::q31_vectorwise(db, 1, vectorSize)->result.get());
+   conf.lateMaterialization = true;
+   auto late = q31Groups(ssb::q31_vectorwise(db, 1, vectorSize)->result.get());
+   conf.lateMaterialization = false;
+   ASSERT_EQ(hyper, eager);
+   ASSERT_EQ(eager, late);
+}
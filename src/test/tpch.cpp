@@ -7,7 +7,11 @@
 #include <algorithm>
 #include <gtest/gtest.h>
 #include <map>
+#include <random>
+#include <regex>
+#include <sstream>
 #include <string>
+#include <tuple>
 #include <unordered_set>
 
 using namespace runtime;
@@ -345,3 +349,226 @@ TEST(TPCH, q18) {
       checkResult(result->result.get());
    }
 }
+
+/// A small random database with the columns of Q1 and Q9, on which the
+/// vectorwise plans with packed keys must find the groups of hyper.
+class TPCHSynthetic : public ::testing::Test {
+ protected:
+   Database db;
+
+   /// Attribute::operator= sizes the column by void*, too small for Char<25>
+   template <typename T>
+   static void fill(Attribute& attribute, const vector<T>& values) {
+      auto& column = attribute.typedAccessForChange<T>();
+      column.reset(values.size());
+      for (auto value : values) column.push_back(value);
+   }
+
+   TPCHSynthetic() {
+      using namespace types;
+      mt19937 rnd(42);
+      auto date = Date::castString("1992-01-01");
+      const size_t nations = 5, suppliers = 20, parts = 100, orders = 500,
+                   lineitems = 5000;
+
+      vector<Integer> n_nationkey;
+      vector<Char<25>> n_name;
+      for (size_t i = 0; i < nations; ++i) {
+         n_nationkey.push_back(Integer(i));
+         n_name.push_back(Char<25>::castString("NATION " + to_string(i)));
+      }
+      auto& nation = db["nation"];
+      fill(nation.insert("n_nationkey", make_unique<algebra::Integer>()),
+           n_nationkey);
+      fill(nation.insert("n_name", make_unique<algebra::Char>(25)), n_name);
+      nation.nrTuples = nations;
+
+      vector<Integer> s_suppkey, s_nationkey;
+      for (size_t i = 0; i < suppliers; ++i) {
+         s_suppkey.push_back(Integer(i));
+         s_nationkey.push_back(Integer(rnd() % nations));
+      }
+      auto& supplier = db["supplier"];
+      fill(supplier.insert("s_suppkey", make_unique<algebra::Integer>()),
+           s_suppkey);
+      fill(supplier.insert("s_nationkey", make_unique<algebra::Integer>()),
+           s_nationkey);
+      supplier.nrTuples = suppliers;
+
+      // every part has 4 suppliers, every third part is green
+      vector<Integer> p_partkey, ps_partkey, ps_suppkey;
+      vector<Varchar<55>> p_name;
+      vector<Numeric<12, 2>> ps_supplycost;
+      for (size_t i = 0; i < parts; ++i) {
+         p_partkey.push_back(Integer(i));
+         p_name.push_back(
+             Varchar<55>::castString(i % 3 ? "plain part" : "forest green"));
+         for (size_t s = 0; s < 4; ++s) {
+            ps_partkey.push_back(Integer(i));
+            ps_suppkey.push_back(Integer((i + s * 5) % suppliers));
+            ps_supplycost.push_back(
+                Numeric<12, 2>::buildRaw(100 + rnd() % 10000));
+         }
+      }
+      auto& part = db["part"];
+      fill(part.insert("p_partkey", make_unique<algebra::Integer>()),
+           p_partkey);
+      fill(part.insert("p_name", make_unique<algebra::Varchar>(55)), p_name);
+      part.nrTuples = parts;
+      auto& partsupp = db["partsupp"];
+      fill(partsupp.insert("ps_partkey", make_unique<algebra::Integer>()),
+           ps_partkey);
+      fill(partsupp.insert("ps_suppkey", make_unique<algebra::Integer>()),
+           ps_suppkey);
+      fill(partsupp.insert("ps_supplycost",
+                           make_unique<algebra::Numeric>(12, 2)),
+           ps_supplycost);
+      partsupp.nrTuples = parts * 4;
+
+      vector<Integer> o_orderkey;
+      vector<Date> o_orderdate;
+      for (size_t i = 0; i < orders; ++i) {
+         o_orderkey.push_back(Integer(i));
+         o_orderdate.push_back(Date(date.value + rnd() % 2500));
+      }
+      auto& order = db["orders"];
+      fill(order.insert("o_orderkey", make_unique<algebra::Integer>()),
+           o_orderkey);
+      fill(order.insert("o_orderdate", make_unique<algebra::Date>()),
+           o_orderdate);
+      order.nrTuples = orders;
+
+      vector<Integer> l_orderkey, l_partkey, l_suppkey;
+      vector<Char<1>> l_returnflag, l_linestatus;
+      vector<Numeric<12, 2>> l_quantity, l_extendedprice, l_discount, l_tax;
+      vector<Date> l_shipdate;
+      for (size_t i = 0; i < lineitems; ++i) {
+         auto p = rnd() % parts;
+         l_orderkey.push_back(Integer(rnd() % orders));
+         l_partkey.push_back(Integer(p));
+         l_suppkey.push_back(Integer((p + rnd() % 4 * 5) % suppliers));
+         l_returnflag.push_back(
+             Char<1>::castString(string(1, "ANR"[rnd() % 3])));
+         l_linestatus.push_back(
+             Char<1>::castString(string(1, "FO"[rnd() % 2])));
+         l_quantity.push_back(Numeric<12, 2>::buildRaw(100 * (1 + rnd() % 50)));
+         l_extendedprice.push_back(
+             Numeric<12, 2>::buildRaw(100 + rnd() % 1000000));
+         l_discount.push_back(Numeric<12, 2>::buildRaw(rnd() % 11));
+         l_tax.push_back(Numeric<12, 2>::buildRaw(rnd() % 9));
+         l_shipdate.push_back(Date(date.value + rnd() % 2500));
+      }
+      auto& li = db["lineitem"];
+      fill(li.insert("l_orderkey", make_unique<algebra::Integer>()),
+           l_orderkey);
+      fill(li.insert("l_partkey", make_unique<algebra::Integer>()), l_partkey);
+      fill(li.insert("l_suppkey", make_unique<algebra::Integer>()), l_suppkey);
+      fill(li.insert("l_returnflag", make_unique<algebra::Char>(1)),
+           l_returnflag);
+      fill(li.insert("l_linestatus", make_unique<algebra::Char>(1)),
+           l_linestatus);
+      fill(li.insert("l_quantity", make_unique<algebra::Numeric>(12, 2)),
+           l_quantity);
+      fill(li.insert("l_extendedprice", make_unique<algebra::Numeric>(12, 2)),
+           l_extendedprice);
+      fill(li.insert("l_discount", make_unique<algebra::Numeric>(12, 2)),
+           l_discount);
+      fill(li.insert("l_tax", make_unique<algebra::Numeric>(12, 2)), l_tax);
+      fill(li.insert("l_shipdate", make_unique<algebra::Date>()), l_shipdate);
+      li.nrTuples = lineitems;
+   }
+
+   using Q1Groups = map<tuple<types::Char<1>, types::Char<1>>,
+                        tuple<types::Numeric<12, 2>, types::Numeric<12, 2>,
+                              types::Numeric<12, 4>, types::Numeric<12, 6>,
+                              int64_t>>;
+   /// returnflag, linestatus -> aggregates of a Q1 result
+   static Q1Groups q1Groups(BlockRelation* result) {
+      using namespace types;
+      Q1Groups g;
+      auto retAttr = result->getAttribute("l_returnflag");
+      auto statusAttr = result->getAttribute("l_linestatus");
+      auto qtyAttr = result->getAttribute("sum_qty");
+      auto base_priceAttr = result->getAttribute("sum_base_price");
+      auto disc_priceAttr = result->getAttribute("sum_disc_price");
+      auto chargeAttr = result->getAttribute("sum_charge");
+      auto count_orderAttr = result->getAttribute("count_order");
+      for (auto& block : *result) {
+         auto ret = reinterpret_cast<Char<1>*>(block.data(retAttr));
+         auto status = reinterpret_cast<Char<1>*>(block.data(statusAttr));
+         auto qty = reinterpret_cast<Numeric<12, 2>*>(block.data(qtyAttr));
+         auto base_price =
+             reinterpret_cast<Numeric<12, 2>*>(block.data(base_priceAttr));
+         auto disc_price =
+             reinterpret_cast<Numeric<12, 4>*>(block.data(disc_priceAttr));
+         auto charge =
+             reinterpret_cast<Numeric<12, 6>*>(block.data(chargeAttr));
+         auto count_order =
+             reinterpret_cast<int64_t*>(block.data(count_orderAttr));
+         for (size_t i = 0; i < block.size(); ++i)
+            g[make_tuple(ret[i], status[i])] =
+                make_tuple(qty[i], base_price[i], disc_price[i], charge[i],
+                           count_order[i]);
+      }
+      return g;
+   }
+
+   using Q9Groups =
+       map<tuple<types::Char<25>, types::Integer>, types::Numeric<12, 4>>;
+   /// nation, year -> profit of a Q9 result
+   static Q9Groups q9Groups(BlockRelation* result) {
+      Q9Groups g;
+      auto nationAttr = result->getAttribute("nation");
+      auto o_yearAttr = result->getAttribute("o_year");
+      auto sum_profitAttr = result->getAttribute("sum_profit");
+      for (auto& block : *result) {
+         auto nation =
+             reinterpret_cast<types::Char<25>*>(block.data(nationAttr));
+         auto o_year =
+             reinterpret_cast<types::Integer*>(block.data(o_yearAttr));
+         auto sum_profit = reinterpret_cast<types::Numeric<12, 4>*>(
+             block.data(sum_profitAttr));
+         for (size_t i = 0; i < block.size(); ++i)
+            g[make_tuple(nation[i], o_year[i])] = sum_profit[i];
+      }
+      return g;
+   }
+};
+
+TEST_F(TPCHSynthetic, q1PackedKeys) {
+   auto hyper = q1Groups(q1_hyper(db, 1)->result.get());
+   ASSERT_EQ(size_t(6), hyper.size());
+   ASSERT_EQ(hyper, q1Groups(q1_vectorwise(db, 1, vectorSize)->result.get()));
+}
+
+TEST_F(TPCHSynthetic, q9PackedKeys) {
+   auto hyper = q9Groups(q9_hyper(db, 1)->result.get());
+   ASSERT_GT(hyper.size(), size_t(10));
+   ASSERT_EQ(hyper, q9Groups(q9_vectorwise(db, 1, vectorSize)->result.get()));
+}
+
+TEST_F(TPCHSynthetic, analyzedQueries) {
+   // the drivers read the results of profiled plans like of plain ones
+   auto q1 = q1Groups(q1_hyper(db, 1)->result.get());
+   auto q6 = q6_hyper(db, 1);
+   auto q9 = q9Groups(q9_hyper(db, 1)->result.get());
+   vectorwise::analyze = true;
+   ASSERT_EQ(q1, q1Groups(q1_vectorwise(db, 1, vectorSize)->result.get()));
+   auto q1Stats = vectorwise::takeAnalyzedPlan();
+   auto revenue = q6_vectorwise(db, 1, vectorSize);
+   ASSERT_EQ(q9, q9Groups(q9_vectorwise(db, 1, vectorSize)->result.get()));
+   vectorwise::analyze = false;
+
+   ASSERT_EQ(size_t(1), revenue.nrTuples);
+   ASSERT_EQ(q6["revenue"].data<int64_t>()[0],
+             revenue["revenue"].data<int64_t>()[0]);
+   ASSERT_NE(nullptr, q1Stats);
+   ostringstream tree;
+   q1Stats->print(tree);
+   // the groups of all workers are counted as hash table entries
+   ASSERT_TRUE(regex_search(tree.str(), regex("HashGroup  tuples 6 .*"
+                                              "ht entries 6 .*"
+                                              "preaggregated groups 6")))
+       << tree.str();
+   ASSERT_NE(nullptr, vectorwise::takeAnalyzedPlan());
+}
@@ -3,12 +3,20 @@
 #include "common/runtime/Concurrency.hpp"
 #include "common/runtime/Import.hpp"
 #include "common/runtime/MemoryPool.hpp"
+#include "common/runtime/Spill.hpp"
 #include "common/runtime/Types.hpp"
+#include "vectorwise/PlanLoader.hpp"
 #include "vectorwise/Primitives.hpp"
 #include "vectorwise/Query.hpp"
 #include "vectorwise/QueryBuilder.hpp"
+#include "tbb/tbb.h"
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <map>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <sstream>
 #include <unordered_set>
 #include <vector>
 
@@ -237,6 +245,46 @@ TEST(Join, simpleJoinWithResultOverflow) {
    ASSERT_EQ(expectedKeys.size(), found);
 }
 
+TEST(Join, buildBeyondSpillBudget) {
+   /// Tests if join finds the ht entries placed in file backed memory
+   const int32_t n = 5000;
+   runtime::Database db;
+   vector<int32_t> k, v, b;
+   for (int32_t i = 0; i < n; ++i) {
+      k.push_back(i);
+      v.push_back(i + 100000);
+   }
+   for (int32_t i = 0; i < 2 * n; ++i) b.push_back(i);
+   db["build"].insert("k", make_unique<algebra::Integer>()) = move(k);
+   db["build"].insert("v", make_unique<algebra::Integer>()) = move(v);
+   db["probe"].insert("b", make_unique<algebra::Integer>()) = move(b);
+   db["build"].nrTuples = n;
+   db["probe"].nrTuples = 2 * n;
+
+   // only the first build vector fits into the budget
+   runtime::ScopedSpillBudget budget(1);
+   auto inMemory = runtime::spillableBytes.load();
+   SimpleJoinBuilder builder(db);
+   auto query = builder.getQuery();
+   vector<int32_t> keys;
+   while (auto m = query->rootOp->next()) {
+      ASSERT_LT(runtime::spillableBytes - inMemory,
+                n * sizeof(runtime::Hashmap::EntryHeader));
+      auto join = dynamic_cast<Hashjoin*>(query->rootOp.get());
+      ASSERT_NE(nullptr, join);
+      for (size_t i = 0; i < m; ++i) {
+         auto key = *addBytes(reinterpret_cast<int32_t*>(join->buildMatches[i]),
+                              sizeof(runtime::Hashmap::EntryHeader));
+         ASSERT_EQ(key + 100000, query->r[i]);
+         keys.push_back(key);
+      }
+   }
+   // every build tuple matches exactly one probe tuple
+   sort(keys.begin(), keys.end());
+   ASSERT_EQ(size_t(n), keys.size());
+   for (int32_t i = 0; i < n; ++i) ASSERT_EQ(i, keys[i]);
+}
+
 struct JoinBuildSelectBuilder : public Query, private vectorwise::QueryBuilder {
    enum { buildValue, sel_key, probe_matches };
    struct Result {
@@ -312,8 +360,10 @@ struct ProbeSelectBuilder : public Query, private vectorwise::QueryBuilder {
       std::unique_ptr<vectorwise::Operator> rootOp;
    };
    runtime::GlobalPool pool;
-   ProbeSelectBuilder(runtime::Database& db, size_t v = 1024)
-       : Query(), QueryBuilder(db, shared, v) {
+   pos_t (Hashjoin::*join)();
+   ProbeSelectBuilder(runtime::Database& db, size_t v = 1024,
+                      pos_t (Hashjoin::*j)() = &Hashjoin::joinSelParallel)
+       : Query(), QueryBuilder(db, shared, v), join(j) {
       previous = runtime::this_worker->allocator.setSource(&pool);
    }
    unique_ptr<Result> getQuery() {
@@ -324,7 +374,7 @@ struct ProbeSelectBuilder : public Query, private vectorwise::QueryBuilder {
                                 Buffer(sel_probe, sizeof(pos_t)),
                                 Column(probe, "b"), Value(&r->bound)));
       HashJoin(Buffer(probe_matches, sizeof(pos_t)))
-          .setProbeSelVector(Buffer(sel_probe))
+          .setProbeSelVector(Buffer(sel_probe), join)
           .addBuildKey(Column(build, "k"), primitives::hash_int64_t_col,
                        primitives::scatter_int64_t_col)
           .addProbeKey(Column(probe, "b"), Buffer(sel_probe),
@@ -398,6 +448,208 @@ TEST(Join, joinProbeSelectionAndResultOverflow) {
    ASSERT_EQ(expectedKeys.size(), found);
 }
 
+TEST(Join, adaptiveJoin) {
+   runtime::Database db;
+   db["build"].insert("k", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{1, 1, 1, 3, 4, 8};
+   std::vector<int64_t> b;
+   for (int64_t i = 0; i < 3000; ++i) b.push_back(i % 10);
+   db["probe"].insert("b", make_unique<algebra::BigInt>()) = move(b);
+   db["build"].nrTuples = 6;
+   db["probe"].nrTuples = 3000;
+
+   ProbeSelectBuilder builder(db, 8, &Hashjoin::joinAdaptive);
+   auto query = builder.getQuery();
+   auto join = dynamic_cast<Hashjoin*>(query->rootOp.get());
+   ASSERT_NE(nullptr, join);
+   std::map<int64_t, size_t> matches;
+   while (auto n = query->rootOp->next()) {
+      ASSERT_LE(n, pos_t(8));
+      for (size_t i = 0; i < n; ++i)
+         matches[*addBytes(reinterpret_cast<int64_t*>(join->buildMatches[i]),
+                           sizeof(runtime::Hashmap::EntryHeader))]++;
+   }
+   // every probe tuple with b = 1 matches three build tuples
+   std::map<int64_t, size_t> expected = {{1, 900}, {3, 300}};
+   ASSERT_EQ(expected, matches);
+
+   // the decisions are logged, all candidates were explored
+   OperatorStats stats;
+   join->addStats(stats);
+   ASSERT_EQ(1200u, stats.notes["probes"]);
+   ASSERT_EQ(1200u, stats.notes["hash matches"]);
+   ASSERT_LT(0u, stats.notes["vectors joinSel"]);
+   ASSERT_LT(0u, stats.notes["vectors joinSelParallel"]);
+}
+
+class LateMaterializationT : public ::testing::Test,
+                             public Query,
+                             public QueryBuilder {
+
+ protected:
+   runtime::Database db;
+   runtime::GlobalPool pool;
+   LateMaterializationT() : Query(), QueryBuilder(db, shared, 4) {
+      previous = runtime::this_worker->allocator.setSource(&pool);
+   };
+};
+
+TEST_F(LateMaterializationT, fetchAfterSelect) {
+   enum { probe_matches, entries, build_v, probe_b, sel_b, fetched_v };
+   db["build"].insert("k", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{1, 3, 4, 8};
+   db["build"].insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{101, 103, 104, 108};
+   db["probe"].insert("b", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{88, 1, 1, 17, 4, 1, 3, 8, 4};
+   db["build"].nrTuples = 4;
+   db["probe"].nrTuples = 9;
+
+   auto build = Scan("build");
+   auto probe = Scan("probe");
+   auto join =
+       HashJoin(Buffer(probe_matches, sizeof(pos_t)))
+           .setLateMaterialization(
+               Buffer(entries, sizeof(runtime::Hashmap::EntryHeader*)))
+           .addBuildKey(Column(build, "k"), primitives::hash_int64_t_col,
+                        primitives::scatter_int64_t_col)
+           .addProbeKey(Column(probe, "b"), primitives::hash_int64_t_col,
+                        primitives::keys_equal_int64_t_col)
+           .addBuildValue(Column(build, "v"), primitives::scatter_int64_t_col,
+                          Buffer(build_v, sizeof(int64_t)),
+                          primitives::gather_col_int64_t_col)
+           .join;
+   // the join itself loads no build values
+   ASSERT_TRUE(join->buildGather.ops.empty());
+   int64_t zero = 0, two = 2;
+   Project().addExpression(
+       Expression().addOp(primitives::proj_sel_plus_int64_t_col_int64_t_val,
+                          Buffer(probe_matches),
+                          Buffer(probe_b, sizeof(int64_t)),
+                          Column(probe, "b"), Value(&zero)));
+   Select(Expression().addOp(primitives::sel_greater_int64_t_col_int64_t_val,
+                             Buffer(sel_b, sizeof(pos_t)), Buffer(probe_b),
+                             Value(&two)));
+   Fetch(Buffer(sel_b))
+       .addValue(Buffer(build_v), primitives::gather_sel_col_int64_t_col,
+                 Buffer(fetched_v, sizeof(int64_t)));
+
+   auto root = popOperator();
+   std::multiset<std::tuple<int64_t, int64_t>> result;
+   while (auto n = root->next()) {
+      auto b = (int64_t*)Buffer(probe_b).data;
+      auto sel = (pos_t*)Buffer(sel_b).data;
+      auto v = (int64_t*)Buffer(fetched_v).data;
+      for (size_t i = 0; i < n; ++i) result.emplace(b[sel[i]], v[i]);
+   }
+   std::multiset<std::tuple<int64_t, int64_t>> expected = {
+       {4, 104}, {3, 103}, {8, 108}, {4, 104}};
+   ASSERT_EQ(expected, result);
+}
+
+class MergeJoinT : public ::testing::Test, public Query, public QueryBuilder {
+
+ protected:
+   enum { probe_matches, sel_build, sel_probe, build_k, build_v, probe_b };
+   runtime::Database db;
+   runtime::GlobalPool pool;
+   int64_t zero = 0;
+   MergeJoinT() : Query(), QueryBuilder(db, shared, 4) {
+      previous = runtime::this_worker->allocator.setSource(&pool);
+   };
+
+   /// run plan on top of the join and collect (probe b, build k, build v)
+   std::multiset<std::tuple<int64_t, int64_t, int64_t>> run(ScanBuilder& p) {
+      Project().addExpression(
+          Expression().addOp(primitives::proj_sel_plus_int64_t_col_int64_t_val,
+                             Buffer(probe_matches),
+                             Buffer(probe_b, sizeof(int64_t)),
+                             Column(p, "b"), Value(&zero)));
+      auto root = popOperator();
+      std::multiset<std::tuple<int64_t, int64_t, int64_t>> result;
+      while (auto n = root->next()) {
+         EXPECT_LE(n, size_t(4));
+         auto b = (int64_t*)Buffer(probe_b).data;
+         auto k = (int64_t*)Buffer(build_k).data;
+         auto v = (int64_t*)Buffer(build_v).data;
+         for (size_t i = 0; i < n; ++i) result.emplace(b[i], k[i], v[i]);
+      }
+      return result;
+   }
+};
+
+TEST_F(MergeJoinT, sortedOneToMany) {
+   db["build"].insert("k", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{1, 1, 1, 1, 1, 3, 4, 8, 8, 20, 21, 22, 23, 40};
+   db["build"].insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+   db["probe"].insert("b", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 8, 8, 23, 39, 40, 41};
+   db["build"].nrTuples = 14;
+   db["probe"].nrTuples = 9;
+
+   auto build = Scan("build");
+   auto probe = Scan("probe");
+   MergeJoin(Buffer(probe_matches, sizeof(pos_t)))
+       .addBuildKey(Column(build, "k"), primitives::normalize_sel_int64_t_col)
+       .addProbeKey(Column(probe, "b"), primitives::normalize_sel_int64_t_col)
+       .addBuildValue(Column(build, "k"), primitives::scatter_int64_t_col,
+                      Buffer(build_k, sizeof(int64_t)),
+                      primitives::gather_col_int64_t_col)
+       .addBuildValue(Column(build, "v"), primitives::scatter_int64_t_col,
+                      Buffer(build_v, sizeof(int64_t)),
+                      primitives::gather_col_int64_t_col);
+
+   std::multiset<std::tuple<int64_t, int64_t, int64_t>> expected = {
+       {1, 1, 0},  {1, 1, 1},   {1, 1, 2},   {1, 1, 3},
+       {1, 1, 4},  {8, 8, 7},   {8, 8, 8},   {8, 8, 7},
+       {8, 8, 8},  {23, 23, 12}, {40, 40, 13}};
+   ASSERT_EQ(expected, run(probe));
+}
+
+TEST_F(MergeJoinT, unsortedWithSelections) {
+   db["build"].insert("k", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{7, -3, 5, 7, 2, 9, -3, 5};
+   db["build"].insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7};
+   db["probe"].insert("b", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{9, 5, -3, 100, 7, 5, 2};
+   db["build"].nrTuples = 8;
+   db["probe"].nrTuples = 7;
+   int64_t buildBound = 6, probeBound = 50;
+
+   // build rows with v < 6 join probe rows with b < 50 on k = b
+   auto build = Scan("build");
+   Select(Expression().addOp(primitives::sel_less_int64_t_col_int64_t_val,
+                             Buffer(sel_build, sizeof(pos_t)),
+                             Column(build, "v"), Value(&buildBound)));
+   auto probe = Scan("probe");
+   Select(Expression().addOp(primitives::sel_less_int64_t_col_int64_t_val,
+                             Buffer(sel_probe, sizeof(pos_t)),
+                             Column(probe, "b"), Value(&probeBound)));
+   MergeJoin(Buffer(probe_matches, sizeof(pos_t)))
+       .setProbeSelVector(Buffer(sel_probe))
+       .addBuildKey(Column(build, "k"), Buffer(sel_build),
+                    primitives::normalize_sel_int64_t_col)
+       .addProbeKey(Column(probe, "b"), Buffer(sel_probe),
+                    primitives::normalize_sel_int64_t_col)
+       .addBuildValue(Column(build, "v"), Buffer(sel_build),
+                      primitives::scatter_sel_int64_t_col,
+                      Buffer(build_v, sizeof(int64_t)),
+                      primitives::gather_col_int64_t_col)
+       .addBuildValue(Column(build, "v"), Buffer(sel_build),
+                      primitives::scatter_sel_int64_t_col,
+                      Buffer(build_k, sizeof(int64_t)),
+                      primitives::gather_col_int64_t_col);
+
+   // build values identify the keys: v 0, 3 -> 7; 1 -> -3; 2 -> 5; 4 -> 2;
+   // 5 -> 9
+   std::multiset<std::tuple<int64_t, int64_t, int64_t>> expected = {
+       {9, 5, 5}, {5, 2, 2}, {-3, 1, 1}, {7, 0, 0},
+       {7, 3, 3}, {5, 2, 2}, {2, 4, 4}};
+   ASSERT_EQ(expected, run(probe));
+}
+
 class HashGroupT : public ::testing::Test, public Query, public QueryBuilder {
 
  protected:
@@ -467,6 +719,819 @@ TEST_F(HashGroupT, simpleGroup) {
    ASSERT_EQ(found, size_t(5));
 }
 
+TEST_F(HashGroupT, spilledGroup) {
+   enum { grouped_k, aggregated_v };
+   const int64_t n = 20000;
+   auto& rel = db["t"];
+   std::vector<int64_t> keys, values;
+   for (int64_t i = 0; i < n; ++i) {
+      keys.push_back(i % (n / 2));
+      values.push_back(i);
+   }
+   rel.insert("k", make_unique<algebra::BigInt>()) = move(keys);
+   rel.insert("v", make_unique<algebra::BigInt>()) = move(values);
+   rel.nrTuples = n;
+
+   auto t = Scan("t");
+   HashGroup()
+       .addKey(Column(t, "k"), primitives::hash_int64_t_col,
+               primitives::keys_not_equal_int64_t_col,
+               primitives::partition_by_key_int64_t_col,
+               primitives::scatter_sel_int64_t_col,
+               primitives::keys_not_equal_row_int64_t_col,
+               primitives::partition_by_key_row_int64_t_col,
+               primitives::scatter_sel_row_int64_t_col,
+               primitives::gather_val_int64_t_col,
+               Buffer(grouped_k, sizeof(int64_t)))
+       .addValue(Column(t, "v"), primitives::aggr_init_plus_int64_t_col,
+                 primitives::aggr_plus_int64_t_col,
+                 primitives::aggr_row_plus_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(aggregated_v, sizeof(int64_t)));
+
+   runtime::ScopedSpillBudget budget(1); // spill every full partition chunk
+   auto root = popOperator();
+   size_t found = 0;
+   while (auto m = root->next()) {
+      found += m;
+      auto k = (int64_t*)Buffer(grouped_k).data;
+      auto v = (int64_t*)Buffer(aggregated_v).data;
+      // each group k sums the values k and k + n / 2
+      for (size_t i = 0; i < m; ++i) ASSERT_EQ(v[i], 2 * k[i] + n / 2);
+   }
+   ASSERT_EQ(found, size_t(n / 2));
+}
+
+TEST_F(HashGroupT, packedKeyGroup) {
+
+   enum { packed, grouped_packed, aggregated_v };
+   auto& rel = db["t"];
+   rel.insert("k1", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{1, 1, 1, 1, 1, 3, 4, 8};
+   rel.insert("k2", make_unique<algebra::Integer>()) =
+       std::vector<int32_t>{1, 2, 1, 1, 2, 9, 17, 4};
+   rel.insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{4, 8, 16, 1, 2, 3, 17, 4};
+   rel.nrTuples = 8;
+
+   auto t = Scan("t");
+   auto keys = PackKeys(Buffer(packed, sizeof(primitives::packed128)));
+   keys.addKey(Column(t, "k1"), primitives::pack_int64_t_col_packed128)
+       .addKey(Column(t, "k2"), primitives::pack_int32_t_col_packed128);
+   HashGroup()
+       .addKey(Buffer(packed), primitives::hash_packed128_col,
+               primitives::keys_not_equal_packed128_col,
+               primitives::partition_by_key_packed128_col,
+               primitives::scatter_sel_packed128_col,
+               primitives::keys_not_equal_row_packed128_col,
+               primitives::partition_by_key_row_packed128_col,
+               primitives::scatter_sel_row_packed128_col,
+               primitives::gather_val_packed128_col,
+               Buffer(grouped_packed, sizeof(primitives::packed128)))
+       .addValue(Column(t, "v"), primitives::aggr_init_plus_int64_t_col,
+                 primitives::aggr_plus_int64_t_col,
+                 primitives::aggr_row_plus_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(aggregated_v, sizeof(int64_t)));
+   ASSERT_EQ(keys.shift(0), size_t(0));
+   ASSERT_EQ(keys.shift(1), size_t(64));
+   std::map<std::tuple<int64_t, int32_t>, int64_t> expectedGroups = {
+       {make_tuple(1, 1), 21},
+       {make_tuple(1, 2), 10},
+       {make_tuple(3, 9), 3},
+       {make_tuple(4, 17), 17},
+       {make_tuple(8, 4), 4}};
+
+   auto root = popOperator();
+   size_t found = 0;
+   std::vector<int64_t> keys1(vecs.getVecSize());
+   std::vector<int32_t> keys2(vecs.getVecSize());
+   while (auto n = root->next()) {
+      found += n;
+      auto groups = Buffer(grouped_packed).data;
+      primitives::unpack_int64_t_col_packed128(n, keys1.data(), groups,
+                                               keys.shift(0));
+      primitives::unpack_int32_t_col_packed128(n, keys2.data(), groups,
+                                               keys.shift(1));
+      auto aggrs = (int64_t*)Buffer(aggregated_v).data;
+      for (size_t i = 0; i < n; ++i) {
+         int64_t ex = expectedGroups[std::make_tuple(keys1[i], keys2[i])];
+         ASSERT_EQ(aggrs[i], ex);
+      }
+   }
+   ASSERT_EQ(found, size_t(5));
+}
+
+class FusedT : public ::testing::Test, public Query, public QueryBuilder {
+
+ protected:
+   runtime::Database db;
+   runtime::GlobalPool pool;
+   enum { sel, minus, disc_price, plus, charge, revenue };
+   int64_t bound = 5, one = 100, sumCharge = 0, sumRevenue = 0;
+   FusedT() : Query(), QueryBuilder(db, shared) {
+      previous = runtime::this_worker->allocator.setSource(&pool);
+      auto& rel = db["t"];
+      rel.insert("a", make_unique<algebra::BigInt>()) =
+          std::vector<int64_t>{1, 7, 3, 9, 4, 2, 8, 0};
+      rel.insert("price", make_unique<algebra::BigInt>()) =
+          std::vector<int64_t>{10, 20, 30, 40, 50, 60, 70, 80};
+      rel.insert("disc", make_unique<algebra::BigInt>()) =
+          std::vector<int64_t>{1, 2, 3, 4, 5, 6, 7, 8};
+      rel.insert("tax", make_unique<algebra::BigInt>()) =
+          std::vector<int64_t>{2, 2, 2, 2, 4, 4, 4, 4};
+      rel.nrTuples = 8;
+   };
+
+   /// Q1/Q6 style plan: select, projections, aggregation
+   std::unique_ptr<Operator> plan() {
+      auto t = Scan("t");
+      Select(Expression().addOp(primitives::sel_less_int64_t_col_int64_t_val,
+                                Buffer(sel, sizeof(pos_t)), Column(t, "a"),
+                                Value(&bound)));
+      Project()
+          .addExpression(
+              Expression()
+                  .addOp(primitives::proj_sel_minus_int64_t_val_int64_t_col,
+                         Buffer(sel), Buffer(minus, sizeof(int64_t)),
+                         Value(&one), Column(t, "disc"))
+                  .addOp(primitives::proj_multiplies_sel_int64_t_col_int64_t_col,
+                         Buffer(sel), Buffer(disc_price, sizeof(int64_t)),
+                         Column(t, "price"), Buffer(minus)))
+          .addExpression(
+              Expression()
+                  .addOp(primitives::proj_sel_plus_int64_t_col_int64_t_val,
+                         Buffer(sel), Buffer(plus, sizeof(int64_t)),
+                         Column(t, "tax"), Value(&one))
+                  .addOp(primitives::proj_multiplies_int64_t_col_int64_t_col,
+                         Buffer(charge, sizeof(int64_t)), Buffer(disc_price),
+                         Buffer(plus)));
+      FixedAggregation(
+          Expression()
+              .addOp(primitives::aggr_static_plus_int64_t_col,
+                     Value(&sumCharge), Buffer(charge))
+              .addOp(primitives::proj_sel_both_multiplies_int64_t_col_int64_t_col,
+                     Buffer(sel), Buffer(revenue, sizeof(int64_t)),
+                     Column(t, "price"), Column(t, "disc"))
+              .addOp(primitives::aggr_static_plus_int64_t_col,
+                     Value(&sumRevenue), Buffer(revenue)));
+      return popOperator();
+   }
+
+   void verify(Operator& root) {
+      ASSERT_EQ(size_t(1), root.next());
+      // rows with a < 5: 0, 2, 4, 5, 7
+      int64_t expectedCharge = 10 * 99 * 102 + 30 * 97 * 102 +
+                               50 * 95 * 104 + 60 * 94 * 104 + 80 * 92 * 104;
+      int64_t expectedRevenue = 10 * 1 + 30 * 3 + 50 * 5 + 60 * 6 + 80 * 8;
+      ASSERT_EQ(expectedCharge, sumCharge);
+      ASSERT_EQ(expectedRevenue, sumRevenue);
+   }
+};
+
+static size_t countFused(Aggregates& aggregates) {
+   size_t fused = 0;
+   for (auto& op : aggregates.ops)
+      if (auto f = dynamic_cast<FusedOp*>(op.get())) fused += !f->materialize;
+   return fused;
+}
+
+TEST_F(FusedT, selectProjectAggregate) {
+   auto root = plan();
+   auto& aggr = dynamic_cast<FixedAggr&>(*root);
+   auto& project = dynamic_cast<vectorwise::Project&>(*aggr.child);
+   ASSERT_EQ(size_t(1), countFused(aggr.aggregates));
+   for (auto& exp : project.expressions) {
+      ASSERT_EQ(size_t(1), exp->ops.size());
+      ASSERT_NE(nullptr, dynamic_cast<FusedOp*>(exp->ops[0].get()));
+   }
+   verify(*root);
+}
+
+TEST_F(FusedT, intermediateReadLater) {
+   auto root = plan();
+   // reading an intermediate again falls back to the unfused primitives
+   Buffer(minus);
+   Buffer(revenue);
+   auto& aggr = dynamic_cast<FixedAggr&>(*root);
+   ASSERT_EQ(size_t(0), countFused(aggr.aggregates));
+   verify(*root);
+}
+
+TEST_F(FusedT, selfAliasedIntermediate) {
+   // plus * plus reads the intermediate twice, only one read can be fused
+   auto t = Scan("t");
+   Select(Expression().addOp(primitives::sel_less_int64_t_col_int64_t_val,
+                             Buffer(sel, sizeof(pos_t)), Column(t, "a"),
+                             Value(&bound)));
+   Project().addExpression(
+       Expression()
+           .addOp(primitives::proj_sel_plus_int64_t_col_int64_t_val,
+                  Buffer(sel), Buffer(plus, sizeof(int64_t)),
+                  Column(t, "tax"), Value(&one))
+           .addOp(primitives::proj_multiplies_int64_t_col_int64_t_col,
+                  Buffer(charge, sizeof(int64_t)), Buffer(plus),
+                  Buffer(plus)));
+   FixedAggregation(Expression().addOp(primitives::aggr_static_plus_int64_t_col,
+                                       Value(&sumCharge), Buffer(charge)));
+   auto root = popOperator();
+   auto& aggr = dynamic_cast<FixedAggr&>(*root);
+   auto& project = dynamic_cast<vectorwise::Project&>(*aggr.child);
+   ASSERT_EQ(size_t(2), project.expressions[0]->ops.size());
+   ASSERT_EQ(size_t(1), root->next());
+   // rows with a < 5 have tax 2, 2, 4, 4, 4
+   ASSERT_EQ(2 * 102 * 102 + 3 * 104 * 104, sumCharge);
+}
+
+class AdaptiveSelectT : public ::testing::Test {
+ protected:
+   runtime::Database db;
+   runtime::GlobalPool pool;
+   int64_t bound = 0, sum = 0;
+   AdaptiveSelectT() {
+      auto& rel = db["t"];
+      std::vector<int64_t> a, b;
+      for (int64_t i = 0; i < 300; ++i) {
+         a.push_back((i * 37) % 100);
+         b.push_back(i);
+      }
+      rel.insert("a", make_unique<algebra::BigInt>()) = move(a);
+      rel.insert("b", make_unique<algebra::BigInt>()) = move(b);
+      rel.nrTuples = 300;
+   };
+
+   int64_t expected() {
+      int64_t r = 0;
+      for (int64_t i = 0; i < 300; ++i)
+         if ((i * 37) % 100 < bound) r += i * 2;
+      return r;
+   }
+
+   /// sum(b + b) where a < bound, the condition is a bitmap or a list
+   struct Plan : public Query, public QueryBuilder {
+      enum { bitmap, sel, sum };
+      const SelectionKind* kind;
+      std::unique_ptr<Operator> root;
+      Plan(AdaptiveSelectT& test, bool bitmapCondition)
+          : Query(), QueryBuilder(test.db, shared) {
+         previous = runtime::this_worker->allocator.setSource(&test.pool);
+         auto t = Scan("t");
+         std::unique_ptr<vectorwise::Expression> condition;
+         if (bitmapCondition)
+            condition = Expression().addOp(
+                primitives::bitmap_sel_less_int64_t_col_int64_t_val,
+                Buffer(bitmap, sizeof(primitives::bitmap_t)), Column(t, "a"),
+                Value(&test.bound));
+         else
+            condition = Expression().addOp(
+                primitives::sel_less_int64_t_col_int64_t_val,
+                Buffer(sel, sizeof(pos_t)), Column(t, "a"),
+                Value(&test.bound));
+         kind = AdaptiveSelect(move(condition),
+                               Buffer(bitmap, sizeof(primitives::bitmap_t)),
+                               Buffer(sel, sizeof(pos_t)), bitmapCondition);
+         std::unique_ptr<vectorwise::Expression> all =
+             Expression()
+                 .addOp(primitives::proj_plus_int64_t_col_int64_t_col,
+                        Buffer(sum, sizeof(int64_t)), Column(t, "b"),
+                        Column(t, "b"))
+                 .addOp(primitives::aggr_static_plus_int64_t_col,
+                        Value(&test.sum), Buffer(sum));
+         std::unique_ptr<vectorwise::Expression> bitmapAggr =
+             Expression()
+                 .addOp(primitives::proj_plus_int64_t_col_int64_t_col,
+                        Buffer(sum), Column(t, "b"), Column(t, "b"))
+                 .addOp(primitives::aggr_static_bitmap_plus_int64_t_col,
+                        Buffer(bitmap), Value(&test.sum), Buffer(sum));
+         std::unique_ptr<vectorwise::Expression> list =
+             Expression()
+                 .addOp(primitives::proj_sel_both_plus_int64_t_col_int64_t_col,
+                        Buffer(sel), Buffer(sum), Column(t, "b"),
+                        Column(t, "b"))
+                 .addOp(primitives::aggr_static_plus_int64_t_col,
+                        Value(&test.sum), Buffer(sum));
+         FixedAggregation(Expression().addSelectionSwitch(
+             kind, move(all), move(bitmapAggr), move(list)));
+         root = popOperator();
+      }
+   };
+};
+
+TEST_F(AdaptiveSelectT, representationByDensity) {
+   // a is uniform in [0, 100), so the bound is the selectivity in percent
+   std::vector<std::pair<int64_t, SelectionKind>> runs = {
+       {100, SelectionKind::All},
+       {60, SelectionKind::Bitmap},
+       {5, SelectionKind::List}};
+   for (auto bitmapCondition : {true, false})
+      for (auto& run : runs) {
+         bound = run.first;
+         sum = 0;
+         Plan plan(*this, bitmapCondition);
+         ASSERT_EQ(size_t(1), plan.root->next());
+         ASSERT_EQ(expected(), sum);
+         ASSERT_EQ(run.second, *plan.kind);
+      }
+}
+
+TEST_F(AdaptiveSelectT, analyzedPlan) {
+   bound = 5;
+   analyze = true;
+   {
+      Plan plan(*this, false);
+      ASSERT_EQ(size_t(1), plan.root->next());
+   }
+   analyze = false;
+   auto stats = takeAnalyzedPlan();
+   ASSERT_NE(nullptr, stats);
+   std::ostringstream tree, json;
+   stats->print(tree);
+   stats->printJson(json);
+   // operators are listed top down with the tuples they produced
+   std::regex expectedTree("FixedAggr  tuples 1 .*\n"
+                           "  AdaptiveSelect  tuples 15 .*\n"
+                           "    Scan  tuples 300 .*\n");
+   ASSERT_TRUE(std::regex_match(tree.str(), expectedTree)) << tree.str();
+   ASSERT_EQ(0u, json.str().find("[{\"name\":\"FixedAggr\",\"tuples\":1,"))
+       << json.str();
+   ASSERT_EQ(nullptr, takeAnalyzedPlan());
+}
+
+class PlanLoaderT : public ::testing::Test {
+ protected:
+   runtime::Database db;
+   PlanLoaderT() {
+      db["build"].insert("k", make_unique<algebra::Integer>()) =
+          std::vector<int32_t>{1, 2, 3, 4};
+      db["build"].insert("v", make_unique<algebra::BigInt>()) =
+          std::vector<int64_t>{101, 102, 103, 104};
+      db["build"].nrTuples = 4;
+      std::vector<int32_t> b;
+      std::vector<int64_t> x;
+      for (int32_t i = 0; i < 60; ++i) {
+         b.push_back(i % 6);
+         x.push_back(i);
+      }
+      db["probe"].insert("b", make_unique<algebra::Integer>()) = move(b);
+      db["probe"].insert("x", make_unique<algebra::BigInt>()) = move(x);
+      db["probe"].nrTuples = 60;
+   }
+};
+
+TEST_F(PlanLoaderT, joinAndGroup) {
+   auto plan = PlanDescription::parse(R"(
+# sum of build values by join key, for probe tuples with x < 30
+scan b build
+scan p probe
+select
+   sel_less_int64_t_col_int64_t_val buf:sel:pos_t col:p.x int64_t:30
+hashjoin buf:matches:pos_t
+   probesel buf:sel
+   buildkey col:b.k hash_int32_t_col scatter_int32_t_col
+   probekey col:p.b buf:sel hash_sel_int32_t_col keys_equal_int32_t_col
+   buildvalue col:b.v scatter_int64_t_col buf:v:8 gather_col_int64_t_col
+hashgroup
+   keysel buf:matches buf:grouped:pos_t
+   key col:p.b buf:matches hash_sel_int32_t_col keys_not_equal_sel_int32_t_col
+      partition_by_key_sel_int32_t_col buf:grouped scatter_sel_int32_t_col
+      keys_not_equal_row_int32_t_col partition_by_key_row_int32_t_col
+      scatter_sel_row_int32_t_col gather_val_int32_t_col buf:key:int32_t
+   value buf:v aggr_init_plus_int64_t_col aggr_plus_int64_t_col
+      aggr_row_plus_int64_t_col gather_val_int64_t_col buf:sum:int64_t
+result
+   b buf:key
+   sum buf:sum
+)",
+                                      db);
+   auto result = runPlan(db, plan, 1, 16);
+   std::map<int32_t, int64_t> groups;
+   auto keyAttr = result->result->getAttribute("b");
+   auto sumAttr = result->result->getAttribute("sum");
+   for (auto& block : *result->result) {
+      auto keys = reinterpret_cast<int32_t*>(block.data(keyAttr));
+      auto sums = reinterpret_cast<int64_t*>(block.data(sumAttr));
+      for (size_t i = 0; i < block.size(); ++i) groups[keys[i]] += sums[i];
+   }
+   std::map<int32_t, int64_t> expected = {
+       {1, 505}, {2, 510}, {3, 515}, {4, 520}};
+   ASSERT_EQ(expected, groups);
+}
+
+TEST_F(PlanLoaderT, invalidPlans) {
+   auto error = [&](std::string plan) {
+      try {
+         PlanDescription::parse(plan, db);
+      } catch (std::runtime_error& e) {
+         return std::string(e.what());
+      }
+      return std::string();
+   };
+   EXPECT_EQ("plan line 3: unknown primitive sel_nonsense",
+             error("scan p probe\nselect\n sel_nonsense buf:s:4 col:p.x\n"
+                   "result\n x col:p.x\n"));
+   EXPECT_EQ("plan line 3: first use of buffer s needs its entry size",
+             error("scan p probe\nselect\n sel_less_int64_t_col_int64_t_val "
+                   "buf:s col:p.x int64_t:3\nresult\n x col:p.x\n"));
+   EXPECT_EQ("plan line 2: hashjoin needs 2 inputs",
+             error("scan p probe\nhashjoin buf:m:4\n probesel buf:m\n"
+                   "result\n x col:p.x\n"));
+   EXPECT_EQ("plan line 1: unknown relation nation",
+             error("scan n nation\nresult\n x col:n.x\n"));
+   EXPECT_EQ("plan line 1: plan must end with a result",
+             error("scan p probe\n\n"));
+   EXPECT_EQ("plan line 3: sel_less_int64_t_col_int64_t_val takes 3 "
+             "arguments, not 2",
+             error("scan p probe\nselect\n sel_less_int64_t_col_int64_t_val "
+                   "buf:s:pos_t col:p.x\nresult\n x col:p.x\n"));
+   EXPECT_EQ("plan line 3: col:p.x of type int64_t does not fit "
+             "sel_less_int32_t_col_int32_t_val",
+             error("scan p probe\nselect\n sel_less_int32_t_col_int32_t_val "
+                   "buf:s:pos_t col:p.x int32_t:3\nresult\n x col:p.x\n"));
+   EXPECT_EQ("plan line 4: buf:v of type int32_t does not fit "
+             "hash_int64_t_col",
+             error("scan p probe\nproject\n proj_plus_int32_t_col_int32_t_val "
+                   "buf:v:int32_t col:p.b int32_t:1\n hash_int64_t_col "
+                   "buf:h:hash_t buf:v\nresult\n x col:p.x\n"));
+   // primitives the executable never calls are found, but packing has no
+   // place in a plan
+   EXPECT_EQ("plan line 3: pack_int16_t_col_packed128 is of type FPack, "
+             "expected F3",
+             error("scan p probe\nproject\n pack_int16_t_col_packed128 "
+                   "buf:k:16 col:p.b int32_t:0\nresult\n x col:p.x\n"));
+   EXPECT_EQ("plan line 4: keys_equal_int32_t_col is of type EQCheck, "
+             "expected F2",
+             error("scan b build\nscan p probe\nhashjoin buf:m:pos_t\n"
+                   " buildkey col:b.k keys_equal_int32_t_col "
+                   "scatter_int32_t_col\n probekey col:p.b hash_int32_t_col "
+                   "keys_equal_int32_t_col\nresult\n x col:p.x\n"));
+}
+
+TEST(ScanT, stealsMorselsOfOtherWorkers) {
+   // the only running worker of a group of 4 scans its own range and
+   // steals the ranges of the others
+   runtime::WorkerGroup group(4);
+   auto prevGroup = runtime::this_worker->group;
+   auto prevId = runtime::this_worker->worker_id;
+   runtime::this_worker->group = &group;
+   runtime::this_worker->worker_id = 1;
+   std::vector<int64_t> column(100000);
+   for (size_t i = 0; i < column.size(); ++i) column[i] = i;
+   std::vector<size_t> seen(column.size());
+   vectorwise::Scan::Shared shared;
+   vectorwise::Scan scan(shared, column.size(), 1024);
+   int64_t* values = column.data();
+   scan.addConsumer(reinterpret_cast<void**>(&values), sizeof(int64_t));
+   while (auto n = scan.next()) {
+      EXPECT_LE(n, size_t(1024));
+      for (size_t i = 0; i < n; ++i) seen[values[i]]++;
+   }
+   EXPECT_EQ(vectorwise::EndOfStream, scan.next());
+   runtime::this_worker->group = prevGroup;
+   runtime::this_worker->worker_id = prevId;
+   for (size_t i = 0; i < seen.size(); ++i) ASSERT_EQ(1u, seen[i]) << i;
+   // 9 morsels of 11 vectors, worker 1 owns 2 of them
+   OperatorStats stats;
+   scan.addStats(stats);
+   EXPECT_EQ(7u, stats.notes["stolen morsels"]);
+}
+
+class ExchangeT : public ::testing::Test {
+ protected:
+   runtime::Database db;
+   runtime::GlobalPool pool;
+   int64_t bound = 50;
+   ExchangeT() {
+      std::vector<int64_t> a, b;
+      for (int64_t i = 0; i < 100; ++i) {
+         a.push_back((i * 37) % 100);
+         b.push_back(i);
+      }
+      db["t"].insert("a", make_unique<algebra::BigInt>()) = move(a);
+      db["t"].insert("b", make_unique<algebra::BigInt>()) = move(b);
+      db["t"].nrTuples = 100;
+   };
+
+   using Tuples = std::multiset<std::pair<int64_t, int64_t>>;
+   /// select a < bound, move (a, b) through an exchange and collect them
+   /// with the hashes of a
+   struct Plan : public QueryBuilder {
+      enum { sel, hash, out_a, out_b, out_hash };
+      Tuples result;
+      std::vector<defs::hash_t> hashes;
+      Plan(ExchangeT& test, vectorwise::Exchange::Mode mode,
+           SharedStateManager& shared)
+          : QueryBuilder(test.db, shared, 16) {
+         previous = runtime::this_worker->allocator.setSource(&test.pool);
+         auto t = Scan("t");
+         Select(Expression().addOp(primitives::sel_less_int64_t_col_int64_t_val,
+                                   Buffer(sel, sizeof(pos_t)), Column(t, "a"),
+                                   Value(&test.bound)));
+         Project().addExpression(
+             Expression().addOp(primitives::hash_sel_int64_t_col, Buffer(sel),
+                                Buffer(hash, sizeof(defs::hash_t)),
+                                Column(t, "a")));
+         Exchange(mode)
+             .setInputSelection(Buffer(sel))
+             .setHashes(Buffer(hash))
+             .addValue(Column(t, "a"), Buffer(out_a, sizeof(int64_t)))
+             .addValue(Column(t, "b"), Buffer(out_b, sizeof(int64_t)));
+         Project().addExpression(
+             Expression().addOp(primitives::hash_int64_t_col,
+                                Buffer(out_hash, sizeof(defs::hash_t)),
+                                Buffer(out_a)));
+         auto root = popOperator();
+         auto a = reinterpret_cast<int64_t*>(Buffer(out_a).data);
+         auto b = reinterpret_cast<int64_t*>(Buffer(out_b).data);
+         auto h = reinterpret_cast<defs::hash_t*>(Buffer(out_hash).data);
+         while (auto n = root->next()) {
+            EXPECT_LE(n, size_t(16));
+            for (size_t i = 0; i < n; ++i) {
+               result.emplace(a[i], b[i]);
+               hashes.push_back(h[i]);
+            }
+         }
+      }
+   };
+
+   Tuples expected() {
+      Tuples expected;
+      for (int64_t i = 0; i < 100; ++i)
+         if ((i * 37) % 100 < bound) expected.emplace((i * 37) % 100, i);
+      return expected;
+   }
+
+   /// results and hashes of the plan on each worker of a group
+   std::vector<Plan*> runOnWorkers(vectorwise::Exchange::Mode mode,
+                                   size_t workers,
+                                   std::vector<std::unique_ptr<Plan>>& plans) {
+      // every worker needs a thread of its own, the consumers wait for all
+      // producers, also on machines with fewer CPUs
+      tbb::global_control parallelism(
+          tbb::global_control::max_allowed_parallelism, workers);
+      tbb::task_arena arena(workers);
+      runtime::WorkerGroup group(workers);
+      SharedStateManager shared;
+      plans.resize(workers);
+      std::mutex m;
+      arena.execute([&]() {
+         group.run([&]() {
+            auto plan = std::make_unique<Plan>(*this, mode, shared);
+            std::lock_guard<std::mutex> lock(m);
+            plans[runtime::this_worker->worker_id] = move(plan);
+         });
+      });
+      std::vector<Plan*> result;
+      for (auto& plan : plans) result.push_back(plan.get());
+      return result;
+   }
+};
+
+TEST_F(ExchangeT, allModes) {
+   for (auto mode :
+        {vectorwise::Exchange::Mode::Repartition,
+         vectorwise::Exchange::Mode::Broadcast,
+         vectorwise::Exchange::Mode::Gather}) {
+      SharedStateManager shared;
+      Plan plan(*this, mode, shared);
+      ASSERT_EQ(expected(), plan.result);
+   }
+}
+
+TEST_F(ExchangeT, repartitionsByHash) {
+   std::vector<std::unique_ptr<Plan>> plans;
+   Tuples all;
+   size_t w = 0, receivers = 0;
+   for (auto plan :
+        runOnWorkers(vectorwise::Exchange::Mode::Repartition, 4, plans)) {
+      for (auto hash : plan->hashes)
+         ASSERT_EQ(w, vectorwise::Exchange::target(hash, 4));
+      all.insert(plan->result.begin(), plan->result.end());
+      receivers += !plan->result.empty();
+      w++;
+   }
+   ASSERT_EQ(expected(), all);
+   EXPECT_GT(receivers, 1u);
+}
+
+TEST_F(ExchangeT, broadcastsToAll) {
+   std::vector<std::unique_ptr<Plan>> plans;
+   for (auto plan :
+        runOnWorkers(vectorwise::Exchange::Mode::Broadcast, 4, plans))
+      ASSERT_EQ(expected(), plan->result);
+}
+
+TEST_F(ExchangeT, gathersOnFirstWorker) {
+   std::vector<std::unique_ptr<Plan>> plans;
+   auto result = runOnWorkers(vectorwise::Exchange::Mode::Gather, 4, plans);
+   ASSERT_EQ(expected(), result[0]->result);
+   for (size_t w = 1; w < result.size(); ++w)
+      ASSERT_TRUE(result[w]->result.empty()) << w;
+}
+
+class SortT : public ::testing::Test, public Query, public QueryBuilder {
+
+ protected:
+   runtime::Database db;
+   runtime::GlobalPool pool;
+   SortT() : Query(), QueryBuilder(db, shared, 4) {
+      previous = runtime::this_worker->allocator.setSource(&pool);
+   };
+};
+
+TEST_F(SortT, multipleKeys) {
+   enum { sorted_k1, sorted_k2, sorted_v };
+   auto& rel = db["t"];
+   rel.insert("k1", make_unique<algebra::Integer>()) =
+       std::vector<int32_t>{3, -1, 3, 0, -7, 3, 0, 1000, -1, 2};
+   rel.insert("k2", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{5, 2, -9, 4, 1, 5, 8, 0, 3, 6};
+   rel.insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+   rel.nrTuples = 10;
+
+   // order by k1 asc, k2 desc
+   auto t = Scan("t");
+   Sort()
+       .addKey(Column(t, "k1"), primitives::normalize_int32_t_col)
+       .addKey(Column(t, "k2"), primitives::normalize_desc_int64_t_col)
+       .addValue(Column(t, "k1"), primitives::scatter_int32_t_col,
+                 primitives::gather_val_int32_t_col,
+                 Buffer(sorted_k1, sizeof(int32_t)))
+       .addValue(Column(t, "k2"), primitives::scatter_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(sorted_k2, sizeof(int64_t)))
+       .addValue(Column(t, "v"), primitives::scatter_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(sorted_v, sizeof(int64_t)));
+
+   std::vector<std::tuple<int32_t, int64_t>> expectedKeys = {
+       {-7, 1}, {-1, 3}, {-1, 2}, {0, 8}, {0, 4},
+       {2, 6},  {3, 5},  {3, 5},  {3, -9}, {1000, 0}};
+   auto root = popOperator();
+   std::vector<std::tuple<int32_t, int64_t>> keys;
+   std::vector<int64_t> values;
+   while (auto n = root->next()) {
+      ASSERT_LE(n, size_t(4));
+      auto k1 = (int32_t*)Buffer(sorted_k1).data;
+      auto k2 = (int64_t*)Buffer(sorted_k2).data;
+      auto v = (int64_t*)Buffer(sorted_v).data;
+      for (size_t i = 0; i < n; ++i) {
+         keys.emplace_back(k1[i], k2[i]);
+         values.push_back(v[i]);
+      }
+   }
+   ASSERT_EQ(expectedKeys, keys);
+   // payload stays with its keys
+   ASSERT_EQ(size_t(10), values.size());
+   ASSERT_EQ(4, values[0]);
+   ASSERT_EQ(2, values[8]);
+   ASSERT_EQ(7, values[9]);
+}
+
+TEST_F(SortT, charKeysWithSelection) {
+   enum { sel, sorted_name, sorted_v };
+   auto& rel = db["t"];
+   auto& name = rel.insert("name", make_unique<algebra::Char>(6));
+   std::vector<types::Char<6>> names;
+   for (auto s : {"delta", "al", "bravo", "alpha", "a", "zulu", "alp"})
+      names.push_back(types::Char<6>::castString(s, strlen(s)));
+   name = move(names);
+   rel.insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6};
+   rel.nrTuples = 7;
+   int64_t upperBound = 5;
+
+   // order by name desc of rows with v < 5
+   auto t = Scan("t");
+   Select(Expression().addOp(primitives::sel_less_int64_t_col_int64_t_val,
+                             Buffer(sel, sizeof(pos_t)), Column(t, "v"),
+                             Value(&upperBound)));
+   Sort()
+       .addKey(Column(t, "name"), Buffer(sel),
+               primitives::normalize_sel_desc_Char_6_col)
+       .addValue(Column(t, "v"), Buffer(sel),
+                 primitives::scatter_sel_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(sorted_v, sizeof(int64_t)));
+
+   auto root = popOperator();
+   std::vector<int64_t> values;
+   while (auto n = root->next()) {
+      auto v = (int64_t*)Buffer(sorted_v).data;
+      values.insert(values.end(), v, v + n);
+   }
+   // delta, bravo, alpha, al, a
+   ASSERT_EQ(std::vector<int64_t>({0, 2, 3, 1, 4}), values);
+}
+
+TEST_F(SortT, varcharKeys) {
+   enum { sorted_v };
+   auto& rel = db["t"];
+   // Attribute::operator= sizes the column by void*, too small for Varchar
+   auto& names =
+       rel.insert("name", make_unique<algebra::Varchar>(55))
+           .typedAccessForChange<types::Varchar<55>>();
+   names.reset(6);
+   for (auto s : {"forest green", "forest", "", "zebra", "forest greens",
+                  "apple"}) {
+      auto name = types::Varchar<55>::castString(s);
+      names.push_back(name);
+   }
+   rel.insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 3, 4, 5};
+   rel.nrTuples = 6;
+
+   // order by name, shorter strings before their extensions
+   auto t = Scan("t");
+   Sort()
+       .addKey(Column(t, "name"), primitives::normalize_Varchar_55_col)
+       .addValue(Column(t, "v"), primitives::scatter_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(sorted_v, sizeof(int64_t)));
+
+   auto root = popOperator();
+   std::vector<int64_t> values;
+   while (auto n = root->next()) {
+      auto v = (int64_t*)Buffer(sorted_v).data;
+      values.insert(values.end(), v, v + n);
+   }
+   ASSERT_EQ(std::vector<int64_t>({2, 5, 1, 0, 4, 3}), values);
+}
+
+TEST_F(SortT, topN) {
+   enum { top_k, top_v };
+   auto& rel = db["t"];
+   std::vector<int64_t> k, v;
+   for (int64_t i = 0; i < 100; ++i) {
+      k.push_back((i * 37) % 101 - 50);
+      v.push_back(i);
+   }
+   rel.insert("k", make_unique<algebra::BigInt>()) = move(k);
+   rel.insert("v", make_unique<algebra::BigInt>()) = move(v);
+   rel.nrTuples = 100;
+
+   // order by k desc limit 5
+   auto t = Scan("t");
+   TopN(5)
+       .addKey(Column(t, "k"), primitives::normalize_sel_desc_int64_t_col)
+       .addValue(Column(t, "k"), primitives::scatter_sel_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(top_k, sizeof(int64_t)))
+       .addValue(Column(t, "v"), primitives::scatter_sel_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(top_v, sizeof(int64_t)));
+
+   auto root = popOperator();
+   auto& topN = dynamic_cast<vectorwise::TopN&>(*root);
+   std::vector<int64_t> keys, values;
+   while (auto n = root->next()) {
+      auto tk = (int64_t*)Buffer(top_k).data;
+      auto tv = (int64_t*)Buffer(top_v).data;
+      keys.insert(keys.end(), tk, tk + n);
+      values.insert(values.end(), tv, tv + n);
+   }
+   ASSERT_EQ(std::vector<int64_t>({50, 49, 48, 47, 46}), keys);
+   for (size_t i = 0; i < keys.size(); ++i)
+      ASSERT_EQ(keys[i], (values[i] * 37) % 101 - 50);
+   // the threshold was tightened to the fifth best key
+   auto fifth = primitives::normalizedPrefix<int64_t, true>(int64_t(46));
+   ASSERT_EQ(fifth, topN.threshold);
+}
+
+TEST_F(SortT, topNWithSelection) {
+   enum { sel, top_name, top_v };
+   auto& rel = db["t"];
+   auto& name = rel.insert("name", make_unique<algebra::Char>(6));
+   std::vector<types::Char<6>> names;
+   for (auto s : {"delta", "al", "bravo", "alpha", "a", "zulu", "alp"})
+      names.push_back(types::Char<6>::castString(s, strlen(s)));
+   name = move(names);
+   rel.insert("v", make_unique<algebra::BigInt>()) =
+       std::vector<int64_t>{0, 1, 2, 3, 4, 5, 6};
+   rel.nrTuples = 7;
+   int64_t lowerBound = 1;
+
+   // order by name of rows with v > 1 limit 2
+   auto t = Scan("t");
+   Select(Expression().addOp(primitives::sel_greater_int64_t_col_int64_t_val,
+                             Buffer(sel, sizeof(pos_t)), Column(t, "v"),
+                             Value(&lowerBound)));
+   TopN(2, Buffer(sel))
+       .addKey(Column(t, "name"), primitives::normalize_sel_Char_6_col)
+       .addValue(Column(t, "v"), primitives::scatter_sel_int64_t_col,
+                 primitives::gather_val_int64_t_col,
+                 Buffer(top_v, sizeof(int64_t)));
+
+   auto root = popOperator();
+   std::vector<int64_t> values;
+   while (auto n = root->next()) {
+      auto v = (int64_t*)Buffer(top_v).data;
+      values.insert(values.end(), v, v + n);
+   }
+   // a, alp
+   ASSERT_EQ(std::vector<int64_t>({4, 6}), values);
+}
+
 class HashGroupSmallBuf : public ::testing::Test,
                           public Query,
                           public QueryBuilder {
@@ -1,8 +1,10 @@
 #include "vectorwise/Primitives.hpp"
+#include "vectorwise/Operations.hpp"
 #include "common/runtime/Hash.hpp"
 #include "common/runtime/Hashmap.hpp"
 #include "common/runtime/Types.hpp"
 #include <gtest/gtest.h>
+#include <sstream>
 
 using types::Date;
 using namespace std;
@@ -124,8 +126,316 @@ TEST(Partition, uint64_t) {
    for (auto& e : expectedGroupCounts) { ASSERT_EQ(e.second, size_t(0)); }
 }
 
+TEST(Pack, CompositeKeys) {
+   using primitives::packed128;
+   using primitives::packed64;
+   vector<types::Char<1>> flags(4);
+   vector<int32_t> ints = {-1, 7, 42, 1 << 30};
+   vector<int64_t> longs = {-5, 0, 1ll << 40, 3};
+   const char* f = "ARNO";
+   for (size_t i = 0; i < flags.size(); ++i) flags[i].value = f[i];
+   const pos_t n = 4;
+
+   vector<packed64> p64(n);
+   primitives::pack_Char_1_col_packed64(n, p64.data(), flags.data(), 0);
+   primitives::pack_int32_t_col_packed64(n, p64.data(), ints.data(), 8);
+   vector<types::Char<1>> flagsOut(n);
+   vector<int32_t> intsOut(n);
+   primitives::unpack_Char_1_col_packed64(n, flagsOut.data(), p64.data(), 0);
+   primitives::unpack_int32_t_col_packed64(n, intsOut.data(), p64.data(), 8);
+   for (size_t i = 0; i < n; ++i) {
+      ASSERT_EQ(flags[i].value, flagsOut[i].value);
+      ASSERT_EQ(ints[i], intsOut[i]);
+   }
+
+   vector<pos_t> sel = {3, 1};
+   vector<packed128> p128(sel.size());
+   primitives::pack_sel_int64_t_col_packed128(sel.size(), sel.data(),
+                                              p128.data(), longs.data(), 0);
+   primitives::pack_sel_int32_t_col_packed128(sel.size(), sel.data(),
+                                              p128.data(), ints.data(), 64);
+   vector<int64_t> longsOut(sel.size());
+   primitives::unpack_int64_t_col_packed128(sel.size(), longsOut.data(),
+                                            p128.data(), 0);
+   primitives::unpack_int32_t_col_packed128(sel.size(), intsOut.data(),
+                                            p128.data(), 64);
+   for (size_t i = 0; i < sel.size(); ++i) {
+      ASSERT_EQ(longs[sel[i]], longsOut[i]);
+      ASSERT_EQ(ints[sel[i]], intsOut[i]);
+   }
+}
+
+TEST(Like, Patterns) {
+   auto matches = [](const char* pattern, const char* str) {
+      return types::LikePattern(pattern).match(str, strlen(str));
+   };
+   ASSERT_TRUE(matches("forest green", "forest green"));
+   ASSERT_FALSE(matches("forest", "forest green"));
+   ASSERT_TRUE(matches("MFGR#22%", "MFGR#2221"));
+   ASSERT_FALSE(matches("MFGR#22%", "MFGR#2"));
+   ASSERT_TRUE(matches("%BRASS", "LARGE POLISHED BRASS"));
+   ASSERT_FALSE(matches("%BRASS", "LARGE BRASS POLISHED"));
+   ASSERT_TRUE(matches("%%", ""));
+   // candidates of the first and last character past the SIMD blocks
+   auto longText = "ironic deposits sleep quickly, blithely final green pinto";
+   ASSERT_TRUE(matches("%green%", longText));
+   ASSERT_TRUE(matches("%pinto%", longText));
+   ASSERT_FALSE(matches("%greens%", longText));
+   ASSERT_TRUE(matches("%special%requests%", "the special pending requests"));
+   ASSERT_FALSE(matches("%special%requests%", "requests are special"));
+   ASSERT_TRUE(matches("i%deposits%pinto", longText));
+   ASSERT_FALSE(matches("ab%ba", "aba"));
+   // _ matches exactly one character
+   ASSERT_TRUE(matches("f_rest", "forest"));
+   ASSERT_FALSE(matches("f_rest", "frest"));
+   ASSERT_FALSE(matches("f_rest", "forests"));
+   ASSERT_FALSE(matches("f_rest", "f_resx"));
+   ASSERT_TRUE(matches("MFGR#2_2%", "MFGR#2221"));
+   ASSERT_FALSE(matches("MFGR#2_2%", "MFGR#2"));
+   ASSERT_TRUE(matches("%BR_SS", "LARGE POLISHED BRASS"));
+   ASSERT_TRUE(matches("%gr__n%", longText));
+   ASSERT_FALSE(matches("%_pinto_%", longText));
+   ASSERT_TRUE(matches("i%d_posits%p_nto", longText));
+   ASSERT_TRUE(matches("%_", "a"));
+   ASSERT_FALSE(matches("%_", ""));
+   ASSERT_FALSE(matches("_%_", "a"));
+   ASSERT_TRUE(matches("_%_", "ab"));
+   ASSERT_TRUE(matches("___", "abc"));
+   ASSERT_FALSE(matches("___", "abcd"));
+}
+
+TEST(Like, Selection) {
+   using types::Varchar;
+   vector<Varchar<55>> names;
+   for (auto s : {"forest green puff", "blush thistle", "green navy",
+                  "lace spring green", "dark green and special requests"})
+      names.push_back(Varchar<55>::castString(s));
+   types::LikePattern green("%green%");
+   vector<pos_t> result(names.size());
+   auto found = primitives::sel_like_Varchar_55_col_pattern_val(
+       names.size(), result.data(), names.data(), &green);
+   ASSERT_EQ(pos_t(4), found);
+   ASSERT_EQ(vector<pos_t>({0, 2, 3, 4}), vector<pos_t>(result.begin(),
+                                                         result.begin() + 4));
+
+   types::LikePattern requests("%special%requests%");
+   vector<pos_t> selection{0, 1, 4}, notLike(3);
+   found = primitives::selsel_not_like_Varchar_55_col_pattern_val(
+       selection.size(), selection.data(), notLike.data(), names.data(),
+       &requests);
+   ASSERT_EQ(pos_t(2), found);
+   ASSERT_EQ(pos_t(0), notLike[0]);
+   ASSERT_EQ(pos_t(1), notLike[1]);
+}
+
+TEST(Bitmap, Conversion) {
+   using primitives::bitmap_t;
+   vector<int32_t> input(1000);
+   for (size_t i = 0; i < input.size(); ++i) input[i] = (i * 7919) % 100;
+   int32_t val = 80;
+   vector<pos_t> expected(input.size());
+   auto expectedFound = primitives::sel_less_int32_t_col_int32_t_val(
+       input.size(), expected.data(), input.data(), &val);
+   vector<bitmap_t> bitmap(primitives::bitmapWords(input.size()));
+   ASSERT_EQ(expectedFound,
+             primitives::bitmap_sel_less_int32_t_col_int32_t_val(
+                 input.size(), bitmap.data(), input.data(), &val));
+   // dense bitmaps to selection vectors and back
+   vector<pos_t> sel(input.size());
+   ASSERT_EQ(expectedFound,
+             primitives::bitmap_to_sel(input.size(), sel.data(),
+                                       bitmap.data()));
+   for (pos_t i = 0; i < expectedFound; ++i) ASSERT_EQ(expected[i], sel[i]);
+   vector<bitmap_t> roundTrip(bitmap.size(), ~bitmap_t(0));
+   primitives::sel_to_bitmap(expectedFound, sel.data(), input.size(),
+                             roundTrip.data());
+   ASSERT_EQ(bitmap, roundTrip);
+}
+
+TEST(Flavors, Equivalent) {
+   // all flavors of a primitive must produce the same result
+   vector<int32_t> input(1000);
+   for (size_t i = 0; i < input.size(); ++i) input[i] = (i * 7919) % 100;
+   int32_t val = 50;
+
+   auto sels = primitives::flavorsOf(primitives::sel_less_int32_t_col_int32_t_val);
+   ASSERT_GE(sels.size(), size_t(2));
+   vector<pos_t> expected(input.size());
+   auto expectedFound =
+       sels[0](input.size(), expected.data(), input.data(), &val);
+   for (auto sel : sels) {
+      vector<pos_t> result(input.size());
+      auto found = sel(input.size(), result.data(), input.data(), &val);
+      ASSERT_EQ(expectedFound, found);
+      for (pos_t i = 0; i < found; ++i) ASSERT_EQ(expected[i], result[i]);
+   }
+
+   auto hashes = primitives::flavorsOf(primitives::hash_murmur_int32_t_col);
+   vector<defs::hash_t> expectedHashes(input.size());
+   hashes[0](input.size(), expectedHashes.data(), input.data());
+   for (auto hash : hashes) {
+      vector<defs::hash_t> result(input.size());
+      hash(input.size(), result.data(), input.data());
+      ASSERT_EQ(expectedHashes, result);
+   }
+}
+
+TEST(MicroAdaptive, ExploitsCheapestFlavor) {
+   MicroAdaptivity settings;
+   settings.exploreCalls = 2;
+   settings.exploitCalls = 10;
+   FlavorChooser chooser(3, settings);
+   auto cost = vector<uint64_t>{10, 2, 5};
+   bool measure;
+   // explore phase runs every flavor exploreCalls times
+   for (size_t i = 0; i < 6; ++i) {
+      auto flavor = chooser.next(measure);
+      ASSERT_TRUE(measure);
+      ASSERT_EQ(i / 2, flavor);
+      chooser.record(flavor, cost[flavor] * 1024, 1024);
+   }
+   for (size_t i = 0; i < 10; ++i) {
+      ASSERT_EQ(size_t(1), chooser.next(measure));
+      ASSERT_FALSE(measure);
+   }
+   // the next explore phase adapts to changed costs
+   cost = {1, 2, 5};
+   for (size_t i = 0; i < 6; ++i) {
+      auto flavor = chooser.next(measure);
+      chooser.record(flavor, cost[flavor] * 1024, 1024);
+   }
+   ASSERT_EQ(size_t(0), chooser.next(measure));
+   ASSERT_EQ(size_t(0), chooser.exploited());
+}
+
+TEST(Expression, ThreadedCode) {
+   vector<int32_t> a(100), b(100), c(100);
+   for (size_t i = 0; i < a.size(); ++i) {
+      a[i] = i;
+      b[i] = 2 * i;
+      c[i] = 100 - i;
+   }
+   int32_t val = 40;
+   vector<pos_t> sel(a.size());
+   vector<int32_t> result(a.size());
+   struct Halve : public Op {
+      virtual pos_t run(pos_t n) override { return n / 2; }
+   };
+   struct Keep : public Op {
+      virtual pos_t run(pos_t n) override { return n; }
+   };
+   Expression expression;
+   auto select = make_unique<F3_Op>(
+       sel.data(), a.data(), &val,
+       (primitives::F3)primitives::sel_less_int32_t_col_int32_t_val);
+   auto selectOp = select.get();
+   expression.ops.push_back(move(select));
+   expression.ops.push_back(make_unique<Halve>());
+   expression.ops.push_back(make_unique<F4_Op>(
+       sel.data(), result.data(), a.data(), b.data(),
+       (primitives::F4)primitives::proj_sel_both_plus_int32_t_col_int32_t_col));
+
+   for (auto threaded : {false, true}) {
+      threadedCode = threaded;
+      selectOp->param1 = a.data();
+      ASSERT_EQ(pos_t(20), expression.evaluate(a.size()));
+      for (pos_t i = 0; i < 20; ++i) ASSERT_EQ(int32_t(3 * i), result[i]);
+      // operators rebind the arguments of ops between vectors
+      selectOp->param1 = c.data();
+      ASSERT_EQ(pos_t(19), expression.evaluate(a.size()));
+      ASSERT_EQ(int32_t(3 * 61), result[0]);
+   }
+   // replacing an op recompiles the program of the same length
+   selectOp->param1 = a.data();
+   expression.ops[1] = make_unique<Keep>();
+   ASSERT_EQ(pos_t(40), expression.evaluate(a.size()));
+   for (pos_t i = 0; i < 40; ++i) ASSERT_EQ(int32_t(3 * i), result[i]);
+   threadedCode = true;
+}
+
+TEST(Expression, PrimitiveProfile) {
+   vector<int32_t> a(100), result(100);
+   for (size_t i = 0; i < a.size(); ++i) a[i] = i;
+   int32_t val = 40, other = 10;
+   vector<pos_t> sel(a.size()), otherSel(a.size());
+   auto less = (primitives::F3)primitives::sel_less_int32_t_col_int32_t_val;
+   auto plus =
+       (primitives::F4)primitives::proj_sel_both_plus_int32_t_col_int32_t_col;
+   nextOpSite = 0;
+   Expression expression, otherExpression;
+   expression.ops.push_back(make_unique<F3_Op>(sel.data(), a.data(), &val,
+                                               less));
+   expression.ops.push_back(
+       make_unique<F4_Op>(sel.data(), result.data(), a.data(), a.data(), plus));
+   // a second call site of the same primitive
+   otherExpression.ops.push_back(
+       make_unique<F3_Op>(otherSel.data(), a.data(), &other, less));
+
+   primitiveProfile.reset();
+   primitiveProfiling = true;
+   for (int i = 0; i < 3; ++i) ASSERT_EQ(pos_t(40), expression.evaluate(100));
+   ASSERT_EQ(pos_t(10), otherExpression.evaluate(100));
+   primitiveProfiling = false;
+   auto counters = primitiveProfile.collect();
+   std::ostringstream table;
+   primitiveProfile.print(table);
+   primitiveProfile.reset();
+   ASSERT_EQ(size_t(3), counters.size());
+   // tuples count the input of each call
+   using Site = PrimitiveProfile::Site;
+   auto& selection = counters[Site{0, reinterpret_cast<const void*>(less)}];
+   ASSERT_EQ(uint64_t(3), selection.calls);
+   ASSERT_EQ(uint64_t(300), selection.tuples);
+   auto& projection = counters[Site{1, reinterpret_cast<const void*>(plus)}];
+   ASSERT_EQ(uint64_t(3), projection.calls);
+   ASSERT_EQ(uint64_t(120), projection.tuples);
+   auto& otherSelection =
+       counters[Site{2, reinterpret_cast<const void*>(less)}];
+   ASSERT_EQ(uint64_t(1), otherSelection.calls);
+   ASSERT_EQ(uint64_t(100), otherSelection.tuples);
+   ASSERT_EQ(int32_t(78), result[39]);
+   // one row per call site, labeled with the primitive
+   EXPECT_NE(std::string::npos, table.str().find(" #0\n"));
+   EXPECT_NE(std::string::npos, table.str().find(" #2\n"));
+}
+
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
 using hash_t = defs::hash_t;
+
+TEST(KeysEqual, SIMD64bits) {
+   // checks if scalar and simd variants find the same matches
+   const pos_t n = 19;
+   struct Entry {
+      void* next;
+      uint64_t key;
+   };
+   vector<Entry> entries(n);
+   vector<uint64_t> probeKeys(n);
+   for (size_t i = 0; i < n; ++i) {
+      entries[i].key = i * 3;
+      probeKeys[i] = i % 3 ? i : i * 3;
+   }
+   vector<void*> scalarEntries, simdEntries;
+   vector<pos_t> scalarIdx, simdIdx;
+   for (size_t i = 0; i < n; ++i) {
+      scalarEntries.push_back(&entries[n - 1 - i]);
+      scalarIdx.push_back(n - 1 - i);
+   }
+   simdEntries = scalarEntries;
+   simdIdx = scalarIdx;
+   auto offset = offsetof(Entry, key);
+   auto scalarFound = primitives::keys_equal_packed64_col(
+       n, scalarEntries.data(), offset, scalarIdx.data(), probeKeys.data());
+   auto simdFound = primitives::keys_equal8_packed64_col(
+       n, simdEntries.data(), offset, simdIdx.data(), probeKeys.data());
+   ASSERT_EQ(scalarFound, simdFound);
+   ASSERT_EQ(scalarFound, size_t(7));
+   for (size_t i = 0; i < scalarFound; ++i) {
+      ASSERT_EQ(scalarEntries[i], simdEntries[i]);
+      ASSERT_EQ(scalarIdx[i], simdIdx[i]);
+   }
+}
+
 TEST(Hash, SIMD32bits){
    // checks if scalar and simd variants generate the same hashes
    using runtime::MurMurHash3;
@@ -144,4 +454,51 @@ TEST(Hash, SIMD32bits){
    }
 
 }
+
+#if HASH_SIZE != 32
+TEST(Hash, SIMD64bitsFunctions) {
+   // checks if scalar and simd variants of the selectable hash functions
+   // generate the same hashes
+   vector<uint64_t> keys = {1, 2, 3, 4, 0x100000000, 1ull << 63, 42, ~0ull};
+   auto check = [&](auto hash) {
+      vector<uint64_t> simdHashes(8);
+      auto simdHash = hash.hashKey(Vec8u(keys.data()),
+                                   Vec8u(vectorwise::primitives::seed));
+      _mm512_storeu_si512(simdHashes.data(), simdHash);
+      for (size_t i = 0; i < keys.size(); ++i)
+         ASSERT_EQ(hash.hashKey(keys[i], vectorwise::primitives::seed),
+                   simdHashes[i]);
+   };
+   check(runtime::XXH3Hash());
+   check(runtime::MultiplyShiftHash());
+   if (runtime::CLMulFoldHash::hasVectorCLMul()) {
+      check(runtime::CLMulFoldHash());
+      // the primitive stores full vectors aligned and masks the rest
+      const pos_t n = 21;
+      alignas(64) int64_t column[24];
+      alignas(64) defs::hash_t scalar[24], simd[24];
+      for (size_t i = 0; i < n; ++i) column[i] = i * 0x9e3779b9;
+      primitives::hash_clmulfold_int64_t_col(n, scalar, column);
+      primitives::hash8_clmulfold_int64_t_col(n, simd, column);
+      for (size_t i = 0; i < n; ++i) ASSERT_EQ(scalar[i], simd[i]);
+   }
+}
+#endif
 #endif
+
+TEST(Hash, SelectFunction) {
+   using runtime::HashFunction;
+   for (auto f : {HashFunction::CRC32, HashFunction::MurMur, HashFunction::XXH3,
+                  HashFunction::MultiplyShift, HashFunction::CLMulFold})
+      ASSERT_EQ(f, runtime::hashFunctionFromString(runtime::hashFunctionName(f)));
+   ASSERT_THROW(runtime::hashFunctionFromString("md5"), std::runtime_error);
+
+   // the default primitives follow the selected hash function
+   vector<int32_t> keys = {1, 2, 3, 4, 5, 6, 7, 8};
+   vector<defs::hash_t> expected(keys.size()), actual(keys.size());
+   primitives::setHashFunction(HashFunction::XXH3);
+   primitives::hash_int32_t_col(keys.size(), actual.data(), keys.data());
+   primitives::hash_xxh3_int32_t_col(keys.size(), expected.data(), keys.data());
+   primitives::setHashFunction(HashFunction::MurMur);
+   ASSERT_EQ(expected, actual);
+}
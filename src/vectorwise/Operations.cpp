@@ -1,8 +1,82 @@
 #include "vectorwise/Operations.hpp"
+#include <algorithm>
+#include <limits>
 
 namespace vectorwise {
 
+bool threadedCode = true;
+thread_local size_t nextOpSite = 0;
+
+void Program::compile(const std::vector<std::unique_ptr<Op>>& ops) {
+   code.assign(ops.size() + 1, Instruction());
+   source.clear();
+   for (size_t i = 0; i < ops.size(); ++i) {
+      ops[i]->compile(code[i]);
+      source.push_back(ops[i].get());
+   }
+}
+
+template <bool chain> pos_t Program::run(pos_t n) {
+   pos_t found = chain ? n : 0;
+   const Instruction* ip = code.data();
+#define ARG(i) (*ip->args[i])
+#define CALL(F, args...)                                                       \
+   found = reinterpret_cast<primitives::F>(ip->primitive)(chain ? found : n,  \
+                                                          args)
+#if defined(__GNUC__)
+   static void* const dispatch[] = {&&op_F1, &&op_F2, &&op_F3,
+                                    &&op_F4, &&op_Thunk, &&op_End};
+#define INSTRUCTION(kind) op_##kind:
+#define NEXT()                                                                 \
+   ++ip;                                                                       \
+   goto* dispatch[ip->kind]
+   goto* dispatch[ip->kind];
+#else
+#define INSTRUCTION(kind) case Instruction::kind:
+#define NEXT()                                                                 \
+   ++ip;                                                                       \
+   continue
+   for (;;) switch (ip->kind) {
+#endif
+      INSTRUCTION(F1) CALL(F1, ARG(0));
+      NEXT();
+      INSTRUCTION(F2) CALL(F2, ARG(0), ARG(1));
+      NEXT();
+      INSTRUCTION(F3) CALL(F3, ARG(0), ARG(1), ARG(2));
+      NEXT();
+      INSTRUCTION(F4) CALL(F4, ARG(0), ARG(1), ARG(2), ARG(3));
+      NEXT();
+      INSTRUCTION(Thunk) found = ip->thunk(ip->op, chain ? found : n);
+      NEXT();
+      INSTRUCTION(End) return found;
+#if !defined(__GNUC__)
+      }
+#endif
+#undef ARG
+#undef CALL
+#undef INSTRUCTION
+#undef NEXT
+}
+
+template pos_t Program::run<true>(pos_t n);
+template pos_t Program::run<false>(pos_t n);
+
+void Op::compile(Instruction& i) {
+   i.kind = Instruction::Thunk;
+   i.thunk = [](Op* op, pos_t n) { return op->run(n); };
+   i.op = this;
+}
+
 pos_t Expression::evaluate(pos_t n) {
+   if (primitiveProfiling) {
+      pos_t found = n;
+      for (auto& op : ops) found = primitiveProfile.run(*op, found);
+      return found;
+   }
+   if (threadedCode) {
+      if (!program.compiledFor(ops)) program.compile(ops);
+      return program.run<true>(n);
+   }
    pos_t found = n;
    for (auto& op : ops) { found = op->run(found); }
    return found;
@@ -25,6 +99,15 @@ void Aggregates::operator+=(std::unique_ptr<Op>&& op) {
 }
 
 pos_t Aggregates::evaluate(pos_t n) {
+   if (primitiveProfiling) {
+      pos_t found = 0;
+      for (auto& aggr : ops) found = primitiveProfile.run(*aggr, n);
+      return found;
+   }
+   if (threadedCode) {
+      if (!program.compiledFor(ops)) program.compile(ops);
+      return program.run<false>(n);
+   }
    auto found = 0;
    for (auto& aggr : ops) found = aggr->run(n);
    return found;
@@ -37,7 +120,10 @@ Scatter::ScatterInfo::ScatterInfo(std::unique_ptr<Op>&& operation, void** s,
 pos_t Scatter::evaluate(pos_t n, void* start) {
    for (auto& scat : ops) {
       *scat.start = reinterpret_cast<uint8_t*>(start) + scat.offset;
-      scat.op->run(n);
+      if (primitiveProfiling)
+         primitiveProfile.run(*scat.op, n);
+      else
+         scat.op->run(n);
    }
    return n;
 }
@@ -47,6 +133,14 @@ GatherOpCol::GatherOpCol(primitives::FGather o, void** s, size_t off, void* t)
 
 pos_t GatherOpCol::run(pos_t n) { return op(n, source, offset, target); }
 
+GatherSelOpCol::GatherSelOpCol(primitives::FGatherSel o, pos_t* sel,
+                               void** s, size_t off, void* t)
+    : op(o), selection(sel), source(s), offset(off), target(t) {}
+
+pos_t GatherSelOpCol::run(pos_t n) {
+   return op(n, selection, source, offset, target);
+}
+
 GatherOpVal::GatherOpVal(primitives::FGatherVal o, void** s, size_t off,
                          size_t* s_s, void* t)
     : op(o), sourceStart(s), offset(off), struct_size(s_s), target(t) {}
@@ -81,12 +175,103 @@ pos_t NEqualityCheckSel::run(pos_t n) {
    return eq(n, entryIdx, entry, probeSel, probeKey, offset, notEq);
 }
 
+double bitmapDensity = 0.25;
+
+SelectionSwitch::SelectionSwitch(const SelectionKind* k,
+                                 std::unique_ptr<Expression> all,
+                                 std::unique_ptr<Expression> bitmap,
+                                 std::unique_ptr<Expression> list)
+    : kind(k), alternatives{move(all), move(bitmap), move(list)} {}
+
+pos_t SelectionSwitch::run(pos_t n) {
+   return alternatives[static_cast<size_t>(*kind)]->evaluate(n);
+}
+
 pos_t F1_Op::run(pos_t n) { return operation(n, input); }
-pos_t F2_Op::run(pos_t n) { return operation(n, input, param1); }
+pos_t FusedOp::run(pos_t n) {
+   if (materialize) return consumer->run(producer->run(n));
+   return fused->run(n);
+}
+pos_t F2_Op::run(pos_t n) {
+   if (adaptive) return adaptive->run(n, input, param1);
+   return operation(n, input, param1);
+}
 pos_t F3_Op::run(pos_t n) {
+   if (adaptive) return adaptive->run(n, outputSelectionV, param1, param2);
    return operation(n, outputSelectionV, param1, param2);
 }
 pos_t F4_Op::run(pos_t n) {
+   if (adaptive)
+      return adaptive->run(n, inputSelectionV, outputSelectionV, param1,
+                           param2);
    return operation(n, inputSelectionV, outputSelectionV, param1, param2);
 }
+
+void F1_Op::compile(Instruction& i) {
+   i.kind = Instruction::F1;
+   i.primitive = reinterpret_cast<Instruction::Primitive>(operation);
+   i.args[0] = &input;
+}
+void F2_Op::compile(Instruction& i) {
+   if (adaptive) return Op::compile(i);
+   i.kind = Instruction::F2;
+   i.primitive = reinterpret_cast<Instruction::Primitive>(operation);
+   i.args[0] = &input;
+   i.args[1] = &param1;
+}
+void F3_Op::compile(Instruction& i) {
+   if (adaptive) return Op::compile(i);
+   i.kind = Instruction::F3;
+   i.primitive = reinterpret_cast<Instruction::Primitive>(operation);
+   i.args[0] = &outputSelectionV;
+   i.args[1] = &param1;
+   i.args[2] = &param2;
+}
+void F4_Op::compile(Instruction& i) {
+   if (adaptive) return Op::compile(i);
+   i.kind = Instruction::F4;
+   i.primitive = reinterpret_cast<Instruction::Primitive>(operation);
+   i.args[0] = &inputSelectionV;
+   i.args[1] = &outputSelectionV;
+   i.args[2] = &param1;
+   i.args[3] = &param2;
+}
+
+MicroAdaptivity microAdaptivity;
+
+FlavorChooser::FlavorChooser(size_t nrFlavors, const MicroAdaptivity& settings)
+    : cycles(nrFlavors, 0), tuples(nrFlavors, 0),
+      exploreCalls(std::max<uint32_t>(settings.exploreCalls, 1)),
+      exploitCalls(settings.exploitCalls) {}
+
+size_t FlavorChooser::next(bool& measure) {
+   const uint64_t exploreEnd = cycles.size() * exploreCalls;
+   const uint64_t phase = calls++ % (exploreEnd + exploitCalls);
+   if (phase < exploreEnd) {
+      auto flavor = phase / exploreCalls;
+      if (phase % exploreCalls == 0) cycles[flavor] = tuples[flavor] = 0;
+      measure = true;
+      return flavor;
+   }
+   if (phase == exploreEnd) {
+      // pick the flavor with the lowest cycles per tuple, flavors that only
+      // saw empty vectors are not comparable and keep the previous choice
+      double bestCost = std::numeric_limits<double>::max();
+      for (size_t f = 0; f < cycles.size(); ++f) {
+         if (!tuples[f]) continue;
+         auto cost = double(cycles[f]) / tuples[f];
+         if (cost < bestCost) {
+            bestCost = cost;
+            best = f;
+         }
+      }
+   }
+   measure = false;
+   return best;
+}
+
+void FlavorChooser::record(size_t flavor, uint64_t c, pos_t n) {
+   cycles[flavor] += c;
+   tuples[flavor] += n;
+}
 }
@@ -3,9 +3,14 @@
 #include "common/runtime/Concurrency.hpp"
 #include "common/runtime/SIMD.hpp"
 #include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cxxabi.h>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 #include <tuple>
+#include <unistd.h>
 
 #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
 #include <x86intrin.h>
@@ -18,6 +23,155 @@ namespace vectorwise {
 
 using runtime::barrier;
 
+bool analyze = false;
+
+static std::mutex analyzedMutex;
+static std::unique_ptr<PlanStats> analyzed;
+
+std::unique_ptr<PlanStats> takeAnalyzedPlan() {
+   std::lock_guard<std::mutex> lock(analyzedMutex);
+   return move(analyzed);
+}
+
+SharedStateManager::~SharedStateManager() {
+   if (stats->empty()) return;
+   std::lock_guard<std::mutex> lock(analyzedMutex);
+   analyzed = move(stats);
+}
+
+void OperatorStats::note(const std::string& what, uint64_t count) {
+   std::lock_guard<std::mutex> lock(notesMutex);
+   notes[what] += count;
+}
+
+OperatorStats& PlanStats::get(size_t nr) {
+   std::lock_guard<std::mutex> lock(m);
+   while (operators.size() <= nr) operators.emplace_back();
+   return operators[nr];
+}
+
+void PlanStats::describe(size_t nr, std::string name,
+                         std::vector<size_t> children) {
+   auto& op = get(nr);
+   std::lock_guard<std::mutex> lock(m);
+   if (!op.name.empty()) return;
+   op.name = move(name);
+   op.children = move(children);
+}
+
+std::vector<size_t> PlanStats::roots() const {
+   std::vector<bool> isChild(operators.size());
+   for (auto& op : operators)
+      for (auto c : op.children) isChild[c] = true;
+   std::vector<size_t> result;
+   for (size_t nr = operators.size(); nr--;)
+      if (!isChild[nr]) result.push_back(nr);
+   return result;
+}
+
+uint64_t PlanStats::selfCycles(size_t nr) const {
+   auto& op = operators[nr];
+   uint64_t children = 0;
+   for (auto c : op.children) children += operators[c].cycles;
+   return op.cycles > children ? op.cycles - children : 0;
+}
+
+void PlanStats::print(std::ostream& out, size_t nr, size_t depth,
+                      uint64_t total) {
+   auto& op = operators[nr];
+   auto self = selfCycles(nr);
+   out << std::string(depth * 2, ' ') << op.name << "  tuples " << op.tuples
+       << "  calls " << op.calls << "  cycles " << op.cycles << "  self "
+       << self << " (" << (total ? 100.0 * self / total : 0.0) << "%)";
+   if (op.htEntries) out << "  ht entries " << op.htEntries;
+   if (op.spilledBytes) out << "  spilled " << op.spilledBytes << " B";
+   for (auto& n : op.notes) out << "  " << n.first << " " << n.second;
+   out << "\n";
+   for (auto c : op.children) print(out, c, depth + 1, total);
+}
+
+void PlanStats::print(std::ostream& out) {
+   uint64_t total = 0;
+   auto r = roots();
+   for (auto nr : r) total += operators[nr].cycles;
+   for (auto nr : r) print(out, nr, 0, total);
+}
+
+void PlanStats::printJson(std::ostream& out, size_t nr) {
+   auto& op = operators[nr];
+   out << "{\"name\":\"";
+   for (auto c : op.name) {
+      if (c == '"' || c == '\\') out << '\\';
+      out << c;
+   }
+   out << "\",\"tuples\":" << op.tuples << ",\"calls\":" << op.calls
+       << ",\"cycles\":" << op.cycles << ",\"selfCycles\":" << selfCycles(nr)
+       << ",\"htEntries\":" << op.htEntries
+       << ",\"spilledBytes\":" << op.spilledBytes << ",\"notes\":{";
+   for (auto n = op.notes.begin(); n != op.notes.end(); ++n)
+      out << (n == op.notes.begin() ? "" : ",") << "\"" << n->first
+          << "\":" << n->second;
+   out << "},\"children\":[";
+   for (size_t i = 0; i < op.children.size(); ++i) {
+      if (i) out << ",";
+      printJson(out, op.children[i]);
+   }
+   out << "]}";
+}
+
+void PlanStats::printJson(std::ostream& out) {
+   out << "[";
+   auto r = roots();
+   for (size_t i = 0; i < r.size(); ++i) {
+      if (i) out << ",";
+      printJson(out, r[i]);
+   }
+   out << "]\n";
+}
+
+static std::string operatorName(const Operator& op) {
+   auto mangled = typeid(op).name();
+   int status;
+   std::unique_ptr<char, void (*)(void*)> demangled(
+       abi::__cxa_demangle(mangled, nullptr, nullptr, &status), std::free);
+   std::string name = status == 0 ? demangled.get() : mangled;
+   std::string prefix = "vectorwise::";
+   if (name.compare(0, prefix.size(), prefix) == 0)
+      name = name.substr(prefix.size());
+   return name;
+}
+
+Profiled::Profiled(std::unique_ptr<Operator> o, PlanStats& p, size_t n)
+    : plan(p), nr(n), op(move(o)) {}
+
+Profiled::~Profiled() {
+   auto& stats = plan.get(nr);
+   stats.calls += calls;
+   stats.tuples += tuples;
+   stats.cycles += cycles;
+   op->addStats(stats);
+   std::vector<size_t> children;
+   auto add = [&](const std::unique_ptr<Operator>& child) {
+      if (auto p = dynamic_cast<Profiled*>(child.get()))
+         children.push_back(p->nr);
+   };
+   if (auto u = dynamic_cast<UnaryOperator*>(op.get())) add(u->child);
+   if (auto b = dynamic_cast<BinaryOperator*>(op.get())) {
+      add(b->left);
+      add(b->right);
+   }
+   plan.describe(nr, operatorName(*op), move(children));
+}
+
+size_t Profiled::next() {
+   auto start = cycleCounter();
+   auto n = op->next();
+   cycles += cycleCounter() - start;
+   calls++;
+   tuples += n;
+   return n;
+}
+
 size_t Select::next() {
    while (true) {
       auto n = child->next();
@@ -27,6 +181,28 @@ size_t Select::next() {
    }
 }
 
+size_t AdaptiveSelect::next() {
+   while (true) {
+      auto n = child->next();
+      if (n == EndOfStream) return EndOfStream;
+      auto found = condition->evaluate(n);
+      if (found == 0) continue;
+      if (found == n) {
+         kind = SelectionKind::All;
+         return n;
+      }
+      if (found >= n * bitmapDensity) {
+         kind = SelectionKind::Bitmap;
+         if (!bitmapCondition)
+            primitives::sel_to_bitmap(found, selection, n, bitmap);
+         return n;
+      }
+      kind = SelectionKind::List;
+      if (bitmapCondition) primitives::bitmap_to_sel(n, selection, bitmap);
+      return found;
+   }
+}
+
 size_t Project::next() {
    auto n = child->next();
    if (n == EndOfStream) return EndOfStream;
@@ -48,62 +224,93 @@ size_t FixedAggr::next() {
 }
 
 Scan::Scan(Shared& s, size_t n, size_t v)
-    : shared(s), needsInit(true), currentChunk(0), lastOffset(0), nrTuples(n),
-      vecSize(v) {
+    : shared(s), needsInit(true), nrTuples(n), vecSize(v),
+      worker(runtime::this_worker->worker_id) {
    scanChunkSize = 1;
    // TODO: make this read a env var?
    size_t scanMorselSize = 1024 * 10;
    if (vecSize < scanMorselSize) scanChunkSize = scanMorselSize / vecSize + 1;
    vecInChunk = scanChunkSize;
+   std::call_once(shared.init, [&]() {
+      shared.workers = runtime::this_worker->group->size;
+      shared.claimed.reset(new Shared::PaddedAtomic[shared.workers]);
+   });
 }
 
 void Scan::addConsumer(void** colPtr, size_t typeSize) {
-   consumers.emplace_back(colPtr, vecSize * typeSize);
+   consumers.push_back({colPtr, typeSize, nullptr});
 }
 
-size_t Scan::next() {
-   auto step = 1;
-
-   if (vecInChunk == scanChunkSize) {
-      // Determine which NUMA region this thread belongs to and claim the next
-      // chunk from that region's counter.  relaxed is sufficient: the counter
-      // only determines *which* chunk we own; the subsequent pointer arithmetic
-      // and data reads impose no cross-thread ordering requirement on the
-      // counter itself.
-      auto thread_id = runtime::this_worker->worker_id;
-      auto numthreads = runtime::this_worker->group->size;
-      auto region_id  = runtime::regionOf(thread_id);
-      auto prevChunk  = currentChunk;
-      currentChunk = shared.pos[region_id].val.fetch_add(1, std::memory_order_relaxed);
-
-      // Work-claiming formula:
-      //   offset = (totalsize / numthreads) * thread_id + pos * chunksize
-      // Each thread owns its own slice of the input; pos walks within that slice.
-      auto sliceSize   = nrTuples / numthreads;
-      auto sliceOffset = sliceSize * thread_id;
-      auto chunkSkip   = currentChunk - prevChunk;
-      if (needsInit) {
-         // First claim: jump to thread's slice start + pos * chunksize
-         // (chunkSkip * scanChunkSize gives the initial offset within the slice)
-         step = static_cast<size_t>(sliceOffset / vecSize) + chunkSkip * scanChunkSize;
-         // Reset lastOffset so nextBegin is computed from 0 on the first call
-         lastOffset = 0;
-         needsInit = false;
-      } else {
-         chunkSkip -= 1;
-         step = chunkSkip * scanChunkSize + 1;
+size_t Scan::nrMorsels() const {
+   auto morselSize = scanChunkSize * vecSize;
+   return (nrTuples + morselSize - 1) / morselSize;
+}
+
+std::pair<size_t, size_t> Scan::range(size_t w) const {
+   auto n = nrMorsels();
+   return {n * w / shared.workers, n * (w + 1) / shared.workers};
+}
+
+size_t Scan::remaining(size_t w) const {
+   auto r = range(w);
+   auto claimed = shared.claimed[w].val.load(std::memory_order_relaxed);
+   return claimed < r.second - r.first ? r.second - r.first - claimed : 0;
+}
+
+bool Scan::claimFrom(size_t w) {
+   auto r = range(w);
+   auto claimed = shared.claimed[w].val.fetch_add(1, std::memory_order_relaxed);
+   if (r.first + claimed >= r.second) return false;
+   morselBegin = (r.first + claimed) * scanChunkSize * vecSize;
+   return true;
+}
+
+bool Scan::claimMorsel() {
+   if (worker < shared.workers && claimFrom(worker)) return true;
+   // steal from the worker with the most morsels left, which is the one
+   // most likely to finish last, first within the own NUMA region
+   auto region = runtime::regionOf(worker);
+   for (bool sameRegion : {true, false}) {
+      while (true) {
+         size_t victim = shared.workers, most = 0;
+         for (size_t w = 0; w < shared.workers; ++w) {
+            if (sameRegion && runtime::regionOf(w) != region) continue;
+            auto left = remaining(w);
+            if (left > most) {
+               most = left;
+               victim = w;
+            }
+         }
+         if (victim == shared.workers) break;
+         if (claimFrom(victim)) {
+            stolen++;
+            return true;
+         }
       }
-      vecInChunk = 0;
    }
+   return false;
+}
 
-   auto nextBegin = lastOffset + step * vecSize;
-   if (nextBegin >= nrTuples) return EndOfStream;
-   auto nextBatchSize = std::min(nrTuples - nextBegin, vecSize);
+size_t Scan::next() {
+   if (needsInit) {
+      for (auto& cons : consumers)
+         cons.column = reinterpret_cast<uint8_t*>(*cons.colPtr);
+      needsInit = false;
+   }
+   auto begin = morselBegin + vecInChunk * vecSize;
+   if (vecInChunk == scanChunkSize || begin >= nrTuples) {
+      if (!claimMorsel()) return EndOfStream;
+      vecInChunk = 0;
+      begin = morselBegin;
+   }
    for (auto& cons : consumers)
-      *cons.first = (void*)(*(uint8_t**)cons.first + step * cons.second);
-   lastOffset = nextBegin;
+      *cons.colPtr = cons.column + begin * cons.typeSize;
    vecInChunk++;
-   return nextBatchSize;
+   return std::min(nrTuples - begin, vecSize);
+}
+
+void Scan::addStats(OperatorStats& stats) const {
+   if (stolen) stats.note("stolen morsels", stolen);
 }
 
 ResultWriter::Input::Input(void* d, size_t size,
@@ -777,6 +984,80 @@ pos_t Hashjoin::joinBoncz() {
    return 0;
 }
 
+static size_t cacheSize() {
+   static const size_t size = [] {
+      auto l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+      return l2 > 0 ? size_t(l2) : size_t(1) << 20;
+   }();
+   return size;
+}
+
+static const char* joinName(pos_t (Hashjoin::*join)()) {
+   if (join == &Hashjoin::joinAll) return "joinAll";
+   if (join == &Hashjoin::joinAllParallel) return "joinAllParallel";
+   if (join == &Hashjoin::joinAllSIMD) return "joinAllSIMD";
+   if (join == &Hashjoin::joinSel) return "joinSel";
+   if (join == &Hashjoin::joinSelParallel) return "joinSelParallel";
+   if (join == &Hashjoin::joinSelSIMD) return "joinSelSIMD";
+   return "joinBoncz";
+}
+
+void Hashjoin::chooseJoinCandidates() {
+   auto& a = adaptive;
+   bool sel = probeSel;
+   auto serial = sel ? &Hashjoin::joinSel : &Hashjoin::joinAll;
+   auto interleaved =
+       sel ? &Hashjoin::joinSelParallel : &Hashjoin::joinAllParallel;
+   // chains of a ht in cache are cheap to follow one after another, the
+   // interleaved joins hide the cache misses of larger ones, but sparse probe
+   // vectors do not amortize their followup buffer
+   auto htBytes = shared.found.load() * (ht_entry_size + sizeof(void*));
+   bool inCache = htBytes <= cacheSize();
+   bool dense = cont.numProbes * 4 >= batchSize;
+   if (inCache || !dense)
+      a.candidates = {serial, interleaved};
+   else
+      a.candidates = {interleaved, serial};
+   // the SIMD joins only gather 32 bit hashes, otherwise they run scalar
+#if defined(__AVX512F__) && HASH_SIZE == 32
+   if (__builtin_cpu_supports("avx512f")) {
+      auto simd = sel ? &Hashjoin::joinSelSIMD : &Hashjoin::joinAllSIMD;
+      a.candidates.insert(inCache ? a.candidates.end() : a.candidates.begin(),
+                          simd);
+   }
+#endif
+   a.chooser =
+       std::make_unique<FlavorChooser>(a.candidates.size(), microAdaptivity);
+   a.vectors.assign(a.candidates.size(), 0);
+}
+
+pos_t Hashjoin::joinAdaptive() {
+   auto& a = adaptive;
+   if (a.candidates.empty()) chooseJoinCandidates();
+   if (!a.inVector) {
+      // a probe vector runs with one implementation, their continuations are
+      // not compatible
+      a.current = a.chooser->next(a.measure);
+      if (!a.measure && a.current != a.exploited) {
+         a.switches++;
+         a.exploited = a.current;
+      }
+      a.inVector = true;
+      a.cycles = 0;
+      a.vectors[a.current]++;
+      a.probes += cont.numProbes;
+   }
+   auto start = cycleCounter();
+   auto found = (this->*a.candidates[a.current])();
+   a.cycles += cycleCounter() - start;
+   a.matches += found;
+   if (cont.nextProbe >= cont.numProbes) {
+      a.inVector = false;
+      if (a.measure) a.chooser->record(a.current, a.cycles, cont.numProbes);
+   }
+   return found;
+}
+
 size_t Hashjoin::next() {
    using runtime::Hashmap;
    // --- build
@@ -787,9 +1068,19 @@ size_t Hashjoin::next() {
          found += n;
          // build hashes
          buildHash.evaluate(n);
-         // scatter hash, keys and values into ht entries
-         auto alloc =
-             runtime::this_worker->allocator.allocate(n * ht_entry_size);
+         // scatter hash, keys and values into ht entries, beyond the memory
+         // budget they are placed in file backed memory
+         auto bytes = n * ht_entry_size;
+         void* alloc;
+         if (runtime::overSpillBudget()) {
+            if (!overflow)
+               overflow = std::make_unique<runtime::FileBackedArena>();
+            alloc = overflow->allocate(bytes);
+         } else {
+            alloc = runtime::this_worker->allocator.allocate(bytes);
+            accounted += bytes;
+            runtime::spillableBytes += bytes;
+         }
          if (!alloc) throw std::runtime_error("malloc failed");
          allocations.push_back(std::make_pair(alloc, n));
          scatterStart = reinterpret_cast<decltype(scatterStart)>(alloc);
@@ -833,10 +1124,234 @@ size_t Hashjoin::next() {
 
 Hashjoin::Hashjoin(Shared& sm) : shared(sm) {}
 
+void Hashjoin::addStats(OperatorStats& stats) const {
+   for (auto& block : allocations) stats.htEntries += block.second;
+   if (overflow) stats.spilledBytes += overflow->size();
+   auto& a = adaptive;
+   for (size_t i = 0; i < a.candidates.size(); ++i)
+      stats.note(std::string("vectors ") + joinName(a.candidates[i]),
+                 a.vectors[i]);
+   if (a.chooser) {
+      stats.note("join switches", a.switches);
+      stats.note("probes", a.probes);
+      stats.note("hash matches", a.matches);
+   }
+}
+
 Hashjoin::~Hashjoin() {
+   runtime::spillableBytes -= accounted;
    // for (auto& block : allocations) free(block.first);
 }
 
+size_t Fetch::next() {
+   auto n = child->next();
+   if (n != EndOfStream) gather.evaluate(n);
+   return n;
+}
+
+MergeJoin::MergeJoin(Shared& s) : shared(s) {}
+
+MergeJoin::Run MergeJoin::buildRun() {
+   size_t found = 0;
+   for (auto n = left->next(); n != EndOfStream; n = left->next()) {
+      localRows.resize((found + n) * rowSize);
+      scatterStart = localRows.data() + found * rowSize;
+      buildKey.evaluate(n);
+      buildScatter.evaluate(n);
+      found += n;
+   }
+   if (!found) return {nullptr, 0};
+
+   // inputs clustered on the join key arrive sorted, others are sorted here
+   auto row = [&](size_t i) { return localRows.data() + i * rowSize; };
+   bool sorted = true;
+   for (size_t i = 1; i < found && sorted; ++i)
+      sorted = keyOf(row(i - 1)) <= keyOf(row(i));
+   if (!sorted) {
+      std::vector<uint32_t> order(found);
+      for (size_t i = 0; i < found; ++i) order[i] = i;
+      std::stable_sort(order.begin(), order.end(),
+                       [&](uint32_t a, uint32_t b) {
+                          return keyOf(row(a)) < keyOf(row(b));
+                       });
+      std::vector<uint8_t> sortedRows(found * rowSize);
+      for (size_t i = 0; i < found; ++i)
+         std::memcpy(sortedRows.data() + i * rowSize, row(order[i]), rowSize);
+      localRows.swap(sortedRows);
+   }
+   return {localRows.data(), found};
+}
+
+size_t MergeJoin::lowerBound(const Run& run, int64_t key) {
+   size_t lo = 0, hi = run.n;
+   while (lo < hi) {
+      auto mid = (lo + hi) / 2;
+      if (keyOf(run.rows + mid * rowSize) < key)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+void MergeJoin::prepareMerge() {
+   shared.n = 0;
+   for (auto& run : shared.runs) shared.n += run.n;
+   if (!shared.n) return;
+   auto& allocator = runtime::this_worker->allocator;
+   shared.rows =
+       reinterpret_cast<uint8_t*>(allocator.allocate(shared.n * rowSize));
+   shared.keys = reinterpret_cast<int64_t*>(
+       allocator.allocate(shared.n * sizeof(int64_t)));
+   if (!shared.rows || !shared.keys) throw std::runtime_error("malloc failed");
+
+   // one key range per worker, chosen from keys sampled from all runs
+   auto workers = runtime::this_worker->group->size;
+   auto nrPartitions =
+       std::max<size_t>(1, std::min<size_t>(workers, shared.n / batchSize));
+   if (nrPartitions == 1) return;
+   std::vector<int64_t> samples;
+   auto samplesPerRun = nrPartitions * 16;
+   for (auto& run : shared.runs) {
+      auto step = std::max<size_t>(1, run.n / samplesPerRun);
+      for (size_t i = 0; i < run.n; i += step)
+         samples.push_back(keyOf(run.rows + i * rowSize));
+   }
+   std::sort(samples.begin(), samples.end());
+   for (size_t p = 1; p < nrPartitions; ++p)
+      shared.splitters.push_back(samples[p * samples.size() / nrPartitions]);
+}
+
+void MergeJoin::mergePartition(size_t p) {
+   // partition p holds the keys in [splitters[p - 1], splitters[p]), so
+   // that all build rows of a key end up in the same partition
+   auto& splitters = shared.splitters;
+   struct Cursor {
+      uint8_t* pos;
+      uint8_t* end;
+   };
+   std::vector<Cursor> cursors;
+   size_t offset = 0;
+   for (auto& run : shared.runs) {
+      auto begin = p ? lowerBound(run, splitters[p - 1]) : 0;
+      auto end = p < splitters.size() ? lowerBound(run, splitters[p]) : run.n;
+      offset += begin;
+      if (begin < end)
+         cursors.push_back(
+             {run.rows + begin * rowSize, run.rows + end * rowSize});
+   }
+   auto target = shared.rows + offset * rowSize;
+   auto keys = shared.keys + offset;
+
+   auto greater = [](const Cursor& a, const Cursor& b) {
+      return keyOf(a.pos) > keyOf(b.pos);
+   };
+   std::make_heap(cursors.begin(), cursors.end(), greater);
+   while (!cursors.empty()) {
+      std::pop_heap(cursors.begin(), cursors.end(), greater);
+      auto& c = cursors.back();
+      std::memcpy(target, c.pos, rowSize);
+      *keys++ = keyOf(c.pos);
+      target += rowSize;
+      c.pos += rowSize;
+      if (c.pos == c.end)
+         cursors.pop_back();
+      else
+         std::push_heap(cursors.begin(), cursors.end(), greater);
+   }
+}
+
+size_t MergeJoin::gallop(int64_t key, size_t from) {
+   auto keys = shared.keys;
+   auto n = shared.n;
+   // probe keys of a worker ascend for clustered inputs, otherwise restart
+   if (from > 0 && keys[from - 1] >= key) from = 0;
+   // grow the step until it passes the key, then halve the remaining range
+   // down to one block of 8 keys
+   size_t lo = from, step = 8;
+   while (lo + step < n && keys[lo + step] < key) {
+      lo += step + 1;
+      step *= 2;
+   }
+   auto hi = std::min(n, lo + step + 1);
+   while (hi - lo > 8) {
+      auto mid = lo + (hi - lo) / 2;
+      if (keys[mid] < key)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+#if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) ||               \
+    defined(SIMDE_ENABLE_NATIVE_ALIASES)
+   // count the keys of the block which are smaller
+   __mmask8 valid = (1u << (hi - lo)) - 1;
+   auto block = _mm512_maskz_loadu_epi64(valid, keys + lo);
+   auto smaller =
+       _mm512_mask_cmplt_epi64_mask(valid, block, _mm512_set1_epi64(key));
+   return lo + __builtin_popcount(smaller);
+#else
+   while (lo < hi && keys[lo] < key) ++lo;
+   return lo;
+#endif
+}
+
+pos_t MergeJoin::join() {
+   pos_t found = 0;
+   while (cont.nextProbe < cont.numProbes) {
+      auto pos = probeSel ? probeSel[cont.nextProbe] : cont.nextProbe;
+      if (cont.match == cont.matchEnd) {
+         auto key = probeKeys[pos];
+         cont.cursor = gallop(key, cont.cursor);
+         cont.match = cont.matchEnd = cont.cursor;
+         while (cont.matchEnd < shared.n && shared.keys[cont.matchEnd] == key)
+            cont.matchEnd++;
+      }
+      // a probe tuple with many build matches may span several vectors
+      for (; cont.match < cont.matchEnd && found < batchSize;
+           ++cont.match, ++found) {
+         buildMatches[found] = shared.rows + cont.match * rowSize;
+         probeMatches[found] = pos;
+      }
+      if (cont.match < cont.matchEnd) return found;
+      cont.nextProbe++;
+      if (found == batchSize) return found;
+   }
+   return found;
+}
+
+size_t MergeJoin::next() {
+   // --- build
+   if (!consumed) {
+      auto run = buildRun();
+      if (run.n) {
+         std::lock_guard<std::mutex> lock(shared.runsMutex);
+         shared.runs.push_back(run);
+      }
+      barrier([&]() { prepareMerge(); });
+      if (shared.n)
+         for (auto p = shared.partition.fetch_add(1);
+              p <= shared.splitters.size(); p = shared.partition.fetch_add(1))
+            mergePartition(p);
+      consumed = true;
+      barrier(); // wait for all threads to finish merging
+      if (shared.n == 0) return EndOfStream;
+   }
+   // --- probe
+   while (true) {
+      if (cont.nextProbe >= cont.numProbes) {
+         cont.numProbes = right->next();
+         cont.nextProbe = 0;
+         if (cont.numProbes == EndOfStream) return EndOfStream;
+         probeKey.evaluate(cont.numProbes);
+      }
+      auto n = join();
+      if (n == 0) continue;
+      // materialize build side
+      buildGather.evaluate(n);
+      return n;
+   }
+}
+
 HashGroup::HashGroup(Shared& s)
     : shared(s), preAggregation(*this), globalAggregation(*this) {
    maxFill = ht.setSize(initialMapSize);
@@ -846,6 +1361,14 @@ HashGroup::~HashGroup() {
    // for (auto& alloc : globalAggregation.allocations) free(alloc.first);
 }
 
+void HashGroup::addStats(OperatorStats& stats) const {
+   auto& spills = shared.spillStorage.threadData;
+   auto local = spills.find(std::this_thread::get_id());
+   if (local != spills.end()) stats.spilledBytes += local->second.spilledBytes();
+   stats.htEntries += globalGroups;
+   stats.note("preaggregated groups", localGroups);
+}
+
 pos_t HashGroup::findGroupsFromPartition(void* data, size_t n) {
    globalAggregation.groupHashes = reinterpret_cast<hash_t*>(data);
    return globalAggregation.findGroups(n, ht);
@@ -886,10 +1409,12 @@ size_t HashGroup::next() {
          // 4. Aggregate: update accumulators for all matched groups
          updateGroups.evaluate(n);
          groups += groupsCreated;
+         localGroups += groupsCreated;
          if (groups >= maxFill) flushAndClear();
       }
       flushAndClear(); // flush remaining entries into spillStorage
-      barrier();       // Wait until all workers have finished phase 1
+      spill.finishWrites();
+      barrier(); // Wait until all workers have finished phase 1
 
       cont.consumed = true;
       cont.partition = shared.partition.fetch_add(1);
@@ -903,26 +1428,27 @@ size_t HashGroup::next() {
          auto partNr = cont.partition;
          // for all thread local partitions
          for (auto& threadPartitions : shared.spillStorage.threadData) {
-            // aggregate data from thread local partition
-            auto& partition = threadPartitions.second.getPartitions()[partNr];
-            for (auto chunk = partition.first; chunk; chunk = chunk->next) {
-               auto elementSize = threadPartitions.second.entrySize;
-               auto nPart = partition.size(chunk, elementSize);
+            // aggregate data from thread local partition, spilled chunks are
+            // read back one at a time
+            auto& deque = threadPartitions.second;
+            auto elementSize = deque.entrySize;
+            deque.forEachChunk(partNr, [&](void* chunk, size_t nPart) {
                for (size_t n = std::min(nPart, vecSize), pos = 0; n;
                     nPart -= n, pos += n, n = std::min(nPart, vecSize)) {
 
                   // communicate data position of current chunk to primitives
                   // for group lookup and creation
-                  auto data = addBytes(chunk->data<void>(), pos * elementSize);
+                  auto data = addBytes(chunk, pos * elementSize);
                   globalAggregation.rowData = data;
                   findGroupsFromPartition(data, n);
                   auto cGroups = [&]() INTERPRET_SEPARATE {
-                     globalAggregation.createMissingGroups(ht, true);
+                     globalGroups +=
+                         globalAggregation.createMissingGroups(ht, true);
                   };
                   cGroups();
                   updateGroupsFromPartition.evaluate(n);
                }
-            }
+            });
          }
          cont.partitionNeedsAggregation = false;
          cont.iter = globalAggregation.allocations.begin();
@@ -950,4 +1476,393 @@ size_t HashGroup::next() {
    }
    return EndOfStream;
 }
+
+Sort::Sort(Shared& s) : shared(s) {}
+
+Sort::Run Sort::sortRun(size_t n) {
+   auto& allocator = runtime::this_worker->allocator;
+   auto out = reinterpret_cast<uint8_t*>(allocator.allocate(n * rowSize));
+   if (!out) throw std::runtime_error("malloc failed");
+   // histograms of all key bytes in one pass over the rows
+   std::vector<std::array<size_t, 256>> histograms(keySize);
+   for (auto& histogram : histograms) histogram.fill(0);
+   for (auto& block : allocations) {
+      auto row = reinterpret_cast<uint8_t*>(block.first);
+      for (size_t i = 0; i < block.second; ++i, row += rowSize)
+         for (size_t d = 0; d < keySize; ++d) histograms[d][row[d]]++;
+   }
+   // bytes which are equal in all rows do not change the order
+   std::vector<size_t> digits;
+   for (size_t d = keySize; d-- > 0;)
+      if (*std::max_element(histograms[d].begin(), histograms[d].end()) != n)
+         digits.push_back(d);
+   if (digits.empty()) {
+      auto target = out;
+      for (auto& block : allocations) {
+         std::memcpy(target, block.first, block.second * rowSize);
+         target += block.second * rowSize;
+      }
+      allocations.clear();
+      return {out, n};
+   }
+
+   // least significant digit first, passes alternate between both buffers so
+   // that the last one writes into out
+   uint8_t* buffers[2] = {out, nullptr};
+   if (digits.size() > 1) {
+      buffers[1] = reinterpret_cast<uint8_t*>(allocator.allocate(n * rowSize));
+      if (!buffers[1]) throw std::runtime_error("malloc failed");
+   }
+   size_t target = digits.size() % 2 ? 0 : 1;
+   std::array<size_t, 256> offsets;
+   auto prefixSum = [&](size_t d) {
+      size_t sum = 0;
+      for (size_t b = 0; b < 256; ++b) {
+         offsets[b] = sum;
+         sum += histograms[d][b];
+      }
+   };
+   // the first pass reads from the materialized blocks
+   auto d = digits[0];
+   prefixSum(d);
+   for (auto& block : allocations) {
+      auto row = reinterpret_cast<uint8_t*>(block.first);
+      for (size_t i = 0; i < block.second; ++i, row += rowSize)
+         std::memcpy(buffers[target] + offsets[row[d]]++ * rowSize, row,
+                     rowSize);
+   }
+   for (size_t pass = 1; pass < digits.size(); ++pass) {
+      auto source = buffers[target];
+      target ^= 1;
+      d = digits[pass];
+      prefixSum(d);
+      auto row = source;
+      for (size_t i = 0; i < n; ++i, row += rowSize)
+         std::memcpy(buffers[target] + offsets[row[d]]++ * rowSize, row,
+                     rowSize);
+   }
+   allocations.clear();
+   return {out, n};
+}
+
+size_t Sort::lowerBound(const Run& run, const uint8_t* key) {
+   size_t lo = 0, hi = run.n;
+   while (lo < hi) {
+      auto mid = (lo + hi) / 2;
+      if (std::memcmp(run.rows + mid * rowSize, key, keySize) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return lo;
+}
+
+void Sort::prepareMerge() {
+   shared.n = 0;
+   for (auto& run : shared.runs) shared.n += run.n;
+   if (!shared.n) return;
+   shared.sorted = reinterpret_cast<uint8_t*>(
+       runtime::this_worker->allocator.allocate(shared.n * rowSize));
+   if (!shared.sorted) throw std::runtime_error("malloc failed");
+
+   // choose splitters from keys sampled evenly from all runs, several
+   // partitions per worker balance skewed partitions
+   auto workers = runtime::this_worker->group->size;
+   auto nrPartitions =
+       std::max<size_t>(1, std::min(workers * 4, shared.n / vecSize));
+   if (nrPartitions == 1) return;
+   std::vector<uint8_t*> samples;
+   auto samplesPerRun = nrPartitions * 16;
+   for (auto& run : shared.runs) {
+      auto step = std::max<size_t>(1, run.n / samplesPerRun);
+      for (size_t i = 0; i < run.n; i += step)
+         samples.push_back(run.rows + i * rowSize);
+   }
+   std::sort(samples.begin(), samples.end(), [&](uint8_t* a, uint8_t* b) {
+      return std::memcmp(a, b, keySize) < 0;
+   });
+   for (size_t p = 1; p < nrPartitions; ++p)
+      shared.splitters.push_back(samples[p * samples.size() / nrPartitions]);
+}
+
+void Sort::mergePartition(size_t p) {
+   // partition p holds the keys in [splitters[p - 1], splitters[p])
+   auto lower = p ? shared.splitters[p - 1] : nullptr;
+   auto upper = p < shared.splitters.size() ? shared.splitters[p] : nullptr;
+   struct Cursor {
+      uint8_t* pos;
+      uint8_t* end;
+   };
+   std::vector<Cursor> cursors;
+   // all keys smaller than the partition precede it in the result
+   size_t offset = 0;
+   for (auto& run : shared.runs) {
+      auto begin = lower ? lowerBound(run, lower) : 0;
+      auto end = upper ? lowerBound(run, upper) : run.n;
+      offset += begin;
+      if (begin < end)
+         cursors.push_back(
+             {run.rows + begin * rowSize, run.rows + end * rowSize});
+   }
+   auto target = shared.sorted + offset * rowSize;
+
+   // k-way merge with a heap of cursors ordered by their current key
+   auto greater = [&](const Cursor& a, const Cursor& b) {
+      return std::memcmp(a.pos, b.pos, keySize) > 0;
+   };
+   std::make_heap(cursors.begin(), cursors.end(), greater);
+   while (cursors.size() > 1) {
+      std::pop_heap(cursors.begin(), cursors.end(), greater);
+      auto& c = cursors.back();
+      std::memcpy(target, c.pos, rowSize);
+      target += rowSize;
+      c.pos += rowSize;
+      if (c.pos == c.end)
+         cursors.pop_back();
+      else
+         std::push_heap(cursors.begin(), cursors.end(), greater);
+   }
+   if (!cursors.empty())
+      std::memcpy(target, cursors[0].pos, cursors[0].end - cursors[0].pos);
+}
+
+size_t Sort::next() {
+   if (!consumed) {
+      /// ------ phase 1: sort the input of this worker into a run
+      size_t found = 0;
+      for (auto n = child->next(); n != EndOfStream; n = child->next()) {
+         auto alloc = runtime::this_worker->allocator.allocate(n * rowSize);
+         if (!alloc) throw std::runtime_error("malloc failed");
+         allocations.push_back(std::make_pair(alloc, n));
+         scatterStart = reinterpret_cast<uint8_t*>(alloc);
+         materialize.evaluate(n);
+         found += n;
+      }
+      mergeRuns(found ? sortRun(found) : Run{nullptr, 0});
+   }
+   return emit();
+}
+
+void Sort::mergeRuns(Run run) {
+   if (run.n) {
+      std::lock_guard<std::mutex> lock(shared.runsMutex);
+      shared.runs.push_back(run);
+   }
+   barrier([&]() { prepareMerge(); });
+
+   /// ------ phase 2: merge the runs of all workers
+   if (shared.n)
+      for (auto p = shared.partition.fetch_add(1); p <= shared.splitters.size();
+           p = shared.partition.fetch_add(1))
+         mergePartition(p);
+   barrier(); // wait until the result is complete
+   consumed = true;
+   // a single worker produces the result to keep it in order
+   if (runtime::this_worker->worker_id != 0) emitted = shared.n;
+}
+
+size_t Sort::emit() {
+   auto end = std::min(shared.n, limit);
+   if (emitted >= end) return EndOfStream;
+   auto n = std::min(vecSize, end - emitted);
+   outputStart = shared.sorted + emitted * rowSize;
+   gatherRows.evaluate(n);
+   emitted += n;
+   return n;
+}
+
+TopN::TopN(Shared& s, size_t l) : Sort(s), sharedThreshold(s.threshold) {
+   limit = l;
+}
+
+void TopN::insert(const uint8_t* candidate) {
+   auto worse = [&](uint32_t a, uint32_t b) {
+      return std::memcmp(row(a), row(b), keySize) < 0;
+   };
+   if (heap.size() < limit) {
+      auto slot = uint32_t(heap.size());
+      std::memcpy(row(slot), candidate, rowSize);
+      heap.push_back(slot);
+      std::push_heap(heap.begin(), heap.end(), worse);
+   } else if (std::memcmp(candidate, row(heap.front()), keySize) < 0) {
+      // replace the worst row
+      std::pop_heap(heap.begin(), heap.end(), worse);
+      std::memcpy(row(heap.back()), candidate, rowSize);
+      std::push_heap(heap.begin(), heap.end(), worse);
+   }
+}
+
+void TopN::publishThreshold() {
+   // the first bytes of the worst row bound the key prefix of better tuples,
+   // key bytes after the first key only make the bound weaker
+   uint64_t prefix = 0;
+   auto worst = row(heap.front());
+   for (size_t b = 0; b < 8; ++b)
+      prefix = (prefix << 8) | (b < keySize ? worst[b] : 0);
+   auto local = int64_t(prefix ^ (uint64_t(1) << 63));
+   auto current = sharedThreshold.load(std::memory_order_relaxed);
+   while (local < current &&
+          !sharedThreshold.compare_exchange_weak(current, local,
+                                                 std::memory_order_relaxed))
+      ;
+   threshold = std::min(local, current);
+}
+
+size_t TopN::next() {
+   if (!consumed) {
+      /// ------ phase 1: keep the best rows of the input of this worker
+      auto& allocator = runtime::this_worker->allocator;
+      slots = reinterpret_cast<uint8_t*>(allocator.allocate(limit * rowSize));
+      auto staging =
+          reinterpret_cast<uint8_t*>(allocator.allocate(vecSize * rowSize));
+      if (!slots || !staging) throw std::runtime_error("malloc failed");
+      heap.reserve(limit);
+      for (auto n = child->next(); n != EndOfStream; n = child->next()) {
+         // other workers may have found better rows
+         threshold = std::min(threshold,
+                              sharedThreshold.load(std::memory_order_relaxed));
+         n = thresholdSelection.evaluate(n);
+         if (!n) continue;
+         scatterStart = staging;
+         materialize.evaluate(n);
+         for (size_t i = 0; i < n; ++i) insert(staging + i * rowSize);
+         if (heap.size() == limit) publishThreshold();
+      }
+
+      // the sorted heap is the run of this worker
+      Run run{nullptr, heap.size()};
+      if (run.n) {
+         std::sort(heap.begin(), heap.end(), [&](uint32_t a, uint32_t b) {
+            return std::memcmp(row(a), row(b), keySize) < 0;
+         });
+         run.rows =
+             reinterpret_cast<uint8_t*>(allocator.allocate(run.n * rowSize));
+         if (!run.rows) throw std::runtime_error("malloc failed");
+         for (size_t i = 0; i < run.n; ++i)
+            std::memcpy(run.rows + i * rowSize, row(heap[i]), rowSize);
+      }
+      mergeRuns(run);
+   }
+   return emit();
+}
+
+Exchange::Shared::~Shared() {
+   for (auto& queue : queues) {
+      Batch* b = nullptr;
+      while (queue.try_pop(b)) delete b;
+   }
+}
+
+Exchange::Exchange(Shared& s, Mode m, size_t v)
+    : shared(s), mode(m), vecSize(v) {}
+
+Exchange::~Exchange() {
+   for (auto b : staged) delete b;
+}
+
+size_t Exchange::target(defs::hash_t hash, size_t workers) {
+   // high hash bits, the low ones select hash table buckets
+   constexpr auto half = sizeof(defs::hash_t) * 4;
+   return ((hash >> half) * workers) >> half;
+}
+
+Exchange::Batch* Exchange::newBatch() {
+   auto b = new Batch();
+   b->data.reset(new uint8_t[batchSize]);
+   return b;
+}
+
+void Exchange::append(Batch& b, pos_t n, pos_t* sel) {
+   for (auto& c : columns) {
+      auto in = reinterpret_cast<uint8_t*>(c.input);
+      auto out = b.data.get() + c.offset + b.n * c.size;
+      if (!sel)
+         memcpy(out, in, n * c.size);
+      else
+         for (pos_t i = 0; i < n; ++i, out += c.size)
+            memcpy(out, in + sel[i] * c.size, c.size);
+   }
+   b.n += n;
+}
+
+bool Exchange::produce() {
+   auto workers = runtime::this_worker->group->size;
+   auto n = child->next();
+   if (n == EndOfStream) {
+      // flush the partially filled batches before others may finish
+      for (size_t t = 0; t < staged.size(); ++t) {
+         if (staged[t]->n)
+            shared.queues[t].push(staged[t]);
+         else
+            delete staged[t];
+      }
+      staged.clear();
+      producing = false;
+      shared.producers.fetch_sub(1);
+      return false;
+   }
+   switch (mode) {
+   case Mode::Repartition: {
+      if (!hashes) throw std::runtime_error("Repartition requires hashes");
+      if (staged.empty())
+         for (size_t t = 0; t < workers; ++t) staged.push_back(newBatch());
+      for (pos_t i = 0; i < n; ++i) {
+         auto t = target(hashes[i], workers);
+         auto& b = *staged[t];
+         pos_t position = inputSelection ? inputSelection[i] : i;
+         append(b, 1, &position);
+         if (b.n == vecSize) {
+            shared.queues[t].push(staged[t]);
+            staged[t] = newBatch();
+         }
+      }
+      break;
+   }
+   case Mode::Broadcast:
+      for (size_t t = 0; t < workers; ++t) {
+         auto b = newBatch();
+         append(*b, n, inputSelection);
+         shared.queues[t].push(b);
+      }
+      break;
+   case Mode::Gather: {
+      auto b = newBatch();
+      append(*b, n, inputSelection);
+      shared.queues[0].push(b);
+      break;
+   }
+   }
+   return true;
+}
+
+size_t Exchange::consume(Batch* b) {
+   auto n = b->n;
+   for (auto& c : columns)
+      memcpy(c.output, b->data.get() + c.offset, n * c.size);
+   delete b;
+   return n;
+}
+
+size_t Exchange::next() {
+   auto worker = runtime::this_worker;
+   std::call_once(shared.initialized, [&]() {
+      shared.queues.resize(worker->group->size);
+      shared.producers = worker->group->size;
+   });
+   auto& queue = shared.queues[worker->worker_id];
+   Batch* b = nullptr;
+   while (true) {
+      if (queue.try_pop(b)) return consume(b);
+      if (producing) {
+         produce();
+         continue;
+      }
+      if (shared.producers.load() == 0) {
+         // every push happened before the last producer finished
+         if (queue.try_pop(b)) return consume(b);
+         return EndOfStream;
+      }
+      std::this_thread::yield();
+   }
+}
 } // namespace vectorwise
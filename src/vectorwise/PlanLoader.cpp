@@ -0,0 +1,635 @@
+#include "vectorwise/PlanLoader.hpp"
+#include "vectorwise/Primitives.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <sstream>
+#include <stdexcept>
+
+namespace vectorwise {
+
+using namespace std;
+using Arg = PlanDescription::Arg;
+using Line = PlanDescription::Line;
+using Statement = PlanDescription::Statement;
+
+namespace {
+using JoinFn = pos_t (Hashjoin::*)();
+
+const unordered_map<string, JoinFn> joins = {
+    {"all", &Hashjoin::joinAllParallel},
+    {"sel", &Hashjoin::joinSelParallel},
+    {"boncz", &Hashjoin::joinBoncz},
+    {"allsimd", &Hashjoin::joinAllSIMD},
+    {"selsimd", &Hashjoin::joinSelSIMD},
+    {"adaptive", &Hashjoin::joinAdaptive}};
+
+/// function pointer types of the primitives
+#define EACH_SIGNATURE(m)                                                      \
+   m(F1) m(F2) m(F3) m(F4) m(F5) m(EQCheck) m(NEQCheck) m(NEQCheckSel)         \
+       m(NEQCheckRow) m(FScatter) m(FScatterSel) m(FScatterSelRow) m(FGather)  \
+           m(FGatherSel) m(FGatherVal) m(FAggr) m(FAggrSel) m(FAggrRow)        \
+               m(FAggrInit) m(FPartitionByKey) m(FPartitionByKeySel)           \
+                   m(FPartitionByKeyRow) m(FPack) m(FPackSel) m(FUnpack)
+#define SIGNATURE_ENUM(sig) sig,
+#define SIGNATURE_NAME(sig) #sig,
+enum class Signature { EACH_SIGNATURE(SIGNATURE_ENUM) };
+const char* signatureNames[] = {EACH_SIGNATURE(SIGNATURE_NAME)};
+using S = Signature;
+
+struct Primitive {
+   /// the variable holding the primitive, setHashFunction may redirect it
+   void** variable;
+   Signature signature;
+};
+
+#undef PRIMITIVE
+#define PRIMITIVE(sig, name)                                                   \
+   {#name, {reinterpret_cast<void**>(&primitives::name), Signature::sig}},
+/// all primitives by name. Referencing them also links the primitives which
+/// the executable does not call itself.
+const unordered_map<string, Primitive> registry = {
+#include "vectorwise/PrimitiveList.hpp"
+};
+#undef PRIMITIVE
+
+/// arguments of a line: w is a word, p a primitive, m a join and d a column,
+/// buffer or constant, with the signature of each primitive
+struct Pattern {
+   string args;
+   vector<Signature> primitives;
+};
+
+/// argument patterns of a line, one per number of tokens
+const unordered_map<string, vector<Pattern>> patterns = {
+    {"scan", {{"www", {}}}},
+    {"select", {{"w", {}}}},
+    {"project", {{"w", {}}}},
+    {"hashjoin", {{"wd", {}}, {"wdm", {}}}},
+    {"hashgroup", {{"w", {}}}},
+    {"result", {{"w", {}}}},
+    {"probesel", {{"wd", {}}, {"wdm", {}}}},
+    {"buildkey",
+     {{"wdpp", {S::F2, S::FScatter}}, {"wddpp", {S::F3, S::FScatterSel}}}},
+    {"probekey",
+     {{"wdpp", {S::F2, S::EQCheck}},
+      {"wddpp", {S::F3, S::EQCheck}},
+      {"wddpdp", {S::F3, S::EQCheck}}}},
+    {"buildvalue",
+     {{"wdpdp", {S::FScatter, S::FGather}},
+      {"wddpdp", {S::FScatterSel, S::FGather}}}},
+    {"keysel", {{"wdd", {}}}},
+    {"key",
+     {{"wdppppppppd",
+       {S::F2, S::NEQCheck, S::FPartitionByKey, S::FScatterSel,
+        S::NEQCheckRow, S::FPartitionByKeyRow, S::FScatterSelRow,
+        S::FGatherVal}},
+      {"wddpppdpppppd",
+       {S::F3, S::NEQCheckSel, S::FPartitionByKeySel, S::FScatterSel,
+        S::NEQCheckRow, S::FPartitionByKeyRow, S::FScatterSelRow,
+        S::FGatherVal}}}},
+    {"value",
+     {{"wdppppd", {S::FAggrInit, S::FAggr, S::FAggrRow, S::FGatherVal}},
+      {"wddppppd", {S::FAggrInit, S::FAggrSel, S::FAggrRow, S::FGatherVal}}}}};
+
+/// keywords of the body lines by statement, select and project have
+/// expressions and result has output names instead
+const unordered_map<string, vector<string>> bodyKeywords = {
+    {"scan", {}},
+    {"hashjoin", {"probesel", "buildkey", "probekey", "buildvalue"}},
+    {"hashgroup", {"keysel", "key", "value"}}};
+
+struct ConstantType {
+   size_t size;
+   void (*parse)(const string& literal, void* to);
+};
+
+template <typename T> void parseInteger(const string& literal, void* to) {
+   size_t end;
+   T value = stoll(literal, &end);
+   if (end != literal.size()) throw runtime_error("invalid integer " + literal);
+   memcpy(to, &value, sizeof(T));
+}
+
+template <typename T> void parseString(const string& literal, void* to) {
+   auto value = T::castString(literal);
+   memcpy(to, &value, sizeof(T));
+}
+
+#define STRING_CONSTANT(type, c)                                               \
+   {#type, {sizeof(primitives::type), parseString<primitives::type>}},
+
+const unordered_map<string, ConstantType> constantTypes = {
+    {"int8_t", {sizeof(int8_t), parseInteger<int8_t>}},
+    {"int16_t", {sizeof(int16_t), parseInteger<int16_t>}},
+    {"int32_t", {sizeof(int32_t), parseInteger<int32_t>}},
+    {"int64_t", {sizeof(int64_t), parseInteger<int64_t>}},
+    {"hash_t", {sizeof(primitives::hash_t), parseInteger<primitives::hash_t>}},
+    {"pos_t", {sizeof(pos_t), parseInteger<pos_t>}},
+    {"bitmap_t",
+     {sizeof(primitives::bitmap_t), parseInteger<primitives::bitmap_t>}},
+    {"Date", {sizeof(types::Date), parseString<types::Date>}},
+    {"Char_1", {sizeof(primitives::Char_1), parseString<primitives::Char_1>}},
+    EACH_STRING(STRING_CONSTANT, )};
+
+/// fixed point decimal with precision fractional digits, stored as int64_t
+int64_t parseNumeric(const string& literal, unsigned precision) {
+   int64_t value = 0;
+   int fraction = -1;
+   size_t i = literal.size() && literal[0] == '-';
+   if (i == literal.size()) throw runtime_error("invalid number " + literal);
+   for (; i < literal.size(); ++i) {
+      auto c = literal[i];
+      if (c == '.' && fraction < 0) {
+         fraction = 0;
+         continue;
+      }
+      if (!isdigit(c) || fraction == int(precision))
+         throw runtime_error("invalid number " + literal);
+      if (fraction >= 0) fraction++;
+      value = value * 10 + (c - '0');
+   }
+   for (fraction = max(fraction, 0); fraction < int(precision); ++fraction)
+      value *= 10;
+   return literal[0] == '-' ? -value : value;
+}
+
+/// size of the type, 0 if unknown. Numeric_<len>_<precision> is accepted for
+/// all lengths and precisions, returns the precision in that case.
+size_t typeSize(const string& type, int* precision = nullptr) {
+   auto t = constantTypes.find(type);
+   if (t != constantTypes.end()) return t->second.size;
+   unsigned len, p;
+   int end = 0;
+   if (sscanf(type.c_str(), "Numeric_%u_%u%n", &len, &p, &end) == 2 &&
+       size_t(end) == type.size() && p <= len && len <= 18) {
+      if (precision) *precision = p;
+      return sizeof(int64_t);
+   }
+   return 0;
+}
+
+const Primitive& primitive(const string& name) {
+   auto p = registry.find(name);
+   if (p == registry.end()) throw runtime_error("unknown primitive " + name);
+   return p->second;
+}
+
+/// fails unless the primitive name has the signature of its place in the plan
+void checkSignature(const string& name, Signature expected) {
+   auto found = primitive(name).signature;
+   if (found == expected) return;
+   if (found <= S::F5 && expected <= S::F5)
+      throw runtime_error(name + " takes " + to_string(int(found) + 1) +
+                          " arguments, not " + to_string(int(expected) + 1));
+   throw runtime_error(name + " is of type " + signatureNames[int(found)] +
+                       ", expected " + signatureNames[int(expected)]);
+}
+
+#define TYPE_NAME(type, c) #type,
+/// the types primitive names are instantiated for
+const vector<string> typeNames = {
+    EACH_TYPE(TYPE_NAME, ) EACH_STRING(TYPE_NAME, ) EACH_PACKED(TYPE_NAME, )};
+
+/// whether the primitive name takes or produces values of type, i.e. names it
+/// as <type>_col, <type>_val or ends with it
+bool takes(const string& name, const string& type) {
+   auto t = "_" + type;
+   for (size_t pos = name.find(t); pos != string::npos;
+        pos = name.find(t, pos + 1)) {
+      auto rest = name.substr(pos + t.size());
+      if (rest.empty() || rest.compare(0, 4, "_col") == 0 ||
+          rest.compare(0, 4, "_val") == 0)
+         return true;
+   }
+   return false;
+}
+
+/// the type which primitives use for values of a declared type, empty for
+/// selection vectors, hashes and types given by their size
+string valueType(const string& type) {
+   if (type.compare(0, 8, "Numeric_") == 0) return "int64_t";
+   if (type == "pos_t" || type == "hash_t" || type == "bitmap_t") return "";
+   if (find(typeNames.begin(), typeNames.end(), type) == typeNames.end())
+      return "";
+   return type;
+}
+
+/// the type which primitives use for values of a column
+string valueType(const algebra::Type& type) {
+   if (dynamic_cast<const algebra::Integer*>(&type)) return "int32_t";
+   if (dynamic_cast<const algebra::BigInt*>(&type) ||
+       dynamic_cast<const algebra::Numeric*>(&type))
+      return "int64_t";
+   if (dynamic_cast<const algebra::Date*>(&type)) return "Date";
+   if (auto c = dynamic_cast<const algebra::Char*>(&type))
+      return "Char_" + to_string(c->size);
+   if (auto v = dynamic_cast<const algebra::Varchar*>(&type))
+      return "Varchar_" + to_string(v->size);
+   return "";
+}
+
+vector<string> tokenize(const string& line) {
+   vector<string> tokens;
+   string token;
+   bool quoted = false, inToken = false;
+   for (auto c : line) {
+      if (c == '"') {
+         quoted = !quoted;
+         inToken = true;
+      } else if (!quoted && c == '#') {
+         break;
+      } else if (!quoted && isspace(c)) {
+         if (inToken) tokens.push_back(move(token));
+         token.clear();
+         inToken = false;
+      } else {
+         token += c;
+         inToken = true;
+      }
+   }
+   if (quoted) throw runtime_error("unterminated quote");
+   if (inToken) tokens.push_back(move(token));
+   return tokens;
+}
+
+struct Parser {
+   runtime::Database& db;
+   PlanDescription& plan;
+   /// relation by scan alias
+   unordered_map<string, string> scans;
+   /// number by buffer name
+   unordered_map<string, size_t> buffers;
+   /// value type by buffer name, see valueType
+   unordered_map<string, string> bufferTypes;
+
+   /// the argument token, its value type is stored in type
+   Arg data(const string& token, string& type) {
+      Arg a;
+      auto colon = token.find(':');
+      if (colon == string::npos)
+         throw runtime_error("expected column, buffer or constant, found " +
+                             token);
+      auto kind = token.substr(0, colon);
+      auto rest = token.substr(colon + 1);
+      if (kind == "col") {
+         a.kind = Arg::Column;
+         auto dot = rest.find('.');
+         a.name = rest.substr(0, dot);
+         if (dot == string::npos || !scans.count(a.name))
+            throw runtime_error("unknown scan in " + token);
+         a.attribute = rest.substr(dot + 1);
+         type = valueType(*db[scans[a.name]][a.attribute].type);
+      } else if (kind == "buf") {
+         a.kind = Arg::Buffer;
+         colon = rest.find(':');
+         a.name = rest.substr(0, colon);
+         if (colon != string::npos) {
+            auto size = rest.substr(colon + 1);
+            a.size = typeSize(size);
+            if (!a.size && !size.empty() && isdigit(size[0]))
+               a.size = stoull(size);
+            if (!a.size) throw runtime_error("invalid buffer size " + size);
+         }
+         auto known = buffers.find(a.name);
+         if (known == buffers.end()) {
+            if (!a.size)
+               throw runtime_error("first use of buffer " + a.name +
+                                   " needs its entry size");
+            known = buffers.emplace(a.name, buffers.size()).first;
+            bufferTypes[a.name] = valueType(rest.substr(colon + 1));
+         }
+         type = bufferTypes[a.name];
+         a.buffer = known->second;
+      } else {
+         a.kind = Arg::Constant;
+         int precision = -1;
+         auto size = typeSize(kind, &precision);
+         if (!size) throw runtime_error("unknown type " + kind);
+         type = valueType(kind);
+         plan.constants.emplace_back(new uint64_t[(size + 7) / 8]());
+         a.data = plan.constants.back().get();
+         if (precision >= 0) {
+            auto value = parseNumeric(rest, precision);
+            memcpy(a.data, &value, sizeof(value));
+         } else
+            constantTypes.at(kind).parse(rest, a.data);
+      }
+      return a;
+   }
+
+   Line line(size_t nr, const vector<string>& tokens, const Pattern& pattern) {
+      Line l;
+      l.nr = nr;
+      vector<string> types(tokens.size()), primitives;
+      for (size_t i = 0; i < tokens.size(); ++i) {
+         if (pattern.args[i] == 'd') {
+            l.args.push_back(data(tokens[i], types[i]));
+            continue;
+         }
+         Arg a;
+         a.kind = Arg::Word;
+         a.name = tokens[i];
+         if (pattern.args[i] == 'p') {
+            a.data = *primitive(a.name).variable;
+            checkSignature(a.name, pattern.primitives[primitives.size()]);
+            primitives.push_back(a.name);
+         }
+         if (pattern.args[i] == 'm' && !joins.count(a.name))
+            throw runtime_error("unknown join " + a.name);
+         l.args.push_back(move(a));
+      }
+      checkTypes(tokens, types, primitives);
+      return l;
+   }
+
+   /// fails if the primitives of a line name value types, but not the type of
+   /// one of its arguments. Primitives without types in their name, e.g.
+   /// aggr_count_star, take all arguments.
+   void checkTypes(const vector<string>& tokens, const vector<string>& types,
+                   const vector<string>& primitives) {
+      vector<string> named;
+      for (auto& p : primitives)
+         for (auto& type : typeNames)
+            if (takes(p, type)) named.push_back(type);
+      if (named.empty()) return;
+      for (size_t i = 0; i < tokens.size(); ++i)
+         if (!types[i].empty() &&
+             find(named.begin(), named.end(), types[i]) == named.end())
+            throw runtime_error(tokens[i] + " of type " + types[i] +
+                                " does not fit " + primitives[0]);
+   }
+
+   Line line(size_t nr, const vector<string>& tokens) {
+      auto p = patterns.find(tokens[0]);
+      if (p == patterns.end())
+         throw runtime_error("unknown keyword " + tokens[0]);
+      for (auto& pattern : p->second)
+         if (pattern.args.size() == tokens.size())
+            return line(nr, tokens, pattern);
+      throw runtime_error("wrong number of arguments for " + tokens[0]);
+   }
+
+   Line bodyLine(const string& op, size_t nr, const vector<string>& tokens) {
+      if (op == "select" || op == "project") {
+         if (tokens.size() < 2 || tokens.size() > 5)
+            throw runtime_error("primitives take 1 to 4 arguments");
+         auto arity = Signature(int(S::F1) + tokens.size() - 2);
+         Pattern expression{"p" + string(tokens.size() - 1, 'd'), {arity}};
+         return line(nr, tokens, expression);
+      }
+      if (op == "result") return line(nr, tokens, {"wd", {}});
+      auto& keywords = bodyKeywords.at(op);
+      if (find(keywords.begin(), keywords.end(), tokens[0]) == keywords.end())
+         throw runtime_error(tokens[0] + " is not allowed in " + op);
+      return line(nr, tokens);
+   }
+
+   /// checks that the operator finds its inputs on the operator stack
+   void checkInputs(const string& op, size_t& depth) {
+      if (op == "scan") {
+         depth++;
+         return;
+      }
+      size_t inputs = op == "hashjoin" ? 2 : 1;
+      if (depth < inputs)
+         throw runtime_error(op + " needs " + to_string(inputs) + " inputs");
+      depth -= inputs - 1;
+      if (op == "result" && depth != 1)
+         throw runtime_error("result needs all operators to be joined");
+   }
+
+   struct Text {
+      size_t nr;
+      size_t indent;
+      vector<string> tokens;
+   };
+
+   /// non empty lines, lines indented deeper than a body line continue it
+   vector<Text> read(istream& in, size_t& nr) {
+      vector<Text> lines;
+      string text;
+      while (getline(in, text)) {
+         nr++;
+         auto tokens = tokenize(text);
+         if (tokens.empty()) continue;
+         auto indent = text.find_first_not_of(" \t");
+         if (indent && !lines.empty() && lines.back().indent &&
+             indent > lines.back().indent)
+            lines.back().tokens.insert(lines.back().tokens.end(),
+                                       tokens.begin(), tokens.end());
+         else
+            lines.push_back({nr, indent, move(tokens)});
+      }
+      return lines;
+   }
+
+   void parse(istream& in) {
+      size_t nr = 0, depth = 0;
+      try {
+         for (auto& text : read(in, nr)) {
+            nr = text.nr;
+            auto& tokens = text.tokens;
+            auto& statements = plan.statements;
+            if (text.indent) {
+               if (statements.empty())
+                  throw runtime_error("indented line outside of a statement");
+               auto& s = statements.back();
+               s.body.push_back(bodyLine(s.head.args[0].name, nr, tokens));
+               continue;
+            }
+            if (!statements.empty()) {
+               auto& previous = statements.back().head;
+               if (previous.args[0].name == "result")
+                  throw runtime_error("result must be the last statement");
+               if (previous.args[0].name != "scan" &&
+                   statements.back().body.empty()) {
+                  nr = previous.nr;
+                  throw runtime_error(previous.args[0].name +
+                                      " needs a body");
+               }
+            }
+            if (!bodyKeywords.count(tokens[0]) && tokens[0] != "select" &&
+                tokens[0] != "project" && tokens[0] != "result")
+               throw runtime_error("unknown operator " + tokens[0]);
+            statements.push_back({line(nr, tokens), {}});
+            checkInputs(tokens[0], depth);
+            if (tokens[0] == "scan") {
+               if (!db.hasRelation(tokens[2]))
+                  throw runtime_error("unknown relation " + tokens[2]);
+               scans[tokens[1]] = tokens[2];
+            }
+         }
+         if (plan.statements.empty() ||
+             plan.statements.back().head.args[0].name != "result")
+            throw runtime_error("plan must end with a result");
+         if (plan.statements.back().body.empty()) {
+            nr = plan.statements.back().head.nr;
+            throw runtime_error("result needs a body");
+         }
+      } catch (exception& e) {
+         throw runtime_error("plan line " + to_string(nr) + ": " + e.what());
+      }
+   }
+};
+
+template <typename F> F fn(const Arg& a) { return reinterpret_cast<F>(a.data); }
+} // namespace
+
+PlanDescription PlanDescription::parse(istream& plan, runtime::Database& db) {
+   PlanDescription description;
+   Parser{db, description, {}, {}, {}}.parse(plan);
+   return description;
+}
+
+PlanDescription PlanDescription::parse(const string& plan,
+                                       runtime::Database& db) {
+   istringstream in(plan);
+   return parse(in, db);
+}
+
+PlanBuilder::PlanBuilder(runtime::Database& db, SharedStateManager& shared,
+                         const PlanDescription& p, size_t vectorSize)
+    : QueryBuilder(db, shared, vectorSize), plan(p) {}
+
+QueryBuilder::DS PlanBuilder::data(const Arg& arg) {
+   switch (arg.kind) {
+   case Arg::Column: return Column(scans.at(arg.name), arg.attribute);
+   case Arg::Buffer:
+      return arg.size ? Buffer(arg.buffer, arg.size) : Buffer(arg.buffer);
+   case Arg::Constant: return Value(arg.data);
+   default: throw runtime_error("not a data argument: " + arg.name);
+   }
+}
+
+unique_ptr<vectorwise::Expression>
+PlanBuilder::expression(const vector<Line>& ops) {
+   auto e = Expression();
+   for (auto& op : ops) {
+      auto& a = op.args;
+      switch (a.size()) {
+      case 2: e.addOp(fn<primitives::F1>(a[0]), data(a[1])); break;
+      case 3: e.addOp(fn<primitives::F2>(a[0]), data(a[1]), data(a[2])); break;
+      case 4:
+         e.addOp(fn<primitives::F3>(a[0]), data(a[1]), data(a[2]), data(a[3]));
+         break;
+      default:
+         e.addOp(fn<primitives::F4>(a[0]), data(a[1]), data(a[2]), data(a[3]),
+                 data(a[4]));
+      }
+   }
+   return e;
+}
+
+void PlanBuilder::hashJoin(const Statement& s) {
+   auto& h = s.head.args;
+   auto join = HashJoin(data(h[1]), h.size() > 2 ? joins.at(h[2].name)
+                                                 : &Hashjoin::joinAllParallel);
+   for (auto& l : s.body) {
+      auto& a = l.args;
+      auto& k = a[0].name;
+      if (k == "probesel")
+         join.setProbeSelVector(data(a[1]), a.size() > 2
+                                                ? joins.at(a[2].name)
+                                                : &Hashjoin::joinSelParallel);
+      else if (k == "buildkey" && a.size() == 4)
+         join.addBuildKey(data(a[1]), fn<primitives::F2>(a[2]),
+                          fn<primitives::FScatter>(a[3]));
+      else if (k == "buildkey")
+         join.addBuildKey(data(a[1]), data(a[2]), fn<primitives::F3>(a[3]),
+                          fn<primitives::FScatterSel>(a[4]));
+      else if (k == "probekey" && a.size() == 4)
+         join.addProbeKey(data(a[1]), fn<primitives::F2>(a[2]),
+                          fn<primitives::EQCheck>(a[3]));
+      else if (k == "probekey" && a.size() == 5)
+         join.addProbeKey(data(a[1]), data(a[2]), fn<primitives::F3>(a[3]),
+                          fn<primitives::EQCheck>(a[4]));
+      else if (k == "probekey")
+         join.addProbeKey(data(a[1]), data(a[2]), fn<primitives::F3>(a[3]),
+                          data(a[4]), fn<primitives::EQCheck>(a[5]));
+      else if (k == "buildvalue" && a.size() == 5)
+         join.addBuildValue(data(a[1]), fn<primitives::FScatter>(a[2]),
+                            data(a[3]), fn<primitives::FGather>(a[4]));
+      else
+         join.addBuildValue(data(a[1]), data(a[2]),
+                            fn<primitives::FScatterSel>(a[3]), data(a[4]),
+                            fn<primitives::FGather>(a[5]));
+   }
+}
+
+void PlanBuilder::hashGroup(const Statement& s) {
+   using namespace primitives;
+   auto group = HashGroup();
+   for (auto& l : s.body) {
+      auto& a = l.args;
+      auto& k = a[0].name;
+      if (k == "keysel")
+         group.pushKeySelVec(data(a[1]), data(a[2]));
+      else if (k == "key" && a.size() == 11)
+         group.addKey(data(a[1]), fn<F2>(a[2]), fn<NEQCheck>(a[3]),
+                      fn<FPartitionByKey>(a[4]), fn<FScatterSel>(a[5]),
+                      fn<NEQCheckRow>(a[6]), fn<FPartitionByKeyRow>(a[7]),
+                      fn<FScatterSelRow>(a[8]), fn<FGatherVal>(a[9]),
+                      data(a[10]));
+      else if (k == "key")
+         group.addKey(data(a[1]), data(a[2]), fn<F3>(a[3]),
+                      fn<NEQCheckSel>(a[4]), fn<FPartitionByKeySel>(a[5]),
+                      data(a[6]), fn<FScatterSel>(a[7]),
+                      fn<NEQCheckRow>(a[8]), fn<FPartitionByKeyRow>(a[9]),
+                      fn<FScatterSelRow>(a[10]), fn<FGatherVal>(a[11]),
+                      data(a[12]));
+      else if (k == "value" && a.size() == 7)
+         group.addValue(data(a[1]), fn<FAggrInit>(a[2]), fn<FAggr>(a[3]),
+                        fn<FAggrRow>(a[4]), fn<FGatherVal>(a[5]),
+                        data(a[6]));
+      else
+         group.addValue(data(a[1]), data(a[2]), fn<FAggrInit>(a[3]),
+                        fn<FAggrSel>(a[4]), fn<FAggrRow>(a[5]),
+                        fn<FGatherVal>(a[6]), data(a[7]));
+   }
+}
+
+unique_ptr<Operator> PlanBuilder::build() {
+   auto result = Result();
+   previous = result.resultWriter.shared.result->participate();
+   output = &result.resultWriter.shared;
+   for (auto& s : plan.statements) {
+      auto& h = s.head.args;
+      auto& op = h[0].name;
+      if (op == "scan")
+         scans.emplace(h[1].name, Scan(h[2].name));
+      else if (op == "select")
+         Select(expression(s.body));
+      else if (op == "project")
+         Project().addExpression(expression(s.body));
+      else if (op == "hashjoin")
+         hashJoin(s);
+      else if (op == "hashgroup")
+         hashGroup(s);
+      else {
+         for (auto& l : s.body)
+            result.addValue(l.args[0].name, data(l.args[1]));
+         result.finalize();
+      }
+   }
+   return popOperator();
+}
+
+unique_ptr<runtime::Query> runPlan(runtime::Database& db,
+                                   const PlanDescription& plan,
+                                   size_t nrThreads, size_t vectorSize) {
+   runtime::WorkerGroup workers(nrThreads);
+   SharedStateManager shared;
+   unique_ptr<runtime::Query> result;
+   workers.run([&]() {
+      PlanBuilder builder(db, shared, plan, vectorSize);
+      auto root = builder.build();
+      root->next();
+      auto leader = runtime::barrier();
+      if (leader) result = move(builder.output->result);
+   });
+   return result;
+}
+} // namespace vectorwise
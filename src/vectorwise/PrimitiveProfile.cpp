@@ -0,0 +1,186 @@
+#include "vectorwise/Operations.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <iomanip>
+#include <map>
+#include <linux/perf_event.h>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace vectorwise {
+
+bool primitiveProfiling = false;
+PrimitiveProfile primitiveProfile;
+
+namespace {
+using Counters = PrimitiveProfile::Counters;
+using Site = PrimitiveProfile::Site;
+
+void add(Counters& to, const Counters& c) {
+   to.calls += c.calls;
+   to.tuples += c.tuples;
+   to.cycles += c.cycles;
+   to.instructions += c.instructions;
+}
+
+struct ThreadProfile;
+
+/// counters of exited threads and the threads which still record
+struct Registry {
+   std::mutex m;
+   std::map<Site, Counters> exited;
+   std::vector<ThreadProfile*> threads;
+};
+
+Registry& registry() {
+   static Registry r;
+   return r;
+}
+
+struct ThreadProfile
+/// Counters of one thread, added to the registry when the thread exits
+{
+   std::map<Site, Counters> counters;
+   /// perf event counting retired instructions, -1 if unavailable
+   int instructions = -2;
+
+   ThreadProfile() {
+      auto& r = registry();
+      std::lock_guard<std::mutex> lock(r.m);
+      r.threads.push_back(this);
+   }
+   ~ThreadProfile() {
+      auto& r = registry();
+      std::lock_guard<std::mutex> lock(r.m);
+      for (auto& c : counters) add(r.exited[c.first], c.second);
+      r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+      if (instructions >= 0) close(instructions);
+   }
+
+   uint64_t readInstructions() {
+      if (instructions == -2) {
+         perf_event_attr pe;
+         memset(&pe, 0, sizeof(pe));
+         pe.type = PERF_TYPE_HARDWARE;
+         pe.size = sizeof(pe);
+         pe.config = PERF_COUNT_HW_INSTRUCTIONS;
+         pe.exclude_kernel = 1;
+         pe.exclude_hv = 1;
+         instructions = syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
+      }
+      uint64_t value = 0;
+      if (instructions >= 0 &&
+          read(instructions, &value, sizeof(value)) != sizeof(value))
+         value = 0;
+      return value;
+   }
+};
+
+ThreadProfile& local() {
+   static thread_local ThreadProfile profile;
+   return profile;
+}
+
+/// name of the primitive function, without namespace and parameters
+std::string primitiveName(const void* primitive) {
+   Dl_info info;
+   if (dladdr(primitive, &info) && info.dli_sname) {
+      int status;
+      std::unique_ptr<char, void (*)(void*)> demangled(
+          abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status),
+          std::free);
+      std::string name = status == 0 ? demangled.get() : info.dli_sname;
+      // cut the parameter list, which follows the template arguments
+      size_t depth = 0;
+      for (size_t i = 0; i < name.size(); ++i) {
+         if (name[i] == '<') depth++;
+         if (name[i] == '>') depth--;
+         if (name[i] == '(' && !depth && i) {
+            name.resize(i);
+            break;
+         }
+      }
+      // the return type precedes the name of template functions
+      auto space = name.rfind(' ', name.find('<'));
+      if (name.find('<') != std::string::npos && space != std::string::npos)
+         name = name.substr(space + 1);
+      std::string prefix = "vectorwise::primitives::";
+      if (name.compare(0, prefix.size(), prefix) == 0)
+         name = name.substr(prefix.size());
+      return name;
+   }
+   std::ostringstream address;
+   address << primitive;
+   return address.str();
+}
+} // namespace
+
+pos_t PrimitiveProfile::run(Op& op, pos_t n) {
+   auto primitive = op.primitive();
+   if (!primitive) return op.run(n);
+   auto& profile = local();
+   auto& c = profile.counters[Site{op.site, primitive}];
+   uint64_t instructions = 0;
+   if (countInstructions) instructions = profile.readInstructions();
+   auto start = cycleCounter();
+   auto found = op.run(n);
+   c.cycles += cycleCounter() - start;
+   if (countInstructions)
+      c.instructions += profile.readInstructions() - instructions;
+   c.calls++;
+   c.tuples += n;
+   return found;
+}
+
+std::map<Site, Counters> PrimitiveProfile::collect() {
+   auto& r = registry();
+   std::lock_guard<std::mutex> lock(r.m);
+   auto result = r.exited;
+   for (auto thread : r.threads)
+      for (auto& c : thread->counters) add(result[c.first], c.second);
+   return result;
+}
+
+void PrimitiveProfile::reset() {
+   auto& r = registry();
+   std::lock_guard<std::mutex> lock(r.m);
+   r.exited.clear();
+   for (auto thread : r.threads) thread->counters.clear();
+}
+
+void PrimitiveProfile::print(std::ostream& out) {
+   auto counters = collect();
+   std::vector<std::pair<Site, Counters>> sorted(counters.begin(),
+                                                 counters.end());
+   std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) {
+      return a.second.cycles > b.second.cycles;
+   });
+   uint64_t total = 0;
+   for (auto& p : sorted) total += p.second.cycles;
+   out << std::setw(14) << "cycles" << std::setw(8) << "share"
+       << std::setw(10) << "calls" << std::setw(14) << "tuples"
+       << std::setw(10) << "cyc/tup";
+   if (countInstructions) out << std::setw(10) << "ins/tup";
+   out << "  primitive #call site\n";
+   for (auto& p : sorted) {
+      auto& c = p.second;
+      auto tuples = std::max<uint64_t>(c.tuples, 1);
+      out << std::fixed << std::setprecision(2) << std::setw(14) << c.cycles
+          << std::setw(7) << 100.0 * c.cycles / std::max<uint64_t>(total, 1)
+          << "%"
+          << std::setw(10) << c.calls << std::setw(14) << c.tuples
+          << std::setw(10) << double(c.cycles) / tuples;
+      if (countInstructions)
+         out << std::setw(10) << double(c.instructions) / tuples;
+      out << "  " << primitiveName(p.first.primitive) << " #" << p.first.op
+          << "\n";
+   }
+   out.unsetf(std::ios_base::floatfield);
+}
+} // namespace vectorwise
@@ -28,7 +28,8 @@ QueryBuilder::ResultBuilder QueryBuilder::Result() {
 
 void QueryBuilder::ResultBuilder::finalize() {
    resultWriter.child = base.popOperator();
-   base.pushOperator(move(resultWriterOwning));
+   // never wrapped in Profiled, callers read the result through the root
+   base.operatorStack.push(move(resultWriterOwning));
 }
 
 QueryBuilder::ResultBuilder&
@@ -77,6 +78,20 @@ void QueryBuilder::Select(std::unique_ptr<class Expression>&& exp) {
    pushOperator(move(select));
 }
 
+const SelectionKind*
+QueryBuilder::AdaptiveSelect(std::unique_ptr<class Expression>&& exp,
+                             DS bitmap, DS sel, bool bitmapCondition) {
+   auto select = make_unique<class AdaptiveSelect>();
+   auto kind = &select->kind;
+   select->condition = move(exp);
+   select->bitmapCondition = bitmapCondition;
+   select->bitmap = reinterpret_cast<primitives::bitmap_t*>(bitmap.data);
+   select->selection = sel;
+   select->child = popOperator();
+   pushOperator(move(select));
+   return kind;
+}
+
 QueryBuilder::ProjectionBuilder QueryBuilder::Project() {
    auto project = make_unique<class Project>();
    auto p = project.get();
@@ -101,6 +116,7 @@ QueryBuilder::ProjectionBuilder& QueryBuilder::ProjectionBuilder::addExpression(
 QueryBuilder::ExpressionBuilder QueryBuilder::Expression() {
    QueryBuilder::ExpressionBuilder b;
    b.expression = make_unique<class Expression>();
+   b.base = this;
    return b;
 }
 
@@ -118,6 +134,12 @@ QueryBuilder::DS QueryBuilder::Buffer(size_t nr) {
    auto& buf = buffers[nr];
    r.dataSize = buf.first;
    r.data = buf.second;
+   // the buffer is read again, so fused ops must materialize it
+   auto fused = fusedIntermediates.find(buf.second);
+   if (fused != fusedIntermediates.end()) {
+      fused->second->materialize = true;
+      fusedIntermediates.erase(fused);
+   }
    return r;
 }
 
@@ -140,6 +162,8 @@ QueryBuilder::DS QueryBuilder::Value(void* data) {
 }
 
 void QueryBuilder::pushOperator(std::unique_ptr<Operator>&& op) {
+   if (analyze)
+      op = make_unique<Profiled>(move(op), *operatorState.stats, profiledNr++);
    operatorStack.push(move(op));
 }
 
@@ -172,6 +196,7 @@ QueryBuilder::ExpressionBuilder::addOp(primitives::F1 op, DS a) {
    auto f1 = make_unique<F1_Op>(a, op);
    a.registerDS(&f1->input);
    expression->ops.push_back(move(f1));
+   previous = {};
    return *this;
 }
 
@@ -181,6 +206,7 @@ QueryBuilder::ExpressionBuilder::addOp(primitives::F2 op, DS a, DS b) {
    a.registerDS(&f2->input);
    b.registerDS(&f2->param1);
    expression->ops.push_back(move(f2));
+   fuse((void*)op, {a, b});
    return *this;
 }
 
@@ -191,6 +217,7 @@ QueryBuilder::ExpressionBuilder::addOp(primitives::F3 op, DS a, DS b, DS c) {
    b.registerDS(&f3->param1);
    c.registerDS(&f3->param2);
    expression->ops.push_back(move(f3));
+   fuse((void*)op, {a, b, c});
    return *this;
 }
 QueryBuilder::ExpressionBuilder&
@@ -202,8 +229,122 @@ QueryBuilder::ExpressionBuilder::addOp(primitives::F4 op, DS a, DS b, DS c,
    c.registerDS(&f4->param1);
    d.registerDS(&f4->param2);
    expression->ops.push_back(move(f4));
+   fuse((void*)op, {a, b, c, d});
+   return *this;
+}
+QueryBuilder::ExpressionBuilder&
+QueryBuilder::ExpressionBuilder::addOp(primitives::FPack op, DS result,
+                                       DS input, size_t shift) {
+   auto pack = make_unique<FPackOp>(op, result, input, shift);
+   result.registerDS(&pack->get<0>());
+   input.registerDS(&pack->get<1>());
+   expression->ops.push_back(move(pack));
+   previous = {};
+   return *this;
+}
+
+QueryBuilder::ExpressionBuilder&
+QueryBuilder::ExpressionBuilder::addOp(primitives::FPackSel op, DS sel,
+                                       DS result, DS input, size_t shift) {
+   auto pack = make_unique<FPackSelOp>(op, sel, result, input, shift);
+   sel.registerDS(&pack->get<0>());
+   result.registerDS(&pack->get<1>());
+   input.registerDS(&pack->get<2>());
+   expression->ops.push_back(move(pack));
+   previous = {};
+   return *this;
+}
+
+QueryBuilder::ExpressionBuilder&
+QueryBuilder::ExpressionBuilder::addSelectionSwitch(
+    const SelectionKind* kind, std::unique_ptr<vectorwise::Expression> all,
+    std::unique_ptr<vectorwise::Expression> bitmap,
+    std::unique_ptr<vectorwise::Expression> list) {
+   expression->ops.push_back(make_unique<SelectionSwitch>(
+       kind, move(all), move(bitmap), move(list)));
+   previous = {};
    return *this;
 }
+
+bool fusePrimitives = true;
+
+void QueryBuilder::ExpressionBuilder::fuse(void* consumer,
+                                           std::vector<DS> args) {
+   auto producer = move(previous);
+   previous = {consumer, args};
+   if (!base || !fusePrimitives || !producer.primitive) return;
+   auto fused = primitives::fusedOf(producer.primitive, consumer);
+   auto& p = producer.args;
+   auto& c = args;
+   // only intermediates in buffers can be left unmaterialized
+   if (fused.shape == primitives::FusedShape::None ||
+       p[1].buf != DataStorage::BufferSpec::Buffer)
+      return;
+   // the fused primitive never writes the intermediate, so the consumer may
+   // only read it in slot and no other argument may refer to it
+   auto onlyIn = [&](size_t slot) {
+      if (c[slot].data != p[1].data) return false;
+      for (size_t i = 0; i < c.size(); ++i)
+         if (i != slot && c[i].data == p[1].data) return false;
+      for (size_t i = 0; i < p.size(); ++i)
+         if (i != 1 && p[i].data == p[1].data) return false;
+      return true;
+   };
+   unique_ptr<Op> op;
+   switch (fused.shape) {
+   case primitives::FusedShape::ProjSelValCol_ProjSelColCol: {
+      // producer (sel, tmp, val, col), consumer (sel, result, col, tmp)
+      if (p[0].data != c[0].data || !onlyIn(3)) return;
+      auto f5 = make_unique<F5_Op>((primitives::F5)fused.primitive, p[0], c[1],
+                                   c[2], p[2], p[3]);
+      p[0].registerDS(&f5->get<0>());
+      c[1].registerDS(&f5->get<1>());
+      c[2].registerDS(&f5->get<2>());
+      p[2].registerDS(&f5->get<3>());
+      p[3].registerDS(&f5->get<4>());
+      op = move(f5);
+      break;
+   }
+   case primitives::FusedShape::ProjSelColVal_ProjColCol: {
+      // producer (sel, tmp, col, val), consumer (result, col, tmp)
+      if (!onlyIn(2)) return;
+      auto f5 = make_unique<F5_Op>((primitives::F5)fused.primitive, p[0], c[0],
+                                   c[1], p[2], p[3]);
+      p[0].registerDS(&f5->get<0>());
+      c[0].registerDS(&f5->get<1>());
+      c[1].registerDS(&f5->get<2>());
+      p[2].registerDS(&f5->get<3>());
+      p[3].registerDS(&f5->get<4>());
+      op = move(f5);
+      break;
+   }
+   case primitives::FusedShape::ProjSelBothColCol_AggrStatic: {
+      // producer (sel, tmp, col, col), consumer (aggregator, tmp)
+      if (!onlyIn(1)) return;
+      auto f4 = make_unique<F4_Op>(p[0], c[0], p[2], p[3],
+                                   (primitives::F4)fused.primitive);
+      p[0].registerDS(&f4->inputSelectionV);
+      c[0].registerDS(&f4->outputSelectionV);
+      p[2].registerDS(&f4->param1);
+      p[3].registerDS(&f4->param2);
+      op = move(f4);
+      break;
+   }
+   case primitives::FusedShape::None: return;
+   }
+
+   auto& ops = expression->ops;
+   auto consumerOp = move(ops.back());
+   ops.pop_back();
+   auto producerOp = move(ops.back());
+   ops.pop_back();
+   auto fusedOp =
+       make_unique<FusedOp>(move(op), move(producerOp), move(consumerOp));
+   base->fusedIntermediates[p[1].data] = fusedOp.get();
+   ops.push_back(move(fusedOp));
+   previous = {};
+}
+
 QueryBuilder::ExpressionBuilder::
 operator std::unique_ptr<vectorwise::Expression>() {
    return move(expression);
@@ -216,6 +357,51 @@ operator std::unique_ptr<vectorwise::Aggregates>() {
    return r;
 }
 
+QueryBuilder::KeyPackBuilder QueryBuilder::PackKeys(DS packed) {
+   if (packed.dataSize != sizeof(primitives::packed64) &&
+       packed.dataSize != sizeof(primitives::packed128))
+      throw runtime_error("Packed keys must be 64 or 128 bits wide");
+   auto project = make_unique<class Project>();
+   auto p = project.get();
+   p->child = popOperator();
+   pushOperator(move(project));
+   return {*this, *p, packed, 0, {}};
+}
+
+size_t QueryBuilder::KeyPackBuilder::nextShift(size_t keySize) {
+   auto bits = keySize * 8;
+   auto shift = usedBits;
+   // keys must not straddle the two words of a 128 bit key
+   if (shift < 64 && shift + bits > 64) shift = 64;
+   if (shift + bits > packed.dataSize * 8)
+      throw runtime_error("Keys do not fit into packed key of " +
+                          to_string(packed.dataSize) + " bytes");
+   usedBits = shift + bits;
+   shifts.push_back(shift);
+   return shift;
+}
+
+size_t QueryBuilder::KeyPackBuilder::shift(size_t i) const {
+   return shifts.at(i);
+}
+
+QueryBuilder::KeyPackBuilder&
+QueryBuilder::KeyPackBuilder::addKey(DS col, primitives::FPack pack) {
+   auto s = nextShift(col.dataSize);
+   project.expressions.push_back(
+       base.Expression().addOp(pack, packed, col, s));
+   return *this;
+}
+
+QueryBuilder::KeyPackBuilder&
+QueryBuilder::KeyPackBuilder::addKey(DS col, DS sel,
+                                     primitives::FPackSel pack) {
+   auto s = nextShift(col.dataSize);
+   project.expressions.push_back(
+       base.Expression().addOp(pack, sel, packed, col, s));
+   return *this;
+}
+
 QueryBuilder::HashJoinBuilder::HashJoinBuilder(QueryBuilder& b) : base(b) {}
 QueryBuilder::HashJoinBuilder::~HashJoinBuilder() {
    join->ht_entry_size += padding(join->ht_entry_size, 8);
@@ -385,6 +571,10 @@ QueryBuilder::HashJoinBuilder& QueryBuilder::HashJoinBuilder::addBuildValue(
        &join->ht_entry_size, entryOffset);
    source.registerDS(&scatter_build->get<0>());
    join->buildScatter += move(scatter_build);
+   if (lateEntries) {
+      base.lateValues[target.data] = {lateEntries, entryOffset};
+      return *this;
+   }
    // gather
    auto gather_build = make_unique<GatherOpCol>(
        gather, (void**)join->buildMatches, entryOffset, target);
@@ -405,6 +595,10 @@ QueryBuilder::HashJoinBuilder& QueryBuilder::HashJoinBuilder::addBuildValue(
        &join->ht_entry_size, entryOffset);
    source.registerDS(&scatter_build->get<1>());
    join->buildScatter += move(scatter_build);
+   if (lateEntries) {
+      base.lateValues[target.data] = {lateEntries, entryOffset};
+      return *this;
+   }
    // gather
    auto gather_build = make_unique<GatherOpCol>(
        gather, (void**)join->buildMatches, entryOffset, target);
@@ -436,6 +630,183 @@ QueryBuilder::HashJoinBuilder::pushProbeSelVector(DS sel, DS target) {
    return *this;
 }
 
+QueryBuilder::HashJoinBuilder&
+QueryBuilder::HashJoinBuilder::setLateMaterialization(DS entries) {
+   if (join->keyEquality.ops.size() || join->buildGather.ops.size())
+      throw runtime_error("Late materialization was set when probe keys or "
+                          "build values were already present");
+   if (entries.dataSize != sizeof(runtime::Hashmap::EntryHeader*))
+      throw runtime_error("Late materialization needs a buffer of entries");
+   join->buildMatches =
+       reinterpret_cast<runtime::Hashmap::EntryHeader**>(entries.data);
+   lateEntries = reinterpret_cast<void**>(entries.data);
+   return *this;
+}
+
+QueryBuilder::FetchBuilder QueryBuilder::Fetch() { return Fetch(DS()); }
+
+QueryBuilder::FetchBuilder QueryBuilder::Fetch(DS sel) {
+   auto fetch = make_unique<vectorwise::Fetch>();
+   FetchBuilder b{*this, fetch.get(), sel};
+   fetch->child = popOperator();
+   pushOperator(move(fetch));
+   return b;
+}
+
+std::pair<void**, size_t> QueryBuilder::FetchBuilder::find(DS late) {
+   auto value = base.lateValues.find(late.data);
+   if (value == base.lateValues.end())
+      throw runtime_error("Fetch of a value which no hash join left in its "
+                          "entries");
+   return value->second;
+}
+
+QueryBuilder::FetchBuilder&
+QueryBuilder::FetchBuilder::addValue(DS late, primitives::FGather gather,
+                                     DS out) {
+   if (inputSel.buf != DS::None)
+      throw runtime_error("Fetch with selection needs a selective gather");
+   auto value = find(late);
+   fetch->gather += make_unique<GatherOpCol>(gather, value.first,
+                                             value.second, out);
+   return *this;
+}
+
+QueryBuilder::FetchBuilder&
+QueryBuilder::FetchBuilder::addValue(DS late, primitives::FGatherSel gather,
+                                     DS out) {
+   if (inputSel.buf == DS::None)
+      throw runtime_error("Selective gather in Fetch without selection");
+   auto value = find(late);
+   fetch->gather += make_unique<GatherSelOpCol>(gather, inputSel, value.first,
+                                                value.second, out);
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder QueryBuilder::MergeJoin(DS probeMatches) {
+   auto nr = nextOpNr();
+   auto& s = operatorState.get<vectorwise::MergeJoin::Shared>(nr);
+   auto join = make_unique<vectorwise::MergeJoin>(s);
+   MergeJoinBuilder b{*this, join.get()};
+   join->batchSize = vecs.getVecSize();
+   join->buildMatches = static_cast<uint8_t**>(vecs.get(sizeof(uint8_t*)));
+   join->probeMatches = probeMatches;
+   join->probeKeys = static_cast<int64_t*>(vecs.get(sizeof(int64_t)));
+   b.buildKeyBuffer = vecs.get(sizeof(int64_t));
+   join->right = popOperator();
+   join->left = popOperator();
+   pushOperator(move(join));
+   return b;
+}
+
+void QueryBuilder::MergeJoinBuilder::checkKey(
+    const vectorwise::Expression& keys, size_t width) {
+   if (keys.ops.size())
+      throw runtime_error("MergeJoin supports only one key, pack several keys "
+                          "into one first");
+   if (width > sizeof(int64_t))
+      throw runtime_error("MergeJoin keys must not be wider than 8 bytes");
+   if (keyWidth && keyWidth != width)
+      throw runtime_error("MergeJoin keys of build and probe side differ");
+   keyWidth = width;
+}
+
+QueryBuilder::MergeJoinBuilder& QueryBuilder::MergeJoinBuilder::addBuildKey(
+    DS col, primitives::FNormalizeSel normalize) {
+   checkKey(join->buildKey, normalize.width);
+   auto key = make_unique<F2_Op>(buildKeyBuffer, col, normalize.prefix);
+   col.registerDS(&key->param1);
+   join->buildKey.ops.push_back(move(key));
+   // keys are the first bytes of build rows
+   join->buildScatter += make_unique<FScatterOp>(
+       primitives::scatter_int64_t_col, buildKeyBuffer,
+       reinterpret_cast<void**>(&join->scatterStart), &join->rowSize, 0);
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder& QueryBuilder::MergeJoinBuilder::addBuildKey(
+    DS col, DS sel, primitives::FNormalizeSel normalize) {
+   checkKey(join->buildKey, normalize.width);
+   auto key =
+       make_unique<F3_Op>(sel, buildKeyBuffer, col, normalize.prefixSel);
+   sel.registerDS(&key->outputSelectionV);
+   col.registerDS(&key->param2);
+   join->buildKey.ops.push_back(move(key));
+   // prefixes are computed at the selected positions
+   join->buildScatter += make_unique<FScatterSelOp>(
+       primitives::scatter_sel_int64_t_col, sel, buildKeyBuffer,
+       reinterpret_cast<void**>(&join->scatterStart), &join->rowSize, 0);
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder& QueryBuilder::MergeJoinBuilder::addProbeKey(
+    DS col, primitives::FNormalizeSel normalize) {
+   if (probeHasSelection)
+      throw runtime_error("Probe key without selection vector was added, but "
+                          "join uses selection vector");
+   checkKey(join->probeKey, normalize.width);
+   auto key = make_unique<F2_Op>(join->probeKeys, col, normalize.prefix);
+   col.registerDS(&key->param1);
+   join->probeKey.ops.push_back(move(key));
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder& QueryBuilder::MergeJoinBuilder::addProbeKey(
+    DS col, DS sel, primitives::FNormalizeSel normalize) {
+   if (!probeHasSelection)
+      throw runtime_error("Probe key with selection vector was added, but "
+                          "join doesn't use selection vector");
+   checkKey(join->probeKey, normalize.width);
+   auto key =
+       make_unique<F3_Op>(sel, join->probeKeys, col, normalize.prefixSel);
+   sel.registerDS(&key->outputSelectionV);
+   col.registerDS(&key->param2);
+   join->probeKey.ops.push_back(move(key));
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder& QueryBuilder::MergeJoinBuilder::addBuildValue(
+    DS source, primitives::FScatter scatter, DS target,
+    primitives::FGather gather) {
+   auto rowOffset = join->rowSize;
+   join->rowSize += source.dataSize;
+
+   auto scatter_build = make_unique<FScatterOp>(
+       scatter, source, reinterpret_cast<void**>(&join->scatterStart),
+       &join->rowSize, rowOffset);
+   source.registerDS(&scatter_build->get<0>());
+   join->buildScatter += move(scatter_build);
+   join->buildGather.ops.push_back(make_unique<GatherOpCol>(
+       gather, (void**)join->buildMatches, rowOffset, target));
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder& QueryBuilder::MergeJoinBuilder::addBuildValue(
+    DS source, DS sel, primitives::FScatterSel scatter, DS target,
+    primitives::FGather gather) {
+   auto rowOffset = join->rowSize;
+   join->rowSize += source.dataSize;
+
+   auto scatter_build = make_unique<FScatterSelOp>(
+       scatter, sel, source, reinterpret_cast<void**>(&join->scatterStart),
+       &join->rowSize, rowOffset);
+   source.registerDS(&scatter_build->get<1>());
+   join->buildScatter += move(scatter_build);
+   join->buildGather.ops.push_back(make_unique<GatherOpCol>(
+       gather, (void**)join->buildMatches, rowOffset, target));
+   return *this;
+}
+
+QueryBuilder::MergeJoinBuilder&
+QueryBuilder::MergeJoinBuilder::setProbeSelVector(DS sel) {
+   if (join->probeKey.ops.size())
+      throw runtime_error("Probe selection vector was added when probe keys "
+                          "were already present");
+   join->probeSel = sel;
+   probeHasSelection = true;
+   return *this;
+}
+
 QueryBuilder::HashGroupBuilder::HashGroupBuilder(QueryBuilder& b) : base(b) {}
 
 QueryBuilder::HashGroupBuilder QueryBuilder::HashGroup() {
@@ -802,4 +1173,180 @@ QueryBuilder::HashGroupBuilder::padToAlign(size_t align) {
        padding(group->globalAggregation.ht_entry_size, align);
    return *this;
 }
+QueryBuilder::SortBuilder QueryBuilder::Sort() {
+   auto& s = operatorState.get<Sort::Shared>(nextOpNr());
+   auto sort = make_unique<class Sort>(s);
+   sort->vecSize = vecs.getVecSize();
+   SortBuilder b{*this, sort.get()};
+   sort->child = popOperator();
+   pushOperator(move(sort));
+   return b;
+}
+
+QueryBuilder::ExchangeBuilder
+QueryBuilder::Exchange(vectorwise::Exchange::Mode mode) {
+   auto& s = operatorState.get<vectorwise::Exchange::Shared>(nextOpNr());
+   auto exchange = make_unique<class Exchange>(s, mode, vecs.getVecSize());
+   ExchangeBuilder b{*this, exchange.get()};
+   exchange->child = popOperator();
+   pushOperator(move(exchange));
+   return b;
+}
+
+QueryBuilder::ExchangeBuilder& QueryBuilder::ExchangeBuilder::addValue(DS col,
+                                                                       DS out) {
+   if (col.dataSize != out.dataSize)
+      throw runtime_error("Exchange input and output sizes differ");
+   auto offset = exchange->batchSize;
+   exchange->columns.push_back({col.data, out.data, col.dataSize, offset});
+   col.registerDS(&exchange->columns.back().input);
+   exchange->batchSize += exchange->vecSize * col.dataSize;
+   return *this;
+}
+
+QueryBuilder::ExchangeBuilder&
+QueryBuilder::ExchangeBuilder::setInputSelection(DS sel) {
+   exchange->inputSelection = sel;
+   sel.registerDS(&exchange->inputSelection);
+   return *this;
+}
+
+QueryBuilder::ExchangeBuilder&
+QueryBuilder::ExchangeBuilder::setHashes(DS hashes) {
+   exchange->hashes = reinterpret_cast<defs::hash_t*>(hashes.data);
+   hashes.registerDS(reinterpret_cast<void**>(&exchange->hashes));
+   return *this;
+}
+
+size_t QueryBuilder::SortBuilder::addKeyBytes(size_t width) {
+   if (sort->rowSize != sort->keySize)
+      throw runtime_error("Sort keys must be added before values");
+   auto offset = sort->keySize;
+   sort->keySize += width;
+   sort->rowSize += width;
+   return offset;
+}
+
+void QueryBuilder::SortBuilder::addOutput(size_t offset, size_t size,
+                                          primitives::FGatherVal gather,
+                                          DS out) {
+   if (out.dataSize != size)
+      throw runtime_error("Sort output buffer has wrong element size");
+   auto gather_rows = make_unique<GatherOpVal>(
+       gather, reinterpret_cast<void**>(&sort->outputStart), offset,
+       &sort->rowSize, out);
+   sort->gatherRows.ops.push_back(move(gather_rows));
+}
+
+QueryBuilder::SortBuilder&
+QueryBuilder::SortBuilder::addKey(DS col, primitives::FNormalize normalize) {
+   auto offset = addKeyBytes(normalize.width);
+   auto normalize_op = make_unique<FScatterOp>(
+       normalize.op, col, reinterpret_cast<void**>(&sort->scatterStart),
+       &sort->rowSize, offset);
+   col.registerDS(&normalize_op->get<0>());
+   sort->materialize += move(normalize_op);
+   return *this;
+}
+
+QueryBuilder::SortBuilder&
+QueryBuilder::SortBuilder::addKey(DS col, DS sel,
+                                  primitives::FNormalizeSel normalize) {
+   auto offset = addKeyBytes(normalize.width);
+   auto normalize_op = make_unique<FScatterSelOp>(
+       normalize.op, sel, col, reinterpret_cast<void**>(&sort->scatterStart),
+       &sort->rowSize, offset);
+   sel.registerDS(&normalize_op->get<0>());
+   col.registerDS(&normalize_op->get<1>());
+   sort->materialize += move(normalize_op);
+   return *this;
+}
+
+QueryBuilder::SortBuilder& QueryBuilder::SortBuilder::addValue(
+    DS col, primitives::FScatter scatter, primitives::FGatherVal gather,
+    DS out) {
+   auto offset = sort->rowSize;
+   sort->rowSize += col.dataSize;
+   auto scatter_op = make_unique<FScatterOp>(
+       scatter, col, reinterpret_cast<void**>(&sort->scatterStart),
+       &sort->rowSize, offset);
+   col.registerDS(&scatter_op->get<0>());
+   sort->materialize += move(scatter_op);
+   addOutput(offset, col.dataSize, gather, out);
+   return *this;
+}
+
+QueryBuilder::SortBuilder& QueryBuilder::SortBuilder::addValue(
+    DS col, DS sel, primitives::FScatterSel scatter,
+    primitives::FGatherVal gather, DS out) {
+   auto offset = sort->rowSize;
+   sort->rowSize += col.dataSize;
+   auto scatter_op = make_unique<FScatterSelOp>(
+       scatter, sel, col, reinterpret_cast<void**>(&sort->scatterStart),
+       &sort->rowSize, offset);
+   sel.registerDS(&scatter_op->get<0>());
+   col.registerDS(&scatter_op->get<1>());
+   sort->materialize += move(scatter_op);
+   addOutput(offset, col.dataSize, gather, out);
+   return *this;
+}
+
+QueryBuilder::SortBuilder::~SortBuilder() {
+   // round up row size to next 8 aligned value
+   sort->rowSize += padding(sort->rowSize, 8);
+}
+QueryBuilder::TopNBuilder QueryBuilder::TopN(size_t limit) {
+   return TopN(limit, DS());
+}
+
+QueryBuilder::TopNBuilder QueryBuilder::TopN(size_t limit, DS sel) {
+   if (!limit) throw runtime_error("TopN needs a limit of at least one row");
+   auto& s = operatorState.get<TopN::Shared>(nextOpNr());
+   auto topN = make_unique<class TopN>(s, limit);
+   topN->vecSize = vecs.getVecSize();
+   topN->prefixes = static_cast<int64_t*>(vecs.get(sizeof(int64_t)));
+   topN->survivors = static_cast<pos_t*>(vecs.get(sizeof(pos_t)));
+   TopNBuilder b{*this, topN.get(), sel, {*this, topN.get()}};
+   topN->child = popOperator();
+   pushOperator(move(topN));
+   return b;
+}
+
+QueryBuilder::TopNBuilder&
+QueryBuilder::TopNBuilder::addKey(DS col,
+                                  primitives::FNormalizeSel normalize) {
+   if (!topN->keySize) {
+      // select tuples whose key prefix does not exceed the threshold
+      auto& selection = topN->thresholdSelection;
+      if (inputSel.buf == DS::None) {
+         auto prefix =
+             make_unique<F2_Op>(topN->prefixes, col, normalize.prefix);
+         col.registerDS(&prefix->param1);
+         selection.ops.push_back(move(prefix));
+         selection.ops.push_back(make_unique<F3_Op>(
+             topN->survivors, topN->prefixes, &topN->threshold,
+             primitives::sel_less_equal_int64_t_col_int64_t_val));
+      } else {
+         auto prefix = make_unique<F3_Op>(inputSel, topN->prefixes, col,
+                                          normalize.prefixSel);
+         inputSel.registerDS(&prefix->outputSelectionV);
+         col.registerDS(&prefix->param2);
+         selection.ops.push_back(move(prefix));
+         auto sel = make_unique<F4_Op>(
+             inputSel, topN->survivors, topN->prefixes, &topN->threshold,
+             primitives::selsel_less_equal_int64_t_col_int64_t_val);
+         inputSel.registerDS(&sel->inputSelectionV);
+         selection.ops.push_back(move(sel));
+      }
+   }
+   rows.addKey(col, base.Value(topN->survivors), normalize);
+   return *this;
+}
+
+QueryBuilder::TopNBuilder& QueryBuilder::TopNBuilder::addValue(
+    DS col, primitives::FScatterSel scatter, primitives::FGatherVal gather,
+    DS out) {
+   rows.addValue(col, base.Value(topN->survivors), scatter, gather, out);
+   return *this;
+}
 } // namespace vectorwise
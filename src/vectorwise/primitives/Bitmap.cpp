@@ -0,0 +1,61 @@
+#include "vectorwise/Primitives.hpp"
+#include <functional>
+
+using namespace types;
+using namespace std;
+
+namespace vectorwise {
+namespace primitives {
+
+#define MK_BITMAP_SEL_COLVAL(type, op)                                         \
+   F3 bitmap_sel_##op##_##type##_col_##type##_val =                            \
+       (F3)&bitmap_sel_col_val<type, op>;
+
+#define MK_BITMAP_SELSEL_COLVAL(type, op)                                      \
+   F4 bitmap_selsel_##op##_##type##_col_##type##_val =                         \
+       (F4)&bitmap_selsel_col_val<type, op>;
+
+#define MK_AGGR_STATIC_BITMAP_COL(type, op)                                    \
+   F3 aggr_static_bitmap_##op##_##type##_col =                                 \
+       (F3)&aggr_static_bitmap_col<type, op>;
+
+EACH_COMP(EACH_TYPE, MK_BITMAP_SEL_COLVAL)
+EACH_COMP(EACH_TYPE, MK_BITMAP_SELSEL_COLVAL) // with input bitmap
+EACH_ARITH(EACH_TYPE_FULL, MK_AGGR_STATIC_BITMAP_COL)
+
+pos_t bitmap_to_sel(pos_t n, pos_t* RES result, bitmap_t* RES bitmap) {
+   pos_t found = 0;
+#if defined(__AVX512F__)
+   static_assert(sizeof(pos_t) == 4,
+                 "This implementation only supports sizeof(pos_t) == 4");
+   const auto lanes =
+       _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+#endif
+   for (size_t w = 0, i = 0; i < n; ++w, i += 64) {
+      auto word = bitmap[w];
+#if defined(__AVX512F__)
+      // dense words are compressed 16 positions at a time
+      if (__builtin_popcountll(word) > 16) {
+         for (size_t j = 0; j < 64; j += 16) {
+            auto mask = __mmask16(word >> j);
+            _mm512_mask_compressstoreu_epi32(
+                result + found, mask,
+                _mm512_add_epi32(lanes, _mm512_set1_epi32(i + j)));
+            found += __builtin_popcount(mask);
+         }
+         continue;
+      }
+#endif
+      for (; word; word &= word - 1)
+         result[found++] = i + __builtin_ctzll(word);
+   }
+   return found;
+}
+
+void sel_to_bitmap(pos_t n, pos_t* RES sel, pos_t size, bitmap_t* RES result) {
+   memset(result, 0, bitmapWords(size) * sizeof(bitmap_t));
+   for (pos_t i = 0; i < n; ++i)
+      result[sel[i] / 64] |= bitmap_t(1) << (sel[i] % 64);
+}
+}
+}
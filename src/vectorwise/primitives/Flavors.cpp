@@ -0,0 +1,91 @@
+#include "vectorwise/Primitives.hpp"
+#include <unordered_map>
+#include <vector>
+
+using namespace types;
+using namespace std;
+
+namespace vectorwise {
+namespace primitives {
+
+template <typename F> using FlavorMap = unordered_map<F, vector<F>>;
+
+template <typename F> static void addFlavors(FlavorMap<F>& map, vector<F> group) {
+   for (auto f : group) map[f] = group;
+}
+
+struct Flavors {
+   FlavorMap<F2> f2;
+   FlavorMap<F3> f3;
+   FlavorMap<F4> f4;
+   Flavors();
+};
+
+#define MK_SEL_FLAVORS(type, op)                                               \
+   addFlavors(f3, {sel_##op##_##type##_col_##type##_col,                        \
+                   sel_##op##_##type##_col_##type##_col_bf});                   \
+   addFlavors(f3, {sel_##op##_##type##_col_##type##_val,                        \
+                   sel_##op##_##type##_col_##type##_val_bf});                   \
+   addFlavors(f4, {selsel_##op##_##type##_col_##type##_col,                     \
+                   selsel_##op##_##type##_col_##type##_col_bf});                \
+   addFlavors(f4, {selsel_##op##_##type##_col_##type##_val,                     \
+                   selsel_##op##_##type##_col_##type##_val_bf});
+
+#define MK_HASH_FLAVORS(type, simd)                                            \
+   addFlavors(f2, {hash_murmur_##type##_col, simd##_##type##_col});             \
+   addFlavors(f3, {hash_sel_murmur_##type##_col, simd##_sel_##type##_col});     \
+   addFlavors(f2, {rehash_murmur_##type##_col, re##simd##_##type##_col});       \
+   addFlavors(f3, {rehash_sel_murmur_##type##_col, re##simd##_sel_##type##_col});
+
+Flavors::Flavors() {
+   EACH_COMP(EACH_TYPE, MK_SEL_FLAVORS)
+
+#if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
+   // the SIMD hashes implement MurMur only
+   MK_HASH_FLAVORS(int32_t, hash4)
+#if HASH_SIZE != 32
+   MK_HASH_FLAVORS(int64_t, hash8)
+   addFlavors(f2, {hash_murmur_packed64_col, hash8_packed64_col});
+   addFlavors(f3, {hash_sel_murmur_packed64_col, hash8_sel_packed64_col});
+#endif
+
+   addFlavors(f3, {sel_less_int32_t_col_int32_t_val,
+                   sel_less_int32_t_col_int32_t_val_bf,
+                   sel_less_int32_t_col_int32_t_val_avx512});
+   addFlavors(f4, {selsel_greater_equal_int32_t_col_int32_t_val,
+                   selsel_greater_equal_int32_t_col_int32_t_val_bf,
+                   selsel_greater_equal_int32_t_col_int32_t_val_avx512});
+   addFlavors(f4, {selsel_greater_equal_int64_t_col_int64_t_val,
+                   selsel_greater_equal_int64_t_col_int64_t_val_bf,
+                   selsel_greater_equal_int64_t_col_int64_t_val_avx512});
+   addFlavors(f4, {selsel_less_int64_t_col_int64_t_val,
+                   selsel_less_int64_t_col_int64_t_val_bf,
+                   selsel_less_int64_t_col_int64_t_val_avx512});
+   addFlavors(f4, {selsel_less_equal_int64_t_col_int64_t_val,
+                   selsel_less_equal_int64_t_col_int64_t_val_bf,
+                   selsel_less_equal_int64_t_col_int64_t_val_avx512});
+
+   addFlavors(f4, {proj_sel_minus_int64_t_val_int64_t_col,
+                   proj_sel8_minus_int64_t_val_int64_t_col});
+   addFlavors(f4, {proj_sel_plus_int64_t_col_int64_t_val,
+                   proj_sel8_plus_int64_t_col_int64_t_val});
+#endif
+}
+
+static Flavors& flavors() {
+   // built on first use, after all primitive pointers are initialized
+   static Flavors instance;
+   return instance;
+}
+
+template <typename F> static vector<F> lookup(FlavorMap<F>& map, F op) {
+   auto it = map.find(op);
+   if (it == map.end()) return {op};
+   return it->second;
+}
+
+vector<F2> flavorsOf(F2 op) { return lookup(flavors().f2, op); }
+vector<F3> flavorsOf(F3 op) { return lookup(flavors().f3, op); }
+vector<F4> flavorsOf(F4 op) { return lookup(flavors().f4, op); }
+} // namespace primitives
+} // namespace vectorwise
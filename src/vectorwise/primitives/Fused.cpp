@@ -0,0 +1,72 @@
+#include "vectorwise/Primitives.hpp"
+#include <functional>
+#include <map>
+#include <utility>
+
+using namespace types;
+using namespace std;
+
+namespace vectorwise {
+namespace primitives {
+
+#define MK_PROJ_FUSED(type, outer, inner)                                      \
+   F5 proj_sel_##outer##_##inner##_##type##_col_##type##_val_##type##_col =    \
+       (F5)&proj_sel_col_val_sel_col<type, outer, inner>;                      \
+   F5 proj_##outer##_##inner##_##type##_col_sel_##type##_col_##type##_val =    \
+       (F5)&proj_col_sel_col_val<type, outer, inner>;
+#define MK_AGGR_STATIC_FUSED(type, outer, inner)                               \
+   F4 aggr_static_sel_##outer##_##inner##_##type##_col_##type##_col =          \
+       (F4)&aggr_static_sel_col_col<type, outer, inner>;
+
+EACH_TYPE_FULL(EACH_FUSED_ARITH, MK_PROJ_FUSED)
+EACH_TYPE_FULL(EACH_FUSED_ARITH, MK_AGGR_STATIC_FUSED)
+
+using FusionMap = map<pair<void*, void*>, Fused>;
+
+static void addFusion(FusionMap& map, F4 producer, void* consumer,
+                      FusedShape shape, void* fused) {
+   for (auto flavor : flavorsOf(producer))
+      map[{(void*)flavor, consumer}] = Fused{shape, fused};
+}
+
+// proj_sel_<op>_val_col only exists for non-commutative operators
+#define MK_FUSION_VALCOL(type, outer, inner)                                   \
+   addFusion(map, proj_sel_##inner##_##type##_val_##type##_col,               \
+             (void*)proj_##outer##_sel_##type##_col_##type##_col,              \
+             FusedShape::ProjSelValCol_ProjSelColCol,                          \
+             (void*)                                                           \
+                 proj_sel_##outer##_##inner##_##type##_col_##type##_val_##type##_col);
+#define MK_FUSION_VALCOL_minus(type, outer) MK_FUSION_VALCOL(type, outer, minus)
+#define MK_FUSION_VALCOL_plus(type, outer)
+#define MK_FUSION_VALCOL_multiplies(type, outer)
+
+#define MK_FUSION(type, outer, inner)                                          \
+   MK_FUSION_VALCOL_##inner(type, outer)                                       \
+   addFusion(map, proj_sel_##inner##_##type##_col_##type##_val,               \
+             (void*)proj_##outer##_##type##_col_##type##_col,                  \
+             FusedShape::ProjSelColVal_ProjColCol,                             \
+             (void*)                                                           \
+                 proj_##outer##_##inner##_##type##_col_sel_##type##_col_##type##_val); \
+   addFusion(map, proj_sel_both_##inner##_##type##_col_##type##_col,          \
+             (void*)aggr_static_##outer##_##type##_col,                        \
+             FusedShape::ProjSelBothColCol_AggrStatic,                         \
+             (void*)aggr_static_sel_##outer##_##inner##_##type##_col_##type##_col);
+
+static FusionMap& fusions() {
+   // built on first use, after all primitive pointers are initialized
+   static FusionMap map = [] {
+      FusionMap map;
+      EACH_TYPE_FULL(EACH_FUSED_ARITH, MK_FUSION)
+      return map;
+   }();
+   return map;
+}
+
+Fused fusedOf(void* producer, void* consumer) {
+   auto& map = fusions();
+   auto it = map.find({producer, consumer});
+   if (it == map.end()) return Fused();
+   return it->second;
+}
+} // namespace primitives
+} // namespace vectorwise
@@ -35,6 +35,64 @@ EACH_TYPE(NIL, MK_HASH)
 EACH_TYPE(NIL, MK_HASH_SEL)
 EACH_TYPE(NIL, MK_REHASH)
 EACH_TYPE(NIL, MK_REHASH_SEL)
+EACH_PACKED(NIL, MK_HASH)
+EACH_PACKED(NIL, MK_HASH_SEL)
+
+// hash primitives for each selectable hash function
+#define MK_HASH_FN(type, fn)                                                   \
+   F2 hash_##fn##_##type##_col = (F2)&hash<type, HASH_CLASS_##fn>;             \
+   F3 hash_sel_##fn##_##type##_col = (F3)&hash_sel<type, HASH_CLASS_##fn>;     \
+   F2 rehash_##fn##_##type##_col = (F2)&rehash<type, HASH_CLASS_##fn>;         \
+   F3 rehash_sel_##fn##_##type##_col = (F3)&rehash_sel<type, HASH_CLASS_##fn>;
+#define HASH_CLASS_murmur DEFAULT_HASH
+#define HASH_CLASS_crc32 runtime::CRC32Hash
+#define HASH_CLASS_xxh3 runtime::XXH3Hash
+#define HASH_CLASS_mulshift runtime::MultiplyShiftHash
+#define HASH_CLASS_clmulfold runtime::CLMulFoldHash
+
+EACH_HASH_FN(EACH_TYPE, MK_HASH_FN)
+EACH_HASH_FN(EACH_PACKED, MK_HASH_FN)
+
+#define SET_HASH_FN(type, fn)                                                  \
+   hash_##type##_col = hash_##fn##_##type##_col;                               \
+   hash_sel_##type##_col = hash_sel_##fn##_##type##_col;                       \
+   rehash_##type##_col = rehash_##fn##_##type##_col;                           \
+   rehash_sel_##type##_col = rehash_sel_##fn##_##type##_col;
+#define SET_HASH_FN_PACKED(type, fn)                                           \
+   hash_##type##_col = hash_##fn##_##type##_col;                               \
+   hash_sel_##type##_col = hash_sel_##fn##_##type##_col;
+
+runtime::HashFunction currentHashFunction = runtime::HashFunction::MurMur;
+
+void setHashFunction(runtime::HashFunction f) {
+   switch (f) {
+   case runtime::HashFunction::MurMur:
+      EACH_TYPE(SET_HASH_FN, murmur)
+      EACH_PACKED(SET_HASH_FN_PACKED, murmur)
+      break;
+   case runtime::HashFunction::CRC32:
+      EACH_TYPE(SET_HASH_FN, crc32)
+      EACH_PACKED(SET_HASH_FN_PACKED, crc32)
+      break;
+   case runtime::HashFunction::XXH3:
+      EACH_TYPE(SET_HASH_FN, xxh3)
+      EACH_PACKED(SET_HASH_FN_PACKED, xxh3)
+      break;
+   case runtime::HashFunction::MultiplyShift:
+      EACH_TYPE(SET_HASH_FN, mulshift)
+      EACH_PACKED(SET_HASH_FN_PACKED, mulshift)
+      break;
+   case runtime::HashFunction::CLMulFold:
+#if defined(__PCLMUL__)
+      EACH_TYPE(SET_HASH_FN, clmulfold)
+      EACH_PACKED(SET_HASH_FN_PACKED, clmulfold)
+      break;
+#else
+      throw runtime_error("clmulfold hash not supported on this platform");
+#endif
+   }
+   currentHashFunction = f;
+}
 
 // SIMD hashes
 #if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
@@ -46,9 +104,17 @@ static_assert(false, "On this platform only 32-bit hashes are supported.");
 #endif
 
 F2 hash8_int64_t_col = (F2)&hash8<int64_t, DEFAULT_HASH>;
-// F3 hash8_sel_int64_t_col = (F3)&hash8_sel<int64_t, DEFAULT_HASH>;
-// F2 rehash8_int64_t_col = (F2)&rehash8<int64_t, DEFAULT_HASH>;
-// F3 rehash8_sel_int64_t_col = (F3)&rehash8_sel<int64_t, DEFAULT_HASH>;
+F3 hash8_sel_int64_t_col = (F3)&hash8_sel<int64_t, DEFAULT_HASH>;
+F2 rehash8_int64_t_col = (F2)&rehash8<int64_t, DEFAULT_HASH>;
+F3 rehash8_sel_int64_t_col = (F3)&rehash8_sel<int64_t, DEFAULT_HASH>;
+F2 hash8_packed64_col = (F2)&hash8<packed64, DEFAULT_HASH>;
+F3 hash8_sel_packed64_col = (F3)&hash8_sel<packed64, DEFAULT_HASH>;
+F2 hash8_xxh3_int64_t_col = (F2)&hash8<int64_t, runtime::XXH3Hash>;
+F2 hash8_mulshift_int64_t_col = (F2)&hash8<int64_t, runtime::MultiplyShiftHash>;
+// needs a CPU with VPCLMULQDQ, see CLMulFoldHash::hasVectorCLMul()
+#if defined(__PCLMUL__) && defined(__AVX512DQ__)
+F2 hash8_clmulfold_int64_t_col = (F2)&hash8<int64_t, runtime::CLMulFoldHash>;
+#endif
 
 /*
  * This variant is a workaround for bad code generation of gcc. It is semantically equivalent
@@ -23,5 +23,14 @@ EACH_TYPE(NIL, MK_KEYS_EQUAL)
 EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL)
 EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_SEL)
 EACH_TYPE(NIL, MK_KEYS_NOT_EQUAL_ROW)
+EACH_PACKED(NIL, MK_KEYS_EQUAL)
+EACH_PACKED(NIL, MK_KEYS_NOT_EQUAL)
+EACH_PACKED(NIL, MK_KEYS_NOT_EQUAL_SEL)
+EACH_PACKED(NIL, MK_KEYS_NOT_EQUAL_ROW)
+
+#if defined(__AVX512F__) || defined(SIMDE_X86_AVX512F_NATIVE) || defined(SIMDE_ENABLE_NATIVE_ALIASES)
+EQCheck keys_equal8_int64_t_col = (EQCheck)&keys_equal8<int64_t>;
+EQCheck keys_equal8_packed64_col = (EQCheck)&keys_equal8<packed64>;
+#endif
 }
 }
@@ -0,0 +1,20 @@
+#include "vectorwise/Primitives.hpp"
+
+using namespace types;
+using namespace std;
+
+namespace vectorwise {
+namespace primitives {
+
+#define MK_LIKE(type)                                                          \
+   F3 sel_like_##type##_col_pattern_val = (F3)&sel_like_col_val<type, false>;  \
+   F3 sel_not_like_##type##_col_pattern_val =                                  \
+       (F3)&sel_like_col_val<type, true>;                                      \
+   F4 selsel_like_##type##_col_pattern_val =                                   \
+       (F4)&selsel_like_col_val<type, false>;                                  \
+   F4 selsel_not_like_##type##_col_pattern_val =                               \
+       (F4)&selsel_like_col_val<type, true>;
+
+EACH_STRING(NIL, MK_LIKE)
+}
+}
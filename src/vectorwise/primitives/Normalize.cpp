@@ -0,0 +1,28 @@
+#include "vectorwise/Operations.hpp"
+#include "vectorwise/Primitives.hpp"
+
+using namespace types;
+using namespace std;
+
+namespace vectorwise {
+namespace primitives {
+
+#define MK_NORMALIZE(type)                                                     \
+   FNormalize normalize_##type##_col = {                                       \
+       (FScatter)&normalize<type, false>, NormalizedKey<type>::width};         \
+   FNormalize normalize_desc_##type##_col = {                                  \
+       (FScatter)&normalize<type, true>, NormalizedKey<type>::width};
+#define MK_NORMALIZE_SEL(type)                                                 \
+   FNormalizeSel normalize_sel_##type##_col = {                                \
+       (FScatterSel)&normalize_sel<type, false>, NormalizedKey<type>::width,   \
+       (F2)&normalized_prefix<type, false>,                                    \
+       (F3)&normalized_prefix_sel<type, false>};                               \
+   FNormalizeSel normalize_sel_desc_##type##_col = {                           \
+       (FScatterSel)&normalize_sel<type, true>, NormalizedKey<type>::width,    \
+       (F2)&normalized_prefix<type, true>,                                     \
+       (F3)&normalized_prefix_sel<type, true>};
+
+EACH_SORT_KEY(NIL, MK_NORMALIZE)
+EACH_SORT_KEY(NIL, MK_NORMALIZE_SEL)
+}
+}
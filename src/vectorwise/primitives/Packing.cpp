@@ -0,0 +1,21 @@
+#include "vectorwise/Operations.hpp"
+#include "vectorwise/Primitives.hpp"
+
+using namespace types;
+using namespace std;
+
+namespace vectorwise {
+namespace primitives {
+
+#define MK_PACK(type, key)                                                     \
+   FPack pack_##type##_col_##key = (FPack)&pack<type, key>;
+#define MK_PACK_SEL(type, key)                                                 \
+   FPackSel pack_sel_##type##_col_##key = (FPackSel)&pack_sel<type, key>;
+#define MK_UNPACK(type, key)                                                   \
+   FUnpack unpack_##type##_col_##key = (FUnpack)&unpack<type, key>;
+
+EACH_PACKED_KEY(EACH_TYPE_PACKABLE, MK_PACK)
+EACH_PACKED_KEY(EACH_TYPE_PACKABLE, MK_PACK_SEL)
+EACH_PACKED_KEY(EACH_TYPE_PACKABLE, MK_UNPACK)
+}
+}
@@ -23,5 +23,8 @@ namespace primitives {
 EACH_TYPE(NIL, MK_PARTITION)
 EACH_TYPE(NIL, MK_PARTITION_SEL)
 EACH_TYPE(NIL, MK_PARTITION_ROW)
+EACH_PACKED(NIL, MK_PARTITION)
+EACH_PACKED(NIL, MK_PARTITION_SEL)
+EACH_PACKED(NIL, MK_PARTITION_ROW)
 }
 }
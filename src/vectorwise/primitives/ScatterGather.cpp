@@ -32,5 +32,11 @@ EACH_TYPE(NIL, MK_SCATTER_SEL_ROW)
 EACH_TYPE(NIL, MK_GATHER_COL)
 EACH_TYPE(NIL, MK_GATHER_SEL_COL)
 EACH_TYPE(NIL, MK_GATHER_VAL)
+
+EACH_PACKED(NIL, MK_SCATTER)
+EACH_PACKED(NIL, MK_SCATTER_SEL)
+EACH_PACKED(NIL, MK_SCATTER_SEL_ROW)
+EACH_PACKED(NIL, MK_GATHER_COL)
+EACH_PACKED(NIL, MK_GATHER_VAL)
 }
 }